@@ -0,0 +1,339 @@
+#include "BatchRenderer.h"
+
+#include "EncodePipeline.h"
+#include "ImageCompare.h"
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
+#include "WorkerPool.h"
+
+#include <vtkImageData.h>
+#include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <set>
+
+namespace {
+    // Рендерит кадр обоими бэкендами и печатает расхождение. Возвращает false, если оно вне допуска.
+    bool VerifyBackends(RenderContext& context, const RenderJob& job) {
+        std::string error;
+        if (!context.Prepare(job, error)) {
+            std::cerr << job.Output << ": " << error << std::endl;
+            return false;
+        }
+        const RenderBackend backend = context.GetBackend();
+        context.SetBackend(RenderBackend::Vtk);
+        vtkNew<vtkImageData> reference;
+        reference->DeepCopy(context.RenderFrame());
+        context.SetBackend(RenderBackend::Cpu);
+        vtkImageData* candidate = context.RenderFrame();
+        context.SetBackend(backend);
+
+        auto* a = vtkUnsignedCharArray::SafeDownCast(reference->GetPointData()->GetScalars());
+        auto* b = vtkUnsignedCharArray::SafeDownCast(candidate->GetPointData()->GetScalars());
+        if (a == nullptr || b == nullptr || a->GetNumberOfTuples() != b->GetNumberOfTuples()) {
+            std::cerr << job.Output << ": frames of different size" << std::endl;
+            return false;
+        }
+        const ImageDifference diff =
+            CompareImages(a->GetPointer(0), a->GetNumberOfComponents(), b->GetPointer(0), b->GetNumberOfComponents(),
+                          static_cast<std::size_t>(a->GetNumberOfTuples()));
+        std::cout << job.Output << ": vtk vs cpu mean " << diff.MeanAbsolute << ", max " << diff.MaxAbsolute
+                  << ", outliers " << 100.0 * diff.OutlierFraction << "%"
+                  << (diff.IsWithinTolerance() ? "" : "  OUT OF TOLERANCE") << std::endl;
+        return diff.IsWithinTolerance();
+    }
+
+    // Конвейер вывода процесса, если он включен; создается в том процессе, который рендерит,
+    // потому что его потоки не переживают fork. Набор данных пишется только через конвейер,
+    // поэтому с ним конвейер есть всегда, хотя бы с одним кодировщиком.
+    std::unique_ptr<EncodePipeline> MakeOutputPipeline(const BatchOptions& options, int worker) {
+        std::unique_ptr<RecordShardWriter> dataset;
+        if (!options.DatasetDirectory.empty()) {
+            char suffix[16];
+            std::snprintf(suffix, sizeof(suffix), "-%03d", worker);
+            dataset.reset(new RecordShardWriter(options.DatasetDirectory, options.DatasetPrefix + suffix,
+                                                options.DatasetShardBytes));
+        } else if (options.Encoders <= 0) {
+            return nullptr;
+        }
+        return std::unique_ptr<EncodePipeline>(new EncodePipeline(std::max(options.Encoders, 1), options.EncodeQueue,
+                                                                  options.EncodeQueue * 2, options.Encoding,
+                                                                  std::move(dataset)));
+    }
+
+    // Дожидается записи отложенного вывода и печатает статистику конвейера.
+    // Возвращает число заданий, вывод которых не записался.
+    std::size_t FinishOutput(EncodePipeline* pipeline, const std::string& prefix) {
+        if (pipeline == nullptr) {
+            return 0;
+        }
+        const std::size_t failed = pipeline->Finish();
+        std::cout << prefix;
+        pipeline->PrintStats(std::cout);
+        return failed;
+    }
+
+    bool RenderJobOutputs(RenderContext& context, const RenderJob& job, bool verify) {
+        if (verify && !VerifyBackends(context, job)) {
+            return false;
+        }
+        std::string error;
+        if (!context.Render(job, error)) {
+            std::cerr << job.Output << ": " << error << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // Задание, построенное до рендеринга (см. RenderRange): found == false — не построилось, причина в Error.
+    struct PendingJob {
+        bool Found = false;
+        RenderJob Job;
+        std::string Error;
+    };
+
+    void GetPendingJob(const JobSource& jobs, std::size_t index, PendingJob& pending) {
+        TRACE_SCOPE("job.get");
+        pending.Error.clear();
+        pending.Found = jobs.Get(index, pending.Job, pending.Error);
+    }
+
+    // pending — задание index, уже построенное RenderRange; nullptr — построить здесь.
+    bool RenderOne(RenderContext& context, EncodePipeline* output, const JobSource& jobs, std::size_t index,
+                   bool verify, const PendingJob* pending = nullptr) {
+        // Трассировка по SIGUSR1 пишется здесь, между заданиями, а не в обработчике сигнала.
+        Tracer::Instance().DumpIfRequested();
+        TRACE_SCOPE("job");
+        if (output != nullptr) {
+            output->BeginJob(jobs.First + index);
+        }
+        PendingJob built;
+        if (pending == nullptr) {
+            GetPendingJob(jobs, index, built);
+            pending = &built;
+        }
+        if (!pending->Found) {
+            std::cerr << "job " << index << ": " << pending->Error << std::endl;
+            if (output != nullptr) {
+                output->EndJob(false, std::string());
+            }
+            return false;
+        }
+        const bool ok = RenderJobOutputs(context, pending->Job, verify);
+        if (output != nullptr) {
+            std::string parameters;
+            EncodeRenderJobJson(pending->Job, parameters);
+            output->EndJob(ok, parameters);
+        }
+        return ok;
+    }
+
+    // Рендерит задания begin..end-1 и возвращает число неудавшихся. С group задания отрезка сначала
+    // строятся все и рендерятся по сценам (см. OrderJobsByScene): соседние задания одной сцены меняют
+    // только камеру, свет и форму страницы, а сетка и текстура остаются в GPU (см. RenderContext::Prepare).
+    // В памяти при этом только задания отрезка.
+    long RenderRange(RenderContext& context, EncodePipeline* output, const JobSource& jobs, std::size_t begin,
+                     std::size_t end, bool group, bool verify) {
+        long failed = 0;
+        if (!group || end - begin < 2) {
+            for (std::size_t index = begin; index < end; ++index) {
+                if (!RenderOne(context, output, jobs, index, verify)) {
+                    ++failed;
+                }
+            }
+            return failed;
+        }
+        std::vector<PendingJob> window(end - begin);
+        std::vector<const RenderJob*> built(window.size());
+        for (std::size_t i = 0; i < window.size(); ++i) {
+            GetPendingJob(jobs, begin + i, window[i]);
+            built[i] = window[i].Found ? &window[i].Job : nullptr;
+        }
+        std::vector<std::size_t> order;
+        OrderJobsByScene(built, order);
+        for (std::size_t i : order) {
+            if (!RenderOne(context, output, jobs, begin + i, verify, &window[i])) {
+                ++failed;
+            }
+        }
+        return failed;
+    }
+
+    // Пишет трассировку процесса в его файл; ошибка записи не влияет на итог пакета.
+    bool DumpTrace() {
+        std::string error;
+        if (!Tracer::Instance().Dump(error)) {
+            std::cerr << error << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+JobSource JobsFromList(const std::vector<RenderJob>& jobs) {
+    JobSource source;
+    source.Count = jobs.size();
+    source.Get = [&jobs](std::size_t index, RenderJob& job, std::string&) {
+        job = jobs[index];
+        return true;
+    };
+    std::set<std::string> meshes;
+    for (const RenderJob& job : jobs) {
+        if (job.Mesh != "plane" && meshes.insert(job.Mesh).second) {
+            source.Meshes.push_back(job.Mesh);
+        }
+    }
+    return source;
+}
+
+JobSource SliceJobs(const JobSource& jobs, std::size_t first, std::size_t count) {
+    JobSource slice;
+    slice.Count = count;
+    slice.Get = [get = jobs.Get, first](std::size_t index, RenderJob& job, std::string& error) {
+        return get(first + index, job, error);
+    };
+    slice.Meshes = jobs.Meshes;
+    slice.First = jobs.First + first;
+    return slice;
+}
+
+void ConfigureContext(RenderContext& context, const BatchOptions& options) {
+    context.SetUVMapEncoding(options.UVEncoding);
+    context.SetForwardMapSize(options.ForwardMapWidth, options.ForwardMapHeight);
+    context.SetImageEncoding(options.Encoding);
+    context.SetCapture(options.Capture);
+}
+
+void MergeTraces(const BatchOptions& options) {
+    std::vector<std::string> parts = {options.TracePath + ".main"};
+    for (int worker = 0; worker < options.Workers; ++worker) {
+        parts.push_back(options.TracePath + ".w" + std::to_string(worker));
+    }
+    std::string error;
+    if (Tracer::Merge(parts, options.TracePath, error)) {
+        std::cout << "trace written to " << options.TracePath << std::endl;
+    } else {
+        std::cerr << error << std::endl;
+    }
+    for (const std::string& part : parts) {
+        std::remove(part.c_str());
+    }
+}
+
+int RunBatch(const JobSource& jobs, const BatchOptions& options) {
+    const auto start = std::chrono::steady_clock::now();
+    TextureCache::Instance().SetCapacity(options.TextureCacheBytes);
+    MeshCache::Instance().SetDirectory(options.MeshCacheDirectory);
+    if (!options.TracePath.empty()) {
+        // У рабочих свои файлы: родитель пишет в .main, а по завершении пакета собирает их в TracePath.
+        Tracer::Instance().Enable(options.Workers <= 1 ? options.TracePath : options.TracePath + ".main");
+        TRACE_THREAD_NAME("render");
+    }
+
+    // Отрезок, который рендерится одним процессом и переставляется по сценам. Рабочие берут его из очереди
+    // целиком; чтобы работы хватало всем, он не длиннее четверти доли одного рабочего.
+    std::size_t window = std::max<std::size_t>(1, options.GroupWindow);
+    if (options.Workers > 1) {
+        const std::size_t share = jobs.Count / (static_cast<std::size_t>(options.Workers) * 4);
+        window = std::max<std::size_t>(1, std::min(window, share));
+    }
+    const bool group = window > 1;
+
+    if (options.Workers <= 1) {
+        RenderContext context(options.Width, options.Height, options.Backend);
+        ConfigureContext(context, options);
+        const std::unique_ptr<EncodePipeline> output = MakeOutputPipeline(options, 0);
+        context.SetOutputPipeline(output.get());
+        std::size_t failed = 0;
+        for (std::size_t begin = 0; begin < jobs.Count; begin += window) {
+            const std::size_t end = std::min(jobs.Count, begin + window);
+            failed += static_cast<std::size_t>(RenderRange(context, output.get(), jobs, begin, end, group,
+                                                           options.Verify));
+        }
+        // Задание могло не удаться и при рендеринге, и при записи уже отданного кадра, поэтому сумма
+        // ограничена числом заданий.
+        failed = std::min(jobs.Count, failed + FinishOutput(output.get(), std::string()));
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const std::size_t rendered = jobs.Count - failed;
+        std::cout << "rendered " << rendered << " of " << jobs.Count << " images in " << seconds << " s";
+        if (seconds > 0.0) {
+            std::cout << " (" << rendered / seconds << " images/s)";
+        }
+        std::cout << std::endl;
+        std::cout << TextureCache::Instance().GetStats() << std::endl;
+        if (Tracer::Instance().IsEnabled() && DumpTrace()) {
+            std::cout << "trace written to " << options.TracePath << std::endl;
+        }
+        return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Недостающие .dmesh готовятся заранее в родителе, чтобы рабочие не разбирали один и тот же OBJ
+    // одновременно, а только отображали готовый файл (страницы кэша ОС при этом общие).
+    // Пул потоков здесь свой и завершается до fork: общий пул процесса должен появиться уже в рабочих.
+    if (!options.MeshCacheDirectory.empty()) {
+        ThreadPool pool(0);
+        for (const std::string& mesh : jobs.Meshes) {
+            std::string error;
+            if (!MeshCache::Instance().Acquire(mesh, error, &pool)) {
+                std::cerr << error << std::endl;
+            }
+        }
+    }
+
+    // Контекст создается лениво уже внутри рабочего процесса: после fork у каждого
+    // рабочего своя копия указателя, а значит и свое окно, маппер, актор и рендерер.
+    // Так же лениво создается и конвейер вывода: его потоки должны появиться уже после fork.
+    std::unique_ptr<RenderContext> context;
+    std::unique_ptr<EncodePipeline> output;
+    const auto renderBatch = [&](int worker, std::size_t begin, std::size_t end) {
+        if (!context) {
+            if (Tracer::Instance().IsEnabled()) {
+                Tracer::Instance().AfterFork(options.TracePath + ".w" + std::to_string(worker));
+            }
+            context.reset(new RenderContext(options.Width, options.Height, options.Backend));
+            ConfigureContext(*context, options);
+            output = MakeOutputPipeline(options, worker);
+            context->SetOutputPipeline(output.get());
+        }
+        return RenderRange(*context, output.get(), jobs, begin, end, group, options.Verify);
+    };
+    const auto finishWorker = [&](int worker) {
+        const std::string prefix = "worker " + std::to_string(worker) + " ";
+        const std::size_t failed = FinishOutput(output.get(), prefix);
+        std::cout << prefix << TextureCache::Instance().GetStats() << std::endl;
+        if (Tracer::Instance().IsEnabled()) {
+            DumpTrace();
+        }
+        return static_cast<long>(failed);
+    };
+    const std::vector<WorkerReport> reports = RunWorkerPool(options.Workers, jobs.Count, window, renderBatch,
+                                                            finishWorker);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    PrintWorkerReport(std::cout, reports, seconds);
+    if (Tracer::Instance().IsEnabled()) {
+        DumpTrace();
+        MergeTraces(options);
+    }
+
+    long done = 0;
+    bool ok = !reports.empty();
+    for (const WorkerReport& report : reports) {
+        done += report.Jobs;
+        ok = ok && report.Failed == 0 && !report.Crashed;
+    }
+    if (done != static_cast<long>(jobs.Count)) {
+        std::cerr << jobs.Count - done << " jobs were lost by crashed workers" << std::endl;
+        ok = false;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
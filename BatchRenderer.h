@@ -0,0 +1,73 @@
+#ifndef BATCH_RENDERER_H
+#define BATCH_RENDERER_H
+
+#include "RenderContext.h"
+#include "RenderJob.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Параметры пакетного режима, заданные в командной строке.
+struct BatchOptions {
+    int Width = 1920;
+    int Height = 1080;
+    int Workers = 1; // число рабочих процессов, каждый со своим внеэкранным контекстом
+    RenderBackend Backend = RenderBackend::Vtk;
+    bool Verify = false; // рендерить каждый кадр обоими бэкендами и сравнивать с допуском ImageDifference
+    std::size_t TextureCacheBytes = std::size_t(1) << 30; // емкость кэша текстур каждого процесса
+    std::string MeshCacheDirectory; // каталог .dmesh-копий OBJ; пусто — OBJ читаются каждый раз
+    UVMapEncoding UVEncoding = UVMapEncoding::Float32; // кодировка карт uvmap= в заданиях
+    int ForwardMapWidth = 0; // размер карт forwardmap= в заданиях; 0 — размер текстуры
+    int ForwardMapHeight = 0;
+    // Суперсэмплинг и съемка по частям кадров больше окна (см. CaptureSettings); по умолчанию кадр рисуется
+    // целиком, если помещается в участок.
+    CaptureSettings Capture;
+    ImageEncoding Encoding; // уровень и фильтр PNG, качество JPEG, альфа-канал; формат — по расширению вывода
+    // Потоки кодирования кадров в каждом процессе (см. EncodePipeline); 0 — кодировать и писать в потоке рендеринга.
+    int Encoders = 2;
+    std::size_t EncodeQueue = 4; // кадров в очереди кодирования; очередь записи вдвое длиннее
+    // Каталог набора данных: все выводы задания и его параметры пишутся одной записью в шарды .rec
+    // (см. RecordShard.h) вместо отдельных файлов. Пусто — писать файлы по путям из заданий.
+    std::string DatasetDirectory;
+    std::uint64_t DatasetShardBytes = std::uint64_t(1) << 30;
+    std::string DatasetPrefix = "part"; // шарды процесса: <prefix>-<номер рабочего>-NNNNN.rec
+    // Окно группировки: процесс берет столько заданий подряд и рендерит их так, чтобы задания с одной сеткой
+    // и текстурой шли друг за другом (см. OrderJobsByScene). 0 или 1 — порядок списка.
+    std::size_t GroupWindow = 64;
+    // Файл трассировки стадий в формате Chrome trace-event (см. Tracer.h); пусто — не трассировать.
+    std::string TracePath;
+};
+
+// Задания пакета по номерам из [0, Count). Задание создается только тогда, когда его берет рендерер,
+// поэтому пакет может быть сколь угодно большим (см. ParameterSweep), а рабочие процессы после fork
+// получают задания по номеру без передачи данных.
+struct JobSource {
+    std::size_t Count = 0;
+    std::function<bool(std::size_t index, RenderJob& job, std::string& error)> Get;
+    std::vector<std::string> Meshes; // сетки, которые стоит подготовить в кэше до запуска рабочих
+    std::size_t First = 0; // номер задания 0 в исходном пакете (для SliceJobs); ключ записей набора данных
+};
+
+// Источник поверх готового списка; список должен жить, пока используется источник.
+JobSource JobsFromList(const std::vector<RenderJob>& jobs);
+
+// Часть источника: задания first, first + 1, ... first + count - 1 под номерами 0 .. count - 1.
+JobSource SliceJobs(const JobSource& jobs, std::size_t first, std::size_t count);
+
+// Настраивает контекст размера options.Width x options.Height под остальные параметры пакета,
+// кроме конвейера вывода.
+void ConfigureContext(RenderContext& context, const BatchOptions& options);
+
+// Собирает файлы трассировки родителя (TracePath.main) и рабочих (TracePath.wN) в options.TracePath
+// и удаляет их.
+void MergeTraces(const BatchOptions& options);
+
+// Рендерит все задания через внеэкранные RenderContext: при Workers == 1 — в текущем процессе,
+// иначе в пуле рабочих процессов с общей очередью заданий.
+// Возвращает EXIT_SUCCESS, если все кадры сохранены.
+int RunBatch(const JobSource& jobs, const BatchOptions& options);
+
+#endif // BATCH_RENDERER_H
@@ -0,0 +1,111 @@
+#ifndef BOUNDED_QUEUE_H
+#define BOUNDED_QUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// Статистика очереди за все время ее жизни.
+struct BoundedQueueStats {
+    std::size_t Capacity = 0;
+    std::size_t MaxDepth = 0;
+    double MeanDepth = 0.0; // глубина сразу после Push, усредненная по всем Push
+    long Pushes = 0;
+    double PushStallSeconds = 0.0; // сколько производители ждали места: противодавление следующей стадии
+    double PopWaitSeconds = 0.0;   // сколько потребители ждали элементов: простой следующей стадии
+};
+
+// Очередь фиксированной емкости между стадиями конвейера: Push ждет, пока освободится место, Pop — пока
+// появится элемент. Емкость ограничивает число элементов между стадиями, а значит и память, которую
+// быстрая стадия может накопить перед медленной.
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(std::size_t capacity) : Capacity(capacity > 0 ? capacity : 1) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Возвращает false, если очередь уже закрыта: элемент не принят.
+    bool Push(T item) {
+        std::unique_lock<std::mutex> lock(this->Mutex);
+        if (this->Items.size() >= this->Capacity && !this->Closed) {
+            const Clock::time_point start = Clock::now();
+            this->NotFull.wait(lock, [&] { return this->Items.size() < this->Capacity || this->Closed; });
+            this->PushStallSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        if (this->Closed) {
+            return false;
+        }
+        this->Items.push_back(std::move(item));
+        ++this->Pushes;
+        this->DepthSum += this->Items.size();
+        if (this->Items.size() > this->MaxDepth) {
+            this->MaxDepth = this->Items.size();
+        }
+        lock.unlock();
+        this->NotEmpty.notify_one();
+        return true;
+    }
+
+    // Ждет элемент. Возвращает false, когда очередь закрыта и все элементы из нее уже забраны.
+    bool Pop(T& item) {
+        std::unique_lock<std::mutex> lock(this->Mutex);
+        if (this->Items.empty() && !this->Closed) {
+            const Clock::time_point start = Clock::now();
+            this->NotEmpty.wait(lock, [&] { return !this->Items.empty() || this->Closed; });
+            this->PopWaitSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        }
+        if (this->Items.empty()) {
+            return false;
+        }
+        item = std::move(this->Items.front());
+        this->Items.pop_front();
+        lock.unlock();
+        this->NotFull.notify_one();
+        return true;
+    }
+
+    // Новых элементов не будет: Pop отдает оставшиеся и затем возвращает false.
+    void Close() {
+        {
+            std::lock_guard<std::mutex> lock(this->Mutex);
+            this->Closed = true;
+        }
+        this->NotEmpty.notify_all();
+        this->NotFull.notify_all();
+    }
+
+    BoundedQueueStats GetStats() const {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        BoundedQueueStats stats;
+        stats.Capacity = this->Capacity;
+        stats.MaxDepth = this->MaxDepth;
+        stats.MeanDepth = this->Pushes > 0 ? static_cast<double>(this->DepthSum) / this->Pushes : 0.0;
+        stats.Pushes = this->Pushes;
+        stats.PushStallSeconds = this->PushStallSeconds;
+        stats.PopWaitSeconds = this->PopWaitSeconds;
+        return stats;
+    }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    const std::size_t Capacity;
+    mutable std::mutex Mutex;
+    std::condition_variable NotEmpty;
+    std::condition_variable NotFull;
+    std::deque<T> Items;
+    bool Closed = false;
+
+    std::size_t MaxDepth = 0;
+    unsigned long long DepthSum = 0;
+    long Pushes = 0;
+    double PushStallSeconds = 0.0;
+    double PopWaitSeconds = 0.0;
+};
+
+#endif // BOUNDED_QUEUE_H
@@ -0,0 +1,282 @@
+#include "BoxAnnotator.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace {
+    const char BoxFileMagic[8] = {'D', 'O', 'C', 'B', 'O', 'X', 'E', 'S'};
+    const std::uint32_t BoxFileVersion = 1;
+    const std::uint32_t NoTriangle = 0xFFFFFFFFu;
+    // Допуск барицентрического теста: точка на общем ребре или на краю развертки не должна потеряться.
+    const float BarycentricEpsilon = 1e-5f;
+
+    // Решетка ячеек над квадратом UV [0, 1]^2 со списками треугольников, задевающих каждую ячейку.
+    struct UVGrid {
+        int Size = 1;
+        std::vector<std::uint32_t> Offsets;
+        std::vector<std::uint32_t> Triangles;
+
+        int Cell(float value) const {
+            return std::min(this->Size - 1, std::max(0, static_cast<int>(value * this->Size)));
+        }
+
+        void Build(const MeshView& mesh) {
+            this->Size = std::max(1, std::min(1024, static_cast<int>(std::sqrt(mesh.TriangleCount / 2.0))));
+            const std::size_t cells = static_cast<std::size_t>(this->Size) * this->Size;
+            this->Offsets.assign(cells + 1, 0);
+            // Два прохода: подсчет треугольников в ячейках, затем раскладка по префиксным суммам.
+            for (int pass = 0; pass < 2; ++pass) {
+                for (std::size_t t = 0; t < mesh.TriangleCount; ++t) {
+                    const std::uint32_t* index = mesh.Indices + 3 * t;
+                    const float minU = std::min({mesh.U[index[0]], mesh.U[index[1]], mesh.U[index[2]]});
+                    const float maxU = std::max({mesh.U[index[0]], mesh.U[index[1]], mesh.U[index[2]]});
+                    const float minV = std::min({mesh.V[index[0]], mesh.V[index[1]], mesh.V[index[2]]});
+                    const float maxV = std::max({mesh.V[index[0]], mesh.V[index[1]], mesh.V[index[2]]});
+                    for (int y = this->Cell(minV); y <= this->Cell(maxV); ++y) {
+                        for (int x = this->Cell(minU); x <= this->Cell(maxU); ++x) {
+                            const std::size_t cell = static_cast<std::size_t>(y) * this->Size + x;
+                            if (pass == 0) {
+                                ++this->Offsets[cell + 1];
+                            } else {
+                                this->Triangles[this->Offsets[cell]++] = static_cast<std::uint32_t>(t);
+                            }
+                        }
+                    }
+                }
+                if (pass == 0) {
+                    for (std::size_t cell = 0; cell < cells; ++cell) {
+                        this->Offsets[cell + 1] += this->Offsets[cell];
+                    }
+                    this->Triangles.resize(this->Offsets[cells]);
+                }
+            }
+            // После раскладки Offsets[cell] указывает на конец ячейки: сдвигаем обратно.
+            for (std::size_t cell = cells; cell > 0; --cell) {
+                this->Offsets[cell] = this->Offsets[cell - 1];
+            }
+            this->Offsets[0] = 0;
+        }
+
+        // Треугольник, содержащий точку (u, v), и ее барицентрические координаты относительно вершин 0 и 1.
+        std::uint32_t Find(const MeshView& mesh, float u, float v, float& b0, float& b1) const {
+            const std::size_t cell = static_cast<std::size_t>(this->Cell(v)) * this->Size + this->Cell(u);
+            for (std::uint32_t k = this->Offsets[cell]; k < this->Offsets[cell + 1]; ++k) {
+                const std::uint32_t t = this->Triangles[k];
+                const std::uint32_t* index = mesh.Indices + 3 * t;
+                const float u0 = mesh.U[index[0]], v0 = mesh.V[index[0]];
+                const float e1u = mesh.U[index[1]] - u0, e1v = mesh.V[index[1]] - v0;
+                const float e2u = mesh.U[index[2]] - u0, e2v = mesh.V[index[2]] - v0;
+                const float area = e1u * e2v - e2u * e1v;
+                if (std::fabs(area) < 1e-12f) {
+                    continue;
+                }
+                const float pu = u - u0, pv = v - v0;
+                const float l1 = (pu * e2v - e2u * pv) / area;
+                const float l2 = (e1u * pv - pu * e1v) / area;
+                const float l0 = 1.0f - l1 - l2;
+                if (l0 >= -BarycentricEpsilon && l1 >= -BarycentricEpsilon && l2 >= -BarycentricEpsilon) {
+                    b0 = l0;
+                    b1 = l1;
+                    return t;
+                }
+            }
+            return NoTriangle;
+        }
+    };
+}
+
+bool ReadBoxList(const std::string& path, std::vector<TextureBox>& boxes, std::string& error) {
+    std::ifstream in(path);
+    if (!in) {
+        error = "cannot open " + path;
+        return false;
+    }
+    boxes.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        const std::string::size_type first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        std::istringstream stream(line);
+        TextureBox box;
+        if (!(stream >> box.X0 >> box.Y0 >> box.X1 >> box.Y1)) {
+            error = path + ":" + std::to_string(lineNumber) + ": expected x0 y0 x1 y1 [label]";
+            return false;
+        }
+        stream >> box.Label;
+        boxes.push_back(box);
+    }
+    return true;
+}
+
+void BoxAnnotator::Locate(const MeshView& mesh, const std::vector<TextureBox>& boxes, int textureWidth,
+                          int textureHeight) {
+    const std::size_t samples = boxes.size() * SamplesPerBox;
+    this->Labels.resize(boxes.size());
+    for (std::size_t b = 0; b < boxes.size(); ++b) {
+        this->Labels[b] = boxes[b].Label;
+    }
+    this->I0.assign(samples, NoTriangle);
+    this->I1.assign(samples, 0);
+    this->I2.assign(samples, 0);
+    this->B0.assign(samples, 0.0f);
+    this->B1.assign(samples, 0.0f);
+    if (!mesh.HasTCoords()) {
+        return;
+    }
+
+    UVGrid grid;
+    grid.Build(mesh);
+    const float invWidth = 1.0f / static_cast<float>(textureWidth);
+    const float invHeight = 1.0f / static_cast<float>(textureHeight);
+    ThreadPool::Instance().ParallelFor(boxes.size(), 256, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; ++b) {
+            const TextureBox& box = boxes[b];
+            for (int j = 0; j < SamplesPerSide; ++j) {
+                for (int i = 0; i < SamplesPerSide; ++i) {
+                    // Пиксели изображения идут сверху вниз, а v = 0 — нижний край текстуры.
+                    const float x = box.X0 + (box.X1 - box.X0) * i / (SamplesPerSide - 1);
+                    const float y = box.Y0 + (box.Y1 - box.Y0) * j / (SamplesPerSide - 1);
+                    const std::size_t s = b * SamplesPerBox + j * SamplesPerSide + i;
+                    const std::uint32_t t =
+                        grid.Find(mesh, x * invWidth, 1.0f - y * invHeight, this->B0[s], this->B1[s]);
+                    if (t != NoTriangle) {
+                        this->I0[s] = mesh.Indices[3 * t];
+                        this->I1[s] = mesh.Indices[3 * t + 1];
+                        this->I2[s] = mesh.Indices[3 * t + 2];
+                    }
+                }
+            }
+        }
+    });
+}
+
+void BoxAnnotator::Project(const RasterScene& scene, const std::vector<float>& depth, int width, int height) {
+    this->Width = width;
+    this->Height = height;
+    const MeshView& mesh = scene.Mesh;
+    const std::size_t samples = this->I0.size();
+    this->ScreenX.resize(samples);
+    this->ScreenY.resize(samples);
+    this->ScreenZ.resize(samples);
+    this->ScreenW.resize(samples);
+    float mvp[16];
+    scene.GetModelViewProjection(mvp);
+    const float halfW = 0.5f * static_cast<float>(width);
+    const float halfH = 0.5f * static_cast<float>(height);
+
+    // Пакетная проекция: точка восстанавливается по текущим координатам вершин ее треугольника,
+    // поэтому деформированная сетка не требует нового Locate.
+    ThreadPool& pool = ThreadPool::Instance();
+    pool.ParallelFor(samples, 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t s = begin; s < end; ++s) {
+            if (this->I0[s] == NoTriangle) {
+                this->ScreenW[s] = 0.0f;
+                continue;
+            }
+            const std::uint32_t i0 = this->I0[s], i1 = this->I1[s], i2 = this->I2[s];
+            const float b0 = this->B0[s], b1 = this->B1[s], b2 = 1.0f - b0 - b1;
+            const float x = b0 * mesh.X[i0] + b1 * mesh.X[i1] + b2 * mesh.X[i2];
+            const float y = b0 * mesh.Y[i0] + b1 * mesh.Y[i1] + b2 * mesh.Y[i2];
+            const float z = b0 * mesh.Z[i0] + b1 * mesh.Z[i1] + b2 * mesh.Z[i2];
+            const float cx = mvp[0] * x + mvp[1] * y + mvp[2] * z + mvp[3];
+            const float cy = mvp[4] * x + mvp[5] * y + mvp[6] * z + mvp[7];
+            const float cz = mvp[8] * x + mvp[9] * y + mvp[10] * z + mvp[11];
+            const float cw = mvp[12] * x + mvp[13] * y + mvp[14] * z + mvp[15];
+            const float invW = cw > 0.0f ? 1.0f / cw : 0.0f;
+            this->ScreenX[s] = (cx * invW + 1.0f) * halfW;
+            this->ScreenY[s] = (cy * invW + 1.0f) * halfH;
+            this->ScreenZ[s] = cz * invW * 0.5f + 0.5f;
+            this->ScreenW[s] = cw;
+        }
+    });
+
+    const std::size_t boxes = this->Labels.size();
+    this->Records.resize(boxes);
+    const int corners[4] = {0, SamplesPerSide - 1, SamplesPerBox - 1, SamplesPerBox - SamplesPerSide};
+    pool.ParallelFor(boxes, 256, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t b = begin; b < end; ++b) {
+            BoxRecord& record = this->Records[b];
+            std::memset(&record, 0, sizeof(record));
+            record.Label = this->Labels[b];
+            record.SampleCount = SamplesPerBox;
+
+            int mapped = 0;
+            int inFrame = 0;
+            int visible = 0;
+            float minX = std::numeric_limits<float>::max(), minY = minX;
+            float maxX = -std::numeric_limits<float>::max(), maxY = maxX;
+            for (int k = 0; k < SamplesPerBox; ++k) {
+                const std::size_t s = b * SamplesPerBox + k;
+                mapped += this->I0[s] != NoTriangle;
+                if (!(this->ScreenW[s] > 0.0f)) {
+                    continue;
+                }
+                const float x = this->ScreenX[s];
+                const float y = this->ScreenY[s];
+                const float z = this->ScreenZ[s];
+                minX = std::min(minX, x);
+                maxX = std::max(maxX, x);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y);
+                if (x >= 0.0f && x < width && y >= 0.0f && y < height && z >= 0.0f && z <= 1.0f) {
+                    ++inFrame;
+                    visible += IsSurfacePointVisible(depth, width, height, x, y, z);
+                }
+            }
+            for (int c = 0; c < 4; ++c) {
+                const std::size_t s = b * SamplesPerBox + corners[c];
+                const bool valid = this->ScreenW[s] > 0.0f;
+                record.Quad[2 * c] = valid ? this->ScreenX[s] : std::numeric_limits<float>::quiet_NaN();
+                record.Quad[2 * c + 1] = valid ? height - this->ScreenY[s] : std::numeric_limits<float>::quiet_NaN();
+            }
+            // Описанный прямоугольник обрезается по кадру; y переводится сверху вниз.
+            const float x0 = std::max(0.0f, minX), x1 = std::min(static_cast<float>(width), maxX);
+            const float y0 = std::max(0.0f, minY), y1 = std::min(static_cast<float>(height), maxY);
+            if (x0 < x1 && y0 < y1) {
+                record.Bounds[0] = x0;
+                record.Bounds[1] = height - y1;
+                record.Bounds[2] = x1;
+                record.Bounds[3] = height - y0;
+            }
+
+            record.Visible = static_cast<std::uint8_t>(visible);
+            if (mapped == 0) {
+                record.State = BoxUnmapped;
+            } else if (visible == SamplesPerBox) {
+                record.State = BoxVisible;
+            } else if (visible > 0) {
+                record.State = BoxPartial;
+            } else if (inFrame > 0) {
+                record.State = BoxOccluded;
+            } else {
+                record.State = BoxOffscreen;
+            }
+        }
+    });
+}
+
+void BoxAnnotator::Encode(std::vector<unsigned char>& bytes) const {
+    BoxFileHeader header {};
+    std::memcpy(header.Magic, BoxFileMagic, sizeof(BoxFileMagic));
+    header.Version = BoxFileVersion;
+    header.BoxCount = static_cast<std::uint32_t>(this->Records.size());
+    header.ImageWidth = static_cast<std::uint32_t>(this->Width);
+    header.ImageHeight = static_cast<std::uint32_t>(this->Height);
+
+    bytes.resize(sizeof(header) + this->Records.size() * sizeof(BoxRecord));
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    if (!this->Records.empty()) {
+        std::memcpy(bytes.data() + sizeof(header), this->Records.data(), this->Records.size() * sizeof(BoxRecord));
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef BOX_ANNOTATOR_H
+#define BOX_ANNOTATOR_H
+
+#include "SoftwareRasterizer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Прямоугольник разметки (слово, строка) в пикселях исходного изображения: начало — левый верхний угол.
+struct TextureBox {
+    float X0, Y0, X1, Y1;
+    std::uint32_t Label = 0;
+};
+
+// Читает список прямоугольников: по одному на строку "x0 y0 x1 y1 [label]", строки с '#' пропускаются.
+bool ReadBoxList(const std::string& path, std::vector<TextureBox>& boxes, std::string& error);
+
+// Что видно от прямоугольника в кадре.
+enum BoxState : std::uint8_t {
+    BoxUnmapped = 0,  // прямоугольник вне развертки сетки
+    BoxVisible = 1,   // все точки прямоугольника видны
+    BoxPartial = 2,   // видна часть точек: остальные закрыты или вне кадра
+    BoxOccluded = 3,  // прямоугольник в кадре, но полностью закрыт
+    BoxOffscreen = 4, // прямоугольник целиком вне кадра или за камерой
+};
+
+// Двоичная запись разметки кадра (.boxes):
+//
+//   BoxFileHeader
+//   BoxRecord[BoxCount] — в порядке списка прямоугольников
+//
+// Координаты — в пикселях кадра, y сверху вниз, как в PNG.
+struct BoxFileHeader {
+    char Magic[8];         // "DOCBOXES"
+    std::uint32_t Version; // 1
+    std::uint32_t BoxCount;
+    std::uint32_t ImageWidth;
+    std::uint32_t ImageHeight;
+};
+
+struct BoxRecord {
+    float Quad[8];   // углы (x0, y0), (x1, y0), (x1, y1), (x0, y1) исходного прямоугольника
+    float Bounds[4]; // описанный прямоугольник всех точек, обрезанный по кадру: x0, y0, x1, y1
+    std::uint32_t Label;
+    std::uint8_t State;   // BoxState
+    std::uint8_t Visible; // сколько из SampleCount точек видно
+    std::uint8_t SampleCount;
+    std::uint8_t Reserved;
+};
+
+// Переносит прямоугольники текстуры в кадр. Каждый прямоугольник представлен сеткой 3x3 точек (углы,
+// середины сторон и центр); Locate один раз на топологию сетки и список находит для каждой точки треугольник
+// развертки и барицентрические координаты, а Project для каждого ракурса пакетно проецирует все точки
+// текущими координатами сетки и проверяет их по буферу глубины кадра.
+class BoxAnnotator {
+public:
+    static const int SamplesPerSide = 3;
+    static const int SamplesPerBox = SamplesPerSide * SamplesPerSide;
+
+    void Locate(const MeshView& mesh, const std::vector<TextureBox>& boxes, int textureWidth, int textureHeight);
+    void Project(const RasterScene& scene, const std::vector<float>& depth, int width, int height);
+
+    const std::vector<BoxRecord>& GetRecords() const { return this->Records; }
+    void Encode(std::vector<unsigned char>& bytes) const;
+
+private:
+    int Width = 0;
+    int Height = 0;
+    std::vector<std::uint32_t> Labels;
+
+    // Точки всех прямоугольников подряд (SamplesPerBox на прямоугольник), SoA: вершины треугольника
+    // и две барицентрические координаты; у точек вне развертки I0 == NoTriangle.
+    std::vector<std::uint32_t> I0, I1, I2;
+    std::vector<float> B0, B1;
+
+    // Проекция точек: экранные x, y (y снизу вверх) и оконная глубина; w <= 0 — точка за камерой.
+    std::vector<float> ScreenX, ScreenY, ScreenZ, ScreenW;
+
+    std::vector<BoxRecord> Records;
+};
+
+#endif // BOX_ANNOTATOR_H
@@ -0,0 +1,254 @@
+#include "DocumentOutline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace {
+    struct PositionKey {
+        std::uint32_t X, Y, Z;
+        bool operator==(const PositionKey& other) const {
+            return this->X == other.X && this->Y == other.Y && this->Z == other.Z;
+        }
+    };
+
+    struct PositionKeyHash {
+        std::size_t operator()(const PositionKey& key) const {
+            std::uint64_t h = 1469598103934665603ull;
+            for (std::uint32_t part : {key.X, key.Y, key.Z}) {
+                h = (h ^ part) * 1099511628211ull;
+            }
+            return static_cast<std::size_t>(h);
+        }
+    };
+
+    std::uint32_t FloatBits(float value) {
+        std::uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    struct BoundaryEdge {
+        std::uint64_t Key; // неориентированное ребро: меньший индекс в старших битах
+        std::uint32_t From;
+        std::uint32_t To;
+    };
+
+    const char* StateName(ForwardMapState state) {
+        switch (state) {
+        case ForwardMapVisible:
+            return "visible";
+        case ForwardMapOccluded:
+            return "occluded";
+        default:
+            return "offscreen";
+        }
+    }
+
+    void AppendNumber(std::string& json, float value) {
+        if (std::isnan(value)) {
+            json += "null";
+            return;
+        }
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+        json += buffer;
+    }
+}
+
+void DocumentOutline::Extract(const MeshView& mesh) {
+    this->Loops.clear();
+    this->Closed.clear();
+    std::fill(this->Corners, this->Corners + 4, NoPoint);
+
+    // Сварка по координатам: каждой точке сопоставляется первая точка с теми же x, y, z.
+    std::vector<std::uint32_t> weld(mesh.PointCount);
+    std::unordered_map<PositionKey, std::uint32_t, PositionKeyHash> first;
+    first.reserve(mesh.PointCount);
+    for (std::size_t i = 0; i < mesh.PointCount; ++i) {
+        const PositionKey key = {FloatBits(mesh.X[i]), FloatBits(mesh.Y[i]), FloatBits(mesh.Z[i])};
+        weld[i] = first.emplace(key, static_cast<std::uint32_t>(i)).first->second;
+    }
+
+    // Граничное ребро встречается в треугольниках ровно один раз; его ориентация берется из треугольника,
+    // поэтому контуры обходятся в одном направлении.
+    std::vector<BoundaryEdge> edges;
+    edges.reserve(mesh.TriangleCount * 3);
+    for (std::size_t t = 0; t < mesh.TriangleCount; ++t) {
+        for (int k = 0; k < 3; ++k) {
+            const std::uint32_t from = weld[mesh.Indices[3 * t + k]];
+            const std::uint32_t to = weld[mesh.Indices[3 * t + (k + 1) % 3]];
+            if (from != to) {
+                const std::uint64_t key = static_cast<std::uint64_t>(std::min(from, to)) << 32 | std::max(from, to);
+                edges.push_back({key, from, to});
+            }
+        }
+    }
+    std::sort(edges.begin(), edges.end(),
+              [](const BoundaryEdge& a, const BoundaryEdge& b) { return a.Key < b.Key; });
+    std::vector<BoundaryEdge> boundary;
+    for (std::size_t i = 0; i < edges.size();) {
+        std::size_t j = i + 1;
+        while (j < edges.size() && edges[j].Key == edges[i].Key) {
+            ++j;
+        }
+        if (j == i + 1) {
+            boundary.push_back(edges[i]);
+        }
+        i = j;
+    }
+
+    // Сборка контуров: ребра упорядочены по начальной точке, из каждой точки идем по первому
+    // неиспользованному ребру, пока не вернемся в начало или не упремся в конец незамкнутой границы.
+    std::sort(boundary.begin(), boundary.end(), [](const BoundaryEdge& a, const BoundaryEdge& b) {
+        return a.From != b.From ? a.From < b.From : a.To < b.To;
+    });
+    std::vector<unsigned char> used(boundary.size(), 0);
+    auto findUnused = [&](std::uint32_t from) -> std::size_t {
+        auto it = std::lower_bound(boundary.begin(), boundary.end(), from,
+                                   [](const BoundaryEdge& edge, std::uint32_t point) { return edge.From < point; });
+        for (std::size_t i = it - boundary.begin(); i < boundary.size() && boundary[i].From == from; ++i) {
+            if (!used[i]) {
+                return i;
+            }
+        }
+        return boundary.size();
+    };
+    for (std::size_t start = 0; start < boundary.size(); ++start) {
+        if (used[start]) {
+            continue;
+        }
+        std::vector<std::uint32_t> loop = {boundary[start].From};
+        std::size_t edge = start;
+        bool closed = false;
+        while (edge < boundary.size()) {
+            used[edge] = 1;
+            const std::uint32_t next = boundary[edge].To;
+            if (next == boundary[start].From) {
+                closed = true;
+                break;
+            }
+            loop.push_back(next);
+            edge = findUnused(next);
+        }
+        this->Loops.push_back(std::move(loop));
+        this->Closed.push_back(closed);
+    }
+
+    // Углы документа среди точек границы.
+    const float targetU[4] = {0.0f, 1.0f, 1.0f, 0.0f};
+    const float targetV[4] = {0.0f, 0.0f, 1.0f, 1.0f};
+    float best[4];
+    std::fill(best, best + 4, std::numeric_limits<float>::max());
+    for (const std::vector<std::uint32_t>& loop : this->Loops) {
+        for (std::uint32_t point : loop) {
+            for (int c = 0; c < 4; ++c) {
+                float score = 0.0f;
+                if (mesh.HasTCoords()) {
+                    const float du = mesh.U[point] - targetU[c];
+                    const float dv = mesh.V[point] - targetV[c];
+                    score = du * du + dv * dv;
+                } else {
+                    score = -((targetU[c] * 2.0f - 1.0f) * mesh.X[point] + (targetV[c] * 2.0f - 1.0f) * mesh.Y[point]);
+                }
+                if (score < best[c]) {
+                    best[c] = score;
+                    this->Corners[c] = point;
+                }
+            }
+        }
+    }
+}
+
+DocumentOutline::ProjectedPoint DocumentOutline::ProjectPoint(const MeshView& mesh, std::uint32_t point,
+                                                              const float mvp[16],
+                                                              const std::vector<float>& depth) const {
+    const float x = mesh.X[point], y = mesh.Y[point], z = mesh.Z[point];
+    const float cx = mvp[0] * x + mvp[1] * y + mvp[2] * z + mvp[3];
+    const float cy = mvp[4] * x + mvp[5] * y + mvp[6] * z + mvp[7];
+    const float cz = mvp[8] * x + mvp[9] * y + mvp[10] * z + mvp[11];
+    const float cw = mvp[12] * x + mvp[13] * y + mvp[14] * z + mvp[15];
+
+    ProjectedPoint projected;
+    if (!(cw > 0.0f)) {
+        projected.X = std::numeric_limits<float>::quiet_NaN();
+        projected.Y = std::numeric_limits<float>::quiet_NaN();
+        projected.State = ForwardMapOffscreen;
+        return projected;
+    }
+    const float sx = (cx / cw + 1.0f) * 0.5f * static_cast<float>(this->Width);
+    const float sy = (cy / cw + 1.0f) * 0.5f * static_cast<float>(this->Height); // снизу вверх
+    const float sz = cz / cw * 0.5f + 0.5f;
+    projected.X = sx;
+    projected.Y = static_cast<float>(this->Height) - sy;
+    if (!(sx >= 0.0f && sx < this->Width && sy >= 0.0f && sy < this->Height && sz >= 0.0f && sz <= 1.0f)) {
+        projected.State = ForwardMapOffscreen;
+        return projected;
+    }
+
+    const bool visible = IsSurfacePointVisible(depth, this->Width, this->Height, sx, sy, sz);
+    projected.State = visible ? ForwardMapVisible : ForwardMapOccluded;
+    return projected;
+}
+
+void DocumentOutline::Project(const RasterScene& scene, const std::vector<float>& depth, int width, int height) {
+    this->Width = width;
+    this->Height = height;
+    float mvp[16];
+    scene.GetModelViewProjection(mvp);
+
+    this->ProjectedLoops.resize(this->Loops.size());
+    for (std::size_t l = 0; l < this->Loops.size(); ++l) {
+        const std::vector<std::uint32_t>& loop = this->Loops[l];
+        std::vector<ProjectedPoint>& projected = this->ProjectedLoops[l];
+        projected.resize(loop.size());
+        for (std::size_t i = 0; i < loop.size(); ++i) {
+            projected[i] = this->ProjectPoint(scene.Mesh, loop[i], mvp, depth);
+        }
+    }
+    for (int c = 0; c < 4; ++c) {
+        if (this->Corners[c] != NoPoint) {
+            this->ProjectedCorners[c] = this->ProjectPoint(scene.Mesh, this->Corners[c], mvp, depth);
+        }
+    }
+}
+
+void DocumentOutline::EncodeJson(std::string& json) const {
+    const char* cornerNames[4] = {"u0v0", "u1v0", "u1v1", "u0v1"};
+    json = "{\n  \"width\": " + std::to_string(this->Width) + ",\n  \"height\": " + std::to_string(this->Height) +
+           ",\n  \"corners\": [";
+    bool firstCorner = true;
+    for (int c = 0; c < 4; ++c) {
+        if (this->Corners[c] == NoPoint) {
+            continue;
+        }
+        const ProjectedPoint& corner = this->ProjectedCorners[c];
+        json += firstCorner ? "\n    " : ",\n    ";
+        json += "{\"corner\": \"" + std::string(cornerNames[c]) + "\", \"x\": ";
+        AppendNumber(json, corner.X);
+        json += ", \"y\": ";
+        AppendNumber(json, corner.Y);
+        json += ", \"state\": \"" + std::string(StateName(corner.State)) + "\"}";
+        firstCorner = false;
+    }
+    json += "\n  ],\n  \"boundaries\": [";
+    for (std::size_t l = 0; l < this->ProjectedLoops.size(); ++l) {
+        json += l == 0 ? "\n    " : ",\n    ";
+        json += "{\"closed\": ";
+        json += this->Closed[l] ? "true" : "false";
+        json += ", \"points\": [";
+        const std::vector<ProjectedPoint>& loop = this->ProjectedLoops[l];
+        for (std::size_t i = 0; i < loop.size(); ++i) {
+            json += i == 0 ? "[" : ", [";
+            AppendNumber(json, loop[i].X);
+            json += ", ";
+            AppendNumber(json, loop[i].Y);
+            json += ", " + std::to_string(static_cast<int>(loop[i].State)) + "]";
+        }
+        json += "]}";
+    }
+    json += "\n  ]\n}\n";
+}
@@ -0,0 +1,55 @@
+#ifndef DOCUMENT_OUTLINE_H
+#define DOCUMENT_OUTLINE_H
+
+#include "ForwardMap.h"
+#include "SoftwareRasterizer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Граница документа и его четыре угла в кадре — эталонная разметка для каждого рендера.
+//
+// Граничные ребра (принадлежащие одному треугольнику) и углы зависят только от топологии сетки,
+// поэтому Extract выполняется один раз на сетку; для каждого ракурса Project лишь умножает точки
+// границы на матрицу камеры и проверяет их по буферу глубины кадра.
+class DocumentOutline {
+public:
+    static const std::uint32_t NoPoint = 0xFFFFFFFFu;
+
+    // Собирает граничные ребра в контуры. Точки с одинаковыми координатами (швы развертки)
+    // считаются одной точкой, иначе шов выглядел бы как край документа. Углы — точки границы,
+    // ближайшие к (u, v) = (0, 0), (1, 0), (1, 1), (0, 1), а без текстурных координат — крайние
+    // по диагоналям в координатах сетки.
+    void Extract(const MeshView& mesh);
+
+    // Проецирует контуры и углы сцены. depth — глубина кадра (SoftwareRasterizer::GetDepth, строки
+    // снизу вверх); видимость — по IsSurfacePointVisible.
+    void Project(const RasterScene& scene, const std::vector<float>& depth, int width, int height);
+
+    // JSON с размером кадра, углами и контурами; координаты — в пикселях, y сверху вниз, как в PNG.
+    void EncodeJson(std::string& json) const;
+
+    const std::vector<std::vector<std::uint32_t>>& GetLoops() const { return this->Loops; }
+    const std::uint32_t* GetCorners() const { return this->Corners; }
+
+private:
+    struct ProjectedPoint {
+        float X, Y;          // NaN для точек за камерой
+        ForwardMapState State; // Visible, Occluded или Offscreen
+    };
+
+    ProjectedPoint ProjectPoint(const MeshView& mesh, std::uint32_t point, const float mvp[16],
+                                const std::vector<float>& depth) const;
+
+    std::vector<std::vector<std::uint32_t>> Loops; // индексы точек сетки вдоль каждого контура
+    std::vector<unsigned char> Closed;
+    std::uint32_t Corners[4] = {NoPoint, NoPoint, NoPoint, NoPoint};
+
+    int Width = 0;
+    int Height = 0;
+    std::vector<std::vector<ProjectedPoint>> ProjectedLoops;
+    ProjectedPoint ProjectedCorners[4] = {};
+};
+
+#endif // DOCUMENT_OUTLINE_H
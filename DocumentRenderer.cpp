@@ -0,0 +1,107 @@
+#include "DocumentRenderer.h"
+
+#include <algorithm>
+#include <cstdint>
+
+DocumentRenderer::DocumentRenderer(int width, int height, RenderBackend backend)
+    : Width(width), Height(height), Context(width, height, backend) {
+    this->Job.Output = "frame"; // задание без вывода считается неполным; в файл кадр не пишется
+}
+
+void DocumentRenderer::SetMesh(const std::string& mesh) {
+    this->Job.Mesh = mesh;
+    this->Changed = true;
+}
+
+void DocumentRenderer::SetPageWarps(const std::vector<PageWarp>& warps) {
+    this->Job.Warps = warps;
+    this->Changed = true;
+}
+
+void DocumentRenderer::SetTexture(const std::string& path) {
+    this->StoredTexture.reset();
+    this->Job.Texture = path;
+    this->Changed = true;
+}
+
+void DocumentRenderer::SetTexture(const unsigned char* pixels, int width, int height, int channels) {
+    // Имя свое у каждого рендерера: следующая текстура этого рендерера заменяет в кэше предыдущую.
+    const std::string name = "renderer" + std::to_string(reinterpret_cast<std::uintptr_t>(this));
+    this->StoredTexture = TextureCache::Instance().Store(name, pixels, width, height, channels);
+    this->Job.Texture = this->StoredTexture->GetPath();
+    this->Changed = true;
+}
+
+void DocumentRenderer::SetCamera(const double position[3], const double focalPoint[3], const double viewUp[3]) {
+    std::copy(position, position + 3, this->Job.CameraPosition);
+    std::copy(focalPoint, focalPoint + 3, this->Job.CameraFocalPoint);
+    std::copy(viewUp, viewUp + 3, this->Job.CameraViewUp);
+    this->Changed = true;
+}
+
+void DocumentRenderer::SetLight(const LightSetup& light) {
+    this->Job.Light = light;
+    this->Changed = true;
+}
+
+void DocumentRenderer::SetJob(const RenderJob& job) {
+    const std::string texture = this->Job.Texture;
+    this->Job = job;
+    // Выводы файлов не нужны; варианты освещения и разметка читают списки с диска, поэтому тоже отключены.
+    this->Job.Output = "frame";
+    this->Job.Relight.clear();
+    this->Job.Boxes.clear();
+    this->Job.Annotations.clear();
+    if (this->StoredTexture && job.Texture != texture) {
+        this->StoredTexture.reset();
+    }
+    this->ApplyMaps();
+    this->Changed = true;
+}
+
+void DocumentRenderer::SetMaps(bool uvmap, bool forwardMap, bool outline) {
+    this->Maps[0] = uvmap;
+    this->Maps[1] = forwardMap;
+    this->Maps[2] = outline;
+    this->ApplyMaps();
+    this->Changed = true;
+}
+
+void DocumentRenderer::ApplyMaps() {
+    // Контекст строит карты, у которых в задании есть путь; сами пути рендерер никогда не открывает.
+    this->Job.UVMap = this->Maps[0] ? "uvmap" : "";
+    this->Job.ForwardMap = this->Maps[1] ? "forwardmap" : "";
+    this->Job.Outline = this->Maps[2] ? "outline" : "";
+}
+
+bool DocumentRenderer::Render(unsigned char* pixels, int channels, std::string& error) {
+    if (channels != 3 && channels != 4) {
+        error = "frames have 3 or 4 channels";
+        return false;
+    }
+    if (this->Changed) {
+        if (!this->Context.Prepare(this->Job, error)) {
+            return false;
+        }
+        this->Changed = false;
+    }
+    this->Context.DrawFrame();
+    if (!this->Context.ReadFrame(pixels, channels)) {
+        error = "cannot read the frame from the render window";
+        return false;
+    }
+    return true;
+}
+
+bool DocumentRenderer::Render(FramePool& pool, int channels, FramePool::Lease& frame, std::string& error) {
+    if (channels != 3 && channels != 4) {
+        error = "frames have 3 or 4 channels";
+        return false;
+    }
+    frame = pool.Acquire(this->Width, this->Height, channels);
+    if (!this->Render(frame->GetData(), channels, error)) {
+        frame.Release();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef DOCUMENT_RENDERER_H
+#define DOCUMENT_RENDERER_H
+
+#include "FramePool.h"
+#include "RenderContext.h"
+#include "RenderJob.h"
+#include "TextureCache.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Встраиваемый рендерер страницы для программ, которым нужны кадры, а не файлы (например, загрузчик
+// обучающих данных): сцена задается методами, кадр читается прямо в буфер вызывающего или в буфер
+// из пула, на диск ничего не пишется. Под ним тот же RenderContext, что у --batch и --daemon, поэтому
+// при тех же параметрах кадры совпадают с кадрами пакетного режима.
+//
+// Объект владеет своим OpenGL-контекстом (или программным растеризатором) и работает в одном потоке;
+// для параллельной генерации нужен свой объект в каждом процессе (см. WorkerPool). Изменения сцены
+// применяются при следующем Render, а если сцена не менялась, Render только перерисовывает кадр.
+class DocumentRenderer {
+public:
+    DocumentRenderer(int width, int height, RenderBackend backend = RenderBackend::Vtk);
+
+    // "plane" — встроенная страница, которую деформируют warps (см. ParsePageWarps); иначе путь к OBJ или .dmesh.
+    void SetMesh(const std::string& mesh);
+    void SetPageWarps(const std::vector<PageWarp>& warps);
+    void SetTexture(const std::string& path);
+    // Текстура из памяти: pixels копируются в кэш текстур (строки снизу вверх, channels от 1 до 4).
+    void SetTexture(const unsigned char* pixels, int width, int height, int channels);
+    void SetCamera(const double position[3], const double focalPoint[3], const double viewUp[3]);
+    void SetLight(const LightSetup& light);
+    // Вся сцена сразу, например задание из ParameterSweep::GetJob. Выводы задания (output, uvmap=, relight=
+    // и т. п.) не используются: карты включает SetMaps.
+    void SetJob(const RenderJob& job);
+    const RenderJob& GetJob() const { return this->Job; }
+
+    // Какие карты строить вместе с кадром (по умолчанию никаких); после Render их отдают GetUVMap,
+    // GetForwardMap и GetOutline.
+    void SetMaps(bool uvmap, bool forwardMap, bool outline);
+
+    int GetWidth() const { return this->Width; }
+    int GetHeight() const { return this->Height; }
+    std::size_t GetFrameBytes(int channels) const {
+        return static_cast<std::size_t>(this->Width) * static_cast<std::size_t>(this->Height) * channels;
+    }
+
+    // Рисует сцену и читает кадр в pixels: GetFrameBytes(channels) байт, channels 3 (RGB) или 4 (RGBA),
+    // строки снизу вверх, как в FrameBuffer. Бэкенд Vtk читает окно прямо в pixels, без промежуточных копий.
+    bool Render(unsigned char* pixels, int channels, std::string& error);
+    // То же в буфер из pool: аренда возвращается в frame, буфер уходит обратно в пул вместе с ней.
+    bool Render(FramePool& pool, int channels, FramePool::Lease& frame, std::string& error);
+
+    // Карты последнего кадра в форматах .uvmap, .fwdmap и JSON границы (см. RenderContext).
+    void GetUVMap(std::vector<unsigned char>& bytes) const { this->Context.GetUVMap(bytes); }
+    bool GetForwardMap(std::vector<unsigned char>& bytes, std::string& error) {
+        return this->Context.GetForwardMap(bytes, error);
+    }
+    void GetOutline(std::string& json) { this->Context.GetOutline(json); }
+
+    // Остальные настройки — суперсэмплинг, кодировка карт, размер прямой карты — задаются у контекста.
+    RenderContext& GetContext() { return this->Context; }
+
+private:
+    void ApplyMaps();
+
+    const int Width;
+    const int Height;
+    RenderContext Context;
+    RenderJob Job;
+    bool Maps[3] = {false, false, false}; // uvmap, forwardmap, outline
+    std::shared_ptr<const CachedTexture> StoredTexture; // текстура из памяти; держит ее запись в кэше
+    bool Changed = true; // сцена менялась после последнего Prepare
+};
+
+#endif // DOCUMENT_RENDERER_H
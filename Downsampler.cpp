@@ -0,0 +1,246 @@
+#include "Downsampler.h"
+
+#include "SoftwareRasterizer.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DOWNSAMPLE_HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    const double Pi = 3.14159265358979323846;
+
+    double Lanczos3(double x) {
+        if (x == 0.0) {
+            return 1.0;
+        }
+        if (std::fabs(x) >= 3.0) {
+            return 0.0;
+        }
+        return 3.0 * std::sin(Pi * x) * std::sin(Pi * x / 3.0) / (Pi * Pi * x * x);
+    }
+
+    // sums[i] = сумма rows[r * stride + i] по factor строкам.
+    void SumRowsScalar(const unsigned char* rows, std::size_t stride, int factor, std::size_t begin,
+                       std::size_t count, std::uint16_t* sums) {
+        for (std::size_t i = begin; i < count; ++i) {
+            unsigned sum = 0;
+            for (int r = 0; r < factor; ++r) {
+                sum += rows[r * stride + i];
+            }
+            sums[i] = static_cast<std::uint16_t>(sum);
+        }
+    }
+
+    // column[i] = сумма weights[t] * rows[t * stride + i] по всем весам.
+    void FilterRowsScalar(const unsigned char* rows, std::size_t stride, const std::vector<float>& weights,
+                          std::size_t begin, std::size_t count, float* column) {
+        for (std::size_t i = begin; i < count; ++i) {
+            float sum = 0.0f;
+            for (std::size_t t = 0; t < weights.size(); ++t) {
+                sum += weights[t] * static_cast<float>(rows[t * stride + i]);
+            }
+            column[i] = sum;
+        }
+    }
+
+#if defined(DOWNSAMPLE_HAVE_AVX2_KERNEL)
+    // SumRowsScalar по 16 байт: factor <= 16, так что сумма помещается в 16 бит.
+    __attribute__((target("avx2"))) void SumRowsAVX2(const unsigned char* rows, std::size_t stride, int factor,
+                                                     std::size_t count, std::uint16_t* sums) {
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m256i sum = _mm256_setzero_si256();
+            for (int r = 0; r < factor; ++r) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + r * stride + i));
+                sum = _mm256_add_epi16(sum, _mm256_cvtepu8_epi16(bytes));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums + i), sum);
+        }
+        SumRowsScalar(rows, stride, factor, i, count, sums);
+    }
+
+    // FilterRowsScalar по 8 байт, без FMA: суммы совпадают со скалярной версией.
+    __attribute__((target("avx2"))) void FilterRowsAVX2(const unsigned char* rows, std::size_t stride,
+                                                        const std::vector<float>& weights, std::size_t count,
+                                                        float* column) {
+        std::size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 sum = _mm256_setzero_ps();
+            for (std::size_t t = 0; t < weights.size(); ++t) {
+                const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows + t * stride + i));
+                const __m256 values = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(weights[t]), values));
+            }
+            _mm256_storeu_ps(column + i, sum);
+        }
+        FilterRowsScalar(rows, stride, weights, i, count, column);
+    }
+#endif
+
+    void SumRows(const unsigned char* rows, std::size_t stride, int factor, std::size_t count, std::uint16_t* sums) {
+#if defined(DOWNSAMPLE_HAVE_AVX2_KERNEL)
+        if (SoftwareRasterizer::HasAVX2()) {
+            SumRowsAVX2(rows, stride, factor, count, sums);
+            return;
+        }
+#endif
+        SumRowsScalar(rows, stride, factor, 0, count, sums);
+    }
+
+    void FilterRows(const unsigned char* rows, std::size_t stride, const std::vector<float>& weights,
+                    std::size_t count, float* column) {
+#if defined(DOWNSAMPLE_HAVE_AVX2_KERNEL)
+        if (SoftwareRasterizer::HasAVX2()) {
+            FilterRowsAVX2(rows, stride, weights, count, column);
+            return;
+        }
+#endif
+        FilterRowsScalar(rows, stride, weights, 0, count, column);
+    }
+
+    // Горизонтальная часть фильтров: строка результата из строки сумм (Box) или свертки по вертикали (Lanczos).
+    // Число каналов — параметр шаблона, чтобы внутренние циклы разворачивались.
+    template <int Channels>
+    void AverageColumns(const std::uint16_t* sums, int factor, int width, unsigned char* out) {
+        const unsigned area = static_cast<unsigned>(factor * factor);
+        for (int x = 0; x < width; ++x) {
+            const std::uint16_t* block = sums + static_cast<std::size_t>(x) * factor * Channels;
+            unsigned sum[Channels] = {};
+            for (int k = 0; k < factor; ++k) {
+                for (int c = 0; c < Channels; ++c) {
+                    sum[c] += block[k * Channels + c];
+                }
+            }
+            for (int c = 0; c < Channels; ++c) {
+                out[x * Channels + c] = static_cast<unsigned char>((sum[c] + area / 2) / area);
+            }
+        }
+    }
+
+    // Channels = 0 — число каналов задает channels.
+    template <int Channels>
+    void FilterColumns(const float* column, const std::vector<float>& weights, int factor, int width,
+                       unsigned char* out, int channels = Channels) {
+        const int n = Channels > 0 ? Channels : channels;
+        const std::size_t taps = weights.size();
+        for (int x = 0; x < width; ++x) {
+            const float* block = column + static_cast<std::size_t>(x) * factor * n;
+            for (int c = 0; c < n; ++c) {
+                float sum = 0.0f;
+                for (std::size_t t = 0; t < taps; ++t) {
+                    sum += weights[t] * block[t * n + c];
+                }
+                // У Lanczos есть отрицательные лепестки: у контрастных краев сумма выходит за [0, 255].
+                sum = std::min(255.0f, std::max(0.0f, sum));
+                out[x * n + c] = static_cast<unsigned char>(sum + 0.5f);
+            }
+        }
+    }
+}
+
+bool ParseDownsampleFilter(const std::string& name, DownsampleFilter& filter) {
+    if (name == "box") {
+        filter = DownsampleFilter::Box;
+    } else if (name == "lanczos") {
+        filter = DownsampleFilter::Lanczos;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void Downsampler::SetFilter(int factor, DownsampleFilter filter) {
+    this->Factor = std::min(16, std::max(1, factor));
+    this->Filter = filter;
+    this->Weights.clear();
+    this->Margin = 0;
+    if (filter != DownsampleFilter::Lanczos) {
+        return;
+    }
+    // Пиксель результата x накрывает пиксели источника [x * factor, (x + 1) * factor), его центр —
+    // (x + 0.5) * factor. Веса одинаковы для всех x, так как factor целый.
+    const int f = this->Factor;
+    int first = 0;
+    double total = 0.0;
+    std::vector<double> weights;
+    for (int offset = -3 * f; offset <= 3 * f; ++offset) {
+        const double distance = (offset + 0.5 - 0.5 * f) / f;
+        if (std::fabs(distance) >= 3.0) {
+            continue;
+        }
+        if (weights.empty()) {
+            first = offset;
+        }
+        weights.push_back(Lanczos3(distance));
+        total += weights.back();
+    }
+    this->Margin = -first;
+    for (double weight : weights) {
+        this->Weights.push_back(static_cast<float>(weight / total));
+    }
+}
+
+void Downsampler::Downsample(const unsigned char* source, std::size_t sourceStride, int channels,
+                             unsigned char* target, std::size_t targetStride, int targetWidth,
+                             int targetHeight) const {
+    if (targetWidth <= 0 || targetHeight <= 0) {
+        return;
+    }
+    if (this->Filter == DownsampleFilter::Lanczos) {
+        this->DownsampleLanczos(source, sourceStride, channels, target, targetStride, targetWidth, targetHeight);
+    } else {
+        this->DownsampleBox(source, sourceStride, channels, target, targetStride, targetWidth, targetHeight);
+    }
+}
+
+void Downsampler::DownsampleBox(const unsigned char* source, std::size_t sourceStride, int channels,
+                                unsigned char* target, std::size_t targetStride, int targetWidth,
+                                int targetHeight) const {
+    const int f = this->Factor;
+    const std::size_t rowValues = static_cast<std::size_t>(targetWidth) * f * channels;
+    ThreadPool::Instance().ParallelFor(static_cast<std::size_t>(targetHeight), 8, [&](std::size_t begin,
+                                                                                     std::size_t end) {
+        std::vector<std::uint16_t> sums(rowValues);
+        for (std::size_t y = begin; y < end; ++y) {
+            SumRows(source + y * f * sourceStride, sourceStride, f, rowValues, sums.data());
+            unsigned char* out = target + y * targetStride;
+            if (channels == 4) {
+                AverageColumns<4>(sums.data(), f, targetWidth, out);
+            } else if (channels == 3) {
+                AverageColumns<3>(sums.data(), f, targetWidth, out);
+            } else {
+                AverageColumns<1>(sums.data(), f, targetWidth * channels, out);
+            }
+        }
+    });
+}
+
+void Downsampler::DownsampleLanczos(const unsigned char* source, std::size_t sourceStride, int channels,
+                                   unsigned char* target, std::size_t targetStride, int targetWidth,
+                                   int targetHeight) const {
+    // Сначала по вертикали (непрерывные строки, векторизуется), затем по горизонтали по одной строке.
+    // Поле margin входит в источник, поэтому веса пикселя результата начинаются с x * factor.
+    const int f = this->Factor;
+    const std::size_t rowValues = (static_cast<std::size_t>(targetWidth) * f + 2 * this->Margin) * channels;
+    ThreadPool::Instance().ParallelFor(static_cast<std::size_t>(targetHeight), 4, [&](std::size_t begin,
+                                                                                     std::size_t end) {
+        std::vector<float> column(rowValues);
+        for (std::size_t y = begin; y < end; ++y) {
+            FilterRows(source + y * f * sourceStride, sourceStride, this->Weights, rowValues, column.data());
+            unsigned char* out = target + y * targetStride;
+            if (channels == 4) {
+                FilterColumns<4>(column.data(), this->Weights, f, targetWidth, out);
+            } else if (channels == 3) {
+                FilterColumns<3>(column.data(), this->Weights, f, targetWidth, out);
+            } else {
+                FilterColumns<0>(column.data(), this->Weights, f, targetWidth, out, channels);
+            }
+        }
+    });
+}
@@ -0,0 +1,50 @@
+#ifndef DOWNSAMPLER_H
+#define DOWNSAMPLER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Фильтр уменьшения суперсэмплированного кадра.
+enum class DownsampleFilter {
+    Box,     // среднее блока factor x factor
+    Lanczos, // разделимое ядро Lanczos-3, растянутое в factor раз: резче, без ступенек на наклонных краях
+};
+
+bool ParseDownsampleFilter(const std::string& name, DownsampleFilter& filter);
+
+// Уменьшение 8-битного кадра с чередующимися каналами в целое число раз по каждой оси.
+//
+// Кадр можно уменьшать по частям: Downsample читает вокруг своей части поле GetMargin() пикселей источника
+// с каждой стороны, поэтому части, снятые с перекрытием, стыкуются без швов. Проход по вертикали идет
+// по 8 значений за раз с AVX2 (если процессор его поддерживает), строки результата делятся между потоками
+// ThreadPool::Instance(). Дополнительная память — одна строка источника на поток.
+class Downsampler {
+public:
+    // factor от 1 до 16.
+    void SetFilter(int factor, DownsampleFilter filter);
+    int GetFactor() const { return this->Factor; }
+    DownsampleFilter GetFilter() const { return this->Filter; }
+    // Поле вокруг уменьшаемой части в пикселях источника; у Box оно нулевое.
+    int GetMargin() const { return this->Margin; }
+
+    // Источник — (targetWidth * factor + 2 * margin) x (targetHeight * factor + 2 * margin) пикселей
+    // по sourceStride байт на строку, результат — targetWidth x targetHeight по targetStride байт.
+    // Порядок строк не важен, но у источника и результата он должен совпадать.
+    void Downsample(const unsigned char* source, std::size_t sourceStride, int channels, unsigned char* target,
+                    std::size_t targetStride, int targetWidth, int targetHeight) const;
+
+private:
+    void DownsampleBox(const unsigned char* source, std::size_t sourceStride, int channels, unsigned char* target,
+                       std::size_t targetStride, int targetWidth, int targetHeight) const;
+    void DownsampleLanczos(const unsigned char* source, std::size_t sourceStride, int channels,
+                           unsigned char* target, std::size_t targetStride, int targetWidth, int targetHeight) const;
+
+    int Factor = 1;
+    DownsampleFilter Filter = DownsampleFilter::Box;
+    int Margin = 0;
+    // Веса Lanczos для пикселей источника от x * factor - margin подряд; их сумма равна 1.
+    std::vector<float> Weights;
+};
+
+#endif // DOWNSAMPLER_H
@@ -0,0 +1,282 @@
+#include "EncodePipeline.h"
+
+#include "Tracer.h"
+#include "UVMap.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double SecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    void PrintQueue(std::ostream& out, const char* name, const BoundedQueueStats& stats) {
+        out << "  " << std::left << std::setw(8) << name << std::right << std::setw(9) << stats.Capacity
+            << std::setw(6) << stats.MaxDepth << std::setw(12) << std::setprecision(2) << stats.MeanDepth
+            << std::setw(16) << stats.PushStallSeconds << std::setw(14) << stats.PopWaitSeconds << "\n";
+    }
+}
+
+EncodePipeline::EncodePipeline(int encoders, std::size_t encodeQueue, std::size_t writeQueue,
+                               const ImageEncoding& encoding, std::unique_ptr<RecordShardWriter> dataset)
+    : Encoding(encoding), Dataset(std::move(dataset)),
+      Frames(encodeQueue + static_cast<std::size_t>(encoders > 0 ? encoders : 1) + 1), EncodeQueue(encodeQueue),
+      WriteQueue(writeQueue) {
+    for (int i = 0; i < (encoders > 0 ? encoders : 1); ++i) {
+        this->Encoders.emplace_back(&EncodePipeline::EncodeLoop, this);
+    }
+    this->Writer = std::thread(&EncodePipeline::WriteLoop, this);
+}
+
+EncodePipeline::~EncodePipeline() {
+    this->Finish();
+}
+
+void EncodePipeline::BeginJob(std::size_t index) {
+    this->CurrentJob = index;
+    this->CurrentOutputs = 0;
+}
+
+void EncodePipeline::EndJob(bool ok, const std::string& parameters) {
+    if (!this->Dataset) {
+        return;
+    }
+    Task task;
+    task.Field = "params";
+    task.Job = this->CurrentJob;
+    task.Bytes.assign(parameters.begin(), parameters.end());
+    task.Failed = !ok;
+    task.End = true;
+    task.Expected = this->CurrentOutputs;
+    if (!this->WriteQueue.Push(std::move(task))) {
+        this->Fail(this->CurrentJob, "params", "output pipeline is already finished");
+    }
+}
+
+int EncodePipeline::GetOutputChannels(const std::string& path, int channels) const {
+    return ::GetOutputChannels(this->Encoding, ImageFormatFromPath(path), channels);
+}
+
+FramePool::Lease EncodePipeline::AcquireFrame(int width, int height, int channels) {
+    // Долгое событие здесь значит, что все буферы заняты: кодировщики не успевают за рендерингом.
+    TRACE_SCOPE("frame.acquire");
+    return this->Frames.Acquire(width, height, channels);
+}
+
+void EncodePipeline::SubmitFrame(const std::string& field, const std::string& path, FramePool::Lease frame) {
+    ++this->CurrentOutputs;
+    {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        ++this->Images;
+    }
+    Task task;
+    task.Field = field;
+    task.Path = path;
+    task.Job = this->CurrentJob;
+    task.Frame = std::move(frame);
+    TRACE_SCOPE("queue.push");
+    if (!this->EncodeQueue.Push(std::move(task))) {
+        this->Fail(this->CurrentJob, path, "output pipeline is already finished");
+    }
+}
+
+void EncodePipeline::SubmitImage(const std::string& field, const std::string& path, const unsigned char* pixels,
+                                 int width, int height, int channels) {
+    FramePool::Lease frame = this->AcquireFrame(width, height, this->GetOutputChannels(path, channels));
+    const Clock::time_point start = Clock::now();
+    TRACE_SCOPE("copy");
+    CopyChannels(pixels, channels, static_cast<std::size_t>(width) * height, frame->GetData(), frame->Channels);
+    {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        this->CopySeconds += SecondsSince(start);
+    }
+    this->SubmitFrame(field, path, std::move(frame));
+}
+
+void EncodePipeline::SubmitBytes(const std::string& field, const std::string& path,
+                                 std::vector<unsigned char> bytes) {
+    ++this->CurrentOutputs;
+    Task task;
+    task.Field = field;
+    task.Path = path;
+    task.Job = this->CurrentJob;
+    task.Bytes = std::move(bytes);
+    if (!this->WriteQueue.Push(std::move(task))) {
+        this->Fail(this->CurrentJob, path, "output pipeline is already finished");
+    }
+}
+
+void EncodePipeline::EncodeLoop() {
+    // У каждого кодировщика свой ImageEncoder: его буферы и писатель JPEG не делятся между потоками.
+    ImageEncoder encoder;
+    encoder.SetEncoding(this->Encoding);
+    TRACE_THREAD_NAME("encode");
+    Task task;
+    while (this->EncodeQueue.Pop(task)) {
+        const Clock::time_point start = Clock::now();
+        std::string error;
+        const FrameBuffer& frame = *task.Frame;
+        bool ok = false;
+        {
+            TRACE_SCOPE("encode");
+            ok = encoder.Encode(frame.GetData(), frame.Width, frame.Height, frame.Channels,
+                                ImageFormatFromPath(task.Path), task.Bytes, error);
+        }
+        // Кадр больше не нужен: буфер возвращается в пул до того, как задача встанет в очередь записи.
+        task.Frame.Release();
+        {
+            std::lock_guard<std::mutex> lock(this->Mutex);
+            this->EncodeSeconds += SecondsSince(start);
+        }
+        const std::size_t job = task.Job;
+        const std::string path = task.Path;
+        if (!ok) {
+            this->Fail(job, path, error);
+            // Записи набора данных нужно знать, что этого поля не будет, иначе она ждала бы его до конца.
+            task.Failed = true;
+            task.Bytes.clear();
+        }
+        if ((ok || this->Dataset) && !this->WriteQueue.Push(std::move(task))) {
+            this->Fail(job, path, "output pipeline is already finished");
+        }
+        task = Task();
+    }
+}
+
+void EncodePipeline::WriteLoop() {
+    TRACE_THREAD_NAME("write");
+    Task task;
+    while (this->WriteQueue.Pop(task)) {
+        const Clock::time_point start = Clock::now();
+        this->Store(task);
+        {
+            std::lock_guard<std::mutex> lock(this->Mutex);
+            this->WriteSeconds += SecondsSince(start);
+        }
+        task = Task();
+    }
+    if (this->Dataset) {
+        // Записи, которые так и не получили все поля (задание прервано до EndJob), не добавляются.
+        for (const auto& pending : this->Pending) {
+            this->Fail(pending.first, "dataset", "record is incomplete");
+        }
+        this->Pending.clear();
+        std::string error;
+        if (!this->Dataset->Close(error)) {
+            this->FailRecords(error);
+        }
+    }
+}
+
+void EncodePipeline::Store(Task& task) {
+    if (!this->Dataset) {
+        TRACE_SCOPE("write");
+        std::string error;
+        if (!WriteBinaryFile(task.Path, task.Bytes, error)) {
+            this->Fail(task.Job, task.Path, error);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        ++this->Files;
+        this->WrittenBytes += task.Bytes.size();
+        return;
+    }
+
+    PendingRecord& record = this->Pending[task.Job];
+    record.Failed = record.Failed || task.Failed;
+    if (task.End) {
+        record.Ended = true;
+        record.Expected = task.Expected;
+    } else {
+        ++record.Received;
+    }
+    if (!task.Failed) {
+        // Конец задания может прийти раньше закодированных кадров; params в записи всегда идет первым.
+        const auto position = task.End ? record.Fields.begin() : record.Fields.end();
+        record.Fields.insert(position, RecordField{task.Field, std::move(task.Bytes)});
+    }
+    if (!record.Ended || record.Received < record.Expected) {
+        return;
+    }
+
+    if (!record.Failed) {
+        std::size_t bytes = 0;
+        for (const RecordField& field : record.Fields) {
+            bytes += field.Bytes.size();
+        }
+        TRACE_SCOPE("dataset.append");
+        std::string error;
+        if (this->Dataset->Append(task.Job, record.Fields, error)) {
+            std::lock_guard<std::mutex> lock(this->Mutex);
+            ++this->Files;
+            this->WrittenBytes += bytes;
+        }
+        // Ошибка бывает и при добавленной записи: тогда потерян предыдущий шард.
+        if (!error.empty()) {
+            this->FailRecords(error);
+        }
+    }
+    this->Pending.erase(task.Job);
+}
+
+void EncodePipeline::FailRecords(const std::string& error) {
+    const std::vector<std::uint64_t> lost = this->Dataset->TakeLostKeys();
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    for (std::uint64_t key : lost) {
+        this->FailedJobs.insert(static_cast<std::size_t>(key));
+    }
+    if (!lost.empty()) {
+        std::cerr << "dataset: " << lost.size() << " records lost: " << error << std::endl;
+    }
+}
+
+void EncodePipeline::Fail(std::size_t job, const std::string& path, const std::string& error) {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->FailedJobs.insert(job);
+    std::cerr << path << ": " << error << std::endl;
+}
+
+std::size_t EncodePipeline::Finish() {
+    if (!this->Finished) {
+        this->Finished = true;
+        // Сначала кодировщики дорабатывают свою очередь, и только потом закрывается очередь записи:
+        // иначе закодированные последними кадры некуда было бы положить.
+        this->EncodeQueue.Close();
+        for (std::thread& encoder : this->Encoders) {
+            encoder.join();
+        }
+        this->WriteQueue.Close();
+        this->Writer.join();
+    }
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    return this->FailedJobs.size();
+}
+
+void EncodePipeline::PrintStats(std::ostream& out) const {
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        out << std::fixed << std::setprecision(2) << "output pipeline: " << this->Images << " images, "
+            << this->Files << (this->Dataset ? " records" : " files");
+        if (this->Dataset) {
+            out << " in " << this->Dataset->GetShardCount() << " shards";
+        }
+        out << ", " << this->WrittenBytes / (1024.0 * 1024.0) << " MiB; copy "
+            << this->CopySeconds << " s, encode " << this->EncodeSeconds << " s in " << this->Encoders.size()
+            << " threads, write " << this->WriteSeconds << " s\n";
+    }
+    const FramePoolStats frames = this->Frames.GetStats();
+    out << "  frame buffers: " << frames.Allocated << " of " << frames.Capacity << ", " << frames.Leases
+        << " leases, " << frames.Resizes << " resizes, waited " << frames.WaitSeconds << " s\n";
+    out << "  queue    capacity   max  mean depth   push stall, s   pop wait, s\n";
+    PrintQueue(out, "encode", this->EncodeQueue.GetStats());
+    PrintQueue(out, "write", this->WriteQueue.GetStats());
+    out.flags(flags);
+    out.precision(precision);
+    out.flush();
+}
@@ -0,0 +1,130 @@
+#ifndef ENCODE_PIPELINE_H
+#define ENCODE_PIPELINE_H
+
+#include "BoundedQueue.h"
+#include "FramePool.h"
+#include "ImageEncoder.h"
+#include "RecordShard.h"
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Конвейер вывода пакетного режима: рендер -> копия кадра -> кодирование -> запись на диск.
+//
+// Поток рендеринга читает готовый кадр прямо в буфер из пула кадров (AcquireFrame) и отдает его вместе
+// с арендой (SubmitFrame), после чего сразу переходит к следующему заданию; кадр N кодируют
+// потоки-кодировщики, пока рисуется кадр N + 1, и буфер возвращается в пул, как только кадр закодирован.
+// Готовые файлы, а также
+// уже закодированные выводы задания (uvmap=, forwardmap= и т. п., SubmitBytes) записывает один поток
+// записи, чтобы диск не получал вперемешку запросы нескольких потоков.
+//
+// Между стадиями стоят очереди фиксированной емкости: если кодировщики не успевают, рендеринг ждет
+// свободного буфера в AcquireFrame. Буферов кадров encodeQueue + encoders + 1, и после разогрева они
+// не перевыделяются; закодированных выводов в очереди записи не больше writeQueue, сколько бы заданий
+// ни было в пакете.
+//
+// С набором данных (dataset) выводы не пишутся в отдельные файлы: поток записи собирает все выводы
+// задания в одну запись шарда, где каждый вывод — поле с именем field, и добавляет ее, когда придет
+// последний (EndJob сообщает, сколько их). Путь вывода тогда задает только формат кадра.
+//
+// Ошибки кодирования и записи печатаются по мере появления и запоминаются по номеру задания (BeginJob):
+// Finish возвращает число заданий, часть вывода которых не записалась.
+class EncodePipeline {
+public:
+    EncodePipeline(int encoders, std::size_t encodeQueue, std::size_t writeQueue, const ImageEncoding& encoding,
+                   std::unique_ptr<RecordShardWriter> dataset = nullptr);
+    ~EncodePipeline();
+
+    EncodePipeline(const EncodePipeline&) = delete;
+    EncodePipeline& operator=(const EncodePipeline&) = delete;
+
+    // Номер задания, к которому относятся следующие Submit*. Вызывается из потока рендеринга.
+    void BeginJob(std::size_t index);
+
+    // Все выводы задания отданы. Для набора данных ставит в очередь конец записи: ok == false — задание
+    // не удалось и запись не добавляется, parameters — поле params (JSON задания).
+    void EndJob(bool ok, const std::string& parameters);
+
+    // Число каналов, которое попадет в файл path из кадра с channels каналами: кадр стоит сразу читать
+    // в AcquireFrame с таким числом каналов.
+    int GetOutputChannels(const std::string& path, int channels) const;
+
+    // Буфер из пула под кадр; ждет, пока кодировщики не вернут хотя бы один. Вызывается из потока рендеринга.
+    FramePool::Lease AcquireFrame(int width, int height, int channels);
+
+    // Ставит кадр из AcquireFrame в очередь кодирования в формат, выбранный по расширению path.
+    void SubmitFrame(const std::string& field, const std::string& path, FramePool::Lease frame);
+
+    // Копирует кадр RGB8 или RGBA8 (строки снизу вверх) в буфер из пула и ставит его в очередь кодирования.
+    // Для кадров, которые рисуются в чужой буфер (программный бэкенд); альфа-канал, который не попадет
+    // в файл, отбрасывается уже при копировании.
+    void SubmitImage(const std::string& field, const std::string& path, const unsigned char* pixels, int width,
+                     int height, int channels);
+
+    // Ставит готовые байты в очередь записи.
+    void SubmitBytes(const std::string& field, const std::string& path, std::vector<unsigned char> bytes);
+
+    // Дожидается записи всего поставленного и останавливает потоки; после этого Submit* не принимаются.
+    // Возвращает число заданий с ошибками вывода.
+    std::size_t Finish();
+
+    // Время стадий, глубина очередей и время ожидания на каждой из них.
+    void PrintStats(std::ostream& out) const;
+
+private:
+    struct Task {
+        std::string Field;
+        std::string Path;
+        std::size_t Job = 0;
+        FramePool::Lease Frame; // кадр для кодирования; пусто — Bytes уже готовы к записи
+        std::vector<unsigned char> Bytes;
+        bool Failed = false;      // вывод не удалось закодировать; записи набора данных не будет
+        bool End = false;         // конец задания (EndJob), Bytes — его параметры
+        std::size_t Expected = 0; // для End: сколько выводов было у задания
+    };
+
+    // Запись набора данных, выводы которой еще не все закодированы.
+    struct PendingRecord {
+        std::vector<RecordField> Fields;
+        std::size_t Received = 0;
+        std::size_t Expected = 0;
+        bool Ended = false;
+        bool Failed = false;
+    };
+
+    void EncodeLoop();
+    void WriteLoop();
+    void Store(Task& task);
+    void FailRecords(const std::string& error); // задания записей, не попавших в набор данных
+    void Fail(std::size_t job, const std::string& path, const std::string& error);
+
+    const ImageEncoding Encoding;
+    std::unique_ptr<RecordShardWriter> Dataset;
+    FramePool Frames; // объявлен до очередей: аренды в задачах возвращаются, пока пул еще жив
+    BoundedQueue<Task> EncodeQueue;
+    BoundedQueue<Task> WriteQueue;
+    std::vector<std::thread> Encoders;
+    std::thread Writer;
+    bool Finished = false;
+    std::size_t CurrentJob = 0;
+    std::size_t CurrentOutputs = 0;
+    std::map<std::size_t, PendingRecord> Pending; // только в потоке записи
+
+    mutable std::mutex Mutex; // защищает поля ниже
+    std::set<std::size_t> FailedJobs;
+    long Images = 0;
+    long Files = 0; // файлов или, с набором данных, записей
+    unsigned long long WrittenBytes = 0;
+    double CopySeconds = 0.0;
+    double EncodeSeconds = 0.0; // суммарно по всем кодировщикам
+    double WriteSeconds = 0.0;
+};
+
+#endif // ENCODE_PIPELINE_H
@@ -0,0 +1,269 @@
+#include "ForwardMap.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+    const int BandRows = 16;
+    const char ForwardMapMagic[8] = {'D', 'O', 'C', 'F', 'W', 'M', 'A', 'P'};
+    const std::uint32_t ForwardMapVersion = 1;
+    const std::size_t SectionAlignment = 64;
+    // Запас сравнения глубины сверх наклона треугольника: погрешность float в буфере глубины.
+    const float DepthEpsilon = 1e-5f;
+
+    std::uint64_t AlignUp(std::uint64_t value) {
+        return (value + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+    }
+
+    // Строки карты, которые задевает треугольник: строка j берется в точке j + 0.5.
+    bool RowRange(const MeshView& mesh, const std::uint32_t* index, int height, int& first, int& last) {
+        float minY = std::numeric_limits<float>::max();
+        float maxY = -std::numeric_limits<float>::max();
+        for (int i = 0; i < 3; ++i) {
+            const float y = (1.0f - mesh.V[index[i]]) * static_cast<float>(height);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+        }
+        first = std::max(0, static_cast<int>(std::ceil(minY - 0.5f)));
+        last = std::min(height - 1, static_cast<int>(std::floor(maxY - 0.5f)));
+        return first <= last;
+    }
+}
+
+bool ForwardMapper::Compute(const RasterScene& scene, const std::vector<float>& depth, int imageWidth,
+                            int imageHeight, int width, int height, std::string& error) {
+    const MeshView& mesh = scene.Mesh;
+    if (!mesh.HasTCoords()) {
+        error = "forward map needs a mesh with texture coordinates";
+        return false;
+    }
+    if (depth.size() != static_cast<std::size_t>(imageWidth) * imageHeight || width <= 0 || height <= 0) {
+        error = "forward map: no depth buffer of the frame";
+        return false;
+    }
+    this->Width = width;
+    this->Height = height;
+    this->ImageWidth = imageWidth;
+    this->ImageHeight = imageHeight;
+    this->Bands = (height + BandRows - 1) / BandRows;
+
+    const std::size_t texels = static_cast<std::size_t>(width) * height;
+    this->X.assign(texels, std::numeric_limits<float>::quiet_NaN());
+    this->Y.assign(texels, std::numeric_limits<float>::quiet_NaN());
+    this->State.assign(texels, ForwardMapUnmapped);
+
+    float mvp[16];
+    scene.GetModelViewProjection(mvp);
+    this->Clip.resize(mesh.PointCount);
+    ThreadPool& pool = ThreadPool::Instance();
+    pool.ParallelFor(mesh.PointCount, 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const float x = mesh.X[i], y = mesh.Y[i], z = mesh.Z[i];
+            ClipPoint& c = this->Clip[i];
+            c.X = mvp[0] * x + mvp[1] * y + mvp[2] * z + mvp[3];
+            c.Y = mvp[4] * x + mvp[5] * y + mvp[6] * z + mvp[7];
+            c.Z = mvp[8] * x + mvp[9] * y + mvp[10] * z + mvp[11];
+            c.W = mvp[12] * x + mvp[13] * y + mvp[14] * z + mvp[15];
+        }
+    });
+
+    this->BinTriangles(mesh);
+    pool.ParallelFor(static_cast<std::size_t>(this->Bands), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t band = begin; band < end; ++band) {
+            this->RasterizeBand(mesh, depth, static_cast<int>(band));
+        }
+    });
+    return true;
+}
+
+void ForwardMapper::BinTriangles(const MeshView& mesh) {
+    const std::size_t bands = static_cast<std::size_t>(this->Bands);
+    const std::size_t count = mesh.TriangleCount;
+    // Как и в SoftwareRasterizer::BinTriangles: куски треугольников считаются и раскладываются
+    // параллельно, а внутри полосы списки идут в порядке кусков.
+    const std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(64, count / 2048));
+    const std::size_t chunkSize = (count + chunks - 1) / chunks;
+    std::vector<std::uint32_t> counts(chunks * bands, 0);
+    const int height = this->Height;
+
+    auto forEachBand = [&](std::size_t t, auto&& fn) {
+        int first = 0;
+        int last = 0;
+        if (RowRange(mesh, mesh.Indices + 3 * t, height, first, last)) {
+            for (int band = first / BandRows; band <= last / BandRows; ++band) {
+                fn(static_cast<std::size_t>(band));
+            }
+        }
+    };
+
+    ThreadPool& pool = ThreadPool::Instance();
+    pool.ParallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            std::uint32_t* chunkCounts = &counts[c * bands];
+            const std::size_t last = std::min(count, (c + 1) * chunkSize);
+            for (std::size_t t = c * chunkSize; t < last; ++t) {
+                forEachBand(t, [&](std::size_t band) { ++chunkCounts[band]; });
+            }
+        }
+    });
+
+    this->BandOffsets.assign(bands + 1, 0);
+    std::uint32_t total = 0;
+    for (std::size_t band = 0; band < bands; ++band) {
+        this->BandOffsets[band] = total;
+        for (std::size_t c = 0; c < chunks; ++c) {
+            const std::uint32_t n = counts[c * bands + band];
+            counts[c * bands + band] = total;
+            total += n;
+        }
+    }
+    this->BandOffsets[bands] = total;
+    this->BandTriangles.resize(total);
+
+    pool.ParallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            std::uint32_t* cursor = &counts[c * bands];
+            const std::size_t last = std::min(count, (c + 1) * chunkSize);
+            for (std::size_t t = c * chunkSize; t < last; ++t) {
+                forEachBand(t, [&](std::size_t band) {
+                    this->BandTriangles[cursor[band]++] = static_cast<std::uint32_t>(t);
+                });
+            }
+        }
+    });
+}
+
+void ForwardMapper::RasterizeBand(const MeshView& mesh, const std::vector<float>& depth, int band) {
+    const int bandFirst = band * BandRows;
+    const int bandLast = std::min(this->Height, bandFirst + BandRows) - 1;
+    const float imageW = static_cast<float>(this->ImageWidth);
+    const float imageH = static_cast<float>(this->ImageHeight);
+
+    for (std::uint32_t k = this->BandOffsets[band]; k < this->BandOffsets[band + 1]; ++k) {
+        const std::uint32_t* index = mesh.Indices + 3 * this->BandTriangles[k];
+        std::uint32_t v[3] = {index[0], index[1], index[2]};
+
+        // Треугольник в координатах карты: x = u * Width, y = (1 - v) * Height.
+        double x[3], y[3];
+        for (int i = 0; i < 3; ++i) {
+            x[i] = static_cast<double>(mesh.U[v[i]]) * this->Width;
+            y[i] = (1.0 - static_cast<double>(mesh.V[v[i]])) * this->Height;
+        }
+        double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (!(std::fabs(area) > 1e-12)) {
+            continue;
+        }
+        if (area < 0.0) {
+            std::swap(v[1], v[2]);
+            std::swap(x[1], x[2]);
+            std::swap(y[1], y[2]);
+            area = -area;
+        }
+
+        // Запас сравнения глубины: на сколько глубина плоскости треугольника может отличаться
+        // между точкой и центром ее пикселя, то есть половина суммы модулей экранных производных z.
+        const ClipPoint* c[3] = {&this->Clip[v[0]], &this->Clip[v[1]], &this->Clip[v[2]]};
+        float bias = DepthEpsilon;
+        if (c[0]->W > 0.0f && c[1]->W > 0.0f && c[2]->W > 0.0f) {
+            float sx[3], sy[3], sz[3];
+            for (int i = 0; i < 3; ++i) {
+                sx[i] = (c[i]->X / c[i]->W + 1.0f) * 0.5f * imageW;
+                sy[i] = (c[i]->Y / c[i]->W + 1.0f) * 0.5f * imageH;
+                sz[i] = c[i]->Z / c[i]->W * 0.5f + 0.5f;
+            }
+            const float screenArea = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+            if (std::fabs(screenArea) > 1e-6f) {
+                const float zx = ((sz[1] - sz[0]) * (sy[2] - sy[0]) - (sz[2] - sz[0]) * (sy[1] - sy[0])) / screenArea;
+                const float zy = ((sz[2] - sz[0]) * (sx[1] - sx[0]) - (sz[1] - sz[0]) * (sx[2] - sx[0])) / screenArea;
+                bias += 0.5f * (std::fabs(zx) + std::fabs(zy));
+            }
+        }
+
+        const int minX = std::max(0, static_cast<int>(std::ceil(std::min({x[0], x[1], x[2]}) - 0.5)));
+        const int maxX = std::min(this->Width - 1, static_cast<int>(std::floor(std::max({x[0], x[1], x[2]}) - 0.5)));
+        const int minY = std::max(bandFirst, static_cast<int>(std::ceil(std::min({y[0], y[1], y[2]}) - 0.5)));
+        const int maxY = std::min(bandLast, static_cast<int>(std::floor(std::max({y[0], y[1], y[2]}) - 0.5)));
+
+        // Уравнения ребер и правило верхнего-левого края — как в растеризаторе кадра.
+        double dx[3], dy[3];
+        bool inclusive[3];
+        for (int i = 0; i < 3; ++i) {
+            const int a = (i + 1) % 3;
+            const int b = (i + 2) % 3;
+            dx[i] = -(y[b] - y[a]);
+            dy[i] = x[b] - x[a];
+            inclusive[i] = dx[i] > 0.0 || (dx[i] == 0.0 && dy[i] < 0.0);
+        }
+        const double invArea = 1.0 / area;
+
+        for (int row = minY; row <= maxY; ++row) {
+            const double py = row + 0.5;
+            for (int col = minX; col <= maxX; ++col) {
+                const double px = col + 0.5;
+                double l[3];
+                bool inside = true;
+                for (int i = 0; i < 3; ++i) {
+                    const int a = (i + 1) % 3;
+                    const double e = dx[i] * (px - x[a]) + dy[i] * (py - y[a]);
+                    inside = inside && (e > 0.0 || (e == 0.0 && inclusive[i]));
+                    l[i] = e * invArea;
+                }
+                const std::size_t texel = static_cast<std::size_t>(row) * this->Width + col;
+                if (!inside || this->State[texel] == ForwardMapVisible) {
+                    continue;
+                }
+
+                // Точка сетки линейна по барицентрическим координатам развертки — как и ее
+                // однородные координаты, поэтому их можно интерполировать до деления на w.
+                const float w0 = static_cast<float>(l[0]), w1 = static_cast<float>(l[1]), w2 = static_cast<float>(l[2]);
+                const float cx = w0 * c[0]->X + w1 * c[1]->X + w2 * c[2]->X;
+                const float cy = w0 * c[0]->Y + w1 * c[1]->Y + w2 * c[2]->Y;
+                const float cz = w0 * c[0]->Z + w1 * c[1]->Z + w2 * c[2]->Z;
+                const float cw = w0 * c[0]->W + w1 * c[1]->W + w2 * c[2]->W;
+                if (!(cw > 0.0f)) {
+                    this->State[texel] = ForwardMapOffscreen;
+                    continue;
+                }
+                const float invW = 1.0f / cw;
+                const float sx = (cx * invW + 1.0f) * 0.5f * imageW;
+                const float sy = (cy * invW + 1.0f) * 0.5f * imageH; // снизу вверх, как буфер глубины
+                const float sz = cz * invW * 0.5f + 0.5f;
+                this->X[texel] = sx;
+                this->Y[texel] = imageH - sy;
+                if (!(sx >= 0.0f && sx < imageW && sy >= 0.0f && sy < imageH && sz >= 0.0f && sz <= 1.0f)) {
+                    this->State[texel] = ForwardMapOffscreen;
+                    continue;
+                }
+                const std::size_t pixel =
+                    static_cast<std::size_t>(sy) * this->ImageWidth + static_cast<std::size_t>(sx);
+                this->State[texel] = sz <= depth[pixel] + bias ? ForwardMapVisible : ForwardMapOccluded;
+            }
+        }
+    }
+}
+
+void ForwardMapper::Encode(std::vector<unsigned char>& bytes) const {
+    const std::size_t texels = static_cast<std::size_t>(this->Width) * this->Height;
+
+    ForwardMapHeader header {};
+    std::memcpy(header.Magic, ForwardMapMagic, sizeof(ForwardMapMagic));
+    header.Version = ForwardMapVersion;
+    header.Width = static_cast<std::uint32_t>(this->Width);
+    header.Height = static_cast<std::uint32_t>(this->Height);
+    header.ImageWidth = static_cast<std::uint32_t>(this->ImageWidth);
+    header.ImageHeight = static_cast<std::uint32_t>(this->ImageHeight);
+    header.XOffset = AlignUp(sizeof(ForwardMapHeader));
+    header.YOffset = AlignUp(header.XOffset + texels * sizeof(float));
+    header.StateOffset = AlignUp(header.YOffset + texels * sizeof(float));
+    header.FileSize = header.StateOffset + texels;
+
+    bytes.assign(static_cast<std::size_t>(header.FileSize), 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    std::memcpy(bytes.data() + header.XOffset, this->X.data(), texels * sizeof(float));
+    std::memcpy(bytes.data() + header.YOffset, this->Y.data(), texels * sizeof(float));
+    std::memcpy(bytes.data() + header.StateOffset, this->State.data(), texels);
+}
@@ -0,0 +1,83 @@
+#ifndef FORWARD_MAP_H
+#define FORWARD_MAP_H
+
+#include "SoftwareRasterizer.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Что известно о текселе в прямой карте.
+enum ForwardMapState : unsigned char {
+    ForwardMapUnmapped = 0,  // тексель не покрыт разверткой сетки
+    ForwardMapVisible = 1,   // точка видна в кадре
+    ForwardMapOccluded = 2,  // точка в кадре, но закрыта другой частью сетки
+    ForwardMapOffscreen = 3, // точка вне кадра или за камерой
+};
+
+// Двоичная прямая карта текстура -> кадр (.fwdmap), рассчитанная на отображение в память:
+//
+//   ForwardMapHeader
+//   X     — float32, Width * Height: x в пикселях кадра (пиксель i занимает [i, i + 1))
+//   Y     — float32, то же, y сверху вниз, как в PNG
+//   State — Width * Height байт ForwardMapState
+//
+// Строка 0 карты — верх исходного скана (v = 1), тексель (i, j) взят в точке
+// u = (i + 0.5) / Width, v = 1 - (j + 0.5) / Height. Для закрытых и внекадровых текселей X и Y —
+// все равно их проекция; для непокрытых и оказавшихся за камерой — NaN. Разделы выровнены по 64 байтам.
+struct ForwardMapHeader {
+    char Magic[8];         // "DOCFWMAP"
+    std::uint32_t Version; // 1
+    std::uint32_t Width;
+    std::uint32_t Height;
+    std::uint32_t ImageWidth;
+    std::uint32_t ImageHeight;
+    std::uint32_t Reserved;
+    std::uint64_t XOffset;
+    std::uint64_t YOffset;
+    std::uint64_t StateOffset;
+    std::uint64_t FileSize;
+};
+
+// Строит прямую карту за один проход: сетка растеризуется в пространстве текстуры, каждая точка
+// проецируется той же матрицей камеры, что и кадр, и сравнивается с буфером глубины кадра.
+// Карта делится на полосы строк, которые обрабатываются параллельно; внутри полосы треугольники
+// идут в порядке сетки, поэтому результат не зависит от числа потоков.
+class ForwardMapper {
+public:
+    // depth — глубина кадра той же сцены (SoftwareRasterizer::GetDepth, строки снизу вверх).
+    bool Compute(const RasterScene& scene, const std::vector<float>& depth, int imageWidth, int imageHeight,
+                 int width, int height, std::string& error);
+
+    int GetWidth() const { return this->Width; }
+    int GetHeight() const { return this->Height; }
+    const std::vector<float>& GetX() const { return this->X; }
+    const std::vector<float>& GetY() const { return this->Y; }
+    const std::vector<unsigned char>& GetState() const { return this->State; }
+
+    void Encode(std::vector<unsigned char>& bytes) const;
+
+private:
+    struct ClipPoint {
+        float X, Y, Z, W;
+    };
+
+    void BinTriangles(const MeshView& mesh);
+    void RasterizeBand(const MeshView& mesh, const std::vector<float>& depth, int band);
+
+    int Width = 0;
+    int Height = 0;
+    int ImageWidth = 0;
+    int ImageHeight = 0;
+    int Bands = 0;
+
+    std::vector<ClipPoint> Clip;             // вершины сетки в пространстве отсечения
+    std::vector<std::uint32_t> BandOffsets;  // Bands + 1
+    std::vector<std::uint32_t> BandTriangles;
+
+    std::vector<float> X;
+    std::vector<float> Y;
+    std::vector<unsigned char> State;
+};
+
+#endif // FORWARD_MAP_H
@@ -0,0 +1,79 @@
+#include "FramePool.h"
+
+#include <chrono>
+#include <utility>
+
+FramePool::Lease::Lease(Lease&& other) noexcept : Pool(other.Pool), Frame(other.Frame) {
+    other.Pool = nullptr;
+    other.Frame = nullptr;
+}
+
+FramePool::Lease& FramePool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        this->Release();
+        this->Pool = other.Pool;
+        this->Frame = other.Frame;
+        other.Pool = nullptr;
+        other.Frame = nullptr;
+    }
+    return *this;
+}
+
+void FramePool::Lease::Release() {
+    if (this->Frame != nullptr) {
+        this->Pool->Return(this->Frame);
+        this->Pool = nullptr;
+        this->Frame = nullptr;
+    }
+}
+
+FramePool::FramePool(std::size_t capacity) : Capacity(capacity > 0 ? capacity : 1) {}
+
+FramePool::Lease FramePool::Acquire(int width, int height, int channels) {
+    const std::size_t size = static_cast<std::size_t>(width) * height * channels;
+    FrameBuffer* frame = nullptr;
+    {
+        std::unique_lock<std::mutex> lock(this->Mutex);
+        if (this->Free.empty() && this->Frames.size() < this->Capacity) {
+            this->Frames.emplace_back(new FrameBuffer());
+            this->Free.push_back(this->Frames.back().get());
+        }
+        if (this->Free.empty()) {
+            const auto start = std::chrono::steady_clock::now();
+            this->Available.wait(lock, [&] { return !this->Free.empty(); });
+            this->WaitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        frame = this->Free.back();
+        this->Free.pop_back();
+        ++this->Leases;
+        if (!frame->Pixels.empty() && frame->Pixels.size() != size) {
+            ++this->Resizes;
+        }
+    }
+    // Размер меняется вне блокировки: resize до прежнего размера ничего не стоит, а новый размер
+    // бывает только при смене разрешения.
+    frame->Width = width;
+    frame->Height = height;
+    frame->Channels = channels;
+    frame->Pixels.resize(size);
+    return Lease(this, frame);
+}
+
+void FramePool::Return(FrameBuffer* frame) {
+    {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        this->Free.push_back(frame);
+    }
+    this->Available.notify_one();
+}
+
+FramePoolStats FramePool::GetStats() const {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    FramePoolStats stats;
+    stats.Capacity = this->Capacity;
+    stats.Allocated = this->Frames.size();
+    stats.Leases = this->Leases;
+    stats.Resizes = this->Resizes;
+    stats.WaitSeconds = this->WaitSeconds;
+    return stats;
+}
@@ -0,0 +1,85 @@
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Кадр RGB8 или RGBA8, строки снизу вверх, как их отдает OpenGL: переворот делает потребитель (кодировщик).
+struct FrameBuffer {
+    int Width = 0;
+    int Height = 0;
+    int Channels = 0;
+    std::vector<unsigned char> Pixels; // Width * Height * Channels байт
+
+    unsigned char* GetData() { return this->Pixels.data(); }
+    const unsigned char* GetData() const { return this->Pixels.data(); }
+};
+
+struct FramePoolStats {
+    std::size_t Capacity = 0;
+    std::size_t Allocated = 0; // буферов, созданных за все время (не больше Capacity)
+    long Leases = 0;
+    long Resizes = 0;          // выдач буфера под кадр другого размера, чем был в нем раньше
+    double WaitSeconds = 0.0;  // сколько ждали свободного буфера: все кадры еще в конвейере
+};
+
+// Фиксированный набор буферов кадров. Кадр читается из окна прямо в арендованный буфер и дальше
+// передается по стадиям конвейера вместе с арендой, без копий; буфер возвращается в пул, когда аренду
+// уничтожают. Пока кадры одного размера, после разогрева не выделяется ни байта.
+//
+// Буферы создаются по мере надобности, но не больше capacity: если все арендованы, Acquire ждет.
+// Пул должен жить дольше всех своих аренд.
+class FramePool {
+public:
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept;
+        Lease& operator=(Lease&& other) noexcept;
+        ~Lease() { this->Release(); }
+
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+
+        FrameBuffer* operator->() const { return this->Frame; }
+        FrameBuffer& operator*() const { return *this->Frame; }
+        explicit operator bool() const { return this->Frame != nullptr; }
+
+        // Возвращает буфер в пул раньше уничтожения аренды.
+        void Release();
+
+    private:
+        friend class FramePool;
+        Lease(FramePool* pool, FrameBuffer* frame) : Pool(pool), Frame(frame) {}
+
+        FramePool* Pool = nullptr;
+        FrameBuffer* Frame = nullptr;
+    };
+
+    explicit FramePool(std::size_t capacity);
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    // Буфер под кадр заданного размера; содержимое не определено. Ждет, если все буферы арендованы.
+    Lease Acquire(int width, int height, int channels);
+
+    FramePoolStats GetStats() const;
+
+private:
+    void Return(FrameBuffer* frame);
+
+    const std::size_t Capacity;
+    mutable std::mutex Mutex;
+    std::condition_variable Available;
+    std::vector<std::unique_ptr<FrameBuffer>> Frames;
+    std::vector<FrameBuffer*> Free;
+    long Leases = 0;
+    long Resizes = 0;
+    double WaitSeconds = 0.0;
+};
+
+#endif // FRAME_POOL_H
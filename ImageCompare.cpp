@@ -0,0 +1,29 @@
+#include "ImageCompare.h"
+
+#include <cstdlib>
+
+ImageDifference CompareImages(const unsigned char* a, int aComponents, const unsigned char* b, int bComponents,
+                              std::size_t pixels) {
+    ImageDifference result;
+    if (pixels == 0) {
+        return result;
+    }
+    unsigned long long sum = 0;
+    std::size_t outliers = 0;
+    for (std::size_t i = 0; i < pixels; ++i) {
+        int worst = 0;
+        for (int c = 0; c < 3; ++c) {
+            const int d =
+                std::abs(static_cast<int>(a[i * aComponents + c]) - static_cast<int>(b[i * bComponents + c]));
+            sum += static_cast<unsigned>(d);
+            worst = d > worst ? d : worst;
+        }
+        if (worst > ImageDifference::PixelTolerance) {
+            ++outliers;
+        }
+        result.MaxAbsolute = worst > result.MaxAbsolute ? worst : result.MaxAbsolute;
+    }
+    result.MeanAbsolute = static_cast<double>(sum) / static_cast<double>(pixels * 3);
+    result.OutlierFraction = static_cast<double>(outliers) / static_cast<double>(pixels);
+    return result;
+}
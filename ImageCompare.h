@@ -0,0 +1,30 @@
+#ifndef IMAGE_COMPARE_H
+#define IMAGE_COMPARE_H
+
+#include <cstddef>
+
+// Допуск, с которым программный растеризатор должен совпадать с рендером VTK (каналы RGB, 0..255):
+//  - средняя абсолютная разница по всем каналам не больше MeanTolerance;
+//  - доля пикселей, где разница хотя бы в одном канале больше PixelTolerance, не больше OutlierTolerance.
+// Выбросы допускаются на контуре листа (сглаживание и правила покрытия OpenGL) и на резких
+// краях текстуры, где выбор mip-уровня GPU немного отличается.
+struct ImageDifference {
+    static constexpr double MeanTolerance = 2.0;
+    static constexpr int PixelTolerance = 16;
+    static constexpr double OutlierTolerance = 0.01;
+
+    double MeanAbsolute = 0.0;
+    int MaxAbsolute = 0;
+    double OutlierFraction = 0.0;
+
+    bool IsWithinTolerance() const {
+        return this->MeanAbsolute <= MeanTolerance && this->OutlierFraction <= OutlierTolerance;
+    }
+};
+
+// Сравнивает два изображения одинакового размера с 3 или 4 байтами на пиксель (число каналов у них может
+// различаться); альфа-канал не сравнивается.
+ImageDifference CompareImages(const unsigned char* a, int aComponents, const unsigned char* b, int bComponents,
+                              std::size_t pixels);
+
+#endif // IMAGE_COMPARE_H
@@ -0,0 +1,371 @@
+#include "ImageEncoder.h"
+
+#include <vtkPointData.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtk_zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+    const char RawImageMagic[8] = {'D', 'O', 'C', 'I', 'M', 'A', 'G', 'E'};
+    const unsigned char PngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    void PutBigEndian(unsigned char* out, std::uint32_t value) {
+        out[0] = static_cast<unsigned char>(value >> 24);
+        out[1] = static_cast<unsigned char>(value >> 16);
+        out[2] = static_cast<unsigned char>(value >> 8);
+        out[3] = static_cast<unsigned char>(value);
+    }
+
+    // Дописывает чанк PNG, данные которого уже лежат в bytes с позиции start + 8.
+    void FinishPngChunk(std::vector<unsigned char>& bytes, std::size_t start, const char type[4], std::size_t size) {
+        PutBigEndian(bytes.data() + start, static_cast<std::uint32_t>(size));
+        std::memcpy(bytes.data() + start + 4, type, 4);
+        const uLong crc = crc32(0L, bytes.data() + start + 4, static_cast<uInt>(size + 4));
+        bytes.resize(start + 8 + size + 4);
+        PutBigEndian(bytes.data() + start + 8 + size, static_cast<std::uint32_t>(crc));
+    }
+
+    void AppendPngChunk(std::vector<unsigned char>& bytes, const char type[4], const unsigned char* data,
+                        std::size_t size) {
+        const std::size_t start = bytes.size();
+        bytes.resize(start + 8 + size);
+        if (size > 0) {
+            std::memcpy(bytes.data() + start + 8, data, size);
+        }
+        FinishPngChunk(bytes, start, type, size);
+    }
+
+    unsigned char Paeth(int a, int b, int c) {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a);
+        const int pb = std::abs(p - b);
+        const int pc = std::abs(p - c);
+        return static_cast<unsigned char>(pa <= pb && pa <= pc ? a : (pb <= pc ? b : c));
+    }
+
+    // Фильтрует строку row длиной length байт; previous — предыдущая строка (нули для первой).
+    void FilterRow(PngFilter filter, const unsigned char* row, const unsigned char* previous, std::size_t length,
+                   int bpp, unsigned char* out) {
+        const std::size_t left = static_cast<std::size_t>(bpp);
+        switch (filter) {
+        case PngFilter::Sub:
+            std::memcpy(out, row, left);
+            for (std::size_t i = left; i < length; ++i) {
+                out[i] = static_cast<unsigned char>(row[i] - row[i - left]);
+            }
+            break;
+        case PngFilter::Up:
+            for (std::size_t i = 0; i < length; ++i) {
+                out[i] = static_cast<unsigned char>(row[i] - previous[i]);
+            }
+            break;
+        case PngFilter::Average:
+            for (std::size_t i = 0; i < left; ++i) {
+                out[i] = static_cast<unsigned char>(row[i] - (previous[i] >> 1));
+            }
+            for (std::size_t i = left; i < length; ++i) {
+                out[i] = static_cast<unsigned char>(row[i] - ((row[i - left] + previous[i]) >> 1));
+            }
+            break;
+        case PngFilter::Paeth:
+            for (std::size_t i = 0; i < left; ++i) {
+                out[i] = static_cast<unsigned char>(row[i] - previous[i]);
+            }
+            for (std::size_t i = left; i < length; ++i) {
+                out[i] = static_cast<unsigned char>(row[i] - Paeth(row[i - left], previous[i], previous[i - left]));
+            }
+            break;
+        default:
+            std::memcpy(out, row, length);
+            break;
+        }
+    }
+
+    // Эвристика libpng: сумма байтов строки как знаковых чисел по модулю.
+    unsigned long FilterCost(const unsigned char* filtered, std::size_t length) {
+        unsigned long cost = 0;
+        for (std::size_t i = 0; i < length; ++i) {
+            cost += static_cast<unsigned long>(std::abs(static_cast<int>(static_cast<signed char>(filtered[i]))));
+        }
+        return cost;
+    }
+}
+
+ImageFormat ImageFormatFromPath(const std::string& path) {
+    const std::string::size_type dot = path.find_last_of('.');
+    const std::string::size_type slash = path.find_last_of('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return ImageFormat::Png;
+    }
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (extension == "jpg" || extension == "jpeg") {
+        return ImageFormat::Jpeg;
+    }
+    if (extension == "qoi") {
+        return ImageFormat::Qoi;
+    }
+    if (extension == "raw") {
+        return ImageFormat::Raw;
+    }
+    return ImageFormat::Png;
+}
+
+bool ParsePngFilter(const std::string& name, PngFilter& filter) {
+    static const char* const names[] = {"none", "sub", "up", "average", "paeth", "adaptive"};
+    for (int i = 0; i < 6; ++i) {
+        if (name == names[i]) {
+            filter = static_cast<PngFilter>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+int GetOutputChannels(const ImageEncoding& encoding, ImageFormat format, int channels) {
+    return encoding.Alpha && channels == 4 && format != ImageFormat::Jpeg ? 4 : 3;
+}
+
+void CopyChannels(const unsigned char* source, int sourceChannels, std::size_t pixels, unsigned char* target,
+                  int targetChannels) {
+    if (sourceChannels == targetChannels) {
+        std::memcpy(target, source, pixels * static_cast<std::size_t>(sourceChannels));
+        return;
+    }
+    for (std::size_t i = 0; i < pixels; ++i) {
+        target[0] = source[0];
+        target[1] = source[1];
+        target[2] = source[2];
+        source += sourceChannels;
+        target += targetChannels;
+    }
+}
+
+ImageEncoder::ImageEncoder() {
+    this->JpegWriter->WriteToMemoryOn();
+}
+
+bool ImageEncoder::Encode(const unsigned char* pixels, int width, int height, int channels, ImageFormat format,
+                          std::vector<unsigned char>& bytes, std::string& error) {
+    if (width <= 0 || height <= 0 || (channels != 3 && channels != 4)) {
+        error = "expected an RGB or RGBA frame";
+        return false;
+    }
+    const int outputChannels = GetOutputChannels(this->Encoding, format, channels);
+    bytes.clear();
+    switch (format) {
+    case ImageFormat::Jpeg:
+        return this->EncodeJpeg(pixels, width, height, channels, bytes, error);
+    case ImageFormat::Qoi:
+        this->EncodeQoi(pixels, width, height, channels, outputChannels, bytes);
+        return true;
+    case ImageFormat::Raw:
+        this->EncodeRaw(pixels, width, height, channels, outputChannels, bytes);
+        return true;
+    default:
+        return this->EncodePng(pixels, width, height, channels, outputChannels, bytes, error);
+    }
+}
+
+bool ImageEncoder::EncodePng(const unsigned char* pixels, int width, int height, int channels, int outputChannels,
+                             std::vector<unsigned char>& bytes, std::string& error) {
+    const std::size_t stride = static_cast<std::size_t>(width) * outputChannels;
+    const std::size_t sourceStride = static_cast<std::size_t>(width) * channels;
+    const PngFilter filter = this->Encoding.Filter;
+    const int candidates = filter == PngFilter::Adaptive ? 5 : 0;
+
+    // Rows: две строки кадра (предыдущая и текущая меняются местами) и кандидаты адаптивного выбора.
+    this->Rows.assign(stride * (2 + candidates), 0);
+    unsigned char* previous = this->Rows.data();
+    unsigned char* current = previous + stride;
+    unsigned char* const trial = this->Rows.data() + 2 * stride;
+    this->Filtered.resize((stride + 1) * static_cast<std::size_t>(height));
+    for (int y = 0; y < height; ++y) {
+        // PNG хранит строки сверху вниз, кадр — снизу вверх.
+        CopyChannels(pixels + static_cast<std::size_t>(height - 1 - y) * sourceStride, channels,
+                     static_cast<std::size_t>(width), current, outputChannels);
+        unsigned char* out = this->Filtered.data() + (stride + 1) * static_cast<std::size_t>(y);
+        PngFilter chosen = filter;
+        if (filter == PngFilter::Adaptive) {
+            unsigned long best = 0;
+            for (int f = 0; f < candidates; ++f) {
+                unsigned char* candidate = trial + stride * static_cast<std::size_t>(f);
+                FilterRow(static_cast<PngFilter>(f), current, previous, stride, outputChannels, candidate);
+                const unsigned long cost = FilterCost(candidate, stride);
+                if (f == 0 || cost < best) {
+                    best = cost;
+                    chosen = static_cast<PngFilter>(f);
+                }
+            }
+            std::memcpy(out + 1, trial + stride * static_cast<std::size_t>(chosen), stride);
+        } else {
+            FilterRow(filter, current, previous, stride, outputChannels, out + 1);
+        }
+        out[0] = static_cast<unsigned char>(chosen);
+        std::swap(previous, current);
+    }
+
+    bytes.assign(PngSignature, PngSignature + sizeof(PngSignature));
+    unsigned char header[13];
+    PutBigEndian(header, static_cast<std::uint32_t>(width));
+    PutBigEndian(header + 4, static_cast<std::uint32_t>(height));
+    header[8] = 8;                                             // бит на канал
+    header[9] = static_cast<unsigned char>(outputChannels == 4 ? 6 : 2); // RGBA или RGB
+    header[10] = 0;                                            // deflate
+    header[11] = 0;                                            // фильтры строк из раздела 9
+    header[12] = 0;                                            // без чередования
+    AppendPngChunk(bytes, "IHDR", header, sizeof(header));
+
+    // Весь кадр сжимается в один IDAT прямо в выходной буфер.
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    const int level = std::min(9, std::max(0, this->Encoding.PngLevel));
+    const int strategy = filter == PngFilter::None ? Z_DEFAULT_STRATEGY : Z_FILTERED;
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15, 8, strategy) != Z_OK) {
+        error = "cannot initialise zlib";
+        return false;
+    }
+    const std::size_t start = bytes.size();
+    const uLong bound = deflateBound(&stream, static_cast<uLong>(this->Filtered.size()));
+    bytes.resize(start + 8 + bound);
+    stream.next_in = this->Filtered.data();
+    stream.avail_in = static_cast<uInt>(this->Filtered.size());
+    stream.next_out = bytes.data() + start + 8;
+    stream.avail_out = static_cast<uInt>(bound);
+    const int status = deflate(&stream, Z_FINISH);
+    const std::size_t compressed = static_cast<std::size_t>(stream.total_out);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END) {
+        error = "cannot compress PNG data";
+        return false;
+    }
+    FinishPngChunk(bytes, start, "IDAT", compressed);
+    AppendPngChunk(bytes, "IEND", nullptr, 0);
+    return true;
+}
+
+void ImageEncoder::EncodeQoi(const unsigned char* pixels, int width, int height, int channels, int outputChannels,
+                             std::vector<unsigned char>& bytes) {
+    // Формат QOI 1.0 (qoiformat.org): индекс последних цветов, серии, малые разности с предыдущим пикселем.
+    const std::size_t count = static_cast<std::size_t>(width) * height;
+    bytes.resize(14 + count * (outputChannels + 1) + 8);
+    unsigned char* out = bytes.data();
+    std::memcpy(out, "qoif", 4);
+    PutBigEndian(out + 4, static_cast<std::uint32_t>(width));
+    PutBigEndian(out + 8, static_cast<std::uint32_t>(height));
+    out[12] = static_cast<unsigned char>(outputChannels);
+    out[13] = 0; // sRGB
+    out += 14;
+
+    unsigned char index[64][4];
+    std::memset(index, 0, sizeof(index));
+    unsigned char previous[4] = {0, 0, 0, 255};
+    int run = 0;
+    std::size_t done = 0;
+    for (int y = height - 1; y >= 0; --y) {
+        const unsigned char* row = pixels + static_cast<std::size_t>(y) * width * channels;
+        for (int x = 0; x < width; ++x, ++done) {
+            const unsigned char* source = row + static_cast<std::size_t>(x) * channels;
+            const unsigned char pixel[4] = {source[0], source[1], source[2],
+                                            outputChannels == 4 ? source[3] : static_cast<unsigned char>(255)};
+            if (std::memcmp(pixel, previous, 4) == 0) {
+                ++run;
+                if (run == 62 || done + 1 == count) {
+                    *out++ = static_cast<unsigned char>(0xC0 | (run - 1));
+                    run = 0;
+                }
+                continue;
+            }
+            if (run > 0) {
+                *out++ = static_cast<unsigned char>(0xC0 | (run - 1));
+                run = 0;
+            }
+            const int slot = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+            if (std::memcmp(index[slot], pixel, 4) == 0) {
+                *out++ = static_cast<unsigned char>(slot);
+            } else {
+                std::memcpy(index[slot], pixel, 4);
+                if (pixel[3] == previous[3]) {
+                    const int dr = static_cast<signed char>(pixel[0] - previous[0]);
+                    const int dg = static_cast<signed char>(pixel[1] - previous[1]);
+                    const int db = static_cast<signed char>(pixel[2] - previous[2]);
+                    const int drg = dr - dg;
+                    const int dbg = db - dg;
+                    if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+                        *out++ = static_cast<unsigned char>(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2));
+                    } else if (drg > -9 && drg < 8 && dg > -33 && dg < 32 && dbg > -9 && dbg < 8) {
+                        *out++ = static_cast<unsigned char>(0x80 | (dg + 32));
+                        *out++ = static_cast<unsigned char>((drg + 8) << 4 | (dbg + 8));
+                    } else {
+                        *out++ = 0xFE;
+                        *out++ = pixel[0];
+                        *out++ = pixel[1];
+                        *out++ = pixel[2];
+                    }
+                } else {
+                    *out++ = 0xFF;
+                    std::memcpy(out, pixel, 4);
+                    out += 4;
+                }
+            }
+            std::memcpy(previous, pixel, 4);
+        }
+    }
+    const unsigned char end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+    std::memcpy(out, end, sizeof(end));
+    out += sizeof(end);
+    bytes.resize(static_cast<std::size_t>(out - bytes.data()));
+}
+
+void ImageEncoder::EncodeRaw(const unsigned char* pixels, int width, int height, int channels, int outputChannels,
+                             std::vector<unsigned char>& bytes) {
+    RawImageHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, RawImageMagic, sizeof(RawImageMagic));
+    header.Version = 1;
+    header.Width = static_cast<std::uint32_t>(width);
+    header.Height = static_cast<std::uint32_t>(height);
+    header.Channels = static_cast<std::uint32_t>(outputChannels);
+    header.PixelOffset = sizeof(RawImageHeader);
+
+    const std::size_t stride = static_cast<std::size_t>(width) * outputChannels;
+    bytes.resize(sizeof(header) + stride * height);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    for (int y = 0; y < height; ++y) {
+        CopyChannels(pixels + static_cast<std::size_t>(height - 1 - y) * width * channels, channels,
+                     static_cast<std::size_t>(width), bytes.data() + sizeof(header) + stride * y, outputChannels);
+    }
+}
+
+bool ImageEncoder::EncodeJpeg(const unsigned char* pixels, int width, int height, int channels,
+                              std::vector<unsigned char>& bytes, std::string& error) {
+    const std::size_t count = static_cast<std::size_t>(width) * height;
+    if (channels == 4) {
+        this->Rgb.resize(count * 3);
+        CopyChannels(pixels, 4, count, this->Rgb.data(), 3);
+        pixels = this->Rgb.data();
+    }
+    // vtkJPEGWriter сам переворачивает строки снизу вверх.
+    vtkNew<vtkUnsignedCharArray> scalars;
+    scalars->SetNumberOfComponents(3);
+    scalars->SetArray(const_cast<unsigned char*>(pixels), static_cast<vtkIdType>(count * 3), 1);
+    this->JpegImage->SetDimensions(width, height, 1);
+    this->JpegImage->GetPointData()->SetScalars(scalars);
+    this->JpegWriter->SetQuality(std::min(100, std::max(0, this->Encoding.JpegQuality)));
+    this->JpegWriter->SetInputData(this->JpegImage);
+    this->JpegWriter->Write();
+    vtkUnsignedCharArray* result = this->JpegWriter->GetResult();
+    this->JpegImage->GetPointData()->SetScalars(nullptr);
+    if (this->JpegWriter->GetErrorCode() != 0 || result == nullptr) {
+        error = "cannot encode JPEG";
+        return false;
+    }
+    const unsigned char* jpeg = result->GetPointer(0);
+    bytes.assign(jpeg, jpeg + result->GetNumberOfTuples() * result->GetNumberOfComponents());
+    return true;
+}
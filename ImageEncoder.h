@@ -0,0 +1,93 @@
+#ifndef IMAGE_ENCODER_H
+#define IMAGE_ENCODER_H
+
+#include <vtkImageData.h>
+#include <vtkJPEGWriter.h>
+#include <vtkNew.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Формат файла кадра; выбирается по расширению пути (ImageFormatFromPath).
+enum class ImageFormat {
+    Png,  // .png и любое другое расширение
+    Jpeg, // .jpg, .jpeg — с потерями, без альфа-канала
+    Qoi,  // .qoi — «Quite OK Image», без потерь, кодируется в разы быстрее PNG
+    Raw,  // .raw — RawImageHeader и пиксели как есть
+};
+
+ImageFormat ImageFormatFromPath(const std::string& path);
+
+// Фильтр строк PNG перед сжатием (раздел 9 спецификации PNG). Adaptive выбирает для каждой строки фильтр
+// с наименьшей суммой модулей, как libpng; остальные применяют один фильтр ко всем строкам и дешевле.
+enum class PngFilter {
+    None = 0,
+    Sub = 1,
+    Up = 2,
+    Average = 3,
+    Paeth = 4,
+    Adaptive = 5,
+};
+
+bool ParsePngFilter(const std::string& name, PngFilter& filter);
+
+// Настройки кодирования кадров пакета.
+struct ImageEncoding {
+    int PngLevel = 5; // уровень zlib 0..9; 5 — как у vtkPNGWriter
+    PngFilter Filter = PngFilter::Adaptive;
+    int JpegQuality = 95;
+    bool Alpha = false; // сохранять альфа-канал (PNG, QOI, raw); иначе кадр пишется как RGB
+};
+
+// Сколько каналов будет в файле: 4 — только если альфа нужна, есть в кадре и формат ее хранит.
+int GetOutputChannels(const ImageEncoding& encoding, ImageFormat format, int channels);
+
+// Копирует пиксели, отбрасывая альфа-канал, если targetChannels == 3, а у источника их 4.
+void CopyChannels(const unsigned char* source, int sourceChannels, std::size_t pixels, unsigned char* target,
+                  int targetChannels);
+
+// Двоичный кадр (.raw), рассчитанный на отображение в память: заголовок и Width * Height * Channels
+// байт с PixelOffset, строки сверху вниз, как в PNG того же кадра.
+struct RawImageHeader {
+    char Magic[8];          // "DOCIMAGE"
+    std::uint32_t Version;  // 1
+    std::uint32_t Width;
+    std::uint32_t Height;
+    std::uint32_t Channels; // 3 — RGB, 4 — RGBA
+    std::uint64_t PixelOffset;
+};
+
+// Кодирует кадры в файлы выбранного формата. Буферы переиспользуются между кадрами; объект не потокобезопасен,
+// поэтому у каждого потока кодирования свой.
+class ImageEncoder {
+public:
+    ImageEncoder();
+
+    void SetEncoding(const ImageEncoding& encoding) { this->Encoding = encoding; }
+    const ImageEncoding& GetEncoding() const { return this->Encoding; }
+
+    // pixels — channels (3 или 4) байт на пиксель, строки снизу вверх, как у кадров VTK и растеризатора.
+    bool Encode(const unsigned char* pixels, int width, int height, int channels, ImageFormat format,
+                std::vector<unsigned char>& bytes, std::string& error);
+
+private:
+    bool EncodePng(const unsigned char* pixels, int width, int height, int channels, int outputChannels,
+                   std::vector<unsigned char>& bytes, std::string& error);
+    void EncodeQoi(const unsigned char* pixels, int width, int height, int channels, int outputChannels,
+                   std::vector<unsigned char>& bytes);
+    void EncodeRaw(const unsigned char* pixels, int width, int height, int channels, int outputChannels,
+                   std::vector<unsigned char>& bytes);
+    bool EncodeJpeg(const unsigned char* pixels, int width, int height, int channels,
+                    std::vector<unsigned char>& bytes, std::string& error);
+
+    ImageEncoding Encoding;
+    std::vector<unsigned char> Filtered; // строки PNG с байтом фильтра перед каждой
+    std::vector<unsigned char> Rows;     // текущая и предыдущая строки без альфы, кандидаты фильтров
+    std::vector<unsigned char> Rgb;      // кадр без альфы для JPEG
+    vtkNew<vtkJPEGWriter> JpegWriter;
+    vtkNew<vtkImageData> JpegImage;
+};
+
+#endif // IMAGE_ENCODER_H
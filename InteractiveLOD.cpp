@@ -0,0 +1,128 @@
+#include "InteractiveLOD.h"
+
+#include <vtkQuadricDecimation.h>
+#include <vtkRenderWindowInteractor.h>
+#include <vtkTriangleFilter.h>
+
+#include <chrono>
+#include <iostream>
+
+InteractiveLOD::~InteractiveLOD() {
+    if (this->Builder.joinable()) {
+        this->Builder.join();
+    }
+}
+
+void InteractiveLOD::Attach(vtkBoxWidget* widget, vtkActor* actor, vtkProp3D* follower) {
+    this->Widget = widget;
+    this->Actor = actor;
+    this->Follower = follower;
+    this->Interactor = widget->GetInteractor();
+    this->FullMapper = actor->GetMapper();
+    widget->AddObserver(vtkCommand::StartInteractionEvent, this);
+    widget->AddObserver(vtkCommand::InteractionEvent, this);
+    widget->AddObserver(vtkCommand::EndInteractionEvent, this);
+    this->Interactor->AddObserver(vtkCommand::TimerEvent, this);
+}
+
+void InteractiveLOD::BuildProxy(vtkIdType triangles) {
+    auto* mapper = vtkPolyDataMapper::SafeDownCast(this->FullMapper);
+    if (mapper == nullptr || mapper->GetInputAlgorithm() == nullptr || this->Builder.joinable()) {
+        return;
+    }
+    mapper->GetInputAlgorithm()->Update();
+    vtkPolyData* input = mapper->GetInput();
+    if (input == nullptr || input->GetNumberOfCells() <= triangles) {
+        return;
+    }
+    // Фильтры только читают массивы входа, а повторное выполнение источника создает новые массивы,
+    // поэтому поверхностной копии достаточно, чтобы фоновый поток не зависел от конвейера окна.
+    vtkSmartPointer<vtkPolyData> mesh = vtkSmartPointer<vtkPolyData>::New();
+    mesh->ShallowCopy(input);
+    this->Builder = std::thread([this, mesh, triangles] {
+        const auto start = std::chrono::steady_clock::now();
+        vtkNew<vtkTriangleFilter> triangulate;
+        triangulate->SetInputData(mesh);
+        triangulate->PassVertsOff();
+        triangulate->PassLinesOff();
+        triangulate->Update();
+        const vtkIdType full = triangulate->GetOutput()->GetNumberOfPolys();
+        if (full <= triangles) {
+            return;
+        }
+        vtkNew<vtkQuadricDecimation> decimate;
+        decimate->SetInputConnection(triangulate->GetOutputPort());
+        decimate->SetTargetReduction(1.0 - static_cast<double>(triangles) / static_cast<double>(full));
+        decimate->VolumePreservationOn();
+        // Текстурные координаты и нормали интерполируются в новые точки, не влияя на выбор ребер.
+        decimate->MapPointDataOn();
+        decimate->Update();
+        this->Proxy = decimate->GetOutput();
+        this->ProxyReady.store(true, std::memory_order_release);
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "interaction proxy: " << full << " -> " << this->Proxy->GetNumberOfPolys() << " triangles in "
+                  << seconds << " s" << std::endl;
+    });
+}
+
+void InteractiveLOD::Execute(vtkObject* caller, unsigned long event, void* callData) {
+    if (caller == this->Widget) {
+        if (event == vtkCommand::StartInteractionEvent) {
+            this->StartInteraction();
+        } else if (event == vtkCommand::InteractionEvent) {
+            this->Dirty = true;
+        } else if (event == vtkCommand::EndInteractionEvent) {
+            this->EndInteraction();
+        }
+        return;
+    }
+    // Таймеры интерактора общие для всех наблюдателей: чужие события пропускаются по номеру.
+    if (event == vtkCommand::TimerEvent && this->TimerId >= 0 && callData != nullptr &&
+        *static_cast<int*>(callData) == this->TimerId && this->ApplyTransform()) {
+        this->Interactor->EnableRenderOn();
+        this->Interactor->Render();
+        this->Interactor->EnableRenderOff();
+    }
+}
+
+void InteractiveLOD::StartInteraction() {
+    if (this->ProxyReady.load(std::memory_order_acquire)) {
+        if (!this->ProxyAttached) {
+            this->Builder.join();
+            // Те же настройки цвета и отсечения, что у полного маппера, но своя сетка и свои буферы на GPU.
+            this->ProxyMapper->ShallowCopy(this->FullMapper);
+            this->ProxyMapper->SetInputData(this->Proxy);
+            this->ProxyAttached = true;
+        }
+        this->Actor->SetMapper(this->ProxyMapper);
+    }
+    // Виджет сам перерисовывает окно после каждого события мыши; пока идет перетаскивание,
+    // рисует только таймер.
+    this->Interactor->EnableRenderOff();
+    this->TimerId = this->Interactor->CreateRepeatingTimer(static_cast<unsigned long>(1000.0 / this->FrameRate));
+    this->Dirty = true;
+}
+
+void InteractiveLOD::EndInteraction() {
+    if (this->TimerId >= 0) {
+        this->Interactor->DestroyTimer(this->TimerId);
+        this->TimerId = -1;
+    }
+    this->ApplyTransform();
+    this->Actor->SetMapper(this->FullMapper);
+    // Последний кадр с полной сеткой рисует сам виджет сразу после EndInteractionEvent.
+    this->Interactor->EnableRenderOn();
+}
+
+bool InteractiveLOD::ApplyTransform() {
+    if (!this->Dirty) {
+        return false;
+    }
+    this->Dirty = false;
+    this->Widget->GetTransform(this->Transform);
+    this->Actor->SetUserTransform(this->Transform);
+    if (this->Follower != nullptr) {
+        this->Follower->SetUserTransform(this->Transform); // границы страницы двигаются вместе с ней
+    }
+    return true;
+}
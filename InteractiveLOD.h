@@ -0,0 +1,71 @@
+#ifndef INTERACTIVE_LOD_H
+#define INTERACTIVE_LOD_H
+
+#include <vtkActor.h>
+#include <vtkBoxWidget.h>
+#include <vtkCommand.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkSmartPointer.h>
+#include <vtkTransform.h>
+
+#include <atomic>
+#include <thread>
+
+class vtkRenderWindowInteractor;
+
+// Интерактивный режим vtkBoxWidget для плотных сеток.
+// Пока виджет тянут, актор рисуется упрощенной копией сетки (quadric decimation, строится один раз
+// в фоновом потоке), а InteractionEvent только помечает кадр устаревшим: трансформация применяется
+// и сцена перерисовывается по таймеру с частотой дисплея, сколько бы событий мыши ни пришло между кадрами.
+// По отпусканию виджета актору возвращается исходный маппер; его буферы на GPU не выгружались,
+// поэтому полная сетка появляется без повторной загрузки.
+class InteractiveLOD : public vtkCommand {
+public:
+    static InteractiveLOD* New() { return new InteractiveLOD; }
+    vtkTypeMacro(InteractiveLOD, vtkCommand);
+
+    // Подписывается на события виджета и его интерактора. actor — объект виджета (SetProp3D),
+    // follower повторяет его трансформацию (может быть nullptr).
+    void Attach(vtkBoxWidget* widget, vtkActor* actor, vtkProp3D* follower);
+
+    // Запускает в фоне упрощение текущего входа маппера актора примерно до triangles треугольников.
+    // Пока копия не готова, и для сеток не больше triangles перетаскивание идет с полной сеткой.
+    void BuildProxy(vtkIdType triangles);
+
+    // Частота перерисовки во время перетаскивания, кадров в секунду (по умолчанию 60).
+    void SetFrameRate(double fps) { this->FrameRate = fps > 1.0 ? fps : 1.0; }
+
+    void Execute(vtkObject* caller, unsigned long event, void* callData) override;
+
+protected:
+    InteractiveLOD() = default;
+    ~InteractiveLOD() override;
+
+private:
+    InteractiveLOD(const InteractiveLOD&) = delete;
+    void operator=(const InteractiveLOD&) = delete;
+
+    void StartInteraction();
+    void EndInteraction();
+    // Применяет последнюю трансформацию виджета, если она менялась с прошлого кадра.
+    bool ApplyTransform();
+
+    vtkBoxWidget* Widget = nullptr;
+    vtkActor* Actor = nullptr;
+    vtkProp3D* Follower = nullptr;
+    vtkRenderWindowInteractor* Interactor = nullptr;
+    vtkNew<vtkTransform> Transform; // одна трансформация на все события, ее разделяют актор и follower
+    vtkSmartPointer<vtkMapper> FullMapper;
+    vtkNew<vtkPolyDataMapper> ProxyMapper;
+    vtkSmartPointer<vtkPolyData> Proxy; // пишет поток Builder; читается только после ProxyReady
+    std::thread Builder;
+    std::atomic<bool> ProxyReady{false};
+    bool ProxyAttached = false; // ProxyMapper уже настроен по FullMapper
+    double FrameRate = 60.0;
+    int TimerId = -1;
+    bool Dirty = false;
+};
+
+#endif // INTERACTIVE_LOD_H
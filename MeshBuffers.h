@@ -0,0 +1,71 @@
+#ifndef MESH_BUFFERS_H
+#define MESH_BUFFERS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Невладеющее представление треугольной сетки в виде структуры массивов (SoA):
+// каждая координата хранится отдельным непрерывным массивом, что удобно для векторных циклов.
+// Нормали и текстурные координаты необязательны (nullptr).
+struct MeshView {
+    std::size_t PointCount = 0;
+    const float* X = nullptr;
+    const float* Y = nullptr;
+    const float* Z = nullptr;
+    const float* U = nullptr;
+    const float* V = nullptr;
+    const float* NX = nullptr;
+    const float* NY = nullptr;
+    const float* NZ = nullptr;
+
+    std::size_t TriangleCount = 0;
+    const std::uint32_t* Indices = nullptr; // 3 * TriangleCount индексов точек
+
+    bool HasTCoords() const { return this->U != nullptr && this->V != nullptr; }
+    bool HasNormals() const { return this->NX != nullptr && this->NY != nullptr && this->NZ != nullptr; }
+};
+
+// Сетка, владеющая своими массивами.
+struct MeshBuffers {
+    std::vector<float> X, Y, Z;
+    std::vector<float> U, V;    // пусто, если текстурных координат нет
+    std::vector<float> NX, NY, NZ; // пусто, если нормалей нет
+    std::vector<std::uint32_t> Indices;
+
+    std::size_t GetPointCount() const { return this->X.size(); }
+    std::size_t GetTriangleCount() const { return this->Indices.size() / 3; }
+
+    void Resize(std::size_t points, bool tcoords, bool normals) {
+        this->X.resize(points);
+        this->Y.resize(points);
+        this->Z.resize(points);
+        this->U.resize(tcoords ? points : 0);
+        this->V.resize(tcoords ? points : 0);
+        this->NX.resize(normals ? points : 0);
+        this->NY.resize(normals ? points : 0);
+        this->NZ.resize(normals ? points : 0);
+    }
+
+    MeshView GetView() const {
+        MeshView view;
+        view.PointCount = this->X.size();
+        view.X = this->X.data();
+        view.Y = this->Y.data();
+        view.Z = this->Z.data();
+        if (!this->U.empty()) {
+            view.U = this->U.data();
+            view.V = this->V.data();
+        }
+        if (!this->NX.empty()) {
+            view.NX = this->NX.data();
+            view.NY = this->NY.data();
+            view.NZ = this->NZ.data();
+        }
+        view.TriangleCount = this->Indices.size() / 3;
+        view.Indices = this->Indices.data();
+        return view;
+    }
+};
+
+#endif // MESH_BUFFERS_H
@@ -0,0 +1,92 @@
+#include "MeshCache.h"
+
+#include "ObjParser.h"
+#include "ThreadPool.h"
+
+#include <sys/stat.h>
+
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+    bool EndsWith(const std::string& text, const std::string& suffix) {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // Имя файла в кэше: FNV-1a от пути, времени изменения (нс) и размера исходника.
+    bool MakeCacheName(const std::string& path, std::string& name) {
+        struct stat info {};
+        if (stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+        const long long mtime = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+        const std::string key =
+            path + '|' + std::to_string(mtime) + '|' + std::to_string(static_cast<long long>(info.st_size));
+        std::uint64_t hash = 14695981039346656037ULL;
+        for (unsigned char c : key) {
+            hash = (hash ^ c) * 1099511628211ULL;
+        }
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%016llx.dmesh", static_cast<unsigned long long>(hash));
+        name = buffer;
+        return true;
+    }
+}
+
+MeshCache& MeshCache::Instance() {
+    static MeshCache cache;
+    return cache;
+}
+
+void MeshCache::SetDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Directory = directory;
+    if (!directory.empty()) {
+        mkdir(directory.c_str(), 0755); // уже существующий каталог — не ошибка
+    }
+}
+
+bool MeshCache::Handles(const std::string& path) const {
+    return EndsWith(path, ".dmesh") || !this->Directory.empty();
+}
+
+std::shared_ptr<const MappedMesh> MeshCache::Acquire(const std::string& path, std::string& error,
+                                                     ThreadPool* pool) {
+    std::string target = path;
+    if (!EndsWith(path, ".dmesh")) {
+        std::string name;
+        if (!MakeCacheName(path, name)) {
+            error = "cannot read mesh " + path;
+            return nullptr;
+        }
+        target = this->Directory + '/' + name;
+    }
+
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::shared_ptr<const MappedMesh> mesh = this->Mapped[target].lock();
+    if (mesh) {
+        return mesh;
+    }
+    std::string ignored;
+    mesh = MappedMesh::Open(target, target == path ? error : ignored);
+    if (!mesh && target != path) {
+        mesh = this->Convert(path, target, error, pool != nullptr ? *pool : ThreadPool::Instance());
+    }
+    if (mesh) {
+        this->Mapped[target] = mesh;
+    }
+    return mesh;
+}
+
+std::shared_ptr<const MappedMesh> MeshCache::Convert(const std::string& source, const std::string& target,
+                                                     std::string& error, ThreadPool& pool) {
+    MeshBuffers buffers;
+    if (!ParseObjFile(source, buffers, error, pool)) {
+        return nullptr;
+    }
+    if (!WriteMeshFile(target, buffers.GetView(), error)) {
+        return nullptr;
+    }
+    // Хэш и индексы сверяются один раз, при записи; готовые файлы дальше открываются без чтения содержимого.
+    return MappedMesh::Open(target, error, true);
+}
@@ -0,0 +1,42 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "MeshFile.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+class ThreadPool;
+
+// Общий для процесса кэш сеток в формате .dmesh.
+//
+// Файлы .dmesh отображаются напрямую. OBJ разбирается один раз и сохраняется в каталог кэша
+// под именем, зависящим от пути, времени изменения и размера исходника; следующие запуски
+// (и другие рабочие процессы) только отображают готовый файл. Без каталога кэша OBJ не кэшируются.
+class MeshCache {
+public:
+    static MeshCache& Instance();
+
+    void SetDirectory(const std::string& directory);
+    const std::string& GetDirectory() const { return this->Directory; }
+
+    // true, если сетку по этому пути нужно брать из кэша, а не разбирать OBJ заново.
+    bool Handles(const std::string& path) const;
+
+    // OBJ без готового .dmesh разбирается в pool (по умолчанию ThreadPool::Instance()).
+    std::shared_ptr<const MappedMesh> Acquire(const std::string& path, std::string& error,
+                                              ThreadPool* pool = nullptr);
+
+private:
+    std::shared_ptr<const MappedMesh> Convert(const std::string& source, const std::string& target,
+                                              std::string& error, ThreadPool& pool);
+
+    std::string Directory;
+    std::mutex Mutex;
+    // Уже отображенные файлы: пока сетку кто-то держит, повторный Acquire не трогает диск.
+    std::unordered_map<std::string, std::weak_ptr<const MappedMesh>> Mapped;
+};
+
+#endif // MESH_CACHE_H
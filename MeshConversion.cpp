@@ -0,0 +1,239 @@
+#include "MeshConversion.h"
+
+#include "MeshFile.h"
+
+#include <vtkCellArray.h>
+#include <vtkDataArray.h>
+#include <vtkFloatArray.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSOADataArrayTemplate.h>
+#include <vtkTypeInt32Array.h>
+#include <vtkTypeInt64Array.h>
+
+#include <initializer_list>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+    // Массивы VTK освобождают чужую память только через функцию без контекста, поэтому владельцы
+    // отображений ищутся по адресу данных: у каждого массива (и каждой SoA-компоненты) адрес свой.
+    std::mutex MappedArraysMutex;
+    std::unordered_map<const void*, std::shared_ptr<const MappedMesh>> MappedArrays;
+
+    void RetainMapping(const void* data, const std::shared_ptr<const MappedMesh>& mesh) {
+        std::lock_guard<std::mutex> lock(MappedArraysMutex);
+        MappedArrays[data] = mesh;
+    }
+
+    void ReleaseMapping(void* data) {
+        std::shared_ptr<const MappedMesh> mesh;
+        {
+            std::lock_guard<std::mutex> lock(MappedArraysMutex);
+            auto found = MappedArrays.find(data);
+            if (found == MappedArrays.end()) {
+                return;
+            }
+            mesh = std::move(found->second);
+            MappedArrays.erase(found);
+        }
+        // Последняя ссылка снимает отображение уже вне блокировки.
+    }
+
+    vtkSmartPointer<vtkDataArray> MapFloatArray(const std::shared_ptr<const MappedMesh>& mesh, const char* name,
+                                                std::initializer_list<MeshFileHeader::Section> sections) {
+        auto array = vtkSmartPointer<vtkSOADataArrayTemplate<float>>::New();
+        array->SetName(name);
+        array->SetNumberOfComponents(static_cast<int>(sections.size()));
+        const vtkIdType count = static_cast<vtkIdType>(mesh->GetHeader().PointCount);
+        int component = 0;
+        for (MeshFileHeader::Section section : sections) {
+            float* data = static_cast<float*>(const_cast<void*>(mesh->GetSection(section)));
+            RetainMapping(data, mesh);
+            array->SetArray(component, data, count, true, false, VTK_DATA_ARRAY_USER_DEFINED);
+            array->SetArrayFreeFunction(component, ReleaseMapping);
+            ++component;
+        }
+        return array;
+    }
+
+    vtkSmartPointer<vtkTypeInt32Array> MapIndexArray(const std::shared_ptr<const MappedMesh>& mesh,
+                                                     MeshFileHeader::Section section, std::size_t count) {
+        auto array = vtkSmartPointer<vtkTypeInt32Array>::New();
+        int* data = static_cast<int*>(const_cast<void*>(mesh->GetSection(section)));
+        RetainMapping(data, mesh);
+        array->SetArray(data, static_cast<vtkIdType>(count), 0, VTK_DATA_ARRAY_USER_DEFINED);
+        array->SetArrayFreeFunction(ReleaseMapping);
+        return array;
+    }
+
+    vtkSmartPointer<vtkCellArray> TriangleCells(const MeshView& mesh) {
+        const vtkIdType triangles = static_cast<vtkIdType>(mesh.TriangleCount);
+        vtkNew<vtkTypeInt64Array> offsets;
+        offsets->SetNumberOfValues(triangles + 1);
+        vtkTypeInt64* offset = offsets->WritePointer(0, triangles + 1);
+        for (vtkIdType t = 0; t <= triangles; ++t) {
+            offset[t] = t * 3;
+        }
+        vtkNew<vtkTypeInt64Array> connectivity;
+        connectivity->SetNumberOfValues(triangles * 3);
+        vtkTypeInt64* ids = connectivity->WritePointer(0, triangles * 3);
+        for (vtkIdType i = 0; i < triangles * 3; ++i) {
+            ids[i] = mesh.Indices[i];
+        }
+        auto polys = vtkSmartPointer<vtkCellArray>::New();
+        polys->SetData(offsets.Get(), connectivity.Get());
+        return polys;
+    }
+
+    // SoA-массив поверх чужих компонент без копирования; память массив не освобождает.
+    vtkSmartPointer<vtkDataArray> WrapFloatArray(const char* name, std::initializer_list<float*> components,
+                                                 std::size_t count) {
+        auto array = vtkSmartPointer<vtkSOADataArrayTemplate<float>>::New();
+        array->SetName(name);
+        array->SetNumberOfComponents(static_cast<int>(components.size()));
+        int component = 0;
+        for (float* data : components) {
+            array->SetArray(component++, data, static_cast<vtkIdType>(count), true, true);
+        }
+        return array;
+    }
+}
+
+bool MeshFromPolyData(vtkPolyData* polyData, MeshBuffers& mesh) {
+    vtkPoints* points = polyData->GetPoints();
+    if (points == nullptr) {
+        return false;
+    }
+    vtkDataArray* tcoords = polyData->GetPointData()->GetTCoords();
+    vtkDataArray* normals = polyData->GetPointData()->GetNormals();
+
+    const vtkIdType count = points->GetNumberOfPoints();
+    mesh.Resize(static_cast<std::size_t>(count), tcoords != nullptr, normals != nullptr);
+    double value[3];
+    for (vtkIdType i = 0; i < count; ++i) {
+        points->GetPoint(i, value);
+        mesh.X[i] = static_cast<float>(value[0]);
+        mesh.Y[i] = static_cast<float>(value[1]);
+        mesh.Z[i] = static_cast<float>(value[2]);
+        if (tcoords != nullptr) {
+            mesh.U[i] = static_cast<float>(tcoords->GetComponent(i, 0));
+            mesh.V[i] = static_cast<float>(tcoords->GetComponent(i, 1));
+        }
+        if (normals != nullptr) {
+            normals->GetTuple(i, value);
+            mesh.NX[i] = static_cast<float>(value[0]);
+            mesh.NY[i] = static_cast<float>(value[1]);
+            mesh.NZ[i] = static_cast<float>(value[2]);
+        }
+    }
+
+    mesh.Indices.clear();
+    mesh.Indices.reserve(static_cast<std::size_t>(polyData->GetNumberOfPolys()) * 3);
+    vtkCellArray* polys = polyData->GetPolys();
+    vtkIdType size = 0;
+    const vtkIdType* ids = nullptr;
+    for (polys->InitTraversal(); polys->GetNextCell(size, ids);) {
+        for (vtkIdType k = 2; k < size; ++k) {
+            mesh.Indices.push_back(static_cast<std::uint32_t>(ids[0]));
+            mesh.Indices.push_back(static_cast<std::uint32_t>(ids[k - 1]));
+            mesh.Indices.push_back(static_cast<std::uint32_t>(ids[k]));
+        }
+    }
+    return !mesh.Indices.empty();
+}
+
+vtkSmartPointer<vtkPolyData> PolyDataFromMesh(const MeshView& mesh) {
+    auto polyData = vtkSmartPointer<vtkPolyData>::New();
+    const vtkIdType count = static_cast<vtkIdType>(mesh.PointCount);
+
+    vtkNew<vtkFloatArray> coords;
+    coords->SetNumberOfComponents(3);
+    coords->SetNumberOfTuples(count);
+    float* xyz = coords->WritePointer(0, count * 3);
+    for (std::size_t i = 0; i < mesh.PointCount; ++i) {
+        xyz[i * 3] = mesh.X[i];
+        xyz[i * 3 + 1] = mesh.Y[i];
+        xyz[i * 3 + 2] = mesh.Z[i];
+    }
+    vtkNew<vtkPoints> points;
+    points->SetData(coords);
+    polyData->SetPoints(points);
+
+    if (mesh.HasTCoords()) {
+        vtkNew<vtkFloatArray> tcoords;
+        tcoords->SetName("TCoords");
+        tcoords->SetNumberOfComponents(2);
+        tcoords->SetNumberOfTuples(count);
+        float* uv = tcoords->WritePointer(0, count * 2);
+        for (std::size_t i = 0; i < mesh.PointCount; ++i) {
+            uv[i * 2] = mesh.U[i];
+            uv[i * 2 + 1] = mesh.V[i];
+        }
+        polyData->GetPointData()->SetTCoords(tcoords);
+    }
+    if (mesh.HasNormals()) {
+        vtkNew<vtkFloatArray> normals;
+        normals->SetName("Normals");
+        normals->SetNumberOfComponents(3);
+        normals->SetNumberOfTuples(count);
+        float* n = normals->WritePointer(0, count * 3);
+        for (std::size_t i = 0; i < mesh.PointCount; ++i) {
+            n[i * 3] = mesh.NX[i];
+            n[i * 3 + 1] = mesh.NY[i];
+            n[i * 3 + 2] = mesh.NZ[i];
+        }
+        polyData->GetPointData()->SetNormals(normals);
+    }
+
+    polyData->SetPolys(TriangleCells(mesh));
+    return polyData;
+}
+
+vtkSmartPointer<vtkPolyData> PolyDataFromMappedMesh(const std::shared_ptr<const MappedMesh>& mesh) {
+    const MeshFileHeader& header = mesh->GetHeader();
+    auto polyData = vtkSmartPointer<vtkPolyData>::New();
+
+    vtkNew<vtkPoints> points;
+    points->SetData(MapFloatArray(mesh, "Points",
+                                  {MeshFileHeader::SectionX, MeshFileHeader::SectionY, MeshFileHeader::SectionZ}));
+    polyData->SetPoints(points);
+    if (header.Flags & MeshFileHeader::HasTCoords) {
+        polyData->GetPointData()->SetTCoords(
+            MapFloatArray(mesh, "TCoords", {MeshFileHeader::SectionU, MeshFileHeader::SectionV}));
+    }
+    if (header.Flags & MeshFileHeader::HasNormals) {
+        polyData->GetPointData()->SetNormals(MapFloatArray(
+            mesh, "Normals", {MeshFileHeader::SectionNX, MeshFileHeader::SectionNY, MeshFileHeader::SectionNZ}));
+    }
+
+    const std::size_t triangles = static_cast<std::size_t>(header.TriangleCount);
+    vtkNew<vtkCellArray> polys;
+    vtkSmartPointer<vtkTypeInt32Array> offsets =
+        MapIndexArray(mesh, MeshFileHeader::SectionCellOffsets, triangles + 1);
+    vtkSmartPointer<vtkTypeInt32Array> connectivity =
+        MapIndexArray(mesh, MeshFileHeader::SectionIndices, triangles * 3);
+    polys->SetData(offsets.Get(), connectivity.Get());
+    polyData->SetPolys(polys);
+    return polyData;
+}
+
+vtkSmartPointer<vtkPolyData> PolyDataOverMesh(MeshBuffers& mesh) {
+    auto polyData = vtkSmartPointer<vtkPolyData>::New();
+    const std::size_t count = mesh.GetPointCount();
+
+    vtkNew<vtkPoints> points;
+    points->SetData(WrapFloatArray("Points", {mesh.X.data(), mesh.Y.data(), mesh.Z.data()}, count));
+    polyData->SetPoints(points);
+    if (!mesh.U.empty()) {
+        polyData->GetPointData()->SetTCoords(WrapFloatArray("TCoords", {mesh.U.data(), mesh.V.data()}, count));
+    }
+    if (!mesh.NX.empty()) {
+        polyData->GetPointData()->SetNormals(
+            WrapFloatArray("Normals", {mesh.NX.data(), mesh.NY.data(), mesh.NZ.data()}, count));
+    }
+    polyData->SetPolys(TriangleCells(mesh.GetView()));
+    return polyData;
+}
@@ -0,0 +1,31 @@
+#ifndef MESH_CONVERSION_H
+#define MESH_CONVERSION_H
+
+#include "MeshBuffers.h"
+
+#include <vtkSmartPointer.h>
+
+#include <memory>
+
+class MappedMesh;
+class vtkPolyData;
+
+// Копирует точки, текстурные координаты, нормали и полигоны vtkPolyData в SoA-буферы.
+// Многоугольники разбиваются на треугольники веером. Возвращает false, если треугольников нет.
+bool MeshFromPolyData(vtkPolyData* polyData, MeshBuffers& mesh);
+
+// Копирует SoA-сетку в новую vtkPolyData: точки, "TCoords" и "Normals" — float, ячейки — треугольники.
+vtkSmartPointer<vtkPolyData> PolyDataFromMesh(const MeshView& mesh);
+
+// Строит vtkPolyData поверх отображенного .dmesh без копирования: точки, текстурные координаты
+// и нормали — SoA-массивы, ячейки — int32-смещения и индексы прямо из файла. Каждый массив
+// удерживает отображение, пока жив сам, поэтому vtkPolyData можно свободно передавать дальше.
+// Память отображена только для чтения: полученные данные нельзя изменять.
+vtkSmartPointer<vtkPolyData> PolyDataFromMappedMesh(const std::shared_ptr<const MappedMesh>& mesh);
+
+// Строит vtkPolyData поверх массивов сетки без копирования точек, текстурных координат и нормалей
+// (полигоны копируются). Сетка должна пережить vtkPolyData и не перевыделять массивы; после изменения
+// координат на месте нужно вызвать Modified() у затронутых массивов.
+vtkSmartPointer<vtkPolyData> PolyDataOverMesh(MeshBuffers& mesh);
+
+#endif // MESH_CONVERSION_H
@@ -0,0 +1,262 @@
+#include "MeshFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace {
+    const char MeshMagic[8] = {'D', 'O', 'C', 'M', 'E', 'S', 'H', '\0'};
+    const std::uint32_t MeshVersion = 1;
+    const std::size_t SectionAlignment = 64;
+
+    std::uint64_t AlignUp(std::uint64_t value) {
+        return (value + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+    }
+
+    const std::uint64_t FnvOffset = 14695981039346656037ULL;
+    const std::uint64_t FnvPrime = 1099511628211ULL;
+
+    std::uint64_t Fnv1a(std::uint64_t hash, const void* data, std::size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash = (hash ^ bytes[i]) * FnvPrime;
+        }
+        return hash;
+    }
+
+    std::size_t SectionBytes(const MeshFileHeader& header, int section) {
+        if (section == MeshFileHeader::SectionIndices) {
+            return static_cast<std::size_t>(header.TriangleCount) * 3 * sizeof(std::int32_t);
+        }
+        if (section == MeshFileHeader::SectionCellOffsets) {
+            return static_cast<std::size_t>(header.TriangleCount + 1) * sizeof(std::int32_t);
+        }
+        return static_cast<std::size_t>(header.PointCount) * sizeof(float);
+    }
+
+    bool IsSectionPresent(const MeshFileHeader& header, int section) {
+        if (section == MeshFileHeader::SectionU || section == MeshFileHeader::SectionV) {
+            return (header.Flags & MeshFileHeader::HasTCoords) != 0;
+        }
+        if (section >= MeshFileHeader::SectionNX && section <= MeshFileHeader::SectionNZ) {
+            return (header.Flags & MeshFileHeader::HasNormals) != 0;
+        }
+        return true;
+    }
+
+    // Хэш считается по разделам в порядке их номеров, без учета выравнивающих промежутков.
+    std::uint64_t HashSections(const MeshFileHeader& header, const void* const* sections) {
+        std::uint64_t hash = FnvOffset;
+        for (int s = 0; s < MeshFileHeader::SectionCount; ++s) {
+            if (sections[s] != nullptr) {
+                hash = Fnv1a(hash, sections[s], SectionBytes(header, s));
+            }
+        }
+        return hash;
+    }
+
+    bool WriteAll(int fd, const void* data, std::size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            const ssize_t written = ::write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+}
+
+MappedMesh::~MappedMesh() {
+    if (this->Data != nullptr) {
+        munmap(this->Data, this->Size);
+    }
+}
+
+std::shared_ptr<MappedMesh> MappedMesh::Open(const std::string& path, std::string& error, bool verify) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error = "cannot open mesh " + path;
+        return nullptr;
+    }
+    struct stat info {};
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(MeshFileHeader)) {
+        ::close(fd);
+        error = "mesh file " + path + " is truncated";
+        return nullptr;
+    }
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        error = "cannot map mesh " + path;
+        return nullptr;
+    }
+
+    std::shared_ptr<MappedMesh> mesh(new MappedMesh());
+    mesh->Path = path;
+    mesh->Data = data;
+    mesh->Size = size;
+    mesh->Header = static_cast<const MeshFileHeader*>(data);
+
+    const MeshFileHeader& header = *mesh->Header;
+    if (std::memcmp(header.Magic, MeshMagic, sizeof(MeshMagic)) != 0 || header.Version != MeshVersion) {
+        error = path + " is not a mesh file of version " + std::to_string(MeshVersion);
+        return nullptr;
+    }
+    if (header.PointCount > static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max()) ||
+        header.TriangleCount * 3 > static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max())) {
+        error = "mesh file " + path + " is corrupted";
+        return nullptr;
+    }
+    for (int s = 0; s < MeshFileHeader::SectionCount; ++s) {
+        if (!IsSectionPresent(header, s)) {
+            continue;
+        }
+        const std::uint64_t offset = header.Offsets[s];
+        // Проверяются только границы: содержимое не читается, чтобы не подтягивать страницы.
+        if (offset == 0 || offset % SectionAlignment != 0 || offset + SectionBytes(header, s) > size) {
+            error = "mesh file " + path + " is corrupted";
+            return nullptr;
+        }
+    }
+    if (verify && !mesh->Verify()) {
+        error = "mesh file " + path + " is corrupted";
+        return nullptr;
+    }
+    return mesh;
+}
+
+const void* MappedMesh::GetSection(MeshFileHeader::Section section) const {
+    const std::uint64_t offset = this->Header->Offsets[section];
+    if (offset == 0 || !IsSectionPresent(*this->Header, section)) {
+        return nullptr;
+    }
+    return static_cast<const char*>(this->Data) + offset;
+}
+
+MeshView MappedMesh::GetView() const {
+    MeshView view;
+    view.PointCount = static_cast<std::size_t>(this->Header->PointCount);
+    view.X = static_cast<const float*>(this->GetSection(MeshFileHeader::SectionX));
+    view.Y = static_cast<const float*>(this->GetSection(MeshFileHeader::SectionY));
+    view.Z = static_cast<const float*>(this->GetSection(MeshFileHeader::SectionZ));
+    view.U = static_cast<const float*>(this->GetSection(MeshFileHeader::SectionU));
+    view.V = static_cast<const float*>(this->GetSection(MeshFileHeader::SectionV));
+    view.NX = static_cast<const float*>(this->GetSection(MeshFileHeader::SectionNX));
+    view.NY = static_cast<const float*>(this->GetSection(MeshFileHeader::SectionNY));
+    view.NZ = static_cast<const float*>(this->GetSection(MeshFileHeader::SectionNZ));
+    view.TriangleCount = static_cast<std::size_t>(this->Header->TriangleCount);
+    // Индексы хранятся как int32 (так их принимает vtkCellArray) и заведомо неотрицательны.
+    view.Indices = static_cast<const std::uint32_t*>(this->GetSection(MeshFileHeader::SectionIndices));
+    return view;
+}
+
+bool MappedMesh::Verify() const {
+    const void* sections[MeshFileHeader::SectionCount];
+    for (int s = 0; s < MeshFileHeader::SectionCount; ++s) {
+        sections[s] = this->GetSection(static_cast<MeshFileHeader::Section>(s));
+    }
+    if (HashSections(*this->Header, sections) != this->Header->ContentHash) {
+        return false;
+    }
+    // Неверный индекс дал бы чтение за пределами отображения.
+    const auto* indices = static_cast<const std::uint32_t*>(sections[MeshFileHeader::SectionIndices]);
+    std::uint32_t largest = 0;
+    for (std::uint64_t i = 0; i < this->Header->TriangleCount * 3; ++i) {
+        largest = std::max(largest, indices[i]);
+    }
+    return this->Header->TriangleCount == 0 || largest < this->Header->PointCount;
+}
+
+bool WriteMeshFile(const std::string& path, const MeshView& mesh, std::string& error) {
+    if (mesh.PointCount > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max()) ||
+        mesh.TriangleCount * 3 > static_cast<std::size_t>(std::numeric_limits<std::int32_t>::max())) {
+        error = "mesh is too large for " + path;
+        return false;
+    }
+    for (std::size_t i = 0; i < mesh.TriangleCount * 3; ++i) {
+        if (mesh.Indices[i] >= mesh.PointCount) {
+            error = "mesh index out of range for " + path;
+            return false;
+        }
+    }
+
+    MeshFileHeader header {};
+    std::memcpy(header.Magic, MeshMagic, sizeof(MeshMagic));
+    header.Version = MeshVersion;
+    header.Flags = (mesh.HasTCoords() ? MeshFileHeader::HasTCoords : 0u) |
+                   (mesh.HasNormals() ? MeshFileHeader::HasNormals : 0u);
+    header.PointCount = mesh.PointCount;
+    header.TriangleCount = mesh.TriangleCount;
+
+    const float infinity = std::numeric_limits<float>::infinity();
+    float bounds[6] = {infinity, -infinity, infinity, -infinity, infinity, -infinity};
+    const float* coords[3] = {mesh.X, mesh.Y, mesh.Z};
+    for (int axis = 0; axis < 3; ++axis) {
+        for (std::size_t i = 0; i < mesh.PointCount; ++i) {
+            bounds[axis * 2] = std::min(bounds[axis * 2], coords[axis][i]);
+            bounds[axis * 2 + 1] = std::max(bounds[axis * 2 + 1], coords[axis][i]);
+        }
+    }
+    std::copy(bounds, bounds + 6, header.Bounds);
+
+    std::vector<std::int32_t> cellOffsets(mesh.TriangleCount + 1);
+    for (std::size_t t = 0; t <= mesh.TriangleCount; ++t) {
+        cellOffsets[t] = static_cast<std::int32_t>(t * 3);
+    }
+
+    const void* sections[MeshFileHeader::SectionCount] = {
+        mesh.X, mesh.Y, mesh.Z,
+        mesh.HasTCoords() ? mesh.U : nullptr, mesh.HasTCoords() ? mesh.V : nullptr,
+        mesh.HasNormals() ? mesh.NX : nullptr, mesh.HasNormals() ? mesh.NY : nullptr,
+        mesh.HasNormals() ? mesh.NZ : nullptr,
+        mesh.Indices, cellOffsets.data(),
+    };
+    std::uint64_t offset = AlignUp(sizeof(MeshFileHeader));
+    for (int s = 0; s < MeshFileHeader::SectionCount; ++s) {
+        if (sections[s] != nullptr) {
+            header.Offsets[s] = offset;
+            offset = AlignUp(offset + SectionBytes(header, s));
+        }
+    }
+    header.ContentHash = HashSections(header, sections);
+
+    const std::string temporary = path + ".tmp." + std::to_string(static_cast<long>(getpid()));
+    const int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "cannot write mesh " + path;
+        return false;
+    }
+    static const char padding[SectionAlignment] = {};
+    std::uint64_t position = sizeof(MeshFileHeader);
+    bool ok = WriteAll(fd, &header, sizeof(header));
+    for (int s = 0; ok && s < MeshFileHeader::SectionCount; ++s) {
+        if (sections[s] == nullptr) {
+            continue;
+        }
+        ok = WriteAll(fd, padding, static_cast<std::size_t>(header.Offsets[s] - position)) &&
+             WriteAll(fd, sections[s], SectionBytes(header, s));
+        position = header.Offsets[s] + SectionBytes(header, s);
+    }
+    ok = ::close(fd) == 0 && ok;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        error = "cannot write mesh " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef MESH_FILE_H
+#define MESH_FILE_H
+
+#include "MeshBuffers.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Двоичный формат сетки (.dmesh), рассчитанный на отображение в память:
+//
+//   MeshFileHeader
+//   X, Y, Z[, U, V][, NX, NY, NZ]   — float32, по PointCount значений (SoA)
+//   Indices                          — int32, 3 * TriangleCount
+//   CellOffsets                      — int32, TriangleCount + 1 (0, 3, 6, ...)
+//
+// Каждый раздел выровнен по 64 байтам, смещения записаны в заголовке. Смещения ячеек лежат в файле,
+// чтобы vtkCellArray можно было собрать поверх отображения без единой копии.
+struct MeshFileHeader {
+    enum : std::uint32_t {
+        HasTCoords = 1u << 0,
+        HasNormals = 1u << 1,
+    };
+    enum Section {
+        SectionX,
+        SectionY,
+        SectionZ,
+        SectionU,
+        SectionV,
+        SectionNX,
+        SectionNY,
+        SectionNZ,
+        SectionIndices,
+        SectionCellOffsets,
+        SectionCount,
+    };
+
+    char Magic[8];               // "DOCMESH"
+    std::uint32_t Version;       // 1
+    std::uint32_t Flags;
+    std::uint64_t PointCount;
+    std::uint64_t TriangleCount;
+    float Bounds[6];             // xmin, xmax, ymin, ymax, zmin, zmax
+    std::uint64_t ContentHash;   // FNV-1a 64 по всем разделам
+    std::uint64_t Offsets[SectionCount]; // 0 — раздела нет
+};
+
+// Сетка, отображенная из .dmesh-файла. Страницы читаются с диска только при обращении к ним,
+// поэтому открытие занимает миллисекунды независимо от размера сетки.
+class MappedMesh {
+public:
+    ~MappedMesh();
+
+    MappedMesh(const MappedMesh&) = delete;
+    MappedMesh& operator=(const MappedMesh&) = delete;
+
+    // Open проверяет только заголовок и границы разделов. С verify он еще вызывает Verify и читает весь файл —
+    // так MeshCache открывает только что записанный им файл, а не каждый готовый.
+    static std::shared_ptr<MappedMesh> Open(const std::string& path, std::string& error, bool verify = false);
+
+    const MeshFileHeader& GetHeader() const { return *this->Header; }
+    MeshView GetView() const;
+    const std::string& GetPath() const { return this->Path; }
+
+    // Указатель на начало раздела или nullptr, если раздела нет.
+    const void* GetSection(MeshFileHeader::Section section) const;
+
+    // Пересчитывает хэш содержимого, сравнивает с заголовком и проверяет, что индексы меньше числа точек
+    // (читает весь файл).
+    bool Verify() const;
+
+private:
+    MappedMesh() = default;
+
+    std::string Path;
+    void* Data = nullptr;
+    std::size_t Size = 0;
+    const MeshFileHeader* Header = nullptr;
+};
+
+// Записывает сетку в .dmesh. Файл сначала пишется рядом под временным именем и затем
+// переименовывается, поэтому параллельные читатели никогда не видят недописанный файл.
+bool WriteMeshFile(const std::string& path, const MeshView& mesh, std::string& error);
+
+#endif // MESH_FILE_H
@@ -0,0 +1,472 @@
+#include "ObjParser.h"
+
+#include "ThreadPool.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    const std::int32_t NoIndex = -1;
+
+    // Файл, отображенный в память только для чтения.
+    class MappedText {
+    public:
+        ~MappedText() {
+            if (this->Data != nullptr) {
+                munmap(const_cast<char*>(this->Data), this->Size);
+            }
+        }
+
+        bool Open(const std::string& path) {
+            const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return false;
+            }
+            struct stat info {};
+            if (fstat(fd, &info) != 0) {
+                ::close(fd);
+                return false;
+            }
+            this->Size = static_cast<std::size_t>(info.st_size);
+            if (this->Size > 0) {
+                void* data = mmap(nullptr, this->Size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (data == MAP_FAILED) {
+                    ::close(fd);
+                    return false;
+                }
+                madvise(data, this->Size, MADV_SEQUENTIAL);
+                this->Data = static_cast<const char*>(data);
+            }
+            ::close(fd);
+            return true;
+        }
+
+        const char* Data = nullptr;
+        std::size_t Size = 0;
+    };
+
+    // Кусок файла из целых строк и все, что о нем известно после каждого прохода.
+    struct Chunk {
+        const char* Begin = nullptr;
+        const char* End = nullptr;
+
+        // Проход 1: число записей и строк; затем — глобальные номера первой записи каждого вида.
+        std::size_t Positions = 0, TCoords = 0, Normals = 0, Lines = 0;
+        std::size_t PositionBase = 0, TCoordBase = 0, NormalBase = 0, LineBase = 0;
+
+        // Проход 2: грани куска. Corners — тройки (v, vt, vn) с глобальными номерами от нуля.
+        std::vector<std::uint32_t> FaceSizes;
+        std::vector<std::int32_t> Corners;
+        std::size_t Triangles = 0;
+        std::size_t TriangleBase = 0;
+        bool HasTCoords = false;
+        bool HasNormals = false;
+        std::string Error;
+    };
+
+    enum class Record {
+        Other,
+        Position,
+        TCoord,
+        Normal,
+        Face,
+    };
+
+    bool IsSpace(char c) {
+        return c == ' ' || c == '\t';
+    }
+
+    const char* SkipSpaces(const char* p, const char* end) {
+        while (p < end && IsSpace(*p)) {
+            ++p;
+        }
+        return p;
+    }
+
+    // Определяет вид записи и сдвигает p за ключевое слово.
+    Record Classify(const char*& p, const char* end) {
+        p = SkipSpaces(p, end);
+        if (end - p < 2) {
+            return Record::Other;
+        }
+        if (p[0] == 'v') {
+            if (IsSpace(p[1])) {
+                p += 1;
+                return Record::Position;
+            }
+            if (end - p >= 3 && IsSpace(p[2])) {
+                if (p[1] == 't') {
+                    p += 2;
+                    return Record::TCoord;
+                }
+                if (p[1] == 'n') {
+                    p += 2;
+                    return Record::Normal;
+                }
+            }
+        } else if (p[0] == 'f' && IsSpace(p[1])) {
+            p += 1;
+            return Record::Face;
+        }
+        return Record::Other;
+    }
+
+    const char* LineEnd(const char* p, const char* end) {
+        const void* found = std::memchr(p, '\n', static_cast<std::size_t>(end - p));
+        return found != nullptr ? static_cast<const char*>(found) : end;
+    }
+
+    bool ParseFloat(const char*& p, const char* end, float& value) {
+        p = SkipSpaces(p, end);
+        if (p < end && *p == '+') {
+            ++p;
+        }
+        const std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec == std::errc::invalid_argument) {
+            return false;
+        }
+        if (result.ec == std::errc::result_out_of_range) {
+            value = 0.0f; // денормализованные числа вроде 1e-50
+        }
+        p = result.ptr;
+        return true;
+    }
+
+    // Номер OBJ (с единицы, отрицательный — относительно текущего числа записей) в номер от нуля.
+    bool ParseIndex(const char*& p, const char* end, std::size_t defined, std::size_t total, std::int32_t& index) {
+        long long value = 0;
+        const std::from_chars_result result = std::from_chars(p, end, value);
+        if (result.ec != std::errc() || value == 0) {
+            return false;
+        }
+        p = result.ptr;
+        const long long resolved = value > 0 ? value - 1 : static_cast<long long>(defined) + value;
+        if (resolved < 0 || resolved >= static_cast<long long>(total)) {
+            return false;
+        }
+        index = static_cast<std::int32_t>(resolved);
+        return true;
+    }
+
+    // Проход 1: сколько в куске строк и записей каждого вида.
+    void CountRecords(Chunk& chunk) {
+        for (const char* line = chunk.Begin; line < chunk.End;) {
+            const char* end = LineEnd(line, chunk.End);
+            const char* p = line;
+            switch (Classify(p, end)) {
+            case Record::Position:
+                ++chunk.Positions;
+                break;
+            case Record::TCoord:
+                ++chunk.TCoords;
+                break;
+            case Record::Normal:
+                ++chunk.Normals;
+                break;
+            default:
+                break;
+            }
+            ++chunk.Lines;
+            line = end + 1;
+        }
+    }
+
+    struct ParseTargets {
+        MeshBuffers* Mesh;
+        std::vector<float>* TCoordU;
+        std::vector<float>* TCoordV;
+        std::vector<float>* Normals[3];
+        std::size_t PositionCount, TCoordCount, NormalCount;
+    };
+
+    // Проход 2: вершины пишутся сразу в общие массивы, грани — в сам кусок.
+    void ParseChunk(Chunk& chunk, const ParseTargets& targets) {
+        std::size_t position = chunk.PositionBase;
+        std::size_t tcoord = chunk.TCoordBase;
+        std::size_t normal = chunk.NormalBase;
+        std::size_t lineNumber = chunk.LineBase;
+        chunk.FaceSizes.reserve(chunk.Lines - chunk.Positions - chunk.TCoords - chunk.Normals);
+        chunk.Corners.reserve(chunk.FaceSizes.capacity() * 9);
+
+        for (const char* line = chunk.Begin; line < chunk.End;) {
+            const char* end = LineEnd(line, chunk.End);
+            ++lineNumber;
+            const char* p = line;
+            const Record record = Classify(p, end);
+            bool ok = true;
+            if (record == Record::Position) {
+                ok = ParseFloat(p, end, targets.Mesh->X[position]) && ParseFloat(p, end, targets.Mesh->Y[position]) &&
+                     ParseFloat(p, end, targets.Mesh->Z[position]);
+                ++position;
+            } else if (record == Record::TCoord) {
+                float v = 0.0f;
+                ok = ParseFloat(p, end, (*targets.TCoordU)[tcoord]);
+                const char* rest = SkipSpaces(p, end);
+                if (ok && rest < end && *rest != '\r' && !ParseFloat(p, end, v)) {
+                    ok = false;
+                }
+                (*targets.TCoordV)[tcoord] = v;
+                ++tcoord;
+            } else if (record == Record::Normal) {
+                ok = ParseFloat(p, end, (*targets.Normals[0])[normal]) &&
+                     ParseFloat(p, end, (*targets.Normals[1])[normal]) &&
+                     ParseFloat(p, end, (*targets.Normals[2])[normal]);
+                ++normal;
+            } else if (record == Record::Face) {
+                std::uint32_t corners = 0;
+                for (p = SkipSpaces(p, end); ok && p < end && *p != '\r'; p = SkipSpaces(p, end)) {
+                    std::int32_t v = NoIndex, vt = NoIndex, vn = NoIndex;
+                    ok = ParseIndex(p, end, position, targets.PositionCount, v);
+                    if (ok && p < end && *p == '/') {
+                        ++p;
+                        if (p < end && *p != '/') {
+                            ok = ParseIndex(p, end, tcoord, targets.TCoordCount, vt);
+                            chunk.HasTCoords = true;
+                        }
+                        if (ok && p < end && *p == '/') {
+                            ++p;
+                            ok = ParseIndex(p, end, normal, targets.NormalCount, vn);
+                            chunk.HasNormals = true;
+                        }
+                    }
+                    if (ok && p < end && !IsSpace(*p) && *p != '\r') {
+                        ok = false;
+                    }
+                    chunk.Corners.push_back(v);
+                    chunk.Corners.push_back(vt);
+                    chunk.Corners.push_back(vn);
+                    ++corners;
+                }
+                if (corners >= 3) {
+                    chunk.FaceSizes.push_back(corners);
+                    chunk.Triangles += corners - 2;
+                } else {
+                    // Вырожденная грань: ее углы не нужны, треугольников в ней нет.
+                    chunk.Corners.resize(chunk.Corners.size() - corners * 3);
+                }
+            }
+            if (!ok) {
+                chunk.Error = "line " + std::to_string(lineNumber) + ": malformed record";
+                return;
+            }
+            line = end + 1;
+        }
+    }
+
+    // Все ли углы ссылаются на vt и vn с тем же номером, что и v.
+    bool CornersMatch(const Chunk& chunk, bool tcoords, bool normals) {
+        const std::vector<std::int32_t>& c = chunk.Corners;
+        for (std::size_t i = 0; i < c.size(); i += 3) {
+            if ((tcoords && c[i + 1] != c[i]) || (normals && c[i + 2] != c[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct CornerKey {
+        std::int32_t V, VT, VN;
+        bool operator==(const CornerKey& other) const {
+            return this->V == other.V && this->VT == other.VT && this->VN == other.VN;
+        }
+    };
+
+    struct CornerKeyHash {
+        std::size_t operator()(const CornerKey& key) const {
+            std::uint64_t h = static_cast<std::uint32_t>(key.V);
+            h = h * 0x9E3779B97F4A7C15ULL ^ static_cast<std::uint32_t>(key.VT);
+            h = h * 0x9E3779B97F4A7C15ULL ^ static_cast<std::uint32_t>(key.VN);
+            return static_cast<std::size_t>(h ^ (h >> 29));
+        }
+    };
+
+    std::uint64_t PackAttributes(std::int32_t vt, std::int32_t vn) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(vt)) << 32) | static_cast<std::uint32_t>(vn);
+    }
+}
+
+bool ParseObjFile(const std::string& path, MeshBuffers& mesh, std::string& error, ThreadPool& pool) {
+    MappedText file;
+    if (!file.Open(path)) {
+        error = "cannot read mesh " + path;
+        return false;
+    }
+
+    // Куски по несколько мегабайт: достаточно мелкие, чтобы загрузить все потоки.
+    const std::size_t threads = static_cast<std::size_t>(pool.GetThreadCount());
+    const std::size_t chunkBytes =
+        std::min<std::size_t>(std::max<std::size_t>(file.Size / (threads * 4), 1 << 20), 16 << 20);
+    std::vector<Chunk> chunks;
+    for (const char* p = file.Data, *end = file.Data + file.Size; p < end;) {
+        const char* split = p + std::min<std::size_t>(chunkBytes, static_cast<std::size_t>(end - p));
+        split = split < end ? LineEnd(split, end) + 1 : end;
+        Chunk chunk;
+        chunk.Begin = p;
+        chunk.End = std::min(split, end);
+        chunks.push_back(chunk);
+        p = chunk.End;
+    }
+
+    pool.ParallelFor(chunks.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            CountRecords(chunks[i]);
+        }
+    });
+    std::size_t positions = 0, tcoords = 0, normals = 0, lines = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.PositionBase = positions;
+        chunk.TCoordBase = tcoords;
+        chunk.NormalBase = normals;
+        chunk.LineBase = lines;
+        positions += chunk.Positions;
+        tcoords += chunk.TCoords;
+        normals += chunk.Normals;
+        lines += chunk.Lines;
+    }
+    if (positions > static_cast<std::size_t>(INT32_MAX)) {
+        error = "mesh " + path + " has too many vertices";
+        return false;
+    }
+
+    std::vector<float> tcoordU(tcoords), tcoordV(tcoords);
+    std::vector<float> normalX(normals), normalY(normals), normalZ(normals);
+    mesh.Resize(positions, false, false);
+    const ParseTargets targets = {&mesh, &tcoordU, &tcoordV, {&normalX, &normalY, &normalZ},
+                                  positions, tcoords, normals};
+    pool.ParallelFor(chunks.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            ParseChunk(chunks[i], targets);
+        }
+    });
+
+    std::size_t triangles = 0;
+    bool hasTCoords = false, hasNormals = false;
+    for (Chunk& chunk : chunks) {
+        if (!chunk.Error.empty()) {
+            error = path + ": " + chunk.Error;
+            return false;
+        }
+        chunk.TriangleBase = triangles;
+        triangles += chunk.Triangles;
+        hasTCoords = hasTCoords || chunk.HasTCoords;
+        hasNormals = hasNormals || chunk.HasNormals;
+    }
+    if (triangles == 0) {
+        error = "mesh " + path + " has no faces";
+        return false;
+    }
+
+    std::vector<char> matched(chunks.size());
+    pool.ParallelFor(chunks.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            matched[i] = CornersMatch(chunks[i], hasTCoords, hasNormals);
+        }
+    });
+
+    if (std::all_of(matched.begin(), matched.end(), [](char m) { return m != 0; })) {
+        // Номера совпадают: точки — вершины файла как есть, атрибуты — по тем же номерам.
+        if (hasTCoords) {
+            tcoordU.resize(positions);
+            tcoordV.resize(positions);
+            mesh.U = std::move(tcoordU);
+            mesh.V = std::move(tcoordV);
+        }
+        if (hasNormals) {
+            normalX.resize(positions);
+            normalY.resize(positions);
+            normalZ.resize(positions);
+            mesh.NX = std::move(normalX);
+            mesh.NY = std::move(normalY);
+            mesh.NZ = std::move(normalZ);
+        }
+    } else {
+        // Каждой вершине достается первая встреченная у нее пара (vt, vn); для других пар
+        // (швы развертки, острые ребра) в порядке появления заводятся новые точки. Проход
+        // последовательный, но состоит из обращений к массиву и редких поисков в хэш-таблице.
+        // Признак «пара уже выбрана» хранится отдельно: любое значение first, включая пару без vt и vn,
+        // может оказаться настоящей парой вершины.
+        std::vector<std::uint64_t> first(positions, PackAttributes(NoIndex, NoIndex));
+        std::vector<char> assigned(positions);
+        std::unordered_map<CornerKey, std::int32_t, CornerKeyHash> extra;
+        std::vector<CornerKey> extraKeys;
+        for (Chunk& chunk : chunks) {
+            std::vector<std::int32_t>& c = chunk.Corners;
+            for (std::size_t i = 0; i < c.size(); i += 3) {
+                const std::int32_t vt = hasTCoords ? c[i + 1] : NoIndex;
+                const std::int32_t vn = hasNormals ? c[i + 2] : NoIndex;
+                const std::uint64_t attributes = PackAttributes(vt, vn);
+                const std::size_t vertex = static_cast<std::size_t>(c[i]);
+                if (!assigned[vertex]) {
+                    assigned[vertex] = 1;
+                    first[vertex] = attributes;
+                } else if (first[vertex] != attributes) {
+                    const CornerKey key = {c[i], vt, vn};
+                    auto inserted = extra.emplace(key, static_cast<std::int32_t>(positions + extraKeys.size()));
+                    if (inserted.second) {
+                        extraKeys.push_back(key);
+                    }
+                    c[i] = inserted.first->second;
+                }
+            }
+        }
+
+        const std::size_t points = positions + extraKeys.size();
+        if (points > static_cast<std::size_t>(INT32_MAX)) {
+            error = "mesh " + path + " has too many vertices";
+            return false;
+        }
+        mesh.Resize(points, hasTCoords, hasNormals);
+        const auto assign = [&](std::size_t point, std::size_t source, std::int32_t vt, std::int32_t vn) {
+            if (point != source) {
+                mesh.X[point] = mesh.X[source];
+                mesh.Y[point] = mesh.Y[source];
+                mesh.Z[point] = mesh.Z[source];
+            }
+            if (hasTCoords) {
+                mesh.U[point] = vt != NoIndex ? tcoordU[static_cast<std::size_t>(vt)] : 0.0f;
+                mesh.V[point] = vt != NoIndex ? tcoordV[static_cast<std::size_t>(vt)] : 0.0f;
+            }
+            if (hasNormals) {
+                mesh.NX[point] = vn != NoIndex ? normalX[static_cast<std::size_t>(vn)] : 0.0f;
+                mesh.NY[point] = vn != NoIndex ? normalY[static_cast<std::size_t>(vn)] : 0.0f;
+                mesh.NZ[point] = vn != NoIndex ? normalZ[static_cast<std::size_t>(vn)] : 0.0f;
+            }
+        };
+        for (std::size_t i = 0; i < positions; ++i) {
+            const std::uint64_t attributes = first[i];
+            assign(i, i, static_cast<std::int32_t>(attributes >> 32), static_cast<std::int32_t>(attributes));
+        }
+        for (std::size_t k = 0; k < extraKeys.size(); ++k) {
+            const CornerKey& key = extraKeys[k];
+            assign(positions + k, static_cast<std::size_t>(key.V), key.VT, key.VN);
+        }
+    }
+
+    // Проход 3: грани разбиваются веером — так же, как MeshFromPolyData разбивает полигоны VTK.
+    mesh.Indices.resize(triangles * 3);
+    pool.ParallelFor(chunks.size(), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const Chunk& chunk = chunks[i];
+            std::uint32_t* out = mesh.Indices.data() + chunk.TriangleBase * 3;
+            const std::int32_t* corner = chunk.Corners.data();
+            for (std::uint32_t size : chunk.FaceSizes) {
+                for (std::uint32_t k = 2; k < size; ++k) {
+                    *out++ = static_cast<std::uint32_t>(corner[0]);
+                    *out++ = static_cast<std::uint32_t>(corner[(k - 1) * 3]);
+                    *out++ = static_cast<std::uint32_t>(corner[k * 3]);
+                }
+                corner += size * 3;
+            }
+        }
+    });
+    return true;
+}
@@ -0,0 +1,24 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include "MeshBuffers.h"
+
+#include <string>
+
+class ThreadPool;
+
+// Параллельный разбор Wavefront OBJ в SoA-буферы.
+//
+// Файл отображается в память и делится на куски по границам строк. Первый проход считает
+// в каждом куске записи v/vt/vn/f и строки, чтобы знать глобальные номера до разбора; второй
+// разбирает куски параллельно (числа — std::from_chars) и пишет вершины сразу на их место
+// в общих массивах; третий строит индексы треугольников. Результат не зависит от числа потоков.
+//
+// Геометрия совпадает с MeshFromPolyData(vtkOBJReader): многоугольники разбиваются веером,
+// и если у всех углов номера vt/vn равны номеру v, точки берутся из файла один к одному.
+// Иначе vtkOBJReader дублирует точку для каждого угла каждой грани, а здесь новая точка
+// заводится только для каждой новой тройки (v, vt, vn) — треугольники и их атрибуты те же,
+// но точек в разы меньше. Записи l, p, o, g, s, usemtl и mtllib пропускаются.
+bool ParseObjFile(const std::string& path, MeshBuffers& mesh, std::string& error, ThreadPool& pool);
+
+#endif // OBJ_PARSER_H
@@ -0,0 +1,428 @@
+#include "PageDeformer.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <sstream>
+
+const float PageDeformer::PageWidth = 0.913f;
+const float PageDeformer::PageHeight = 1.291f;
+
+namespace {
+    const float Pi = 3.14159265358979f;
+    const std::size_t RowGrain = 8;
+
+    struct WarpSyntax {
+        const char* Name;
+        PageWarpType Type;
+        int ParameterCount;
+        float Defaults[4];
+    };
+
+    const WarpSyntax WarpSyntaxes[] = {
+        {"curl", PageWarpType::Curl, 3, {0.15f, 0.2f, 0.0f, 0.0f}},
+        {"fold", PageWarpType::Fold, 4, {0.0f, 0.0f, 90.0f, 0.01f}},
+        {"lift", PageWarpType::Lift, 3, {2.0f, 0.3f, 0.1f, 0.0f}},
+        {"wave", PageWarpType::Wave, 4, {0.01f, 0.3f, 0.0f, 0.0f}},
+        {"noise", PageWarpType::Noise, 3, {0.01f, 0.2f, 1.0f, 0.0f}},
+    };
+
+    bool IsHeightWarp(PageWarpType type) {
+        return type == PageWarpType::Lift || type == PageWarpType::Wave || type == PageWarpType::Noise;
+    }
+
+    const char* CheckWarp(const PageWarp& warp) {
+        const float* p = warp.Parameters;
+        switch (warp.Type) {
+        case PageWarpType::Curl:
+            return p[0] != 0.0f ? nullptr : "curl radius must not be 0";
+        case PageWarpType::Fold:
+            return p[3] >= 0.0f ? nullptr : "fold radius must not be negative";
+        case PageWarpType::Lift:
+            if (p[0] != std::floor(p[0]) || p[0] < 0.0f || p[0] > 3.0f) {
+                return "lift corner must be 0, 1, 2 or 3";
+            }
+            return p[1] > 0.0f ? nullptr : "lift radius must be positive";
+        case PageWarpType::Wave:
+            return p[1] > 0.0f ? nullptr : "wave length must be positive";
+        case PageWarpType::Noise:
+            return p[1] > 0.0f ? nullptr : "noise scale must be positive";
+        }
+        return nullptr;
+    }
+
+    // Значение узла решетки шума в [-1, 1]: целочисленное перемешивание семени и координат узла.
+    float LatticeValue(std::uint32_t seed, std::int32_t i, std::int32_t j) {
+        std::uint32_t h = seed * 0x9E3779B9u ^ static_cast<std::uint32_t>(i) * 0x85EBCA6Bu ^
+                          static_cast<std::uint32_t>(j) * 0xC2B2AE35u;
+        h ^= h >> 16;
+        h *= 0x7FEB352Du;
+        h ^= h >> 15;
+        h *= 0x846CA68Bu;
+        h ^= h >> 16;
+        return static_cast<float>(h >> 8) * (2.0f / 16777216.0f) - 1.0f;
+    }
+
+    float SmoothStep(float t) {
+        return t * t * (3.0f - 2.0f * t);
+    }
+}
+
+bool ParsePageWarps(const std::string& spec, std::vector<PageWarp>& warps, std::string& error) {
+    warps.clear();
+    std::istringstream stream(spec);
+    std::string item;
+    while (std::getline(stream, item, '+')) {
+        const std::string::size_type open = item.find('(');
+        const std::string name = item.substr(0, open);
+        const WarpSyntax* syntax = nullptr;
+        for (const WarpSyntax& candidate : WarpSyntaxes) {
+            if (name == candidate.Name) {
+                syntax = &candidate;
+            }
+        }
+        if (!syntax) {
+            error = "unknown warp '" + name + "'";
+            return false;
+        }
+
+        PageWarp warp;
+        warp.Type = syntax->Type;
+        std::copy(syntax->Defaults, syntax->Defaults + 4, warp.Parameters);
+        if (open != std::string::npos) {
+            if (item.back() != ')') {
+                error = "expected ')' in warp '" + item + "'";
+                return false;
+            }
+            std::istringstream arguments(item.substr(open + 1, item.size() - open - 2));
+            std::string argument;
+            int count = 0;
+            while (std::getline(arguments, argument, ',')) {
+                char* end = nullptr;
+                const float value = std::strtof(argument.c_str(), &end);
+                if (count == syntax->ParameterCount || argument.empty() || *end != '\0') {
+                    error = "bad arguments of warp '" + item + "'";
+                    return false;
+                }
+                warp.Parameters[count++] = value;
+            }
+        }
+        if (const char* problem = CheckWarp(warp)) {
+            error = problem;
+            return false;
+        }
+        warps.push_back(warp);
+    }
+    if (warps.empty()) {
+        error = "empty warp list";
+        return false;
+    }
+    return true;
+}
+
+std::string FormatPageWarps(const std::vector<PageWarp>& warps) {
+    std::string spec;
+    for (const PageWarp& warp : warps) {
+        for (const WarpSyntax& syntax : WarpSyntaxes) {
+            if (syntax.Type != warp.Type) {
+                continue;
+            }
+            spec += spec.empty() ? "" : "+";
+            spec += syntax.Name;
+            for (int i = 0; i < syntax.ParameterCount; ++i) {
+                char buffer[32];
+                std::snprintf(buffer, sizeof(buffer), "%.9g", warp.Parameters[i]);
+                spec += i == 0 ? "(" : ",";
+                spec += buffer;
+            }
+            spec += ")";
+        }
+    }
+    return spec;
+}
+
+PageDeformer::PageDeformer() {
+    this->SetResolution(128, 181);
+}
+
+void PageDeformer::SetResolution(int columns, int rows) {
+    if (columns == this->Columns && rows == this->Rows) {
+        return;
+    }
+    this->Columns = std::max(1, columns);
+    this->Rows = std::max(1, rows);
+    const std::size_t stride = static_cast<std::size_t>(this->Columns) + 1;
+    const std::size_t points = stride * (this->Rows + 1);
+
+    // Плоский лист: те же точки, текстурные координаты и нормали, что у vtkPlaneSource с этим разрешением.
+    this->Mesh.Resize(points, true, true);
+    for (int j = 0; j <= this->Rows; ++j) {
+        for (int i = 0; i <= this->Columns; ++i) {
+            const std::size_t p = j * stride + i;
+            this->Mesh.U[p] = static_cast<float>(i) / this->Columns;
+            this->Mesh.V[p] = static_cast<float>(j) / this->Rows;
+            this->Mesh.X[p] = (this->Mesh.U[p] - 0.5f) * PageWidth;
+            this->Mesh.Y[p] = (this->Mesh.V[p] - 0.5f) * PageHeight;
+        }
+    }
+    std::fill(this->Mesh.Z.begin(), this->Mesh.Z.end(), 0.0f);
+    std::fill(this->Mesh.NX.begin(), this->Mesh.NX.end(), 0.0f);
+    std::fill(this->Mesh.NY.begin(), this->Mesh.NY.end(), 0.0f);
+    std::fill(this->Mesh.NZ.begin(), this->Mesh.NZ.end(), 1.0f);
+
+    this->Mesh.Indices.clear();
+    this->Mesh.Indices.reserve(static_cast<std::size_t>(this->Columns) * this->Rows * 6);
+    for (int j = 0; j < this->Rows; ++j) {
+        for (int i = 0; i < this->Columns; ++i) {
+            const std::uint32_t a = static_cast<std::uint32_t>(j * stride + i);
+            const std::uint32_t b = a + 1;
+            const std::uint32_t c = a + static_cast<std::uint32_t>(stride) + 1;
+            const std::uint32_t d = a + static_cast<std::uint32_t>(stride);
+            this->Mesh.Indices.insert(this->Mesh.Indices.end(), {a, b, c, a, c, d});
+        }
+    }
+
+    this->NewX.resize(points);
+    this->NewY.resize(points);
+    this->NewZ.resize(points);
+    this->RowChanged.assign(this->Rows + 1, 0);
+}
+
+bool PageDeformer::Apply(const std::vector<PageWarp>& warps) {
+    const std::size_t stride = static_cast<std::size_t>(this->Columns) + 1;
+    const std::size_t rows = static_cast<std::size_t>(this->Rows) + 1;
+    ThreadPool& pool = ThreadPool::Instance();
+
+    pool.ParallelFor(rows, RowGrain, [&](std::size_t firstRow, std::size_t lastRow) {
+        const std::size_t begin = firstRow * stride;
+        const std::size_t end = lastRow * stride;
+        for (std::size_t p = begin; p < end; ++p) {
+            this->NewX[p] = (this->Mesh.U[p] - 0.5f) * PageWidth;
+            this->NewY[p] = (this->Mesh.V[p] - 0.5f) * PageHeight;
+            this->NewZ[p] = 0.0f;
+        }
+        for (const PageWarp& warp : warps) {
+            if (IsHeightWarp(warp.Type)) {
+                this->ApplyHeight(warp, firstRow, lastRow);
+            }
+        }
+        for (const PageWarp& warp : warps) {
+            if (!IsHeightWarp(warp.Type)) {
+                this->ApplyBend(warp, begin, end);
+            }
+        }
+
+        // В сетку переносятся только изменившиеся строки: по ним же потом пересчитываются нормали.
+        for (std::size_t row = firstRow; row < lastRow; ++row) {
+            const std::size_t offset = row * stride;
+            const std::size_t bytes = stride * sizeof(float);
+            const bool changed = std::memcmp(&this->Mesh.X[offset], &this->NewX[offset], bytes) != 0 ||
+                                 std::memcmp(&this->Mesh.Y[offset], &this->NewY[offset], bytes) != 0 ||
+                                 std::memcmp(&this->Mesh.Z[offset], &this->NewZ[offset], bytes) != 0;
+            this->RowChanged[row] = changed;
+            if (changed) {
+                std::memcpy(&this->Mesh.X[offset], &this->NewX[offset], bytes);
+                std::memcpy(&this->Mesh.Y[offset], &this->NewY[offset], bytes);
+                std::memcpy(&this->Mesh.Z[offset], &this->NewZ[offset], bytes);
+            }
+        }
+    });
+
+    // Нормаль точки зависит от соседних строк, поэтому пересчитываются и строки рядом с измененными.
+    std::atomic<int> updated{0};
+    pool.ParallelFor(rows, RowGrain, [&](std::size_t firstRow, std::size_t lastRow) {
+        int count = 0;
+        for (std::size_t row = firstRow; row < lastRow; ++row) {
+            const bool dirty = this->RowChanged[row] || (row > 0 && this->RowChanged[row - 1]) ||
+                               (row + 1 < rows && this->RowChanged[row + 1]);
+            if (dirty) {
+                this->UpdateNormals(row);
+                ++count;
+            }
+        }
+        updated += count;
+    });
+    this->UpdatedRows = updated;
+    return this->UpdatedRows > 0;
+}
+
+void PageDeformer::ApplyHeight(const PageWarp& warp, std::size_t firstRow, std::size_t lastRow) {
+    // На плоском листе координаты точки (i, j) разделяются: x зависит только от столбца, y — только от строки.
+    // Поэтому тригонометрия и узлы шума считаются по столбцам и строкам, а на точку остаются умножения.
+    const float* p = warp.Parameters;
+    const std::size_t stride = static_cast<std::size_t>(this->Columns) + 1;
+    std::vector<float> columnX(stride);
+    for (std::size_t i = 0; i < stride; ++i) {
+        columnX[i] = (static_cast<float>(i) / this->Columns - 0.5f) * PageWidth;
+    }
+    auto rowY = [this](std::size_t row) {
+        return (static_cast<float>(row) / this->Rows - 0.5f) * PageHeight;
+    };
+
+    switch (warp.Type) {
+    case PageWarpType::Lift: {
+        // Купол высоты height с плавным (smoothstep) спадом до нуля на расстоянии radius от угла.
+        const int corner = static_cast<int>(p[0]);
+        const float cornerX = (corner == 1 || corner == 2 ? 0.5f : -0.5f) * PageWidth;
+        const float cornerY = (corner >= 2 ? 0.5f : -0.5f) * PageHeight;
+        const float invRadius = 1.0f / p[1];
+        const float height = p[2];
+        for (std::size_t row = firstRow; row < lastRow; ++row) {
+            const float dy = rowY(row) - cornerY;
+            if (std::fabs(dy) >= p[1]) {
+                continue;
+            }
+            float* z = &this->NewZ[row * stride];
+            for (std::size_t i = 0; i < stride; ++i) {
+                const float dx = columnX[i] - cornerX;
+                const float t = std::max(0.0f, 1.0f - std::sqrt(dx * dx + dy * dy) * invRadius);
+                z[i] += height * SmoothStep(t);
+            }
+        }
+        break;
+    }
+    case PageWarpType::Wave: {
+        // sin(a + b) = sin(a) cos(b) + cos(a) sin(b), где a — вклад столбца, b — вклад строки и фазы.
+        const float amplitude = p[0];
+        const float frequency = 2.0f * Pi / p[1];
+        const float dirX = std::cos(p[2] * Pi / 180.0f);
+        const float dirY = std::sin(p[2] * Pi / 180.0f);
+        const float phase = p[3] * Pi / 180.0f;
+        std::vector<float> columnSin(stride), columnCos(stride);
+        for (std::size_t i = 0; i < stride; ++i) {
+            columnSin[i] = amplitude * std::sin(columnX[i] * dirX * frequency);
+            columnCos[i] = amplitude * std::cos(columnX[i] * dirX * frequency);
+        }
+        for (std::size_t row = firstRow; row < lastRow; ++row) {
+            const float b = rowY(row) * dirY * frequency + phase;
+            const float rowSin = std::sin(b);
+            const float rowCos = std::cos(b);
+            float* z = &this->NewZ[row * stride];
+            for (std::size_t i = 0; i < stride; ++i) {
+                z[i] += columnSin[i] * rowCos + columnCos[i] * rowSin;
+            }
+        }
+        break;
+    }
+    case PageWarpType::Noise: {
+        // Шум значений: случайные высоты в узлах решетки с шагом scale, между узлами — бикубическое
+        // (smoothstep) смешивание, так что поверхность остается гладкой.
+        const float amplitude = p[0];
+        const float invScale = 1.0f / p[1];
+        const std::uint32_t seed = static_cast<std::uint32_t>(static_cast<std::int64_t>(p[2]));
+        std::vector<std::int32_t> cell(stride);
+        std::vector<float> blend(stride);
+        for (std::size_t i = 0; i < stride; ++i) {
+            const float g = (columnX[i] + 0.5f * PageWidth) * invScale;
+            cell[i] = static_cast<std::int32_t>(std::floor(g));
+            blend[i] = SmoothStep(g - std::floor(g));
+        }
+        const std::int32_t cells = cell[stride - 1] + 2;
+        std::vector<float> bottom(cells), top(cells);
+        for (std::size_t row = firstRow; row < lastRow; ++row) {
+            const float g = (rowY(row) + 0.5f * PageHeight) * invScale;
+            const std::int32_t cellY = static_cast<std::int32_t>(std::floor(g));
+            const float blendY = SmoothStep(g - std::floor(g));
+            for (std::int32_t k = 0; k < cells; ++k) {
+                bottom[k] = LatticeValue(seed, k, cellY);
+                top[k] = LatticeValue(seed, k, cellY + 1);
+            }
+            float* z = &this->NewZ[row * stride];
+            for (std::size_t i = 0; i < stride; ++i) {
+                const std::int32_t k = cell[i];
+                const float lower = bottom[k] + blend[i] * (bottom[k + 1] - bottom[k]);
+                const float upper = top[k] + blend[i] * (top[k + 1] - top[k]);
+                z[i] += amplitude * (lower + blendY * (upper - lower));
+            }
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void PageDeformer::ApplyBend(const PageWarp& warp, std::size_t begin, std::size_t end) {
+    // Изгиб вокруг оси, параллельной линии start: точки за линией наматываются на цилиндр радиуса
+    // radius, а после дуги в limit радиан продолжаются по касательной. Curl — изгиб без предела,
+    // fold — с пределом degrees. Высота точки над листом сохраняется как отступ по нормали цилиндра.
+    const float* p = warp.Parameters;
+    float radius = 0.0f;
+    float start = 0.0f;
+    float angle = 0.0f;
+    float limit = std::numeric_limits<float>::max();
+    float side = 1.0f; // -1 — изгиб от камеры (в сторону -Z)
+    if (warp.Type == PageWarpType::Curl) {
+        radius = std::fabs(p[0]);
+        side = p[0] < 0.0f ? -1.0f : 1.0f;
+        start = p[1];
+        angle = p[2];
+    } else {
+        start = p[0];
+        angle = p[1];
+        limit = std::fabs(p[2]) * Pi / 180.0f;
+        side = p[2] < 0.0f ? -1.0f : 1.0f;
+        radius = p[3];
+    }
+    const float dirX = std::cos(angle * Pi / 180.0f);
+    const float dirY = std::sin(angle * Pi / 180.0f);
+    const float limitSin = std::sin(limit);
+    const float limitCos = std::cos(limit);
+    float* x = this->NewX.data();
+    float* y = this->NewY.data();
+    float* z = this->NewZ.data();
+
+    for (std::size_t i = begin; i < end; ++i) {
+        const float along = x[i] * dirX + y[i] * dirY;
+        const float across = -x[i] * dirY + y[i] * dirX;
+        const float distance = along - start;
+        if (distance <= 0.0f) {
+            continue;
+        }
+        const float height = side * z[i];
+        const float theta = radius > 0.0f ? std::min(distance / radius, limit) : limit;
+        const float straight = distance - theta * radius;
+        // За концом дуги угол постоянный, синус и косинус там уже посчитаны.
+        const float s = theta < limit ? std::sin(theta) : limitSin;
+        const float c = theta < limit ? std::cos(theta) : limitCos;
+        const float bentAlong = start + radius * s + straight * c - height * s;
+        const float bentHeight = radius * (1.0f - c) + straight * s + height * c;
+        x[i] = bentAlong * dirX - across * dirY;
+        y[i] = bentAlong * dirY + across * dirX;
+        z[i] = side * bentHeight;
+    }
+}
+
+void PageDeformer::UpdateNormals(std::size_t row) {
+    const std::size_t stride = static_cast<std::size_t>(this->Columns) + 1;
+    const std::size_t down = row > 0 ? row - 1 : row;
+    const std::size_t up = row < static_cast<std::size_t>(this->Rows) ? row + 1 : row;
+    const float* x = this->Mesh.X.data();
+    const float* y = this->Mesh.Y.data();
+    const float* z = this->Mesh.Z.data();
+
+    for (std::size_t i = 0; i < stride; ++i) {
+        // Касательные — центральные разности по решетке (на краю — односторонние), нормаль — их произведение.
+        const std::size_t left = row * stride + (i > 0 ? i - 1 : i);
+        const std::size_t right = row * stride + (i + 1 < stride ? i + 1 : i);
+        const std::size_t below = down * stride + i;
+        const std::size_t above = up * stride + i;
+        const float ux = x[right] - x[left], uy = y[right] - y[left], uz = z[right] - z[left];
+        const float vx = x[above] - x[below], vy = y[above] - y[below], vz = z[above] - z[below];
+        const float nx = uy * vz - uz * vy;
+        const float ny = uz * vx - ux * vz;
+        const float nz = ux * vy - uy * vx;
+        const float length = std::sqrt(nx * nx + ny * ny + nz * nz);
+        const float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        const std::size_t p = row * stride + i;
+        this->Mesh.NX[p] = nx * scale;
+        this->Mesh.NY[p] = ny * scale;
+        this->Mesh.NZ[p] = length > 0.0f ? nz * scale : 1.0f;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef PAGE_DEFORMER_H
+#define PAGE_DEFORMER_H
+
+#include "MeshBuffers.h"
+
+#include <string>
+#include <vector>
+
+// Вид деформации страницы. Углы — в градусах, расстояния — в единицах сцены (страница 0.913 x 1.291,
+// центр в начале координат). Направление angle отсчитывается от оси +X к оси +Y.
+enum class PageWarpType {
+    Curl,  // curl(radius, start, angle): часть страницы за линией start сворачивается в цилиндр
+    Fold,  // fold(start, angle, degrees, radius): сгиб по линии start на degrees со скруглением radius
+    Lift,  // lift(corner, radius, height): угол 0..3 (против часовой от u = 0, v = 0) поднят на height
+    Wave,  // wave(amplitude, wavelength, angle, phase): синусоидальная волна вдоль направления angle
+    Noise, // noise(amplitude, scale, seed): гладкий шум с размером ячейки scale
+};
+
+struct PageWarp {
+    PageWarpType Type = PageWarpType::Curl;
+    float Parameters[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+};
+
+// Разбирает цепочку деформаций вида "curl(0.15,0.2)+lift(2,0.3,0.1)+noise(0.005,0.1,7)".
+// Незаданные параметры берут значения по умолчанию.
+bool ParsePageWarps(const std::string& spec, std::vector<PageWarp>& warps, std::string& error);
+
+// Обратное к ParsePageWarps: цепочка со всеми параметрами каждой деформации.
+std::string FormatPageWarps(const std::vector<PageWarp>& warps);
+
+// Сетка страницы и деформации над ней. Сетка — регулярная решетка как у vtkPlaneSource с разрешением
+// Columns x Rows ячеек; топология и текстурные координаты строятся один раз при смене разрешения,
+// деформация меняет только координаты точек и нормали. Точки хранятся SoA, ядра деформаций — простые
+// циклы по строкам решетки, которые идут параллельно в ThreadPool.
+//
+// Порядок применения: сначала все смещения по высоте (lift, wave, noise) — они заданы на плоском листе
+// и складываются; затем изгибы (curl, fold) в порядке записи, каждый над результатом предыдущего.
+// Нормали считаются конечными разностями по соседям решетки и пересчитываются только в строках,
+// где точки изменились с прошлого вызова Apply.
+class PageDeformer {
+public:
+    static const float PageWidth;
+    static const float PageHeight;
+
+    PageDeformer();
+
+    void SetResolution(int columns, int rows);
+    int GetColumns() const { return this->Columns; }
+    int GetRows() const { return this->Rows; }
+
+    // Строит форму страницы. Возвращает false, если форма совпала с предыдущей и сетка не изменилась.
+    bool Apply(const std::vector<PageWarp>& warps);
+
+    // Сетка принадлежит деформатору; массивы не перевыделяются до следующего SetResolution.
+    MeshBuffers& GetMesh() { return this->Mesh; }
+    const MeshBuffers& GetMesh() const { return this->Mesh; }
+
+    // Число строк решетки, в которых пересчитывались нормали при последнем Apply.
+    int GetUpdatedRowCount() const { return this->UpdatedRows; }
+
+private:
+    void ApplyHeight(const PageWarp& warp, std::size_t firstRow, std::size_t lastRow);
+    void ApplyBend(const PageWarp& warp, std::size_t begin, std::size_t end);
+    void UpdateNormals(std::size_t row);
+
+    int Columns = 0;
+    int Rows = 0;
+    int UpdatedRows = 0;
+
+    MeshBuffers Mesh;
+    std::vector<float> NewX, NewY, NewZ; // форма, которую строит текущий Apply
+    std::vector<unsigned char> RowChanged;
+};
+
+#endif // PAGE_DEFORMER_H
@@ -0,0 +1,40 @@
+#include "ParallelOBJReader.h"
+
+#include "MeshConversion.h"
+#include "ObjParser.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
+
+#include <vtkInformation.h>
+#include <vtkInformationVector.h>
+#include <vtkObjectFactory.h>
+#include <vtkPolyData.h>
+
+vtkStandardNewMacro(ParallelOBJReader);
+
+ParallelOBJReader::ParallelOBJReader() {
+    this->SetNumberOfInputPorts(0);
+}
+
+ParallelOBJReader::~ParallelOBJReader() {
+    this->SetFileName(nullptr);
+}
+
+int ParallelOBJReader::RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector* outputVector) {
+    TRACE_SCOPE("obj.parse");
+    vtkPolyData* output = vtkPolyData::GetData(outputVector);
+    if (this->FileName == nullptr) {
+        vtkErrorMacro("A FileName must be specified.");
+        return 0;
+    }
+
+    MeshBuffers mesh;
+    std::string error;
+    ThreadPool& pool = this->Pool != nullptr ? *this->Pool : ThreadPool::Instance();
+    if (!ParseObjFile(this->FileName, mesh, error, pool)) {
+        vtkErrorMacro(<< error);
+        return 0;
+    }
+    output->ShallowCopy(PolyDataFromMesh(mesh.GetView()));
+    return 1;
+}
@@ -0,0 +1,37 @@
+#ifndef PARALLEL_OBJ_READER_H
+#define PARALLEL_OBJ_READER_H
+
+#include <vtkPolyDataAlgorithm.h>
+
+class ThreadPool;
+
+// Замена vtkOBJReader в конвейерах VTK: разбирает файл через ParseObjFile в несколько потоков.
+// На выходе — треугольники с точками, "TCoords" и "Normals" в float, как у vtkOBJReader
+// (отличия в разбиении многоугольников и числе точек описаны у ParseObjFile).
+class ParallelOBJReader : public vtkPolyDataAlgorithm {
+public:
+    static ParallelOBJReader* New();
+    vtkTypeMacro(ParallelOBJReader, vtkPolyDataAlgorithm);
+
+    vtkSetStringMacro(FileName);
+    vtkGetStringMacro(FileName);
+
+    // Пул потоков для разбора; по умолчанию ThreadPool::Instance().
+    void SetThreadPool(ThreadPool* pool) { this->Pool = pool; }
+
+protected:
+    ParallelOBJReader();
+    ~ParallelOBJReader() override;
+
+    int RequestData(vtkInformation* request, vtkInformationVector** inputVector,
+                    vtkInformationVector* outputVector) override;
+
+private:
+    ParallelOBJReader(const ParallelOBJReader&) = delete;
+    void operator=(const ParallelOBJReader&) = delete;
+
+    char* FileName = nullptr;
+    ThreadPool* Pool = nullptr;
+};
+
+#endif // PARALLEL_OBJ_READER_H
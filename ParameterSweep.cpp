@@ -0,0 +1,303 @@
+#include "ParameterSweep.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace {
+    void MultiplyHighLow(std::uint32_t a, std::uint32_t b, std::uint32_t& high, std::uint32_t& low) {
+        const std::uint64_t product = static_cast<std::uint64_t>(a) * b;
+        high = static_cast<std::uint32_t>(product >> 32);
+        low = static_cast<std::uint32_t>(product);
+    }
+
+    // Равномерное число из [0, 1) с 53 значащими битами из двух 32-битных слов.
+    double UnitInterval(std::uint32_t a, std::uint32_t b) {
+        return ((a >> 5) * 67108864.0 + (b >> 6)) * (1.0 / 9007199254740992.0);
+    }
+
+    std::string FormatNumber(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return buffer;
+    }
+
+    bool IsIdentifierChar(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    // Разбивает аргументы распределения по разделителю; пустые аргументы не допускаются.
+    bool SplitArguments(const std::string& text, char separator, std::vector<std::string>& parts) {
+        parts.clear();
+        std::istringstream stream(text);
+        std::string part;
+        while (std::getline(stream, part, separator)) {
+            if (part.empty()) {
+                return false;
+            }
+            parts.push_back(part);
+        }
+        return !parts.empty() && text.back() != separator;
+    }
+
+    bool ParseNumbers(const std::vector<std::string>& parts, double* out) {
+        for (std::size_t i = 0; i < parts.size(); ++i) {
+            char* end = nullptr;
+            out[i] = std::strtod(parts[i].c_str(), &end);
+            if (*end != '\0') {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Заменяет {index} и {index:N} номером задания.
+    void SubstituteIndex(std::string& line, std::uint64_t index) {
+        std::string::size_type pos = 0;
+        while ((pos = line.find("{index", pos)) != std::string::npos) {
+            const std::string::size_type close = line.find('}', pos);
+            if (close == std::string::npos) {
+                return;
+            }
+            int width = 0;
+            if (line[pos + 6] == ':') {
+                width = std::atoi(line.c_str() + pos + 7);
+            } else if (pos + 6 != close) {
+                pos = close;
+                continue;
+            }
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%0*llu", width, static_cast<unsigned long long>(index));
+            line.replace(pos, close + 1 - pos, buffer);
+            pos += std::char_traits<char>::length(buffer);
+        }
+    }
+}
+
+void Philox4x32(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t out[4]) {
+    std::uint32_t c[4] = {counter[0], counter[1], counter[2], counter[3]};
+    std::uint32_t k[2] = {key[0], key[1]};
+    for (int round = 0; round < 10; ++round) {
+        std::uint32_t high0, low0, high1, low1;
+        MultiplyHighLow(0xD2511F53u, c[0], high0, low0);
+        MultiplyHighLow(0xCD9E8D57u, c[2], high1, low1);
+        c[0] = high1 ^ c[1] ^ k[0];
+        c[1] = low1;
+        c[2] = high0 ^ c[3] ^ k[1];
+        c[3] = low0;
+        k[0] += 0x9E3779B9u;
+        k[1] += 0xBB67AE85u;
+    }
+    for (int i = 0; i < 4; ++i) {
+        out[i] = c[i];
+    }
+}
+
+bool ParameterSweep::Load(const std::string& path, std::string& error) {
+    std::ifstream file(path);
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string text;
+    std::string line;
+    while (std::getline(file, line)) {
+        const std::string::size_type first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        text += line;
+        text += ' ';
+    }
+    if (!this->Parse(text, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+bool ParameterSweep::Parse(const std::string& text, std::string& error) {
+    this->Text.assign(1, std::string());
+    this->Slots.clear();
+    this->GridSize = 1;
+
+    std::size_t i = 0;
+    while (i < text.size()) {
+        if (!std::isalpha(static_cast<unsigned char>(text[i])) || (i > 0 && IsIdentifierChar(text[i - 1]))) {
+            this->Text.back() += text[i++];
+            continue;
+        }
+        std::size_t end = i;
+        while (end < text.size() && IsIdentifierChar(text[end])) {
+            ++end;
+        }
+        const std::string name = text.substr(i, end - i);
+        Slot slot;
+        bool known = true;
+        if (name == "uniform") {
+            slot.Type = Distribution::Uniform;
+        } else if (name == "normal") {
+            slot.Type = Distribution::Normal;
+        } else if (name == "randint") {
+            slot.Type = Distribution::Integer;
+        } else if (name == "choice") {
+            slot.Type = Distribution::Choice;
+        } else if (name == "grid") {
+            slot.Type = Distribution::Grid;
+        } else {
+            known = false;
+        }
+        if (!known || end == text.size() || text[end] != '(') {
+            this->Text.back() += name;
+            i += name.size();
+            continue;
+        }
+
+        const std::size_t close = text.find(')', end);
+        if (close == std::string::npos) {
+            error = "unclosed " + name + "(";
+            return false;
+        }
+        const std::string arguments = text.substr(end + 1, close - end - 1);
+        const std::string expression = name + "(" + arguments + ")";
+        std::vector<std::string> parts;
+        if (!SplitArguments(arguments, slot.Type == Distribution::Choice ? '|' : ',', parts)) {
+            error = "bad arguments in " + expression;
+            return false;
+        }
+        if (slot.Type == Distribution::Choice) {
+            slot.Options = parts;
+        } else {
+            double values[3] = {0.0, 0.0, 0.0};
+            const std::size_t expected = slot.Type == Distribution::Grid ? 3 : 2;
+            if (parts.size() != expected || !ParseNumbers(parts, values)) {
+                error = "expected " + std::to_string(expected) + " numbers in " + expression;
+                return false;
+            }
+            slot.A = values[0];
+            slot.B = values[1];
+            if (slot.Type == Distribution::Grid) {
+                if (!(values[2] >= 1.0) || values[2] != std::floor(values[2])) {
+                    error = "grid size must be a positive integer in " + expression;
+                    return false;
+                }
+                slot.Count = static_cast<std::uint64_t>(values[2]);
+                slot.Stride = this->GridSize;
+                if (this->GridSize > (std::uint64_t(1) << 62) / slot.Count) {
+                    error = "too many grid points";
+                    return false;
+                }
+                this->GridSize *= slot.Count;
+            } else if (slot.Type == Distribution::Integer && (slot.A != std::floor(slot.A) ||
+                                                               slot.B != std::floor(slot.B) || slot.A > slot.B)) {
+                error = "expected integers a <= b in " + expression;
+                return false;
+            }
+        }
+        this->Slots.push_back(slot);
+        this->Text.emplace_back();
+        i = close + 1;
+    }
+
+    // Шаблон проверяется на первом задании: остальные отличаются только подставленными значениями.
+    RenderJob job;
+    if (!this->GetJob(0, job, error)) {
+        error = "job 0 '" + this->GetJobLine(0) + "': " + error;
+        return false;
+    }
+    return true;
+}
+
+void ParameterSweep::SetSeed(std::uint64_t seed) {
+    this->Key[0] = static_cast<std::uint32_t>(seed);
+    this->Key[1] = static_cast<std::uint32_t>(seed >> 32);
+}
+
+std::string ParameterSweep::Sample(const Slot& slot, std::uint64_t index, std::uint32_t slotIndex) const {
+    if (slot.Type == Distribution::Grid) {
+        const std::uint64_t node = (index / slot.Stride) % slot.Count;
+        if (slot.Count == 1) {
+            return FormatNumber(slot.A);
+        }
+        const double t = static_cast<double>(node) / static_cast<double>(slot.Count - 1);
+        return FormatNumber(slot.A + (slot.B - slot.A) * t);
+    }
+
+    const std::uint32_t counter[4] = {static_cast<std::uint32_t>(index), static_cast<std::uint32_t>(index >> 32),
+                                      slotIndex, 0};
+    std::uint32_t bits[4];
+    Philox4x32(counter, this->Key, bits);
+    const double u = UnitInterval(bits[0], bits[1]);
+    switch (slot.Type) {
+    case Distribution::Uniform:
+        return FormatNumber(slot.A + (slot.B - slot.A) * u);
+    case Distribution::Normal: {
+        // Бокс — Мюллер; 1 - u лежит в (0, 1], поэтому логарифм конечен.
+        const double v = UnitInterval(bits[2], bits[3]);
+        const double pi = 3.14159265358979323846;
+        return FormatNumber(slot.A + slot.B * std::sqrt(-2.0 * std::log(1.0 - u)) * std::cos(2.0 * pi * v));
+    }
+    case Distribution::Integer: {
+        const double value = std::min(slot.B, slot.A + std::floor(u * (slot.B - slot.A + 1.0)));
+        return std::to_string(static_cast<long long>(value));
+    }
+    case Distribution::Choice:
+        return slot.Options[std::min(slot.Options.size() - 1, static_cast<std::size_t>(u * slot.Options.size()))];
+    default:
+        return std::string();
+    }
+}
+
+std::string ParameterSweep::GetJobLine(std::uint64_t index) const {
+    std::string line = this->Text[0];
+    for (std::size_t s = 0; s < this->Slots.size(); ++s) {
+        line += this->Sample(this->Slots[s], index, static_cast<std::uint32_t>(s));
+        line += this->Text[s + 1];
+    }
+    SubstituteIndex(line, index);
+    return line;
+}
+
+bool ParameterSweep::GetJob(std::uint64_t index, RenderJob& job, std::string& error) const {
+    job = RenderJob();
+    return ParseRenderJob(this->GetJobLine(index), job, error);
+}
+
+std::vector<std::string> ParameterSweep::GetMeshes() const {
+    std::vector<std::string> meshes;
+    for (std::size_t i = 0; i < this->Text.size(); ++i) {
+        const std::string& piece = this->Text[i];
+        for (std::string::size_type pos = piece.find("mesh="); pos != std::string::npos;
+             pos = piece.find("mesh=", pos + 1)) {
+            // Ключ начинается с начала шаблона или после пробела, а не внутри значения, подставленного слотом.
+            if (pos == 0 ? i != 0 : !std::isspace(static_cast<unsigned char>(piece[pos - 1]))) {
+                continue;
+            }
+            const std::string::size_type valueEnd = piece.find_first_of(" \t", pos);
+            const std::string prefix =
+                piece.substr(pos + 5, valueEnd == std::string::npos ? valueEnd : valueEnd - pos - 5);
+            std::vector<std::string> options = {std::string()};
+            if (valueEnd == std::string::npos && i < this->Slots.size()) {
+                if (this->Slots[i].Type != Distribution::Choice) {
+                    continue;
+                }
+                options = this->Slots[i].Options;
+                const std::string& next = this->Text[i + 1];
+                const std::string suffix = next.substr(0, next.find_first_of(" \t"));
+                for (std::string& option : options) {
+                    option += suffix;
+                }
+            }
+            for (const std::string& option : options) {
+                if (prefix + option != "plane") {
+                    meshes.push_back(prefix + option);
+                }
+            }
+        }
+    }
+    return meshes;
+}
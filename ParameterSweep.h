@@ -0,0 +1,72 @@
+#ifndef PARAMETER_SWEEP_H
+#define PARAMETER_SWEEP_H
+
+#include "RenderJob.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Счетчиковый генератор Philox4x32-10 (Salmon и др., «Parallel Random Numbers: As Easy as 1, 2, 3», 2011):
+// 128 случайных бит — чистая функция счетчика и ключа, без состояния между вызовами.
+void Philox4x32(const std::uint32_t counter[4], const std::uint32_t key[2], std::uint32_t out[4]);
+
+// Перебор параметров сцены: шаблон задания, в котором вместо чисел стоят распределения или сетки.
+//
+//   mesh=plane texture=page.jpeg
+//   camera=uniform(-0.3,0.3),uniform(-1.8,-1.2),2 cone=grid(20,40,5)
+//   warp=curl(normal(0.2,0.03),uniform(0,0.4)) background=choice(0,0,0|1,1,1)
+//   output=out/{index:8}.png
+//
+// Задание с номером k получается подстановкой в шаблон: распределение номер s берет случайные биты
+// Philox4x32 со счетчиком (k, s) и ключом seed, сетки перебираются смешанной системой счисления
+// по k. Поэтому любое задание восстанавливается по номеру без общего состояния: рабочие, шарды
+// и повторный запуск одного задания получают одни и те же параметры, а список заданий не хранится.
+//
+// Распределения: uniform(a,b), normal(mean,sigma), randint(a,b) — целое из [a, b], choice(x|y|...) —
+// одна из строк, grid(a,b,n) — n равноотстоящих значений от a до b. {index} и {index:N} заменяются
+// номером задания (дополненным нулями до N знаков).
+class ParameterSweep {
+public:
+    // Читает шаблон: строки файла склеиваются через пробел, пустые строки и строки с '#' пропускаются.
+    bool Load(const std::string& path, std::string& error);
+    bool Parse(const std::string& text, std::string& error);
+
+    void SetSeed(std::uint64_t seed);
+
+    // Число узлов всех сеток; номера заданий перебирают их по кругу, первая сетка меняется быстрее всех.
+    std::uint64_t GetGridSize() const { return this->GridSize; }
+
+    std::string GetJobLine(std::uint64_t index) const;
+    bool GetJob(std::uint64_t index, RenderJob& job, std::string& error) const;
+
+    // Все сетки, которые может выбрать шаблон (mesh= или mesh=choice(...)), кроме встроенной страницы.
+    std::vector<std::string> GetMeshes() const;
+
+private:
+    enum class Distribution {
+        Uniform,
+        Normal,
+        Integer,
+        Choice,
+        Grid,
+    };
+
+    struct Slot {
+        Distribution Type = Distribution::Uniform;
+        double A = 0.0;
+        double B = 0.0;
+        std::uint64_t Count = 0;  // узлов сетки
+        std::uint64_t Stride = 1; // вес сетки в смешанной системе счисления номера задания
+        std::vector<std::string> Options;
+    };
+
+    std::string Sample(const Slot& slot, std::uint64_t index, std::uint32_t slotIndex) const;
+
+    std::vector<std::string> Text; // куски шаблона: Text[i] перед Slots[i], последний — после всех
+    std::vector<Slot> Slots;
+    std::uint64_t GridSize = 1;
+    std::uint32_t Key[2] = {0, 0};
+};
+
+#endif // PARAMETER_SWEEP_H
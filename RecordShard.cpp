@@ -0,0 +1,178 @@
+#include "RecordShard.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char ShardMagic[8] = {'D', 'O', 'C', 'S', 'H', 'A', 'R', 'D'};
+    const char RecordMagic[4] = {'D', 'R', 'E', 'C'};
+    const std::uint32_t ShardVersion = 1;
+    const std::size_t RecordAlignment = 64;
+
+    std::uint64_t AlignUp(std::uint64_t value) {
+        return (value + RecordAlignment - 1) / RecordAlignment * RecordAlignment;
+    }
+
+    bool WriteAll(int fd, const void* data, std::size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            const ssize_t written = ::write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<std::size_t>(written);
+        }
+        return true;
+    }
+
+    // Переименование попадает на диск только вместе с каталогом.
+    void SyncDirectory(const std::string& directory) {
+        const int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::fsync(fd);
+            ::close(fd);
+        }
+    }
+}
+
+RecordShardWriter::RecordShardWriter(const std::string& directory, const std::string& prefix,
+                                     std::uint64_t shardBytes)
+    : Directory(directory), Prefix(prefix), ShardBytes(shardBytes) {}
+
+RecordShardWriter::~RecordShardWriter() {
+    std::string error;
+    this->Close(error);
+}
+
+bool RecordShardWriter::OpenShard(std::string& error) {
+    mkdir(this->Directory.c_str(), 0755); // уже существующий каталог — не ошибка
+    char name[32];
+    std::snprintf(name, sizeof(name), "-%05ld.rec", this->ShardCount);
+    this->Path = this->Directory + "/" + this->Prefix + name;
+    const std::string temporary = this->Path + ".tmp";
+    this->File = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (this->File < 0) {
+        error = "cannot create " + temporary;
+        return false;
+    }
+    // Место под заголовок; сам заголовок пишется при закрытии, когда известен индекс.
+    static const char padding[RecordAlignment] = {};
+    this->Offset = AlignUp(sizeof(RecordShardHeader));
+    this->Index.clear();
+    ++this->ShardCount;
+    if (!WriteAll(this->File, padding, static_cast<std::size_t>(this->Offset))) {
+        error = "cannot write " + temporary;
+        this->Abandon();
+        return false;
+    }
+    return true;
+}
+
+void RecordShardWriter::Abandon() {
+    if (this->File >= 0) {
+        ::close(this->File);
+        this->File = -1;
+    }
+    std::remove((this->Path + ".tmp").c_str());
+    for (const RecordIndexEntry& entry : this->Index) {
+        this->LostKeys.push_back(entry.Key);
+    }
+    this->RecordCount -= this->Index.size();
+    this->Index.clear();
+}
+
+std::vector<std::uint64_t> RecordShardWriter::TakeLostKeys() {
+    std::vector<std::uint64_t> keys;
+    keys.swap(this->LostKeys);
+    return keys;
+}
+
+bool RecordShardWriter::Append(std::uint64_t key, const std::vector<RecordField>& fields, std::string& error) {
+    std::vector<RecordFieldEntry> entries(fields.size());
+    std::uint64_t size = AlignUp(sizeof(RecordHeader) + sizeof(RecordFieldEntry) * fields.size());
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        if (fields[i].Name.size() >= sizeof(entries[i].Name)) {
+            error = "record field name '" + fields[i].Name + "' is too long";
+            this->LostKeys.push_back(key);
+            return false;
+        }
+        std::memset(&entries[i], 0, sizeof(entries[i]));
+        std::memcpy(entries[i].Name, fields[i].Name.data(), fields[i].Name.size());
+        entries[i].Offset = size;
+        entries[i].Size = fields[i].Bytes.size();
+        size = AlignUp(size + fields[i].Bytes.size());
+    }
+
+    // Если заполненный шард не удалось закрыть, теряются только его записи: эта уходит в новый шард.
+    if (this->File >= 0 && !this->Index.empty() && this->Offset + size > this->ShardBytes) {
+        this->Close(error);
+    }
+    if (this->File < 0 && !this->OpenShard(error)) {
+        this->LostKeys.push_back(key);
+        return false;
+    }
+
+    RecordHeader header;
+    std::memcpy(header.Magic, RecordMagic, sizeof(RecordMagic));
+    header.FieldCount = static_cast<std::uint32_t>(fields.size());
+    header.Key = key;
+    header.Size = size;
+
+    static const char padding[RecordAlignment] = {};
+    const std::uint64_t tableEnd = sizeof(RecordHeader) + sizeof(RecordFieldEntry) * entries.size();
+    bool ok = WriteAll(this->File, &header, sizeof(header)) &&
+              WriteAll(this->File, entries.data(), sizeof(RecordFieldEntry) * entries.size());
+    std::uint64_t position = tableEnd;
+    for (std::size_t i = 0; ok && i < fields.size(); ++i) {
+        ok = WriteAll(this->File, padding, static_cast<std::size_t>(entries[i].Offset - position)) &&
+             WriteAll(this->File, fields[i].Bytes.data(), fields[i].Bytes.size());
+        position = entries[i].Offset + entries[i].Size;
+    }
+    ok = ok && WriteAll(this->File, padding, static_cast<std::size_t>(size - position));
+    if (!ok) {
+        error = "cannot write " + this->Path + ".tmp";
+        this->LostKeys.push_back(key);
+        this->Abandon();
+        return false;
+    }
+    this->Index.push_back({this->Offset, size, key});
+    this->Offset += size;
+    ++this->RecordCount;
+    return true;
+}
+
+bool RecordShardWriter::Close(std::string& error) {
+    if (this->File < 0) {
+        return true;
+    }
+    RecordShardHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.Magic, ShardMagic, sizeof(ShardMagic));
+    header.Version = ShardVersion;
+    header.RecordCount = this->Index.size();
+    header.IndexOffset = this->Offset;
+    header.FileSize = this->Offset + sizeof(RecordIndexEntry) * this->Index.size();
+
+    const std::string temporary = this->Path + ".tmp";
+    bool ok = WriteAll(this->File, this->Index.data(), sizeof(RecordIndexEntry) * this->Index.size()) &&
+              ::pwrite(this->File, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+              ::fsync(this->File) == 0;
+    ok = ::close(this->File) == 0 && ok;
+    this->File = -1;
+    if (!ok || std::rename(temporary.c_str(), this->Path.c_str()) != 0) {
+        error = "cannot finish " + this->Path;
+        this->Abandon();
+        return false;
+    }
+    SyncDirectory(this->Directory);
+    return true;
+}
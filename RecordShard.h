@@ -0,0 +1,97 @@
+#ifndef RECORD_SHARD_H
+#define RECORD_SHARD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Набор данных из крупных файлов-шардов (.rec) вместо отдельного файла на каждый вывод каждого задания.
+// Шард рассчитан на отображение в память:
+//
+//   RecordShardHeader
+//   записи, каждая с границы 64 байт:
+//     RecordHeader, FieldCount x RecordFieldEntry, данные полей (каждое с границы 64 байт)
+//   индекс: RecordCount x RecordIndexEntry с IndexOffset
+//
+// Запись k читается за O(1): Index[k] дает ее смещение, таблица полей — смещения полей внутри записи.
+// Заголовок и индекс дописываются при закрытии шарда; до этого файл лежит под временным именем, поэтому
+// читатели видят только целые шарды. Записи в шарде идут в порядке готовности, номер задания — в Key.
+struct RecordShardHeader {
+    char Magic[8];             // "DOCSHARD"
+    std::uint32_t Version;     // 1
+    std::uint32_t Reserved;
+    std::uint64_t RecordCount;
+    std::uint64_t IndexOffset;
+    std::uint64_t FileSize;
+};
+
+struct RecordIndexEntry {
+    std::uint64_t Offset; // от начала файла
+    std::uint64_t Size;   // вся запись вместе с таблицей полей и выравниванием
+    std::uint64_t Key;
+};
+
+struct RecordHeader {
+    char Magic[4];            // "DREC"
+    std::uint32_t FieldCount;
+    std::uint64_t Key;
+    std::uint64_t Size;
+};
+
+struct RecordFieldEntry {
+    char Name[24];        // с завершающим нулем
+    std::uint64_t Offset; // от начала записи
+    std::uint64_t Size;
+};
+
+struct RecordField {
+    std::string Name; // не длиннее 23 байт
+    std::vector<unsigned char> Bytes;
+};
+
+// Пишет записи последовательно в шарды <directory>/<prefix>-NNNNN.rec размером около shardBytes:
+// новый шард начинается, когда следующая запись не помещается в текущий (запись больше shardBytes
+// занимает шард целиком). Каждый закрытый шард сбрасывается на диск fsync до переименования.
+class RecordShardWriter {
+public:
+    RecordShardWriter(const std::string& directory, const std::string& prefix, std::uint64_t shardBytes);
+    ~RecordShardWriter();
+
+    RecordShardWriter(const RecordShardWriter&) = delete;
+    RecordShardWriter& operator=(const RecordShardWriter&) = delete;
+
+    // При ошибке записи шард целиком отбрасывается (его файл удаляется), а ключи его записей, включая
+    // эту, попадают в TakeLostKeys; следующий Append начнет новый шард. Ключ записи, которая не добавлена
+    // по другой причине, тоже попадает в TakeLostKeys. Если не удалось закрыть заполненный шард перед этой
+    // записью, его ключи тоже попадают в TakeLostKeys, а error описывает ошибку, но сама запись пишется
+    // в новый шард и Append возвращает true.
+    bool Append(std::uint64_t key, const std::vector<RecordField>& fields, std::string& error);
+
+    // Закрывает текущий шард. Следующий Append начнет новый.
+    bool Close(std::string& error);
+
+    // Ключи записей, не попавших в набор или потерянных с отброшенными шардами, с прошлого вызова.
+    std::vector<std::uint64_t> TakeLostKeys();
+
+    long GetShardCount() const { return this->ShardCount; }
+    unsigned long long GetRecordCount() const { return this->RecordCount; } // в закрытых и открытом шардах
+
+private:
+    bool OpenShard(std::string& error);
+    void Abandon();
+
+    std::string Directory;
+    std::string Prefix;
+    std::uint64_t ShardBytes;
+
+    int File = -1;
+    std::string Path; // окончательное имя открытого шарда; пишется он в Path + ".tmp"
+    std::uint64_t Offset = 0;
+    std::vector<RecordIndexEntry> Index;
+    long ShardCount = 0;
+    unsigned long long RecordCount = 0;
+    std::vector<std::uint64_t> LostKeys;
+};
+
+#endif // RECORD_SHARD_H
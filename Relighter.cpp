@@ -0,0 +1,197 @@
+#include "Relighter.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RELIGHT_HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    unsigned char ToByte(float value) {
+        value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+        return static_cast<unsigned char>(value * 255.0f + 0.5f);
+    }
+
+    void ShadeScalar(const GBuffer& g, const RasterScene& scene, const unsigned char background[4], std::size_t begin,
+                     std::size_t end, unsigned char* color) {
+        for (std::size_t i = begin; i < end; ++i) {
+            unsigned char* out = color + i * 4;
+            if (!g.Mask[i]) {
+                std::memcpy(out, background, 4);
+                continue;
+            }
+            const float point[3] = {g.PositionX[i], g.PositionY[i], g.PositionZ[i]};
+            const float normal[3] = {g.NormalX[i], g.NormalY[i], g.NormalZ[i]};
+            const float texel[3] = {g.AlbedoR[i], g.AlbedoG[i], g.AlbedoB[i]};
+            float lit[3];
+            ShadeSpotLight(scene.Light, scene.Material, point, normal, scene.Eye, lit);
+            for (int c = 0; c < 3; ++c) {
+                out[c] = ToByte(std::min(1.0f, std::max(0.0f, lit[c])) * texel[c]);
+            }
+            out[3] = 255;
+        }
+    }
+
+#if defined(RELIGHT_HAVE_AVX2_KERNEL)
+    // ShadeSpotLight по 8 пикселей: те же операции в том же порядке. Только AVX2, без FMA: иначе компилятор
+    // сольет умножения со сложениями и результат разойдется со скалярной версией в последнем бите.
+    // Хвост отрезка досчитывает ShadeScalar.
+    __attribute__((target("avx2"))) void ShadeAVX2(const GBuffer& g, const RasterScene& scene,
+                                                    const unsigned char background[4], std::size_t begin,
+                                                    std::size_t end, unsigned char* color) {
+        const SpotLight& light = scene.Light;
+        const SurfaceMaterial& material = scene.Material;
+        const bool specular = material.Specular[0] > 0.0f || material.Specular[1] > 0.0f || material.Specular[2] > 0.0f;
+        const bool conePow = light.HasCone && light.Exponent != 1.0f;
+
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 one = _mm256_set1_ps(1.0f);
+        const __m256 two = _mm256_set1_ps(2.0f);
+        const __m256 scale = _mm256_set1_ps(255.0f);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        __m256 position[3], direction[3], eye[3], attenuation[3];
+        __m256 ambient[3], diffuse[3], specularColor[3], lightColor[3];
+        for (int k = 0; k < 3; ++k) {
+            position[k] = _mm256_set1_ps(light.Position[k]);
+            direction[k] = _mm256_set1_ps(light.Direction[k]);
+            eye[k] = _mm256_set1_ps(scene.Eye[k]);
+            attenuation[k] = _mm256_set1_ps(light.Attenuation[k]);
+            ambient[k] = _mm256_set1_ps(material.Ambient[k]);
+            diffuse[k] = _mm256_set1_ps(material.Diffuse[k]);
+            specularColor[k] = _mm256_set1_ps(material.Specular[k]);
+            lightColor[k] = _mm256_set1_ps(light.Color[k]);
+        }
+        const __m256 cosCone = _mm256_set1_ps(light.CosConeAngle);
+        std::uint32_t backgroundPixel;
+        std::memcpy(&backgroundPixel, background, 4);
+        const __m256i backgroundV = _mm256_set1_epi32(static_cast<int>(backgroundPixel));
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+
+        const float* albedo[3] = {g.AlbedoR.data(), g.AlbedoG.data(), g.AlbedoB.data()};
+        std::size_t i = begin;
+        for (; i + 8 <= end; i += 8) {
+            const __m256i mask = _mm256_cmpgt_epi32(
+                _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(g.Mask.data() + i))),
+                _mm256_setzero_si256());
+            if (_mm256_testz_si256(mask, mask)) {
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(color + i * 4), backgroundV);
+                continue;
+            }
+            const __m256 p[3] = {_mm256_loadu_ps(g.PositionX.data() + i), _mm256_loadu_ps(g.PositionY.data() + i),
+                                 _mm256_loadu_ps(g.PositionZ.data() + i)};
+            const __m256 n[3] = {_mm256_loadu_ps(g.NormalX.data() + i), _mm256_loadu_ps(g.NormalY.data() + i),
+                                 _mm256_loadu_ps(g.NormalZ.data() + i)};
+
+            __m256 l[3];
+            for (int k = 0; k < 3; ++k) {
+                l[k] = _mm256_sub_ps(p[k], position[k]);
+            }
+            const __m256 distance = _mm256_sqrt_ps(_mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(l[0], l[0]), _mm256_mul_ps(l[1], l[1])), _mm256_mul_ps(l[2], l[2])));
+            const __m256 invDistance =
+                _mm256_and_ps(_mm256_div_ps(one, distance), _mm256_cmp_ps(distance, zero, _CMP_GT_OQ));
+            for (int k = 0; k < 3; ++k) {
+                l[k] = _mm256_mul_ps(l[k], invDistance);
+            }
+
+            __m256 att = _mm256_div_ps(
+                one, _mm256_add_ps(_mm256_add_ps(attenuation[0], _mm256_mul_ps(attenuation[1], distance)),
+                                   _mm256_mul_ps(_mm256_mul_ps(attenuation[2], distance), distance)));
+            if (light.HasCone) {
+                const __m256 coneDot = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(l[0], direction[0]), _mm256_mul_ps(l[1], direction[1])),
+                    _mm256_mul_ps(l[2], direction[2]));
+                const __m256 inside = _mm256_cmp_ps(coneDot, cosCone, _CMP_GE_OQ);
+                if (conePow) {
+                    alignas(32) float dots[8];
+                    alignas(32) float values[8];
+                    _mm256_store_ps(dots, coneDot);
+                    _mm256_store_ps(values, att);
+                    for (int k = 0; k < 8; ++k) {
+                        values[k] *= std::pow(dots[k], light.Exponent);
+                    }
+                    att = _mm256_load_ps(values);
+                } else {
+                    att = _mm256_mul_ps(att, coneDot);
+                }
+                att = _mm256_and_ps(att, inside);
+            }
+
+            const __m256 nDotL = _mm256_sub_ps(
+                zero, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(n[0], l[0]), _mm256_mul_ps(n[1], l[1])),
+                                    _mm256_mul_ps(n[2], l[2])));
+            const __m256 df = _mm256_max_ps(_mm256_mul_ps(att, nDotL), zero); // NaN -> 0, как у fmax
+
+            __m256 sf = zero;
+            const __m256 lit = _mm256_cmp_ps(df, zero, _CMP_GT_OQ);
+            if (specular && !_mm256_testz_ps(lit, lit)) {
+                __m256 r[3], v[3];
+                for (int k = 0; k < 3; ++k) {
+                    r[k] = _mm256_add_ps(l[k], _mm256_mul_ps(_mm256_mul_ps(two, nDotL), n[k]));
+                    v[k] = _mm256_sub_ps(eye[k], p[k]);
+                }
+                const __m256 vLength = _mm256_sqrt_ps(_mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(v[0], v[0]), _mm256_mul_ps(v[1], v[1])), _mm256_mul_ps(v[2], v[2])));
+                const __m256 invV =
+                    _mm256_and_ps(_mm256_div_ps(one, vLength), _mm256_cmp_ps(vLength, zero, _CMP_GT_OQ));
+                const __m256 rDotV = _mm256_mul_ps(
+                    _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r[0], v[0]), _mm256_mul_ps(r[1], v[1])),
+                                  _mm256_mul_ps(r[2], v[2])),
+                    invV);
+                alignas(32) float dots[8];
+                alignas(32) float values[8];
+                alignas(32) float lanes[8];
+                _mm256_store_ps(dots, _mm256_max_ps(rDotV, zero));
+                _mm256_store_ps(values, att);
+                _mm256_store_ps(lanes, lit);
+                for (int k = 0; k < 8; ++k) {
+                    values[k] = lanes[k] != 0.0f ? values[k] * std::pow(dots[k], material.SpecularPower) : 0.0f;
+                }
+                sf = _mm256_load_ps(values);
+            }
+
+            __m256i pixel = alpha;
+            for (int c = 0; c < 3; ++c) {
+                const __m256 shaded = _mm256_add_ps(
+                    _mm256_add_ps(ambient[c], _mm256_mul_ps(_mm256_mul_ps(diffuse[c], df), lightColor[c])),
+                    _mm256_mul_ps(_mm256_mul_ps(specularColor[c], sf), lightColor[c]));
+                __m256 value = _mm256_mul_ps(_mm256_min_ps(one, _mm256_max_ps(shaded, zero)),
+                                             _mm256_loadu_ps(albedo[c] + i));
+                value = _mm256_min_ps(one, _mm256_max_ps(value, zero));
+                const __m256i byte = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(value, scale), half));
+                pixel = _mm256_or_si256(pixel, _mm256_slli_epi32(byte, 8 * c));
+            }
+            pixel = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(backgroundV),
+                                                         _mm256_castsi256_ps(pixel), _mm256_castsi256_ps(mask)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(color + i * 4), pixel);
+        }
+        ShadeScalar(g, scene, background, i, end, color);
+    }
+#endif
+}
+
+void Relighter::Shade(const GBuffer& gbuffer, const RasterScene& scene) {
+    const std::size_t pixels = static_cast<std::size_t>(gbuffer.Width) * gbuffer.Height;
+    this->Color.resize(pixels * 4);
+    unsigned char background[4];
+    for (int c = 0; c < 4; ++c) {
+        background[c] = ToByte(scene.Background[c]);
+    }
+
+    unsigned char* color = this->Color.data();
+    ThreadPool::Instance().ParallelFor(pixels, 16384, [&](std::size_t begin, std::size_t end) {
+#if defined(RELIGHT_HAVE_AVX2_KERNEL)
+        if (SoftwareRasterizer::HasAVX2()) {
+            ShadeAVX2(gbuffer, scene, background, begin, end, color);
+            return;
+        }
+#endif
+        ShadeScalar(gbuffer, scene, background, begin, end, color);
+    });
+}
@@ -0,0 +1,26 @@
+#ifndef RELIGHTER_H
+#define RELIGHTER_H
+
+#include "SoftwareRasterizer.h"
+
+#include <vector>
+
+// Отложенное освещение: кадр того же ракурса при другом свете собирается из G-буфера растеризатора
+// (RasterScene::OutputGBuffer) без преобразования вершин, растеризации и выборки текстуры.
+//
+// Модель та же, что у ShadeSpotLight (позиционный прожектор VTK), и результат совпадает с кадром
+// программного бэкенда при том же свете. Пиксели обрабатываются в пуле потоков, с AVX2 — по 8 за раз;
+// pow (показатель конуса, отличный от 1, и блик) считается поэлементно только там, где он нужен.
+class Relighter {
+public:
+    // Освещает G-буфер светом, материалом, позицией камеры и фоном сцены.
+    void Shade(const GBuffer& gbuffer, const RasterScene& scene);
+
+    // RGBA8, строки снизу вверх, как SoftwareRasterizer::GetColor.
+    const std::vector<unsigned char>& GetColor() const { return this->Color; }
+
+private:
+    std::vector<unsigned char> Color;
+};
+
+#endif // RELIGHTER_H
@@ -0,0 +1,771 @@
+#include "RenderContext.h"
+
+#include "MeshCache.h"
+#include "MeshConversion.h"
+#include "Tracer.h"
+
+#include <vtkMath.h>
+#include <vtkMatrix4x4.h>
+#include <vtkNamedColors.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkProperty.h>
+#include <vtkUnsignedCharArray.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <sys/stat.h>
+
+namespace {
+    // Кадр отдается как vtkImageData поверх буфера, без копирования.
+    void WrapColor(const std::vector<unsigned char>& color, int width, int height, vtkImageData* image,
+                   int channels = 4) {
+        vtkNew<vtkUnsignedCharArray> pixels;
+        pixels->SetNumberOfComponents(channels);
+        pixels->SetArray(const_cast<unsigned char*>(color.data()), static_cast<vtkIdType>(color.size()), 1);
+        image->SetDimensions(width, height, 1);
+        image->GetPointData()->SetScalars(pixels);
+    }
+
+    bool SameVector(const double a[3], const double b[3]) {
+        return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+    }
+
+    bool SameLight(const LightSetup& a, const LightSetup& b) {
+        return SameVector(a.Position, b.Position) && SameVector(a.FocalPoint, b.FocalPoint) &&
+               a.ConeAngle == b.ConeAngle && SameVector(a.Color, b.Color) && a.Intensity == b.Intensity &&
+               SameVector(a.Ambient, b.Ambient) && SameVector(a.Diffuse, b.Diffuse) &&
+               SameVector(a.Specular, b.Specular) && a.SpecularPower == b.SpecularPower;
+    }
+
+    // Одинаковая форма встроенной страницы: те же деформации на решетке того же размера.
+    bool SamePage(const RenderJob& a, const RenderJob& b) {
+        if (a.PageGrid[0] != b.PageGrid[0] || a.PageGrid[1] != b.PageGrid[1] || a.Warps.size() != b.Warps.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.Warps.size(); ++i) {
+            if (a.Warps[i].Type != b.Warps[i].Type ||
+                !std::equal(a.Warps[i].Parameters, a.Warps[i].Parameters + 4, b.Warps[i].Parameters)) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool ParseRenderBackend(const std::string& name, RenderBackend& backend) {
+    if (name == "vtk") {
+        backend = RenderBackend::Vtk;
+    } else if (name == "cpu") {
+        backend = RenderBackend::Cpu;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+RenderContext::RenderContext(int width, int height, RenderBackend backend)
+    : Width(width), Height(height), Backend(backend), WindowWidth(width), WindowHeight(height) {
+    vtkNew<vtkNamedColors> colors;
+
+    // Та же плоскость, что и в интерактивном режиме: пропорции листа A4 (0.913 x 1.291).
+    this->PlaneSource->SetOrigin(0.0, 0.0, 0.0);
+    this->PlaneSource->SetPoint1(0.913, 0.0, 0.0);
+    this->PlaneSource->SetPoint2(0.0, 1.291, 0.0);
+    this->PlaneSource->SetCenter(0.0, 0.0, 0.0);
+
+    this->Transform->PostMultiply();
+
+    this->Actor->SetMapper(this->Mapper);
+    this->Actor->SetUserTransform(this->Transform);
+
+    this->Light->SetLightTypeToSceneLight();
+    this->Light->SetPositional(true);
+    this->Light->SetDiffuseColor(colors->GetColor3d("White").GetData());
+    this->Light->SetSpecularColor(colors->GetColor3d("White").GetData());
+    this->Light->SetAmbientColor(1.0, 1.0, 1.0);
+
+    this->Renderer->AddActor(this->Actor);
+    this->Renderer->SetBackground(colors->GetColor3d("MidnightBlue").GetData());
+    this->Renderer->SetActiveCamera(this->Camera);
+    this->Renderer->AddLight(this->Light);
+
+    // Окно рисует только во внеэкранный буфер: оно не появляется на экране и не требует интерактора.
+    this->RenderWindow->SetOffScreenRendering(1);
+    this->RenderWindow->AddRenderer(this->Renderer);
+    this->RenderWindow->SetSize(width, height);
+
+    this->WindowToImageFilter->SetInput(this->RenderWindow);
+    this->WindowToImageFilter->SetScale(1);
+    this->WindowToImageFilter->ReadFrontBufferOff();
+    this->SetImageEncoding(ImageEncoding());
+}
+
+void RenderContext::SetImageEncoding(const ImageEncoding& encoding) {
+    this->Encoder.SetEncoding(encoding);
+    this->CaptureAlpha = encoding.Alpha;
+    // Альфа-канал читается из окна, только если он попадет в файл: так на четверть меньше байт на чтение,
+    // копирование и кодирование. Программный бэкенд рисует RGBA, лишний канал отбрасывается при кодировании.
+    if (encoding.Alpha) {
+        this->WindowToImageFilter->SetInputBufferTypeToRGBA();
+    } else {
+        this->WindowToImageFilter->SetInputBufferTypeToRGB();
+    }
+}
+
+void RenderContext::SetCapture(const CaptureSettings& capture) {
+    this->Capture = capture;
+    this->Capture.Supersample = std::min(16, std::max(1, capture.Supersample));
+    this->TileFilter.SetFilter(this->Capture.Supersample, capture.Filter);
+    // Участок вмещает хотя бы один пиксель кадра вместе с полем фильтра.
+    const int minimum = this->Capture.Supersample + 2 * this->TileFilter.GetMargin();
+    this->Capture.TileWidth = std::max(minimum, capture.TileWidth);
+    this->Capture.TileHeight = std::max(minimum, capture.TileHeight);
+    this->Tiled = this->Capture.Supersample > 1 || this->Width > this->Capture.TileWidth ||
+                  this->Height > this->Capture.TileHeight;
+    if (this->Tiled) {
+        // Окно не больше, чем нужно для кадра целиком: маленький кадр снимается одним участком.
+        const int margin = 2 * this->TileFilter.GetMargin();
+        this->WindowWidth = std::min(this->Capture.TileWidth, this->Width * this->Capture.Supersample + margin);
+        this->WindowHeight = std::min(this->Capture.TileHeight, this->Height * this->Capture.Supersample + margin);
+    } else {
+        this->WindowWidth = this->Width;
+        this->WindowHeight = this->Height;
+    }
+    this->RenderWindow->SetSize(this->WindowWidth, this->WindowHeight);
+}
+
+bool RenderContext::ApplyMesh(const RenderJob& job, const RenderJob* previous, std::string& error) {
+    if (previous == nullptr || job.RotateX != previous->RotateX) {
+        // Поворот меняет только матрицу актора, геометрия в GPU остается прежней.
+        this->Transform->Identity();
+        this->Transform->RotateX(job.RotateX);
+    }
+
+    if (job.Mesh == "plane") {
+        // Страница целиком задается параметрами задания: при тех же параметрах пересчитывать нечего.
+        if (previous != nullptr && previous->Mesh == "plane" && SamePage(job, *previous)) {
+            return true;
+        }
+        TRACE_SCOPE("prepare.mesh");
+        if (job.Warps.empty()) {
+            this->Mapper->SetInputConnection(this->PlaneSource->GetOutputPort());
+        } else {
+            this->ApplyPage(job);
+        }
+        return true;
+    }
+    // Файлы сетки сверяются с кэшем и при том же пути: служба должна заметить, что файл изменился.
+    TRACE_SCOPE("prepare.mesh");
+    if (MeshCache::Instance().Handles(job.Mesh)) {
+        std::shared_ptr<const MappedMesh> mesh = MeshCache::Instance().Acquire(job.Mesh, error);
+        if (!mesh) {
+            return false;
+        }
+        if (mesh != this->CurrentMesh) {
+            this->CurrentMesh = mesh;
+            this->MappedPolyData = PolyDataFromMappedMesh(mesh);
+        }
+        this->SetMapperInput(this->MappedPolyData);
+        return true;
+    }
+    // Читатель перечитывает файл, только если изменилось имя, поэтому правку файла на месте
+    // замечаем сами по времени изменения и размеру.
+    struct stat info {};
+    if (stat(job.Mesh.c_str(), &info) != 0) {
+        error = "cannot read mesh " + job.Mesh;
+        return false;
+    }
+    const long long mtime = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+    const long long size = static_cast<long long>(info.st_size);
+    this->ObjReader->SetFileName(job.Mesh.c_str());
+    if (mtime != this->ObjFileTime || size != this->ObjFileSize) {
+        this->ObjReader->Modified();
+        this->ObjFileTime = mtime;
+        this->ObjFileSize = size;
+    }
+    this->ObjReader->Update();
+    if (this->ObjReader->GetOutput()->GetNumberOfPoints() == 0) {
+        error = "cannot read mesh " + job.Mesh;
+        return false;
+    }
+    this->Mapper->SetInputConnection(this->ObjReader->GetOutputPort());
+    return true;
+}
+
+void RenderContext::SetMapperInput(vtkPolyData* polyData) {
+    // SetInputData каждый раз подключает данные через новый vtkTrivialProducer и тем самым меняет маппер,
+    // а измененный маппер заново загружает геометрию в GPU. Поэтому уже подключенные данные не переподключаются;
+    // изменения самих данных (новая форма страницы) маппер по-прежнему видит по их времени изменения.
+    if (this->Mapper->GetInputDataObject(0, 0) != polyData) {
+        this->Mapper->SetInputData(polyData);
+    }
+}
+
+void RenderContext::ApplyPage(const RenderJob& job) {
+    // Смена разрешения перевыделяет массивы страницы, поэтому vtkPolyData над ними строится заново.
+    if (!this->PagePolyData || this->Deformer.GetColumns() != job.PageGrid[0] ||
+        this->Deformer.GetRows() != job.PageGrid[1]) {
+        this->Deformer.SetResolution(job.PageGrid[0], job.PageGrid[1]);
+        this->PagePolyData = PolyDataOverMesh(this->Deformer.GetMesh());
+    }
+    // Массивы изменены на месте: маппер перезагрузит их, только если форма действительно другая.
+    if (this->Deformer.Apply(job.Warps)) {
+        this->PagePolyData->GetPoints()->Modified();
+        this->PagePolyData->GetPointData()->GetNormals()->Modified();
+        this->PagePolyData->Modified();
+    }
+    this->SetMapperInput(this->PagePolyData);
+}
+
+bool RenderContext::ApplyTexture(const RenderJob& job, std::string& error) {
+    TRACE_SCOPE("prepare.texture");
+    std::shared_ptr<const CachedTexture> texture = TextureCache::Instance().Acquire(job.Texture, error);
+    if (!texture) {
+        return false;
+    }
+    if (this->CurrentTexture && this->CurrentTexture->GetKey() == texture->GetKey()) {
+        return true;
+    }
+    this->CurrentTexture = texture;
+
+    // Забываем vtkTexture тех записей, которые кэш уже вытеснил, вместе с их памятью в OpenGL.
+    for (auto it = this->UploadedTextures.begin(); it != this->UploadedTextures.end();) {
+        if (it->second.Source.expired()) {
+            it->second.Texture->ReleaseGraphicsResources(this->RenderWindow);
+            it = this->UploadedTextures.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    UploadedTexture& uploaded = this->UploadedTextures[texture->GetKey()];
+    if (!uploaded.Texture) {
+        uploaded.Source = texture;
+        uploaded.Texture = vtkSmartPointer<vtkTexture>::New();
+        uploaded.Texture->SetInputData(texture->GetImage());
+        // Билинейная фильтрация с mip-уровнями: так же выбирает тексели программный растеризатор.
+        uploaded.Texture->InterpolateOn();
+        uploaded.Texture->MipmapOn();
+    }
+    this->Actor->SetTexture(uploaded.Texture);
+    return true;
+}
+
+void RenderContext::ApplyCamera(const RenderJob& job) {
+    this->Camera->SetPosition(job.CameraPosition);
+    this->Camera->SetFocalPoint(job.CameraFocalPoint);
+    this->Camera->SetViewUp(job.CameraViewUp);
+}
+
+void RenderContext::ApplyLight(const LightSetup& light) {
+    this->Light->SetPosition(light.Position);
+    this->Light->SetFocalPoint(light.FocalPoint);
+    this->Light->SetConeAngle(light.ConeAngle);
+    this->Light->SetDiffuseColor(light.Color[0], light.Color[1], light.Color[2]);
+    this->Light->SetIntensity(light.Intensity);
+
+    // Цвета материала задаются целиком через *Color при единичных коэффициентах.
+    vtkProperty* property = this->Actor->GetProperty();
+    property->SetAmbient(1.0);
+    property->SetAmbientColor(light.Ambient[0], light.Ambient[1], light.Ambient[2]);
+    property->SetDiffuse(1.0);
+    property->SetDiffuseColor(light.Diffuse[0], light.Diffuse[1], light.Diffuse[2]);
+    property->SetSpecular(1.0);
+    property->SetSpecularColor(light.Specular[0], light.Specular[1], light.Specular[2]);
+    property->SetSpecularPower(light.SpecularPower);
+}
+
+bool RenderContext::Prepare(const RenderJob& job, std::string& error) {
+    TRACE_SCOPE("prepare");
+    // Задание сравнивается с тем, что уже применено к сцене. Если подготовка не удастся, сцена может
+    // остаться примененной частично, поэтому следующее задание тогда готовится целиком.
+    const RenderJob* previous = this->HasApplied ? &this->Applied : nullptr;
+    this->HasApplied = false;
+    if (!this->ApplyMesh(job, previous, error) || !this->ApplyTexture(job, error)) {
+        return false;
+    }
+    if (previous == nullptr || !SameVector(job.CameraPosition, previous->CameraPosition) ||
+        !SameVector(job.CameraFocalPoint, previous->CameraFocalPoint) ||
+        !SameVector(job.CameraViewUp, previous->CameraViewUp)) {
+        this->ApplyCamera(job);
+    }
+    if (previous == nullptr || !SameLight(job.Light, previous->Light)) {
+        this->ApplyLight(job.Light);
+    }
+    this->Renderer->SetBackground(job.Background);
+    this->Renderer->ResetCameraClippingRange();
+    this->WantUVMap = !job.UVMap.empty();
+    this->WantForwardMap = !job.ForwardMap.empty();
+    this->WantOutline = !job.Outline.empty();
+    this->WantAnnotations = !job.Annotations.empty();
+    this->WantGBuffer = !job.Relight.empty();
+    this->Applied = job;
+    this->HasApplied = true;
+    return true;
+}
+
+vtkImageData* RenderContext::RenderVtk() {
+    this->DrawVtk();
+    TRACE_SCOPE("readback");
+    // Фильтр не отслеживает изменения в окне, поэтому его нужно явно пометить измененным,
+    // иначе Update() вернет снимок предыдущего кадра.
+    this->WindowToImageFilter->Modified();
+    this->WindowToImageFilter->Update();
+    return this->WindowToImageFilter->GetOutput();
+}
+
+void RenderContext::DrawVtk() {
+    {
+        TRACE_SCOPE("render.vtk");
+        this->RenderWindow->Render();
+    }
+    // Собственное время рендерера VTK: без ожидания GPU и без обмена буферов окна.
+    TRACE_DURATION("render.vtk.renderer", this->Renderer->GetLastRenderTimeInSeconds());
+    this->RenderVisibility();
+}
+
+void RenderContext::RenderVisibility() {
+    // Карта UV, глубина для прямой карты и границы и G-буфер берутся из прохода видимости растеризатора по той же
+    // сцене, без затенения: прочитать интерполированные атрибуты и глубину из конвейера OpenGL VTK нельзя.
+    if (this->NeedsVisibilityPass()) {
+        TRACE_SCOPE("render.visibility");
+        RasterScene scene;
+        this->BuildRasterScene(scene);
+        scene.Shade = false;
+        scene.OutputUV = this->WantUVMap;
+        if (this->WantGBuffer) {
+            scene.Texture = &this->CurrentTexture->GetMips();
+            scene.OutputGBuffer = true;
+        }
+        this->Rasterizer.Render(scene, this->Width, this->Height);
+    }
+}
+
+void RenderContext::DrawFrame() {
+    if (this->Tiled) {
+        this->CaptureChannels = 4;
+        this->CaptureFrame.resize(static_cast<std::size_t>(this->Width) * this->Height * 4);
+        this->CaptureTiles(this->CaptureFrame.data(), 4);
+    } else if (this->Backend == RenderBackend::Cpu) {
+        this->RenderCpu();
+    } else {
+        this->DrawVtk();
+    }
+}
+
+bool RenderContext::ReadFrame(unsigned char* pixels, int channels) {
+    TRACE_SCOPE("readback");
+    if (this->Tiled) {
+        CopyChannels(this->CaptureFrame.data(), this->CaptureChannels,
+                     static_cast<std::size_t>(this->Width) * this->Height, pixels, channels);
+        return true;
+    }
+    if (this->Backend == RenderBackend::Cpu) {
+        CopyChannels(this->Rasterizer.GetColor().data(), 4, static_cast<std::size_t>(this->Width) * this->Height,
+                     pixels, channels);
+        return true;
+    }
+    return this->ReadWindow(pixels, this->Width, this->Height, channels);
+}
+
+bool RenderContext::ReadWindow(unsigned char* pixels, int width, int height, int channels) {
+    // Массив лишь оборачивает буфер, и VTK пишет в него, не перевыделяя, раз размер уже совпадает.
+    const std::size_t size = static_cast<std::size_t>(width) * height * channels;
+    this->ReadbackPixels->SetNumberOfComponents(channels);
+    this->ReadbackPixels->SetArray(pixels, static_cast<vtkIdType>(size), 1);
+    const int x = width - 1;
+    const int y = height - 1;
+    const int read = channels == 4 ? this->RenderWindow->GetRGBACharPixelData(0, 0, x, y, 0, this->ReadbackPixels)
+                                   : this->RenderWindow->GetPixelData(0, 0, x, y, 0, this->ReadbackPixels);
+    const bool ok = read != 0 && this->ReadbackPixels->GetPointer(0) == pixels;
+    // Массив не должен пережить вызов: следующий кадр может читаться в другой буфер. Чужой буфер
+    // (save = 1) Initialize не освобождает.
+    this->ReadbackPixels->Initialize();
+    return ok;
+}
+
+bool RenderContext::ReadbackFrame(const std::string& field, const std::string& path, std::string& error) {
+    // Кадр читается из окна сразу в буфер из пула конвейера: ни vtkImageData фильтра, ни копии в задачу.
+    // При съемке по частям в этот буфер собираются уменьшенные участки.
+    const int channels = this->Output->GetOutputChannels(path, this->CaptureAlpha ? 4 : 3);
+    FramePool::Lease frame = this->Output->AcquireFrame(this->Width, this->Height, channels);
+    bool ok = false;
+    if (this->Tiled) {
+        ok = this->CaptureTiles(frame->GetData(), channels);
+    } else {
+        this->DrawVtk();
+        ok = this->ReadFrame(frame->GetData(), channels);
+    }
+    if (!ok) {
+        error = "cannot read the frame from the render window";
+        return false;
+    }
+    this->Output->SubmitFrame(field, path, std::move(frame));
+    return true;
+}
+
+bool RenderContext::CaptureTiles(unsigned char* pixels, int channels) {
+    TRACE_SCOPE("capture");
+    struct Tile {
+        int X, Y, Width, Height; // часть кадра в его пикселях, строки снизу вверх
+    };
+    const int factor = this->Capture.Supersample;
+    const int margin = this->TileFilter.GetMargin();
+    const int stepX = (this->WindowWidth - 2 * margin) / factor;
+    const int stepY = (this->WindowHeight - 2 * margin) / factor;
+    std::vector<Tile> tiles;
+    for (int y = 0; y < this->Height; y += stepY) {
+        for (int x = 0; x < this->Width; x += stepX) {
+            tiles.push_back(Tile{x, y, std::min(stepX, this->Width - x), std::min(stepY, this->Height - y)});
+        }
+    }
+
+    // Участок — окно камеры с той же точкой и направлением, но суженным углом зрения и сдвинутым
+    // центром (vtkCamera::SetWindowCenter): его пиксели совпадают с пикселями суперсэмплированного кадра.
+    // Поле фильтра снимается за краями кадра как обычная часть сцены.
+    const double fullWidth = static_cast<double>(this->Width) * factor;
+    const double fullHeight = static_cast<double>(this->Height) * factor;
+    const double viewAngle = this->Camera->GetViewAngle();
+    double windowCenter[2];
+    this->Camera->GetWindowCenter(windowCenter);
+    const double tileAngle = vtkMath::DegreesFromRadians(
+        2.0 * std::atan(std::tan(vtkMath::RadiansFromDegrees(viewAngle) / 2.0) * this->WindowHeight / fullHeight));
+    const auto draw = [&](const Tile& tile) {
+        const double centerX = (tile.X * factor - margin + 0.5 * this->WindowWidth) / fullWidth * 2.0 - 1.0;
+        const double centerY = (tile.Y * factor - margin + 0.5 * this->WindowHeight) / fullHeight * 2.0 - 1.0;
+        this->Camera->SetViewAngle(tileAngle);
+        this->Camera->SetWindowCenter((windowCenter[0] + centerX) * fullWidth / this->WindowWidth,
+                                      (windowCenter[1] + centerY) * fullHeight / this->WindowHeight);
+        if (this->Backend == RenderBackend::Cpu) {
+            TRACE_SCOPE("render.cpu");
+            RasterScene scene;
+            this->BuildRasterScene(scene, this->WindowWidth, this->WindowHeight);
+            scene.Texture = &this->CurrentTexture->GetMips();
+            this->TileRasterizer.Render(scene, this->WindowWidth, this->WindowHeight);
+        } else {
+            TRACE_SCOPE("render.vtk");
+            this->RenderWindow->Render();
+        }
+    };
+    const auto read = [&](std::vector<unsigned char>& buffer) {
+        TRACE_SCOPE("readback");
+        const std::size_t count = static_cast<std::size_t>(this->WindowWidth) * this->WindowHeight;
+        buffer.resize(count * channels);
+        if (this->Backend == RenderBackend::Cpu) {
+            CopyChannels(this->TileRasterizer.GetColor().data(), 4, count, buffer.data(), channels);
+            return true;
+        }
+        return this->ReadWindow(buffer.data(), this->WindowWidth, this->WindowHeight, channels);
+    };
+    const auto shrink = [&](const Tile& tile, const std::vector<unsigned char>& buffer) {
+        TRACE_SCOPE("downsample");
+        const std::size_t stride = static_cast<std::size_t>(this->Width) * channels;
+        this->TileFilter.Downsample(buffer.data(), static_cast<std::size_t>(this->WindowWidth) * channels, channels,
+                                    pixels + tile.Y * stride + static_cast<std::size_t>(tile.X) * channels, stride,
+                                    tile.Width, tile.Height);
+    };
+
+    // Участок i + 1 уже отдан OpenGL, пока процессор уменьшает участок i: чтение окна дождется GPU
+    // только после этого.
+    bool ok = true;
+    draw(tiles[0]);
+    ok = read(this->TilePixels[0]) && ok;
+    for (std::size_t i = 1; i < tiles.size(); ++i) {
+        draw(tiles[i]);
+        shrink(tiles[i - 1], this->TilePixels[(i - 1) % 2]);
+        ok = read(this->TilePixels[i % 2]) && ok;
+    }
+    shrink(tiles.back(), this->TilePixels[(tiles.size() - 1) % 2]);
+
+    this->Camera->SetViewAngle(viewAngle);
+    this->Camera->SetWindowCenter(windowCenter[0], windowCenter[1]);
+    this->RenderVisibility();
+    return ok;
+}
+
+void RenderContext::BuildRasterScene(RasterScene& scene, int width, int height) {
+    // Геометрия: та же vtkPolyData, что подается в маппер.
+    this->Mapper->GetInputAlgorithm()->Update();
+    vtkPolyData* polyData = this->Mapper->GetInput();
+    if (polyData == this->MappedPolyData.Get()) {
+        scene.Mesh = this->CurrentMesh->GetView();
+    } else if (polyData == this->PagePolyData.Get()) {
+        scene.Mesh = this->Deformer.GetMesh().GetView();
+    } else {
+        if (polyData != this->CpuMeshSource || polyData->GetMTime() != this->CpuMeshTime) {
+            MeshFromPolyData(polyData, this->CpuMesh);
+            this->CpuMeshSource = polyData;
+            this->CpuMeshTime = polyData->GetMTime();
+        }
+        scene.Mesh = this->CpuMesh.GetView();
+    }
+    // Копия сетки из vtkPolyData пересобирается на месте, поэтому для нее топологию различает еще и время.
+    const vtkMTimeType time = scene.Mesh.Indices == this->CpuMesh.Indices.data() ? this->CpuMeshTime : 0;
+    if (scene.Mesh.Indices != this->TopologyIndices || scene.Mesh.TriangleCount != this->TopologyTriangles ||
+        time != this->TopologyTime) {
+        this->TopologyIndices = scene.Mesh.Indices;
+        this->TopologyTriangles = scene.Mesh.TriangleCount;
+        this->TopologyTime = time;
+        ++this->TopologyVersion;
+    }
+
+    vtkMatrix4x4* model = this->Transform->GetMatrix();
+    vtkMatrix4x4* viewProjection =
+        this->Camera->GetCompositeProjectionTransformMatrix(static_cast<double>(width) / height, -1.0, 1.0);
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            scene.Model[r * 4 + c] = static_cast<float>(model->GetElement(r, c));
+            scene.ViewProjection[r * 4 + c] = static_cast<float>(viewProjection->GetElement(r, c));
+        }
+    }
+    const double* eye = this->Camera->GetPosition();
+    for (int i = 0; i < 3; ++i) {
+        scene.Eye[i] = static_cast<float>(eye[i]);
+    }
+
+    this->BuildLighting(scene);
+    scene.TwoSidedLighting = this->Renderer->GetTwoSidedLighting() != 0;
+
+    const double* background = this->Renderer->GetBackground();
+    for (int i = 0; i < 3; ++i) {
+        scene.Background[i] = static_cast<float>(background[i]);
+    }
+    scene.Background[3] = static_cast<float>(this->Renderer->GetBackgroundAlpha());
+}
+
+void RenderContext::BuildLighting(RasterScene& scene) {
+    // Свет: параметры vtkLight в том виде, в каком их получает шейдер VTK.
+    const double* position = this->Light->GetPosition();
+    const double* focalPoint = this->Light->GetFocalPoint();
+    double direction[3] = {focalPoint[0] - position[0], focalPoint[1] - position[1], focalPoint[2] - position[2]};
+    const double length = std::sqrt(direction[0] * direction[0] + direction[1] * direction[1] +
+                                     direction[2] * direction[2]);
+    const double* attenuation = this->Light->GetAttenuationValues();
+    const double* lightColor = this->Light->GetDiffuseColor();
+    for (int i = 0; i < 3; ++i) {
+        scene.Light.Position[i] = static_cast<float>(position[i]);
+        scene.Light.Direction[i] = static_cast<float>(length > 0.0 ? direction[i] / length : 0.0);
+        scene.Light.Attenuation[i] = static_cast<float>(attenuation[i]);
+        scene.Light.Color[i] = static_cast<float>(lightColor[i] * this->Light->GetIntensity());
+    }
+    // Как и в OpenGL, конус больше 90 градусов означает обычный точечный источник.
+    scene.Light.HasCone = this->Light->GetConeAngle() <= 90.0;
+    scene.Light.CosConeAngle = static_cast<float>(std::cos(vtkMath::RadiansFromDegrees(this->Light->GetConeAngle())));
+    scene.Light.Exponent = static_cast<float>(this->Light->GetExponent());
+
+    vtkProperty* property = this->Actor->GetProperty();
+    const double* ambient = property->GetAmbientColor();
+    const double* diffuse = property->GetDiffuseColor();
+    const double* specular = property->GetSpecularColor();
+    for (int i = 0; i < 3; ++i) {
+        scene.Material.Ambient[i] = static_cast<float>(property->GetAmbient() * ambient[i]);
+        scene.Material.Diffuse[i] = static_cast<float>(property->GetDiffuse() * diffuse[i]);
+        scene.Material.Specular[i] = static_cast<float>(property->GetSpecular() * specular[i]);
+    }
+    scene.Material.SpecularPower = static_cast<float>(property->GetSpecularPower());
+}
+
+vtkImageData* RenderContext::RenderCpu() {
+    TRACE_SCOPE("render.cpu");
+    RasterScene scene;
+    this->BuildRasterScene(scene);
+    scene.Texture = &this->CurrentTexture->GetMips();
+    scene.OutputUV = this->WantUVMap;
+    scene.OutputGBuffer = this->WantGBuffer;
+    this->Rasterizer.Render(scene, this->Width, this->Height);
+    WrapColor(this->Rasterizer.GetColor(), this->Width, this->Height, this->CpuFrame);
+    return this->CpuFrame;
+}
+
+vtkImageData* RenderContext::RenderFrame() {
+    if (this->Tiled) {
+        this->CaptureChannels = this->CaptureAlpha ? 4 : 3;
+        this->CaptureFrame.resize(static_cast<std::size_t>(this->Width) * this->Height * this->CaptureChannels);
+        this->CaptureTiles(this->CaptureFrame.data(), this->CaptureChannels);
+        WrapColor(this->CaptureFrame, this->Width, this->Height, this->CaptureImage, this->CaptureChannels);
+        return this->CaptureImage;
+    }
+    return this->Backend == RenderBackend::Cpu ? this->RenderCpu() : this->RenderVtk();
+}
+
+bool RenderContext::Render(const RenderJob& job, std::string& error) {
+    if (!this->Prepare(job, error)) {
+        return false;
+    }
+    if (this->Output != nullptr && (this->Backend == RenderBackend::Vtk || this->Tiled)) {
+        if (!this->ReadbackFrame("output", job.Output, error)) {
+            return false;
+        }
+    } else if (!this->WriteImage("output", this->RenderFrame(), job.Output, error)) {
+        return false;
+    }
+    std::vector<unsigned char> bytes;
+    if (this->WantUVMap) {
+        TRACE_SCOPE("uvmap");
+        this->GetUVMap(bytes);
+        if (!this->WriteBytes("uvmap", job.UVMap, bytes, error)) {
+            return false;
+        }
+    }
+    if (this->WantForwardMap) {
+        TRACE_SCOPE("forwardmap");
+        if (!this->GetForwardMap(bytes, error) || !this->WriteBytes("forwardmap", job.ForwardMap, bytes, error)) {
+            return false;
+        }
+    }
+    if (this->WantOutline) {
+        TRACE_SCOPE("outline");
+        std::string json;
+        this->GetOutline(json);
+        bytes.assign(json.begin(), json.end());
+        if (!this->WriteBytes("outline", job.Outline, bytes, error)) {
+            return false;
+        }
+    }
+    if (this->WantAnnotations) {
+        TRACE_SCOPE("annotations");
+        if (!this->GetBoxAnnotations(job.Boxes, bytes, error) ||
+            !this->WriteBytes("annotations", job.Annotations, bytes, error)) {
+            return false;
+        }
+    }
+    if (this->WantGBuffer) {
+        std::vector<LightVariant> variants;
+        if (!ReadLightVariants(job.Relight, job.Light, variants, error) ||
+            !this->RenderLightVariants(variants, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RenderContext::WriteImage(const std::string& field, vtkImageData* image, const std::string& path,
+                               std::string& error) {
+    auto* pixels = vtkUnsignedCharArray::SafeDownCast(image->GetPointData()->GetScalars());
+    int dimensions[3];
+    image->GetDimensions(dimensions);
+    if (pixels == nullptr) {
+        error = "frame is not 8-bit";
+        return false;
+    }
+    const int channels = pixels->GetNumberOfComponents();
+    if (this->Output != nullptr) {
+        this->Output->SubmitImage(field, path, pixels->GetPointer(0), dimensions[0], dimensions[1], channels);
+        return true;
+    }
+    {
+        TRACE_SCOPE("encode");
+        if (!this->Encoder.Encode(pixels->GetPointer(0), dimensions[0], dimensions[1], channels,
+                                  ImageFormatFromPath(path), this->EncodedImage, error)) {
+            return false;
+        }
+    }
+    TRACE_SCOPE("write");
+    return WriteBinaryFile(path, this->EncodedImage, error);
+}
+
+bool RenderContext::WriteBytes(const std::string& field, const std::string& path, std::vector<unsigned char>& bytes,
+                               std::string& error) {
+    if (this->Output != nullptr) {
+        this->Output->SubmitBytes(field, path, std::move(bytes));
+        bytes.clear();
+        return true;
+    }
+    TRACE_SCOPE("write");
+    return WriteBinaryFile(path, bytes, error);
+}
+
+bool RenderContext::RenderLightVariants(const std::vector<LightVariant>& variants, std::string& error) {
+    // Свет каждого варианта проходит через vtkLight и vtkProperty, как и свет задания: параметры шейдера
+    // VTK и освещение G-буфера вычисляются одним и тем же кодом.
+    RasterScene scene;
+    this->BuildRasterScene(scene);
+    bool ok = true;
+    for (std::size_t i = 0; i < variants.size(); ++i) {
+        TRACE_SCOPE("relight");
+        const LightVariant& variant = variants[i];
+        this->ApplyLight(variant.Light);
+        this->BuildLighting(scene);
+        this->VariantShader.Shade(this->Rasterizer.GetGBuffer(), scene);
+        WrapColor(this->VariantShader.GetColor(), this->Width, this->Height, this->VariantFrame);
+        if (!this->WriteImage("relight/" + std::to_string(i), this->VariantFrame, variant.Output, error)) {
+            ok = false;
+            break;
+        }
+    }
+    // Сцене возвращается свет задания: с ним следующий Prepare сравнивает свет своего задания.
+    this->ApplyLight(this->Applied.Light);
+    return ok;
+}
+
+void RenderContext::GetUVMap(std::vector<unsigned char>& bytes) const {
+    EncodeUVMap(this->Rasterizer.GetUV().data(), this->Rasterizer.GetCoverage().data(), this->Width, this->Height,
+                this->UVEncoding, bytes);
+}
+
+bool RenderContext::GetForwardMap(std::vector<unsigned char>& bytes, std::string& error) {
+    // Размер по умолчанию берется из исходного изображения: мип-уровни бэкенду Vtk не нужны.
+    int width = this->ForwardMapWidth;
+    int height = this->ForwardMapHeight;
+    if (width <= 0 || height <= 0) {
+        int dimensions[3] = {0, 0, 0};
+        this->CurrentTexture->GetImage()->GetDimensions(dimensions);
+        width = dimensions[0];
+        height = dimensions[1];
+    }
+
+    RasterScene scene;
+    this->BuildRasterScene(scene);
+    if (!this->ForwardMapBuilder.Compute(scene, this->Rasterizer.GetDepth(), this->Width, this->Height, width,
+                                         height, error)) {
+        return false;
+    }
+    this->ForwardMapBuilder.Encode(bytes);
+    return true;
+}
+
+void RenderContext::SetForwardMapSize(int width, int height) {
+    this->ForwardMapWidth = width;
+    this->ForwardMapHeight = height;
+}
+
+void RenderContext::GetOutline(std::string& json) {
+    RasterScene scene;
+    this->BuildRasterScene(scene);
+    if (this->OutlineVersion != this->TopologyVersion) {
+        this->Outline.Extract(scene.Mesh);
+        this->OutlineVersion = this->TopologyVersion;
+    }
+    this->Outline.Project(scene, this->Rasterizer.GetDepth(), this->Width, this->Height);
+    this->Outline.EncodeJson(json);
+}
+
+bool RenderContext::GetBoxAnnotations(const std::string& boxesPath, std::vector<unsigned char>& bytes,
+                                      std::string& error) {
+    // Обычно один и тот же список идет подряд во многих ракурсах страницы, поэтому хранится только последний.
+    if (boxesPath != this->BoxesPath) {
+        if (!ReadBoxList(boxesPath, this->Boxes, error)) {
+            this->BoxesPath.clear();
+            return false;
+        }
+        this->BoxesPath = boxesPath;
+        this->AnnotatorVersion = 0;
+    }
+
+    RasterScene scene;
+    this->BuildRasterScene(scene);
+    if (this->AnnotatorVersion != this->TopologyVersion || this->AnnotatorTexture != this->CurrentTexture->GetKey()) {
+        int dimensions[3] = {0, 0, 0};
+        this->CurrentTexture->GetImage()->GetDimensions(dimensions);
+        this->Annotator.Locate(scene.Mesh, this->Boxes, dimensions[0], dimensions[1]);
+        this->AnnotatorVersion = this->TopologyVersion;
+        this->AnnotatorTexture = this->CurrentTexture->GetKey();
+    }
+    this->Annotator.Project(scene, this->Rasterizer.GetDepth(), this->Width, this->Height);
+    this->Annotator.Encode(bytes);
+    return true;
+}
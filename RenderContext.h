@@ -0,0 +1,257 @@
+#ifndef RENDER_CONTEXT_H
+#define RENDER_CONTEXT_H
+
+#include "BoxAnnotator.h"
+#include "DocumentOutline.h"
+#include "Downsampler.h"
+#include "EncodePipeline.h"
+#include "ForwardMap.h"
+#include "ImageEncoder.h"
+#include "MeshBuffers.h"
+#include "MeshFile.h"
+#include "PageDeformer.h"
+#include "ParallelOBJReader.h"
+#include "Relighter.h"
+#include "RenderJob.h"
+#include "SoftwareRasterizer.h"
+#include "TextureCache.h"
+#include "UVMap.h"
+
+#include <vtkActor.h>
+#include <vtkCamera.h>
+#include <vtkImageData.h>
+#include <vtkLight.h>
+#include <vtkNew.h>
+#include <vtkPlaneSource.h>
+#include <vtkPolyData.h>
+#include <vtkPolyDataMapper.h>
+#include <vtkRenderWindow.h>
+#include <vtkRenderer.h>
+#include <vtkSmartPointer.h>
+#include <vtkTexture.h>
+#include <vtkTransform.h>
+#include <vtkUnsignedCharArray.h>
+#include <vtkWindowToImageFilter.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Чем рисуется кадр: OpenGL-конвейером VTK или встроенным программным растеризатором.
+enum class RenderBackend {
+    Vtk,
+    Cpu,
+};
+
+bool ParseRenderBackend(const std::string& name, RenderBackend& backend);
+
+// Съемка кадра по частям: кадр рисуется в Supersample раз крупнее по каждой оси участками не больше
+// TileWidth x TileHeight (размер окна), и каждый участок сразу уменьшается фильтром в свою часть кадра.
+// Так ни кадр крупнее окна, ни суперсэмплированный кадр целиком никогда не лежат в памяти.
+struct CaptureSettings {
+    int Supersample = 1; // 1..16
+    DownsampleFilter Filter = DownsampleFilter::Lanczos;
+    int TileWidth = 2048;
+    int TileHeight = 2048;
+};
+
+// Внеэкранный (offscreen) контекст рендеринга для пакетного режима.
+// Окно, рендерер, актор, камера и свет создаются один раз и переиспользуются между заданиями:
+// каждое задание лишь меняет параметры сцены, поэтому OpenGL-контекст и загруженные
+// в него данные живут все время работы процесса. Интерактор не создается вовсе.
+//
+// Сцена всегда описывается объектами VTK; бэкенд Cpu берет из них геометрию, текстуру, матрицы
+// камеры и параметры света и рисует кадр SoftwareRasterizer, не создавая OpenGL-контекст.
+class RenderContext {
+public:
+    RenderContext(int width, int height, RenderBackend backend = RenderBackend::Vtk);
+
+    // Настраивает сцену под задание, рендерит кадр и сохраняет его в job.Output (и карты в job.UVMap и job.ForwardMap).
+    // Варианты освещения job.Relight дорисовываются из G-буфера этого кадра (см. RenderLightVariants).
+    bool Render(const RenderJob& job, std::string& error);
+
+    // Настраивает сцену под задание без рендеринга. Повторяются только стадии, параметры которых изменились
+    // с прошлого задания: новая камера меняет лишь матрицы, новый свет — параметры света, поворот — матрицу
+    // актора, новая текстура — только ее привязку (и загрузку, если ее еще нет в GPU). Геометрия
+    // перестраивается и загружается заново только при другой сетке или другой форме страницы.
+    bool Prepare(const RenderJob& job, std::string& error);
+
+    // Рендерит подготовленную сцену и возвращает кадр (строки снизу вверх): RGBA у бэкенда Cpu, у бэкенда Vtk —
+    // RGBA или RGB в зависимости от ImageEncoding::Alpha.
+    // Изображение принадлежит контексту и действительно до следующего вызова.
+    vtkImageData* RenderFrame();
+
+    // RenderFrame по частям, без vtkImageData: DrawFrame рисует подготовленную сцену (у бэкенда Vtk кадр
+    // остается в окне), ReadFrame читает его в pixels — Width * Height * channels байт, channels 3 или 4,
+    // строки снизу вверх. Кадр можно прочитать несколько раз.
+    void DrawFrame();
+    bool ReadFrame(unsigned char* pixels, int channels);
+
+    // Карта пиксель -> текстура последнего кадра в формате .uvmap. Строится вместе с кадром,
+    // если у подготовленного задания задан UVMap: бэкенд Cpu берет UV из своего прохода видимости,
+    // бэкенд Vtk дополнительно запускает только проход видимости растеризатора.
+    void GetUVMap(std::vector<unsigned char>& bytes) const;
+    void SetUVMapEncoding(UVMapEncoding encoding) { this->UVEncoding = encoding; }
+
+    // Прямая карта текстура -> кадр последнего кадра в формате .fwdmap: сетка растеризуется в пространстве
+    // текстуры и проецируется текущей камерой, видимость проверяется по глубине прохода видимости.
+    // Размер карты задает SetForwardMapSize; 0 — размер текстуры.
+    bool GetForwardMap(std::vector<unsigned char>& bytes, std::string& error);
+    void SetForwardMapSize(int width, int height);
+
+    // Граница и углы документа в последнем кадре (JSON, см. DocumentOutline). Граница извлекается
+    // заново только при смене топологии сетки, на каждый кадр остается проекция ее точек.
+    void GetOutline(std::string& json);
+
+    // Разметка прямоугольников текстуры в последнем кадре (.boxes, см. BoxAnnotator). Точки прямоугольников
+    // ищутся в развертке один раз на сетку и список; на каждый кадр остается их пакетная проекция.
+    bool GetBoxAnnotations(const std::string& boxesPath, std::vector<unsigned char>& bytes, std::string& error);
+
+    // Кадры вариантов освещения того же ракурса: G-буфер последнего кадра освещается каждым вариантом
+    // на CPU (Relighter), без повторного рендеринга. Сохраняет кадр каждого варианта.
+    bool RenderLightVariants(const std::vector<LightVariant>& variants, std::string& error);
+
+    // Формат кадров задается расширением пути вывода, уровень и фильтр PNG, качество JPEG и альфа-канал —
+    // здесь. Без альфа-канала кадр и читается из окна как RGB.
+    void SetImageEncoding(const ImageEncoding& encoding);
+
+    // Конвейер, которому Render и RenderLightVariants отдают кадры и карты вместо записи на месте:
+    // кодирование и запись идут в его потоках, пока рисуется следующий кадр. nullptr — писать синхронно.
+    // Конвейер должен жить, пока им пользуется контекст.
+    void SetOutputPipeline(EncodePipeline* pipeline) { this->Output = pipeline; }
+
+    // Включает съемку по частям, если кадр с суперсэмплингом не помещается в участок или Supersample > 1;
+    // окно тогда получает размер участка. Карты, граница, разметка и варианты освещения строятся
+    // по-прежнему в размере кадра, без суперсэмплинга.
+    void SetCapture(const CaptureSettings& capture);
+    bool IsTiled() const { return this->Tiled; }
+
+    void SetBackend(RenderBackend backend) { this->Backend = backend; }
+    RenderBackend GetBackend() const { return this->Backend; }
+
+    vtkRenderWindow* GetRenderWindow() { return this->RenderWindow; }
+    vtkRenderer* GetRenderer() { return this->Renderer; }
+
+private:
+    // previous — задание, уже примененное к сцене; nullptr — применить все заново.
+    bool ApplyMesh(const RenderJob& job, const RenderJob* previous, std::string& error);
+    void ApplyPage(const RenderJob& job);
+    void SetMapperInput(vtkPolyData* polyData);
+    bool ApplyTexture(const RenderJob& job, std::string& error);
+    void ApplyCamera(const RenderJob& job);
+    void ApplyLight(const LightSetup& light);
+    // field — имя вывода в записи набора данных (см. EncodePipeline); без конвейера не используется.
+    bool WriteImage(const std::string& field, vtkImageData* image, const std::string& path, std::string& error);
+    // Записывает байты или отдает их конвейеру; в обоих случаях bytes можно сразу заполнять заново.
+    bool WriteBytes(const std::string& field, const std::string& path, std::vector<unsigned char>& bytes,
+                    std::string& error);
+
+    vtkImageData* RenderVtk();
+    void DrawVtk(); // кадр в окне и, если нужен, проход видимости растеризатора
+    void RenderVisibility(); // проход видимости растеризатора в размере кадра для карт и G-буфера
+    // Читает окно width x height в pixels (channels 3 или 4, строки снизу вверх).
+    bool ReadWindow(unsigned char* pixels, int width, int height, int channels);
+    // Рисует кадр по частям (см. CaptureSettings) и собирает его в pixels: Width * Height * channels байт.
+    bool CaptureTiles(unsigned char* pixels, int channels);
+    // Рисует кадр бэкендом Vtk и читает его из окна прямо в буфер конвейера вывода; только с конвейером.
+    bool ReadbackFrame(const std::string& field, const std::string& path, std::string& error);
+    vtkImageData* RenderCpu();
+    void BuildRasterScene(RasterScene& scene) { this->BuildRasterScene(scene, this->Width, this->Height); }
+    // Сцена для кадра width x height: от размера зависит только соотношение сторон проекции.
+    void BuildRasterScene(RasterScene& scene, int width, int height);
+    void BuildLighting(RasterScene& scene);
+    bool NeedsVisibilityPass() const {
+        return this->WantUVMap || this->WantForwardMap || this->WantOutline || this->WantAnnotations ||
+               this->WantGBuffer;
+    }
+
+    int Width;
+    int Height;
+    RenderBackend Backend;
+    bool WantUVMap = false;
+    bool WantForwardMap = false;
+    bool WantOutline = false;
+    bool WantAnnotations = false;
+    bool WantGBuffer = false;
+    UVMapEncoding UVEncoding = UVMapEncoding::Float32;
+    int ForwardMapWidth = 0;
+    int ForwardMapHeight = 0;
+    // Задание, с которым совпадает сцена после последнего успешного Prepare (см. Prepare).
+    RenderJob Applied;
+    bool HasApplied = false;
+
+    vtkNew<vtkPlaneSource> PlaneSource;
+    vtkNew<ParallelOBJReader> ObjReader;
+    // Время изменения (нс) и размер файла, прочитанного ObjReader.
+    long long ObjFileTime = -1;
+    long long ObjFileSize = -1;
+    // Сетка из MeshCache и построенная поверх нее без копирования vtkPolyData.
+    std::shared_ptr<const MappedMesh> CurrentMesh;
+    vtkSmartPointer<vtkPolyData> MappedPolyData;
+    // Деформируемая страница и vtkPolyData поверх ее массивов: новая форма меняет точки на месте.
+    PageDeformer Deformer;
+    vtkSmartPointer<vtkPolyData> PagePolyData;
+    vtkNew<vtkPolyDataMapper> Mapper;
+    // Текущая текстура из общего кэша и загруженные в OpenGL vtkTexture для записей, которые
+    // еще живы в кэше: при возврате к уже встречавшейся текстуре она только привязывается заново.
+    struct UploadedTexture {
+        std::weak_ptr<const CachedTexture> Source;
+        vtkSmartPointer<vtkTexture> Texture;
+    };
+    std::shared_ptr<const CachedTexture> CurrentTexture;
+    std::unordered_map<std::string, UploadedTexture> UploadedTextures;
+    vtkNew<vtkTransform> Transform;
+    vtkNew<vtkActor> Actor;
+    vtkNew<vtkCamera> Camera;
+    vtkNew<vtkLight> Light;
+    vtkNew<vtkRenderer> Renderer;
+    vtkNew<vtkRenderWindow> RenderWindow;
+    vtkNew<vtkWindowToImageFilter> WindowToImageFilter;
+    vtkNew<vtkUnsignedCharArray> ReadbackPixels; // обертка над буфером кадра на время ReadFrame
+    bool CaptureAlpha = false;
+    ImageEncoder Encoder;
+    std::vector<unsigned char> EncodedImage;
+    EncodePipeline* Output = nullptr;
+
+    // Состояние программного бэкенда: копия сетки пересобирается только при ее изменении.
+    // Отображенные сетки и деформируемую страницу копировать не нужно — растеризатор читает их массивы.
+    SoftwareRasterizer Rasterizer;
+    ForwardMapper ForwardMapBuilder;
+    // Топология сетки последней сцены: версия растет, когда BuildRasterScene видит другие треугольники.
+    // По ней граница и точки прямоугольников понимают, что их нужно пересчитать.
+    const std::uint32_t* TopologyIndices = nullptr;
+    std::size_t TopologyTriangles = 0;
+    vtkMTimeType TopologyTime = 0;
+    unsigned long TopologyVersion = 0;
+
+    DocumentOutline Outline;
+    unsigned long OutlineVersion = 0;
+
+    BoxAnnotator Annotator;
+    std::vector<TextureBox> Boxes;
+    std::string BoxesPath;
+    unsigned long AnnotatorVersion = 0;
+    std::string AnnotatorTexture;
+    MeshBuffers CpuMesh;
+    vtkPolyData* CpuMeshSource = nullptr;
+    vtkMTimeType CpuMeshTime = 0;
+    vtkNew<vtkImageData> CpuFrame;
+
+    // Съемка по частям: окно размером с участок, два буфера участков (один читается, пока уменьшается
+    // другой), собранный кадр для RenderFrame и DrawFrame и растеризатор участков бэкенда Cpu.
+    CaptureSettings Capture;
+    bool Tiled = false;
+    int WindowWidth;
+    int WindowHeight;
+    Downsampler TileFilter;
+    std::vector<unsigned char> TilePixels[2];
+    std::vector<unsigned char> CaptureFrame;
+    int CaptureChannels = 0;
+    vtkNew<vtkImageData> CaptureImage;
+    SoftwareRasterizer TileRasterizer;
+    Relighter VariantShader;
+    vtkNew<vtkImageData> VariantFrame;
+};
+
+#endif // RENDER_CONTEXT_H
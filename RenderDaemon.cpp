@@ -0,0 +1,417 @@
+#include "RenderDaemon.h"
+
+#include "MeshCache.h"
+#include "TextureCache.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    volatile std::sig_atomic_t StopRequested = 0;
+
+    void RequestStop(int) {
+        StopRequested = 1;
+    }
+
+    // Без SA_RESTART сигнал прерывает poll и waitpid, и цикл службы видит флаг; задание, которое уже
+    // рисуется, доводится до конца.
+    void InstallStopHandlers() {
+        struct sigaction action = {};
+        action.sa_handler = RequestStop;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT, &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+        // Клиент может отключиться, не дождавшись ответа: запись тогда вернет EPIPE, а не завершит службу.
+        std::signal(SIGPIPE, SIG_IGN);
+    }
+
+    double MillisecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    // Клиент службы: запросы читаются из In, ответы пишутся в Out (у сокета это один дескриптор).
+    struct Connection {
+        int In = -1;
+        int Out = -1;
+        std::string Input; // прочитано, но еще не обработано
+        std::size_t Requests = 0;
+        bool Closed = false; // клиент закрыл In; строки, оставшиеся в Input, все равно обрабатываются
+
+        bool HasRequest() const {
+            return this->Input.find('\n') != std::string::npos || (this->Closed && !this->Input.empty());
+        }
+
+        // Следующая строка; последняя строка потока может быть без перевода строки.
+        std::string TakeRequest() {
+            const std::string::size_type end = std::min(this->Input.find('\n'), this->Input.size());
+            std::string line = this->Input.substr(0, end);
+            this->Input.erase(0, end + 1);
+            return line;
+        }
+    };
+
+    void Receive(Connection& client) {
+        char buffer[65536];
+        const ssize_t count = read(client.In, buffer, sizeof(buffer));
+        if (count > 0) {
+            client.Input.append(buffer, static_cast<std::size_t>(count));
+        } else if (count == 0 || (errno != EINTR && errno != EAGAIN)) {
+            client.Closed = true;
+        }
+    }
+
+    bool WriteAll(int fd, const std::string& text) {
+        std::size_t written = 0;
+        while (written < text.size()) {
+            const ssize_t count = write(fd, text.data() + written, text.size() - written);
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                return false;
+            }
+            written += static_cast<std::size_t>(count);
+        }
+        return true;
+    }
+
+    // Пути всех выводов задания, которые записал Render.
+    void CollectOutputs(const RenderJob& job, std::vector<std::string>& outputs) {
+        for (const std::string* path : {&job.Output, &job.UVMap, &job.ForwardMap, &job.Outline, &job.Annotations}) {
+            if (!path->empty()) {
+                outputs.push_back(*path);
+            }
+        }
+        std::vector<LightVariant> variants;
+        std::string error;
+        if (!job.Relight.empty() && ReadLightVariants(job.Relight, job.Light, variants, error)) {
+            for (const LightVariant& variant : variants) {
+                outputs.push_back(variant.Output);
+            }
+        }
+    }
+
+    // Теплое состояние процесса службы: один контекст рисует все запросы. Вывод пишется синхронно,
+    // без конвейера: ответ отправляется, когда файлы уже на диске.
+    class RequestHandler {
+    public:
+        explicit RequestHandler(const BatchOptions& options)
+            : Context(options.Width, options.Height, options.Backend),
+              FrameBytes(static_cast<std::size_t>(options.Width) * static_cast<std::size_t>(options.Height) * 4) {
+            ConfigureContext(this->Context, options);
+        }
+
+        // Рисует и читает кадры заданий из path (без path — встроенную плоскость), не сохраняя их:
+        // так до первого запроса создается OpenGL-контекст, компилируются шейдеры, а сетки и текстуры
+        // попадают в кэши и в GPU.
+        void Warmup(const std::string& path) {
+            std::vector<RenderJob> jobs;
+            std::string error;
+            if (path.empty()) {
+                jobs.emplace_back();
+            } else if (!ReadRenderJobs(path, jobs, error)) {
+                std::cerr << "warm-up: " << error << std::endl;
+            }
+            std::vector<unsigned char> pixels(this->FrameBytes);
+            for (const RenderJob& job : jobs) {
+                if (!this->Context.Prepare(job, error)) {
+                    std::cerr << "warm-up: " << error << std::endl;
+                    continue;
+                }
+                this->Context.DrawFrame();
+                this->Context.ReadFrame(pixels.data(), 4);
+            }
+        }
+
+        // Ответ на строку запроса number; false — строка пустая или комментарий, ответа на нее нет.
+        bool Handle(const std::string& line, std::size_t number, std::string& response) {
+            const std::string::size_type first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                return false;
+            }
+            // Трассировка по SIGUSR1 пишется здесь, между заданиями, как и в пакетном режиме.
+            Tracer::Instance().DumpIfRequested();
+            TRACE_SCOPE("job");
+            const auto start = Clock::now();
+            RenderJob job;
+            std::string id = std::to_string(number);
+            std::string error;
+            const bool ok = (line[first] == '{' ? ParseRenderJobJson(line, job, id, error)
+                                                : ParseRenderJob(line, job, error)) &&
+                            this->Context.Render(job, error);
+            const double milliseconds = MillisecondsSince(start);
+            ++this->Jobs;
+            this->Failed += ok ? 0 : 1;
+            this->Milliseconds += milliseconds;
+
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.3f", milliseconds);
+            response = "{\"id\": " + id + ", \"ok\": " + (ok ? "true" : "false") + ", \"ms\": " + buffer;
+            if (ok) {
+                std::vector<std::string> outputs;
+                CollectOutputs(job, outputs);
+                response += ", \"outputs\": [";
+                for (std::size_t i = 0; i < outputs.size(); ++i) {
+                    response += i == 0 ? "" : ", ";
+                    AppendJsonString(response, outputs[i]);
+                }
+                response += "]";
+            } else {
+                response += ", \"error\": ";
+                AppendJsonString(response, error);
+            }
+            response += "}\n";
+            return true;
+        }
+
+        void PrintStats(std::ostream& out, const std::string& prefix) {
+            out << prefix << "served " << this->Jobs << " jobs, " << this->Failed << " failed";
+            if (this->Jobs > 0) {
+                out << ", mean " << this->Milliseconds / static_cast<double>(this->Jobs) << " ms";
+            }
+            out << std::endl;
+            out << prefix << TextureCache::Instance().GetStats() << std::endl;
+        }
+
+    private:
+        RenderContext Context;
+        std::size_t FrameBytes;
+        std::size_t Jobs = 0;
+        std::size_t Failed = 0;
+        double Milliseconds = 0.0;
+    };
+
+    // Обслуживает клиентов до SIGINT или SIGTERM, а без сокета (listener < 0) — пока не закроется
+    // единственный клиент.
+    void Serve(RequestHandler& handler, int listener, std::vector<Connection>& clients) {
+        std::vector<pollfd> fds;
+        while (!StopRequested && (listener >= 0 || !clients.empty())) {
+            bool pending = false;
+            fds.clear();
+            for (const Connection& client : clients) {
+                pending = pending || client.HasRequest();
+                fds.push_back({client.Closed ? -1 : client.In, POLLIN, 0});
+            }
+            if (listener >= 0) {
+                fds.push_back({listener, POLLIN, 0});
+            }
+            // Пока есть необработанные строки, poll только забирает новые данные, не дожидаясь их.
+            if (poll(fds.data(), fds.size(), pending ? 0 : -1) < 0) {
+                if (errno != EINTR) {
+                    std::cerr << "poll: " << std::strerror(errno) << std::endl;
+                    return;
+                }
+                continue;
+            }
+
+            // По строке на клиента за круг: длинная очередь одного клиента не задерживает ответы остальным.
+            for (std::size_t i = 0; i < clients.size(); ++i) {
+                Connection& client = clients[i];
+                if (fds[i].revents != 0 && !client.Closed) {
+                    Receive(client);
+                }
+                std::string response;
+                if (client.HasRequest() && handler.Handle(client.TakeRequest(), client.Requests + 1, response)) {
+                    ++client.Requests;
+                    if (!WriteAll(client.Out, response)) {
+                        client.Closed = true; // клиент ушел, ответы на остальные его запросы некому читать
+                        client.Input.clear();
+                    }
+                }
+            }
+            clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                         [](const Connection& client) {
+                                             if (!client.Closed || client.HasRequest()) {
+                                                 return false;
+                                             }
+                                             if (client.In > STDERR_FILENO) {
+                                                 close(client.In);
+                                             }
+                                             return true;
+                                         }),
+                          clients.end());
+
+            if (listener >= 0 && (fds.back().revents & POLLIN) != 0) {
+                // EAGAIN — соединение уже принял другой рабочий процесс.
+                const int fd = accept(listener, nullptr, nullptr);
+                if (fd >= 0) {
+                    Connection client;
+                    client.In = fd;
+                    client.Out = fd;
+                    clients.push_back(client);
+                }
+            }
+        }
+        for (const Connection& client : clients) {
+            if (client.In > STDERR_FILENO) {
+                close(client.In);
+            }
+        }
+    }
+
+    // Слушающий сокет службы на path. Файл сокета от прошлого запуска, который никто не слушает, заменяется;
+    // к живой службе и к файлу, который не сокет, служба не прикасается.
+    int Listen(const std::string& path, std::string& error) {
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            error = "socket path is too long: " + path;
+            return -1;
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        const auto* generic = reinterpret_cast<const sockaddr*>(&address);
+
+        struct stat info = {};
+        if (lstat(path.c_str(), &info) == 0) {
+            const int probe = S_ISSOCK(info.st_mode) ? socket(AF_UNIX, SOCK_STREAM, 0) : -1;
+            const bool alive = probe >= 0 && connect(probe, generic, sizeof(address)) == 0;
+            if (probe >= 0) {
+                close(probe);
+            }
+            if (!S_ISSOCK(info.st_mode) || alive) {
+                error = path + (alive ? " is served by another daemon" : " exists and is not a socket");
+                return -1;
+            }
+            unlink(path.c_str());
+        }
+
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || bind(fd, generic, sizeof(address)) != 0 || listen(fd, 64) != 0) {
+            error = "cannot listen on " + path + ": " + std::strerror(errno);
+            if (fd >= 0) {
+                close(fd);
+            }
+            return -1;
+        }
+        // Рабочие процессы ждут на одном сокете: соединение может забрать другой процесс между poll и accept.
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        return fd;
+    }
+
+    // Процесс службы целиком: контекст, прогрев и обслуживание клиентов.
+    void ServeProcess(const BatchOptions& options, const DaemonOptions& daemon, int listener,
+                      const std::string& prefix, Clock::time_point start) {
+        RequestHandler handler(options);
+        handler.Warmup(daemon.WarmupPath);
+        std::cerr << prefix << "ready in " << MillisecondsSince(start) << " ms" << std::endl;
+        std::vector<Connection> clients;
+        if (listener < 0) {
+            Connection client;
+            client.In = STDIN_FILENO;
+            client.Out = STDOUT_FILENO;
+            clients.push_back(client);
+        }
+        Serve(handler, listener, clients);
+        handler.PrintStats(std::cerr, prefix);
+    }
+
+    void DumpTrace() {
+        std::string error;
+        if (!Tracer::Instance().Dump(error)) {
+            std::cerr << error << std::endl;
+        }
+    }
+}
+
+int RunDaemon(const BatchOptions& options, const DaemonOptions& daemon) {
+    const auto start = Clock::now();
+    TextureCache::Instance().SetCapacity(options.TextureCacheBytes);
+    MeshCache::Instance().SetDirectory(options.MeshCacheDirectory);
+    InstallStopHandlers();
+    // Без сокета клиент один, и рабочим процессам нечего делить.
+    BatchOptions processes = options;
+    processes.Workers = daemon.SocketPath.empty() ? 1 : std::max(1, options.Workers);
+    if (!options.TracePath.empty()) {
+        Tracer::Instance().Enable(processes.Workers <= 1 ? options.TracePath : options.TracePath + ".main");
+        TRACE_THREAD_NAME("render");
+    }
+
+    int listener = -1;
+    if (!daemon.SocketPath.empty()) {
+        std::string error;
+        listener = Listen(daemon.SocketPath, error);
+        if (listener < 0) {
+            std::cerr << error << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cerr << "listening on " << daemon.SocketPath << std::endl;
+    }
+
+    if (processes.Workers <= 1) {
+        ServeProcess(options, daemon, listener, std::string(), start);
+    } else {
+        // Контексты и пулы потоков создаются уже в рабочих, как и в пакетном режиме: в родителе до fork
+        // их быть не должно. Соединения между рабочими распределяет ядро через общий слушающий сокет.
+        std::fflush(nullptr);
+        std::vector<pid_t> children;
+        for (int worker = 0; worker < processes.Workers; ++worker) {
+            const pid_t pid = fork();
+            if (pid == 0) {
+                if (Tracer::Instance().IsEnabled()) {
+                    Tracer::Instance().AfterFork(options.TracePath + ".w" + std::to_string(worker));
+                }
+                ServeProcess(options, daemon, listener, "worker " + std::to_string(worker) + " ", start);
+                if (Tracer::Instance().IsEnabled()) {
+                    DumpTrace();
+                }
+                _exit(EXIT_SUCCESS);
+            }
+            if (pid > 0) {
+                children.push_back(pid);
+            } else {
+                std::cerr << "cannot start worker " << worker << ": " << std::strerror(errno) << std::endl;
+            }
+        }
+        // Родитель только ждет рабочих; SIGINT или SIGTERM, пришедший ему одному, передается им.
+        std::size_t running = children.size();
+        bool forwarded = false;
+        while (running > 0) {
+            if (StopRequested && !forwarded) {
+                for (const pid_t pid : children) {
+                    kill(pid, SIGTERM);
+                }
+                forwarded = true;
+            }
+            int status = 0;
+            const pid_t pid = waitpid(-1, &status, 0);
+            if (pid > 0) {
+                --running;
+                if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+                    std::cerr << "worker process " << pid << " died" << std::endl;
+                }
+            } else if (errno != EINTR) {
+                break;
+            }
+        }
+    }
+
+    if (listener >= 0) {
+        close(listener);
+        unlink(daemon.SocketPath.c_str());
+    }
+    if (Tracer::Instance().IsEnabled()) {
+        DumpTrace();
+        if (processes.Workers > 1) {
+            MergeTraces(processes);
+        }
+    }
+    return EXIT_SUCCESS;
+}
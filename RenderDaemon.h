@@ -0,0 +1,29 @@
+#ifndef RENDER_DAEMON_H
+#define RENDER_DAEMON_H
+
+#include "BatchRenderer.h"
+
+#include <string>
+
+// Параметры режима службы (--daemon); остальное — те же BatchOptions, что у пакета.
+struct DaemonOptions {
+    std::string SocketPath; // Unix-сокет для клиентов; пусто — запросы из stdin, ответы в stdout
+    std::string WarmupPath; // задания, которые рисуются при запуске без записи вывода; пусто — одна плоскость
+};
+
+// Служба рендеринга: процесс запускается один раз, а задания приходят по одному на строку — объектом JSON
+// (см. ParseRenderJobJson) или строкой key=value, как в списке заданий. На каждую строку служба отвечает
+// строкой JSON: {"id": ..., "ok": true, "ms": 12.5, "outputs": ["out.png", ...]} — ответ приходит, когда
+// все выводы задания уже записаны, ms — время от разбора запроса до записи. При ошибке вместо outputs
+// приходит "error".
+//
+// Модули VTK, OpenGL-контекст, шейдеры, кэши текстур и сеток и загруженные в GPU текстуры живут все время
+// работы службы, а до первого запроса прогреваются заданиями WarmupPath, поэтому задание стоит только
+// своего рендеринга. С сокетом и Workers > 1 запросы принимают рабочие процессы, у каждого свой контекст;
+// клиенты одного процесса обслуживаются по очереди, по строке за раз.
+//
+// SIGINT и SIGTERM завершают службу после текущего задания. Возвращает EXIT_SUCCESS, если служба
+// запустилась и завершилась штатно; ошибки заданий сообщаются только в ответах.
+int RunDaemon(const BatchOptions& options, const DaemonOptions& daemon);
+
+#endif // RENDER_DAEMON_H
@@ -0,0 +1,459 @@
+#include "RenderJob.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <utility>
+
+namespace {
+    // Разбирает вектор из трех чисел, записанных через запятую: "0,-1.5,2".
+    bool ParseVector3(const std::string& text, double out[3]) {
+        std::istringstream stream(text);
+        std::string item;
+        int count = 0;
+        while (std::getline(stream, item, ',')) {
+            if (count == 3) {
+                return false;
+            }
+            char* end = nullptr;
+            out[count] = std::strtod(item.c_str(), &end);
+            if (item.empty() || *end != '\0') {
+                return false;
+            }
+            ++count;
+        }
+        return count == 3;
+    }
+
+    bool ParseNumber(const std::string& text, double& out) {
+        char* end = nullptr;
+        out = std::strtod(text.c_str(), &end);
+        return !text.empty() && *end == '\0';
+    }
+
+    // Ключи освещения, общие для заданий и вариантов освещения. Возвращает false, если ключ не из их числа;
+    // иначе ok сообщает, удалось ли разобрать значение.
+    bool ParseLightKey(const std::string& key, const std::string& value, LightSetup& light, bool& ok) {
+        if (key == "light") {
+            ok = ParseVector3(value, light.Position);
+        } else if (key == "light_focal") {
+            ok = ParseVector3(value, light.FocalPoint);
+        } else if (key == "cone") {
+            ok = ParseNumber(value, light.ConeAngle);
+        } else if (key == "light_color") {
+            ok = ParseVector3(value, light.Color);
+        } else if (key == "intensity") {
+            ok = ParseNumber(value, light.Intensity);
+        } else if (key == "ambient") {
+            ok = ParseVector3(value, light.Ambient);
+        } else if (key == "diffuse") {
+            ok = ParseVector3(value, light.Diffuse);
+        } else if (key == "specular") {
+            ok = ParseVector3(value, light.Specular);
+        } else if (key == "specular_power") {
+            ok = ParseNumber(value, light.SpecularPower);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    // Ключ задания в виде key=value: общий разбор строк списка заданий и полей JSON.
+    bool ParseJobKey(const std::string& key, const std::string& value, RenderJob& job, std::string& error) {
+        bool ok = true;
+        if (key == "mesh") {
+            job.Mesh = value;
+        } else if (key == "texture") {
+            job.Texture = value;
+        } else if (key == "camera") {
+            ok = ParseVector3(value, job.CameraPosition);
+        } else if (key == "focal") {
+            ok = ParseVector3(value, job.CameraFocalPoint);
+        } else if (key == "viewup") {
+            ok = ParseVector3(value, job.CameraViewUp);
+        } else if (key == "rotate") {
+            ok = ParseNumber(value, job.RotateX);
+        } else if (key == "background") {
+            ok = ParseVector3(value, job.Background);
+        } else if (key == "warp") {
+            if (!ParsePageWarps(value, job.Warps, error)) {
+                error = "bad value for 'warp': " + error;
+                return false;
+            }
+        } else if (key == "grid") {
+            // WxH в строке задания, [W, H] в JSON (так его пишет EncodeRenderJobJson).
+            ok = (std::sscanf(value.c_str(), "%dx%d", &job.PageGrid[0], &job.PageGrid[1]) == 2 ||
+                  std::sscanf(value.c_str(), "%d,%d", &job.PageGrid[0], &job.PageGrid[1]) == 2) &&
+                 job.PageGrid[0] > 0 && job.PageGrid[1] > 0;
+        } else if (key == "output") {
+            job.Output = value;
+        } else if (key == "uvmap") {
+            job.UVMap = value;
+        } else if (key == "forwardmap") {
+            job.ForwardMap = value;
+        } else if (key == "outline") {
+            job.Outline = value;
+        } else if (key == "boxes") {
+            job.Boxes = value;
+        } else if (key == "annotations") {
+            job.Annotations = value;
+        } else if (key == "relight") {
+            job.Relight = value;
+        } else if (!ParseLightKey(key, value, job.Light, ok)) {
+            error = "unknown key '" + key + "'";
+            return false;
+        }
+        if (!ok) {
+            error = "bad value for '" + key + "': '" + value + "'";
+            return false;
+        }
+        return true;
+    }
+
+    bool CheckJob(const RenderJob& job, std::string& error) {
+        if (job.Output.empty()) {
+            error = "missing output=";
+            return false;
+        }
+        if (job.Annotations.empty() != job.Boxes.empty()) {
+            error = "annotations= and boxes= go together";
+            return false;
+        }
+        return true;
+    }
+
+    // Плоский объект JSON запроса: значения — строки, числа и массивы чисел. ReadValue приводит значение
+    // к виду key=value: массив — числа через запятую.
+    struct JsonCursor {
+        const char* Position;
+
+        void SkipSpace() {
+            while (*this->Position == ' ' || *this->Position == '\t' || *this->Position == '\r' ||
+                   *this->Position == '\n') {
+                ++this->Position;
+            }
+        }
+
+        bool Skip(char c) {
+            this->SkipSpace();
+            if (*this->Position != c) {
+                return false;
+            }
+            ++this->Position;
+            return true;
+        }
+
+        bool AtEnd() {
+            this->SkipSpace();
+            return *this->Position == '\0';
+        }
+
+        bool ReadString(std::string& out) {
+            if (!this->Skip('"')) {
+                return false;
+            }
+            out.clear();
+            while (*this->Position != '"') {
+                char c = *this->Position++;
+                if (c == '\0') {
+                    return false;
+                }
+                if (c == '\\') {
+                    c = *this->Position++;
+                    if (c == 'u') {
+                        unsigned code = 0;
+                        if (std::sscanf(this->Position, "%4x", &code) != 1) {
+                            return false;
+                        }
+                        this->Position += 4;
+                        AppendUtf8(out, code);
+                        continue;
+                    }
+                    switch (c) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        break;
+                    case 'b':
+                        c = '\b';
+                        break;
+                    case 'f':
+                        c = '\f';
+                        break;
+                    case 'n':
+                        c = '\n';
+                        break;
+                    case 'r':
+                        c = '\r';
+                        break;
+                    case 't':
+                        c = '\t';
+                        break;
+                    default:
+                        return false;
+                    }
+                }
+                out += c;
+            }
+            ++this->Position;
+            return true;
+        }
+
+        bool ReadNumber(std::string& out) {
+            this->SkipSpace();
+            const char* begin = this->Position;
+            while (*this->Position != '\0' && std::strchr("+-.0123456789eE", *this->Position) != nullptr) {
+                ++this->Position;
+            }
+            out.assign(begin, this->Position);
+            return !out.empty();
+        }
+
+        bool ReadValue(std::string& out) {
+            this->SkipSpace();
+            if (*this->Position == '"') {
+                return this->ReadString(out);
+            }
+            if (!this->Skip('[')) {
+                return this->ReadNumber(out);
+            }
+            out.clear();
+            while (!this->Skip(']')) {
+                std::string number;
+                if ((!out.empty() && !this->Skip(',')) || !this->ReadNumber(number)) {
+                    return false;
+                }
+                out += (out.empty() ? "" : ",") + number;
+            }
+            return true;
+        }
+
+        static void AppendUtf8(std::string& out, unsigned code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+    };
+
+    void AppendNumbers(std::string& json, const double* values, int count) {
+        char buffer[32];
+        json += count > 1 ? "[" : "";
+        for (int i = 0; i < count; ++i) {
+            std::snprintf(buffer, sizeof(buffer), "%s%.9g", i == 0 ? "" : ", ", values[i]);
+            json += buffer;
+        }
+        json += count > 1 ? "]" : "";
+    }
+
+    // Вызывает parse для каждой непустой строки файла, кроме комментариев; ошибку дополняет номером строки.
+    template <typename Parse>
+    bool ParseLines(const std::string& path, std::string& error, Parse&& parse) {
+        std::ifstream file(path);
+        if (!file) {
+            error = "cannot open " + path;
+            return false;
+        }
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(file, line)) {
+            ++lineNumber;
+            const std::string::size_type first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                continue;
+            }
+            std::string lineError;
+            if (!parse(line, lineError)) {
+                error = path + ":" + std::to_string(lineNumber) + ": " + lineError;
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+void AppendJsonString(std::string& json, const std::string& value) {
+    json += '"';
+    for (const char c : value) {
+        if (c == '"' || c == '\\') {
+            json += '\\';
+            json += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            json += buffer;
+        } else {
+            json += c;
+        }
+    }
+    json += '"';
+}
+
+bool ParseRenderJob(const std::string& line, RenderJob& job, std::string& error) {
+    std::istringstream stream(line);
+    std::string token;
+    while (stream >> token) {
+        const std::string::size_type eq = token.find('=');
+        if (eq == std::string::npos) {
+            error = "expected key=value, got '" + token + "'";
+            return false;
+        }
+        if (!ParseJobKey(token.substr(0, eq), token.substr(eq + 1), job, error)) {
+            return false;
+        }
+    }
+    return CheckJob(job, error);
+}
+
+bool ParseRenderJobJson(const std::string& json, RenderJob& job, std::string& id, std::string& error) {
+    JsonCursor cursor{json.c_str()};
+    if (!cursor.Skip('{')) {
+        error = "expected a JSON object";
+        return false;
+    }
+    bool first = true;
+    while (!cursor.Skip('}')) {
+        std::string key;
+        if ((!first && !cursor.Skip(',')) || !cursor.ReadString(key) || !cursor.Skip(':')) {
+            error = "malformed JSON object";
+            return false;
+        }
+        first = false;
+        cursor.SkipSpace();
+        const char* begin = cursor.Position;
+        std::string value;
+        if (!cursor.ReadValue(value)) {
+            error = "bad JSON value for '" + key + "': only strings, numbers and arrays of numbers are accepted";
+            return false;
+        }
+        if (key == "id") {
+            id.assign(begin, cursor.Position); // возвращается в ответе как есть, вместе с кавычками
+        } else if (!ParseJobKey(key, value, job, error)) {
+            return false;
+        }
+    }
+    if (!cursor.AtEnd()) {
+        error = "unexpected text after the JSON object";
+        return false;
+    }
+    return CheckJob(job, error);
+}
+
+void EncodeRenderJobJson(const RenderJob& job, std::string& json) {
+    const double grid[2] = {static_cast<double>(job.PageGrid[0]), static_cast<double>(job.PageGrid[1])};
+    const LightSetup& light = job.Light;
+    const struct {
+        const char* Name;
+        const double* Values;
+        int Count;
+    } numbers[] = {
+        {"camera", job.CameraPosition, 3}, {"focal", job.CameraFocalPoint, 3}, {"viewup", job.CameraViewUp, 3},
+        {"rotate", &job.RotateX, 1}, {"background", job.Background, 3}, {"grid", grid, 2},
+        {"light", light.Position, 3}, {"light_focal", light.FocalPoint, 3}, {"cone", &light.ConeAngle, 1},
+        {"light_color", light.Color, 3}, {"intensity", &light.Intensity, 1}, {"ambient", light.Ambient, 3},
+        {"diffuse", light.Diffuse, 3}, {"specular", light.Specular, 3},
+        {"specular_power", &light.SpecularPower, 1},
+    };
+    const std::pair<const char*, const std::string*> strings[] = {
+        {"output", &job.Output}, {"uvmap", &job.UVMap}, {"forwardmap", &job.ForwardMap},
+        {"outline", &job.Outline}, {"boxes", &job.Boxes}, {"annotations", &job.Annotations},
+        {"relight", &job.Relight},
+    };
+
+    json = "{\"mesh\": ";
+    AppendJsonString(json, job.Mesh);
+    json += ", \"texture\": ";
+    AppendJsonString(json, job.Texture);
+    for (const auto& number : numbers) {
+        json += ", \"" + std::string(number.Name) + "\": ";
+        AppendNumbers(json, number.Values, number.Count);
+    }
+    json += ", \"warp\": ";
+    AppendJsonString(json, FormatPageWarps(job.Warps));
+    for (const auto& value : strings) {
+        if (!value.second->empty()) {
+            json += ", \"" + std::string(value.first) + "\": ";
+            AppendJsonString(json, *value.second);
+        }
+    }
+    json += "}";
+}
+
+bool ReadRenderJobs(const std::string& path, std::vector<RenderJob>& jobs, std::string& error) {
+    return ParseLines(path, error, [&](const std::string& line, std::string& lineError) {
+        RenderJob job;
+        if (!ParseRenderJob(line, job, lineError)) {
+            return false;
+        }
+        jobs.push_back(job);
+        return true;
+    });
+}
+
+bool ReadLightVariants(const std::string& path, const LightSetup& base, std::vector<LightVariant>& variants,
+                       std::string& error) {
+    variants.clear();
+    return ParseLines(path, error, [&](const std::string& line, std::string& lineError) {
+        LightVariant variant;
+        variant.Light = base;
+        std::istringstream stream(line);
+        std::string token;
+        while (stream >> token) {
+            const std::string::size_type eq = token.find('=');
+            if (eq == std::string::npos) {
+                lineError = "expected key=value, got '" + token + "'";
+                return false;
+            }
+            const std::string key = token.substr(0, eq);
+            const std::string value = token.substr(eq + 1);
+            bool ok = true;
+            if (key == "output") {
+                variant.Output = value;
+            } else if (!ParseLightKey(key, value, variant.Light, ok)) {
+                lineError = "unknown lighting key '" + key + "'";
+                return false;
+            }
+            if (!ok) {
+                lineError = "bad value for '" + key + "': '" + value + "'";
+                return false;
+            }
+        }
+        if (variant.Output.empty()) {
+            lineError = "missing output=";
+            return false;
+        }
+        variants.push_back(variant);
+        return true;
+    });
+}
+
+void OrderJobsByScene(const std::vector<const RenderJob*>& jobs, std::vector<std::size_t>& order) {
+    // Номер сцены каждого задания, затем устойчивая сортировка подсчетом по нему.
+    std::unordered_map<std::string, std::size_t> sceneIds;
+    std::vector<std::size_t> scenes(jobs.size());
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        // Ключ не построившегося задания не совпадает ни с одной сценой: в путях нет нулевых байтов.
+        const std::string key = jobs[i] != nullptr ? jobs[i]->Mesh + '\n' + jobs[i]->Texture : std::string(1, '\0');
+        scenes[i] = sceneIds.emplace(key, sceneIds.size()).first->second;
+    }
+    std::vector<std::size_t> next(sceneIds.size() + 1, 0);
+    for (std::size_t scene : scenes) {
+        ++next[scene + 1];
+    }
+    for (std::size_t i = 1; i < next.size(); ++i) {
+        next[i] += next[i - 1];
+    }
+    order.resize(jobs.size());
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+        order[next[scenes[i]]++] = i;
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef RENDER_JOB_H
+#define RENDER_JOB_H
+
+#include "PageDeformer.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Освещение кадра: параметры vtkLight и цвета vtkProperty актора, которые влияют на затенение.
+struct LightSetup {
+    double Position[3] = {0.1, -1.2, 2.1};
+    double FocalPoint[3] = {0.0, 0.0, 0.0};
+    double ConeAngle = 30.0;
+    double Color[3] = {1.0, 1.0, 1.0}; // vtkLight::SetDiffuseColor
+    double Intensity = 1.0;
+
+    double Ambient[3] = {0.0, 0.0, 0.0};  // vtkProperty::GetAmbient() * GetAmbientColor()
+    double Diffuse[3] = {1.0, 1.0, 1.0};  // vtkProperty::GetDiffuse() * GetDiffuseColor()
+    double Specular[3] = {0.0, 0.0, 0.0}; // vtkProperty::GetSpecular() * GetSpecularColor()
+    double SpecularPower = 1.0;
+};
+
+// Вариант освещения того же ракурса: кадр, который получается из G-буфера без повторного рендеринга.
+struct LightVariant {
+    LightSetup Light;
+    std::string Output; // путь к PNG варианта
+};
+
+// Описание одного кадра пакетного рендеринга: что рисовать (сетка + текстура),
+// откуда смотреть (камера), чем освещать (свет) и куда сохранить результат.
+// Значения по умолчанию совпадают со сценой из интерактивного режима main.cpp.
+struct RenderJob {
+    std::string Mesh = "plane"; // "plane" — встроенная плоскость 0.913 x 1.291, иначе путь к OBJ-файлу
+    std::string Texture = "../chess.jpeg";
+
+    double CameraPosition[3] = {0.0, -1.5, 2.0};
+    double CameraFocalPoint[3] = {0.0, 0.0, 0.0};
+    double CameraViewUp[3] = {0.0, 1.0, 0.0};
+
+    LightSetup Light;
+
+    double RotateX = 45.0; // поворот сетки вокруг оси X (как transform->RotateX(45) в main.cpp)
+    double Background[3] = {25.0 / 255.0, 25.0 / 255.0, 112.0 / 255.0}; // MidnightBlue, как в main.cpp
+
+    // Деформации встроенной страницы (mesh=plane); пусто — плоский лист из vtkPlaneSource.
+    std::vector<PageWarp> Warps;
+    int PageGrid[2] = {128, 181}; // разрешение сетки деформируемой страницы, ячеек по ширине и высоте
+
+    std::string Output;      // путь к выходному PNG
+    std::string UVMap;       // путь к карте пиксель -> текстура (.uvmap); пусто — не сохранять
+    std::string ForwardMap;  // путь к прямой карте текстура -> кадр (.fwdmap); пусто — не сохранять
+    std::string Outline;     // путь к JSON с границей и углами документа в кадре; пусто — не сохранять
+    std::string Boxes;       // список прямоугольников разметки в пикселях текстуры (см. ReadBoxList)
+    std::string Annotations; // путь к разметке прямоугольников Boxes в кадре (.boxes); пусто — не сохранять
+    std::string Relight;     // список вариантов освещения (см. ReadLightVariants); пусто — только основной кадр
+};
+
+// Разбирает строку вида "mesh=plane texture=page.jpeg camera=0,-1.5,2 output=out.png uvmap=out.uvmap".
+// Незаданные ключи сохраняют значения по умолчанию. При ошибке возвращает false и заполняет error.
+bool ParseRenderJob(const std::string& line, RenderJob& job, std::string& error);
+
+// То же задание одним объектом JSON: {"mesh": "page.obj", "camera": [0, -1.5, 2], "grid": [128, 181],
+// "output": "out.png"} — ключи строки задания, векторы массивами; так же пишет задание EncodeRenderJobJson.
+// Поле id (строка или число) к заданию не относится: его исходный текст возвращается в id, чтобы ответ
+// можно было сопоставить с запросом; без поля id не меняется.
+bool ParseRenderJobJson(const std::string& json, RenderJob& job, std::string& id, std::string& error);
+
+// Параметры задания в JSON — все значения после разбора, включая значения по умолчанию.
+// Так задание описывается в поле params записей набора данных (см. RecordShard).
+void EncodeRenderJobJson(const RenderJob& job, std::string& json);
+
+// Дописывает value в json строкой JSON, в кавычках и с экранированием.
+void AppendJsonString(std::string& json, const std::string& value);
+
+// Читает список заданий: одно задание на строку, пустые строки и строки с '#' пропускаются.
+bool ReadRenderJobs(const std::string& path, std::vector<RenderJob>& jobs, std::string& error);
+
+// Читает варианты освещения: по одному на строку, ключи света (light, light_focal, cone, light_color, intensity,
+// ambient, diffuse, specular, specular_power) и обязательный output. Незаданные ключи берутся из base.
+bool ReadLightVariants(const std::string& path, const LightSetup& base, std::vector<LightVariant>& variants,
+                       std::string& error);
+
+// Порядок рендеринга, в котором задания с одной сеткой и текстурой идут подряд: order[k] — номер задания
+// в jobs, которое рендерится k-м. Сцены идут в порядке первого появления, задания сцены — в исходном
+// порядке. nullptr (задание не построилось) — своя сцена. Так пакет переставляет окно заданий (--group-scenes).
+void OrderJobsByScene(const std::vector<const RenderJob*>& jobs, std::vector<std::size_t>& order);
+
+#endif // RENDER_JOB_H
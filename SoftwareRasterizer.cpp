@@ -0,0 +1,724 @@
+#include "SoftwareRasterizer.h"
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RASTER_HAVE_AVX2_KERNEL 1
+#include <immintrin.h>
+#endif
+
+namespace {
+    const int TileSize = 32;
+    const int TilePixels = TileSize * TileSize;
+
+    // Отсечение по ближней плоскости выполняется в пространстве отсечения, поэтому
+    // вершинам нужны однородные координаты, а не только экранные.
+    struct ClipVertex {
+        float P[4];
+        float Attr[8];
+    };
+
+    // Матрица нормалей — обратная транспонированная к верхнему левому блоку 3x3 модели.
+    void NormalMatrix(const float m[16], float out[9]) {
+        const float a = m[0], b = m[1], c = m[2];
+        const float d = m[4], e = m[5], f = m[6];
+        const float g = m[8], h = m[9], i = m[10];
+        const float det = a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+        const float s = det != 0.0f ? 1.0f / det : 0.0f;
+        // (M^-1)^T = cofactor(M) / det
+        out[0] = (e * i - f * h) * s;
+        out[1] = -(d * i - f * g) * s;
+        out[2] = (d * h - e * g) * s;
+        out[3] = -(b * i - c * h) * s;
+        out[4] = (a * i - c * g) * s;
+        out[5] = -(a * h - b * g) * s;
+        out[6] = (b * f - c * e) * s;
+        out[7] = -(a * f - c * d) * s;
+        out[8] = (a * e - b * d) * s;
+    }
+
+    // Уравнения ребер треугольника, отсчитанные от центра первого пикселя прямоугольника.
+    // Eᵢ(x, y) = E[i] + DX[i] * x + DY[i] * y, пиксель внутри, если все Eᵢ >= 0 (или > 0 для
+    // «не верхних-левых» ребер — так общий край двух треугольников закрашивается ровно один раз).
+    struct EdgeSetup {
+        float E[3];
+        float DX[3];
+        float DY[3];
+        bool Inclusive[3];
+        float Z;
+        float ZX;
+        float ZY;
+        float InvArea;
+    };
+
+    struct TileBuffers {
+        float Depth[TilePixels];
+        std::int32_t Id[TilePixels];
+        float L1[TilePixels];
+        float L2[TilePixels];
+    };
+
+    bool SetupEdges(const SoftwareRasterizer::Vertex& v0, const SoftwareRasterizer::Vertex& v1,
+                    const SoftwareRasterizer::Vertex& v2, int px, int py, EdgeSetup& setup) {
+        const double x[3] = {v0.X, v1.X, v2.X};
+        const double y[3] = {v0.Y, v1.Y, v2.Y};
+        const double area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+        if (!(area > 0.0)) {
+            return false;
+        }
+        // Центр пикселя (px, py) — точка (px + 0.5, py + 0.5).
+        const double cx = px + 0.5;
+        const double cy = py + 0.5;
+        for (int i = 0; i < 3; ++i) {
+            const int a = (i + 1) % 3;
+            const int b = (i + 2) % 3;
+            const double dx = -(y[b] - y[a]);
+            const double dy = x[b] - x[a];
+            const double e = dx * (cx - x[a]) + dy * (cy - y[a]);
+            setup.E[i] = static_cast<float>(e);
+            setup.DX[i] = static_cast<float>(dx);
+            setup.DY[i] = static_cast<float>(dy);
+            setup.Inclusive[i] = dx > 0.0 || (dx == 0.0 && dy < 0.0);
+        }
+        setup.InvArea = static_cast<float>(1.0 / area);
+
+        // Глубина z/w линейна в экранных координатах.
+        const double z[3] = {v0.Z, v1.Z, v2.Z};
+        double zx = 0.0;
+        double zy = 0.0;
+        for (int i = 0; i < 3; ++i) {
+            zx += setup.DX[i] * z[i];
+            zy += setup.DY[i] * z[i];
+        }
+        zx /= area;
+        zy /= area;
+        double z0 = 0.0;
+        for (int i = 0; i < 3; ++i) {
+            z0 += static_cast<double>(setup.E[i]) * z[i];
+        }
+        setup.Z = static_cast<float>(z0 / area);
+        setup.ZX = static_cast<float>(zx);
+        setup.ZY = static_cast<float>(zy);
+        return true;
+    }
+
+    // Скалярный проход видимости по прямоугольнику [x0, x1] x [y0, y1] в координатах тайла.
+    void CoverScalar(const EdgeSetup& s, int x0, int y0, int x1, int y1, std::int32_t id, TileBuffers& tile) {
+        for (int y = y0; y <= y1; ++y) {
+            const float fy = static_cast<float>(y - y0);
+            for (int x = x0; x <= x1; ++x) {
+                const float fx = static_cast<float>(x - x0);
+                float e[3];
+                bool inside = true;
+                for (int i = 0; i < 3; ++i) {
+                    e[i] = s.E[i] + s.DX[i] * fx + s.DY[i] * fy;
+                    inside = inside && (s.Inclusive[i] ? e[i] >= 0.0f : e[i] > 0.0f);
+                }
+                if (!inside) {
+                    continue;
+                }
+                const float z = s.Z + s.ZX * fx + s.ZY * fy;
+                const int k = y * TileSize + x;
+                if (z <= tile.Depth[k]) { // GL_LEQUAL, как в VTK
+                    tile.Depth[k] = z;
+                    tile.Id[k] = id;
+                    tile.L1[k] = e[1] * s.InvArea;
+                    tile.L2[k] = e[2] * s.InvArea;
+                }
+            }
+        }
+    }
+
+#if defined(RASTER_HAVE_AVX2_KERNEL)
+    // Та же логика, что в CoverScalar, но по 8 пикселей строки за раз.
+    __attribute__((target("avx2,fma"))) void CoverAVX2(const EdgeSetup& s, int x0, int y0, int x1, int y1,
+                                                        std::int32_t id, TileBuffers& tile) {
+        const int xs = x0 & ~7; // выравнивание по 8 внутри тайла; ширина тайла кратна 8
+        const __m256 lane = _mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256i laneI = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 invArea = _mm256_set1_ps(s.InvArea);
+        const __m256i idV = _mm256_set1_epi32(id);
+        __m256 inclusive[3];
+        for (int i = 0; i < 3; ++i) {
+            inclusive[i] = _mm256_castsi256_ps(_mm256_set1_epi32(s.Inclusive[i] ? -1 : 0));
+        }
+
+        for (int y = y0; y <= y1; ++y) {
+            const float fy = static_cast<float>(y - y0);
+            for (int x = xs; x <= x1; x += 8) {
+                const __m256 fx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x - x0)), lane);
+                const __m256i px = _mm256_add_epi32(_mm256_set1_epi32(x), laneI);
+                __m256 mask = _mm256_castsi256_ps(_mm256_and_si256(
+                    _mm256_cmpgt_epi32(px, _mm256_set1_epi32(x0 - 1)), _mm256_cmpgt_epi32(_mm256_set1_epi32(x1 + 1), px)));
+
+                __m256 e[3];
+                for (int i = 0; i < 3; ++i) {
+                    e[i] = _mm256_fmadd_ps(_mm256_set1_ps(s.DX[i]), fx,
+                                           _mm256_set1_ps(s.E[i] + s.DY[i] * fy));
+                    const __m256 ge = _mm256_cmp_ps(e[i], zero, _CMP_GE_OQ);
+                    const __m256 gt = _mm256_cmp_ps(e[i], zero, _CMP_GT_OQ);
+                    mask = _mm256_and_ps(mask, _mm256_blendv_ps(gt, ge, inclusive[i]));
+                }
+                if (_mm256_testz_ps(mask, mask)) {
+                    continue;
+                }
+
+                const int k = y * TileSize + x;
+                const __m256 z = _mm256_fmadd_ps(_mm256_set1_ps(s.ZX), fx, _mm256_set1_ps(s.Z + s.ZY * fy));
+                const __m256 depth = _mm256_loadu_ps(tile.Depth + k);
+                mask = _mm256_and_ps(mask, _mm256_cmp_ps(z, depth, _CMP_LE_OQ));
+
+                _mm256_storeu_ps(tile.Depth + k, _mm256_blendv_ps(depth, z, mask));
+                const __m256i oldId = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tile.Id + k));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(tile.Id + k),
+                                    _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(oldId),
+                                                                         _mm256_castsi256_ps(idV), mask)));
+                _mm256_storeu_ps(tile.L1 + k,
+                                 _mm256_blendv_ps(_mm256_loadu_ps(tile.L1 + k), _mm256_mul_ps(e[1], invArea), mask));
+                _mm256_storeu_ps(tile.L2 + k,
+                                 _mm256_blendv_ps(_mm256_loadu_ps(tile.L2 + k), _mm256_mul_ps(e[2], invArea), mask));
+            }
+        }
+    }
+#endif
+
+    bool DetectAVX2() {
+#if defined(RASTER_HAVE_AVX2_KERNEL)
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+        return false;
+#endif
+    }
+
+    const bool UseAVX2 = DetectAVX2();
+
+    unsigned char ToByte(float value) {
+        value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+        return static_cast<unsigned char>(value * 255.0f + 0.5f);
+    }
+}
+
+bool IsSurfacePointVisible(const std::vector<float>& depth, int width, int height, float x, float y, float z) {
+    const float epsilon = 1e-4f;
+    const int px = static_cast<int>(x);
+    const int py = static_cast<int>(y);
+    float farthest = 0.0f;
+    for (int j = std::max(0, py - 1); j <= std::min(height - 1, py + 1); ++j) {
+        for (int i = std::max(0, px - 1); i <= std::min(width - 1, px + 1); ++i) {
+            farthest = std::max(farthest, depth[static_cast<std::size_t>(j) * width + i]);
+        }
+    }
+    return z <= farthest + epsilon;
+}
+
+void GBuffer::Resize(int width, int height) {
+    this->Width = width;
+    this->Height = height;
+    const std::size_t pixels = static_cast<std::size_t>(width) * height;
+    for (std::vector<float>* plane : {&this->PositionX, &this->PositionY, &this->PositionZ, &this->NormalX,
+                                      &this->NormalY, &this->NormalZ, &this->AlbedoR, &this->AlbedoG,
+                                      &this->AlbedoB}) {
+        plane->resize(pixels);
+    }
+    this->Mask.resize(pixels);
+}
+
+void RasterScene::GetModelViewProjection(float mvp[16]) const {
+    const float* a = this->ViewProjection;
+    const float* b = this->Model;
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            mvp[r * 4 + c] = a[r * 4 + 0] * b[0 * 4 + c] + a[r * 4 + 1] * b[1 * 4 + c] +
+                             a[r * 4 + 2] * b[2 * 4 + c] + a[r * 4 + 3] * b[3 * 4 + c];
+        }
+    }
+}
+
+bool SoftwareRasterizer::HasAVX2() {
+    return UseAVX2;
+}
+
+void SoftwareRasterizer::TransformVertices(const RasterScene& scene) {
+    const MeshView& mesh = scene.Mesh;
+    float mvp[16];
+    scene.GetModelViewProjection(mvp);
+    float normalMatrix[9];
+    NormalMatrix(scene.Model, normalMatrix);
+    const float* m = scene.Model;
+    const float halfW = 0.5f * static_cast<float>(this->Width);
+    const float halfH = 0.5f * static_cast<float>(this->Height);
+
+    this->Vertices.resize(mesh.PointCount);
+    ThreadPool::Instance().ParallelFor(mesh.PointCount, 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const float x = mesh.X[i];
+            const float y = mesh.Y[i];
+            const float z = mesh.Z[i];
+            const float cx = mvp[0] * x + mvp[1] * y + mvp[2] * z + mvp[3];
+            const float cy = mvp[4] * x + mvp[5] * y + mvp[6] * z + mvp[7];
+            const float cz = mvp[8] * x + mvp[9] * y + mvp[10] * z + mvp[11];
+            const float cw = mvp[12] * x + mvp[13] * y + mvp[14] * z + mvp[15];
+
+            Vertex& v = this->Vertices[i];
+            // Для вершин за камерой (w <= 0) экранные координаты не используются: такие
+            // треугольники уходят на отсечение и получают новые вершины.
+            const float invW = cw > 0.0f ? 1.0f / cw : 0.0f;
+            v.X = (cx * invW + 1.0f) * halfW;
+            v.Y = (cy * invW + 1.0f) * halfH;
+            v.Z = cz * invW * 0.5f + 0.5f;
+            v.InvW = invW;
+
+            v.Attr[0] = mesh.HasTCoords() ? mesh.U[i] : 0.0f;
+            v.Attr[1] = mesh.HasTCoords() ? mesh.V[i] : 0.0f;
+            v.Attr[2] = m[0] * x + m[1] * y + m[2] * z + m[3];
+            v.Attr[3] = m[4] * x + m[5] * y + m[6] * z + m[7];
+            v.Attr[4] = m[8] * x + m[9] * y + m[10] * z + m[11];
+            if (mesh.HasNormals()) {
+                const float nx = mesh.NX[i];
+                const float ny = mesh.NY[i];
+                const float nz = mesh.NZ[i];
+                v.Attr[5] = normalMatrix[0] * nx + normalMatrix[1] * ny + normalMatrix[2] * nz;
+                v.Attr[6] = normalMatrix[3] * nx + normalMatrix[4] * ny + normalMatrix[5] * nz;
+                v.Attr[7] = normalMatrix[6] * nx + normalMatrix[7] * ny + normalMatrix[8] * nz;
+            } else {
+                v.Attr[5] = v.Attr[6] = v.Attr[7] = 0.0f;
+            }
+        }
+    });
+}
+
+void SoftwareRasterizer::SetupTriangles(const RasterScene& scene) {
+    const MeshView& mesh = scene.Mesh;
+    const std::size_t count = mesh.TriangleCount;
+    float mvp[16];
+    scene.GetModelViewProjection(mvp);
+    const bool faceNormals = !mesh.HasNormals();
+
+    // 0 — отброшен, 1 — готов, 2 — пересекает ближнюю плоскость и требует отсечения.
+    std::vector<unsigned char> status(count);
+    this->Triangles.resize(count);
+    this->FaceNormals.assign(faceNormals ? count * 3 : 0, 0.0f);
+
+    auto clipCoord = [&](std::uint32_t i, float out[4]) {
+        const float x = mesh.X[i], y = mesh.Y[i], z = mesh.Z[i];
+        for (int r = 0; r < 4; ++r) {
+            out[r] = mvp[r * 4 + 0] * x + mvp[r * 4 + 1] * y + mvp[r * 4 + 2] * z + mvp[r * 4 + 3];
+        }
+    };
+
+    const int width = this->Width;
+    const int height = this->Height;
+    auto finish = [width, height](Triangle& t, const Vertex* v) {
+        const float area = (v[1].X - v[0].X) * (v[2].Y - v[0].Y) - (v[2].X - v[0].X) * (v[1].Y - v[0].Y);
+        if (!(std::fabs(area) > 1e-12f)) {
+            return false;
+        }
+        // Лицевая сторона в OpenGL — обход против часовой стрелки; для растеризации приводим
+        // все треугольники к положительной площади.
+        t.BackFacing = area < 0.0f;
+        if (t.BackFacing) {
+            std::swap(t.V[1], t.V[2]);
+        }
+        const float minX = std::min({v[0].X, v[1].X, v[2].X});
+        const float maxX = std::max({v[0].X, v[1].X, v[2].X});
+        const float minY = std::min({v[0].Y, v[1].Y, v[2].Y});
+        const float maxY = std::max({v[0].Y, v[1].Y, v[2].Y});
+        // Пиксель i покрывается, если его центр i + 0.5 внутри треугольника.
+        t.MinX = std::max(0, static_cast<int>(std::ceil(minX - 0.5f)));
+        t.MinY = std::max(0, static_cast<int>(std::ceil(minY - 0.5f)));
+        t.MaxX = std::min(width - 1, static_cast<int>(std::floor(maxX - 0.5f)));
+        t.MaxY = std::min(height - 1, static_cast<int>(std::floor(maxY - 0.5f)));
+        return t.MinX <= t.MaxX && t.MinY <= t.MaxY;
+    };
+
+    ThreadPool::Instance().ParallelFor(count, 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t t = begin; t < end; ++t) {
+            const std::uint32_t* index = mesh.Indices + 3 * t;
+            Triangle& tri = this->Triangles[t];
+            tri.V[0] = index[0];
+            tri.V[1] = index[1];
+            tri.V[2] = index[2];
+            tri.Source = static_cast<std::uint32_t>(t);
+
+            if (faceNormals) {
+                const float e1[3] = {this->Vertices[index[1]].Attr[2] - this->Vertices[index[0]].Attr[2],
+                                     this->Vertices[index[1]].Attr[3] - this->Vertices[index[0]].Attr[3],
+                                     this->Vertices[index[1]].Attr[4] - this->Vertices[index[0]].Attr[4]};
+                const float e2[3] = {this->Vertices[index[2]].Attr[2] - this->Vertices[index[0]].Attr[2],
+                                     this->Vertices[index[2]].Attr[3] - this->Vertices[index[0]].Attr[3],
+                                     this->Vertices[index[2]].Attr[4] - this->Vertices[index[0]].Attr[4]};
+                float* n = &this->FaceNormals[3 * t];
+                n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+                n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+                n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+                const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                if (length > 0.0f) {
+                    n[0] /= length;
+                    n[1] /= length;
+                    n[2] /= length;
+                }
+            }
+
+            float c[3][4];
+            int inFront = 0;
+            int outside[6] = {0, 0, 0, 0, 0, 0};
+            for (int k = 0; k < 3; ++k) {
+                clipCoord(index[k], c[k]);
+                inFront += (c[k][2] + c[k][3] >= 0.0f && c[k][3] > 0.0f) ? 1 : 0;
+                outside[0] += c[k][0] < -c[k][3];
+                outside[1] += c[k][0] > c[k][3];
+                outside[2] += c[k][1] < -c[k][3];
+                outside[3] += c[k][1] > c[k][3];
+                outside[4] += c[k][2] < -c[k][3];
+                outside[5] += c[k][2] > c[k][3];
+            }
+            bool culled = false;
+            for (int p = 0; p < 6; ++p) {
+                culled = culled || outside[p] == 3;
+            }
+            if (culled) {
+                status[t] = 0;
+            } else if (inFront == 3) {
+                const Vertex v[3] = {this->Vertices[tri.V[0]], this->Vertices[tri.V[1]], this->Vertices[tri.V[2]]};
+                status[t] = finish(tri, v) ? 1 : 0;
+            } else {
+                status[t] = 2;
+            }
+        }
+    });
+
+    // Отсечение по ближней плоскости z + w >= 0 (Сазерленд — Ходжман) — редкий случай, выполняется последовательно.
+    std::vector<Triangle> clipped;
+    const float halfW = 0.5f * static_cast<float>(width);
+    const float halfH = 0.5f * static_cast<float>(height);
+    for (std::size_t t = 0; t < count; ++t) {
+        if (status[t] != 2) {
+            continue;
+        }
+        ClipVertex in[3];
+        for (int k = 0; k < 3; ++k) {
+            const std::uint32_t i = mesh.Indices[3 * t + k];
+            clipCoord(i, in[k].P);
+            std::memcpy(in[k].Attr, this->Vertices[i].Attr, sizeof(in[k].Attr));
+        }
+        ClipVertex out[4];
+        int outCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            const ClipVertex& a = in[k];
+            const ClipVertex& b = in[(k + 1) % 3];
+            const float da = a.P[2] + a.P[3];
+            const float db = b.P[2] + b.P[3];
+            if (da >= 0.0f) {
+                out[outCount++] = a;
+            }
+            if ((da >= 0.0f) != (db >= 0.0f)) {
+                const float s = da / (da - db);
+                ClipVertex& v = out[outCount++];
+                for (int j = 0; j < 4; ++j) {
+                    v.P[j] = a.P[j] + (b.P[j] - a.P[j]) * s;
+                }
+                for (int j = 0; j < 8; ++j) {
+                    v.Attr[j] = a.Attr[j] + (b.Attr[j] - a.Attr[j]) * s;
+                }
+            }
+        }
+        if (outCount < 3) {
+            continue;
+        }
+        const std::uint32_t first = static_cast<std::uint32_t>(this->Vertices.size());
+        for (int k = 0; k < outCount; ++k) {
+            const float w = out[k].P[3] > 1e-20f ? out[k].P[3] : 1e-20f;
+            Vertex v;
+            v.InvW = 1.0f / w;
+            v.X = (out[k].P[0] * v.InvW + 1.0f) * halfW;
+            v.Y = (out[k].P[1] * v.InvW + 1.0f) * halfH;
+            v.Z = out[k].P[2] * v.InvW * 0.5f + 0.5f;
+            std::memcpy(v.Attr, out[k].Attr, sizeof(v.Attr));
+            this->Vertices.push_back(v);
+        }
+        for (int k = 2; k < outCount; ++k) {
+            Triangle tri;
+            tri.V[0] = first;
+            tri.V[1] = first + static_cast<std::uint32_t>(k - 1);
+            tri.V[2] = first + static_cast<std::uint32_t>(k);
+            tri.Source = static_cast<std::uint32_t>(t);
+            const Vertex v[3] = {this->Vertices[tri.V[0]], this->Vertices[tri.V[1]], this->Vertices[tri.V[2]]};
+            if (finish(tri, v)) {
+                clipped.push_back(tri);
+            }
+        }
+    }
+
+    // Уплотнение: остаются только видимые треугольники в исходном порядке, затем отсеченные.
+    std::size_t kept = 0;
+    for (std::size_t t = 0; t < count; ++t) {
+        if (status[t] == 1) {
+            this->Triangles[kept++] = this->Triangles[t];
+        }
+    }
+    this->Triangles.resize(kept);
+    this->Triangles.insert(this->Triangles.end(), clipped.begin(), clipped.end());
+}
+
+void SoftwareRasterizer::BinTriangles() {
+    const std::size_t tiles = static_cast<std::size_t>(this->TilesX) * this->TilesY;
+    const std::size_t count = this->Triangles.size();
+    // Треугольники делятся на куски; внутри тайла списки идут в порядке кусков, поэтому порядок
+    // треугольников (важный при равной глубине) не зависит от числа потоков.
+    const std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(64, count / 2048));
+    const std::size_t chunkSize = (count + chunks - 1) / chunks;
+    std::vector<std::uint32_t> counts(chunks * tiles, 0);
+
+    auto forEachTile = [this](const Triangle& t, auto&& fn) {
+        const int tx0 = t.MinX / TileSize;
+        const int tx1 = t.MaxX / TileSize;
+        const int ty0 = t.MinY / TileSize;
+        const int ty1 = t.MaxY / TileSize;
+        for (int ty = ty0; ty <= ty1; ++ty) {
+            for (int tx = tx0; tx <= tx1; ++tx) {
+                fn(static_cast<std::size_t>(ty) * this->TilesX + tx);
+            }
+        }
+    };
+
+    ThreadPool& pool = ThreadPool::Instance();
+    pool.ParallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            std::uint32_t* chunkCounts = &counts[c * tiles];
+            const std::size_t last = std::min(count, (c + 1) * chunkSize);
+            for (std::size_t i = c * chunkSize; i < last; ++i) {
+                forEachTile(this->Triangles[i], [&](std::size_t tile) { ++chunkCounts[tile]; });
+            }
+        }
+    });
+
+    // Префиксные суммы: начало списка тайла и начало доли каждого куска внутри него.
+    this->TileOffsets.assign(tiles + 1, 0);
+    std::uint32_t total = 0;
+    for (std::size_t tile = 0; tile < tiles; ++tile) {
+        this->TileOffsets[tile] = total;
+        for (std::size_t c = 0; c < chunks; ++c) {
+            const std::uint32_t n = counts[c * tiles + tile];
+            counts[c * tiles + tile] = total;
+            total += n;
+        }
+    }
+    this->TileOffsets[tiles] = total;
+    this->TileTriangles.resize(total);
+
+    pool.ParallelFor(chunks, 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t c = begin; c < end; ++c) {
+            std::uint32_t* cursor = &counts[c * tiles];
+            const std::size_t last = std::min(count, (c + 1) * chunkSize);
+            for (std::size_t i = c * chunkSize; i < last; ++i) {
+                forEachTile(this->Triangles[i],
+                            [&](std::size_t tile) { this->TileTriangles[cursor[tile]++] = static_cast<std::uint32_t>(i); });
+            }
+        }
+    });
+}
+
+void SoftwareRasterizer::RasterizeTile(const RasterScene& scene, int tile) {
+    const int tileX = (tile % this->TilesX) * TileSize;
+    const int tileY = (tile / this->TilesX) * TileSize;
+    const int tileW = std::min(TileSize, this->Width - tileX);
+    const int tileH = std::min(TileSize, this->Height - tileY);
+
+    TileBuffers buffers;
+    std::fill(buffers.Depth, buffers.Depth + TilePixels, 1.0f);
+    std::fill(buffers.Id, buffers.Id + TilePixels, -1);
+
+    // Проход видимости: для каждого пикселя остается ближайший треугольник и его барицентрические координаты.
+    for (std::uint32_t k = this->TileOffsets[tile]; k < this->TileOffsets[tile + 1]; ++k) {
+        const std::uint32_t id = this->TileTriangles[k];
+        const Triangle& t = this->Triangles[id];
+        const int x0 = std::max(t.MinX, tileX) - tileX;
+        const int y0 = std::max(t.MinY, tileY) - tileY;
+        const int x1 = std::min(t.MaxX, tileX + tileW - 1) - tileX;
+        const int y1 = std::min(t.MaxY, tileY + tileH - 1) - tileY;
+        EdgeSetup setup;
+        if (!SetupEdges(this->Vertices[t.V[0]], this->Vertices[t.V[1]], this->Vertices[t.V[2]], tileX + x0,
+                        tileY + y0, setup)) {
+            continue;
+        }
+#if defined(RASTER_HAVE_AVX2_KERNEL)
+        if (UseAVX2) {
+            CoverAVX2(setup, x0, y0, x1, y1, static_cast<std::int32_t>(id), buffers);
+            continue;
+        }
+#endif
+        CoverScalar(setup, x0, y0, x1, y1, static_cast<std::int32_t>(id), buffers);
+    }
+
+    // Затенение: каждый видимый пиксель освещается и текстурируется ровно один раз.
+    const TextureMips* texture = scene.Texture != nullptr && !scene.Texture->IsEmpty() ? scene.Texture : nullptr;
+    const float texW = texture != nullptr ? static_cast<float>(texture->GetWidth()) : 0.0f;
+    const float texH = texture != nullptr ? static_cast<float>(texture->GetHeight()) : 0.0f;
+    unsigned char background[4];
+    for (int c = 0; c < 4; ++c) {
+        background[c] = ToByte(scene.Background[c]);
+    }
+
+    float* uv = scene.OutputUV ? this->UV.data() : nullptr;
+    unsigned char* coverage = scene.OutputUV ? this->Coverage.data() : nullptr;
+    GBuffer* surfaces = scene.OutputGBuffer ? &this->Surfaces : nullptr;
+
+    for (int y = 0; y < tileH; ++y) {
+        const std::size_t row = static_cast<std::size_t>(tileY + y) * this->Width + tileX;
+        for (int x = 0; x < tileW; ++x) {
+            const int k = y * TileSize + x;
+            unsigned char* out = &this->Color[(row + x) * 4];
+            this->Depth[row + x] = buffers.Depth[k];
+            if (buffers.Id[k] < 0) {
+                if (scene.Shade) {
+                    std::memcpy(out, background, 4);
+                }
+                if (uv != nullptr) {
+                    uv[(row + x) * 2] = 0.0f;
+                    uv[(row + x) * 2 + 1] = 0.0f;
+                    coverage[row + x] = 0;
+                }
+                if (surfaces != nullptr) {
+                    surfaces->Mask[row + x] = 0;
+                }
+                continue;
+            }
+
+            const Triangle& t = this->Triangles[static_cast<std::size_t>(buffers.Id[k])];
+            const Vertex* v[3] = {&this->Vertices[t.V[0]], &this->Vertices[t.V[1]], &this->Vertices[t.V[2]]};
+            const float l[3] = {1.0f - buffers.L1[k] - buffers.L2[k], buffers.L1[k], buffers.L2[k]};
+
+            // Перспективная коррекция: атрибут/w и 1/w линейны на экране.
+            const float q = l[0] * v[0]->InvW + l[1] * v[1]->InvW + l[2] * v[2]->InvW;
+            const float invQ = 1.0f / q;
+            float b[3];
+            for (int i = 0; i < 3; ++i) {
+                b[i] = l[i] * v[i]->InvW * invQ;
+            }
+            float attr[8];
+            for (int a = 0; a < 8; ++a) {
+                attr[a] = b[0] * v[0]->Attr[a] + b[1] * v[1]->Attr[a] + b[2] * v[2]->Attr[a];
+            }
+            if (uv != nullptr) {
+                uv[(row + x) * 2] = attr[0];
+                uv[(row + x) * 2 + 1] = attr[1];
+                coverage[row + x] = 1;
+            }
+            if (!scene.Shade && surfaces == nullptr) {
+                continue;
+            }
+
+            float normal[3];
+            if (this->FaceNormals.empty()) {
+                const float length = std::sqrt(attr[5] * attr[5] + attr[6] * attr[6] + attr[7] * attr[7]);
+                const float s = length > 0.0f ? 1.0f / length : 0.0f;
+                normal[0] = attr[5] * s;
+                normal[1] = attr[6] * s;
+                normal[2] = attr[7] * s;
+                if (t.BackFacing && scene.TwoSidedLighting) {
+                    normal[0] = -normal[0];
+                    normal[1] = -normal[1];
+                    normal[2] = -normal[2];
+                }
+            } else {
+                // Без нормалей VTK берет нормаль грани, развернутую к камере.
+                const float* n = &this->FaceNormals[3 * t.Source];
+                const float toEye = (scene.Eye[0] - attr[2]) * n[0] + (scene.Eye[1] - attr[3]) * n[1] +
+                                    (scene.Eye[2] - attr[4]) * n[2];
+                const float s = toEye < 0.0f ? -1.0f : 1.0f;
+                normal[0] = n[0] * s;
+                normal[1] = n[1] * s;
+                normal[2] = n[2] * s;
+            }
+
+            float texel[3] = {1.0f, 1.0f, 1.0f};
+            if (texture != nullptr) {
+                // Производные UV по экрану для выбора mip-уровня, как это делает GPU.
+                const Vertex& a = *v[0];
+                const Vertex& bb = *v[1];
+                const Vertex& c = *v[2];
+                const float area = (bb.X - a.X) * (c.Y - a.Y) - (c.X - a.X) * (bb.Y - a.Y);
+                const float invArea = 1.0f / area;
+                const float ldx[3] = {-(c.Y - bb.Y) * invArea, -(a.Y - c.Y) * invArea, -(bb.Y - a.Y) * invArea};
+                const float ldy[3] = {(c.X - bb.X) * invArea, (a.X - c.X) * invArea, (bb.X - a.X) * invArea};
+                float dq[2] = {0.0f, 0.0f};
+                float du[2] = {0.0f, 0.0f};
+                float dv[2] = {0.0f, 0.0f};
+                for (int i = 0; i < 3; ++i) {
+                    const float w = v[i]->InvW;
+                    dq[0] += ldx[i] * w;
+                    dq[1] += ldy[i] * w;
+                    du[0] += ldx[i] * w * v[i]->Attr[0];
+                    du[1] += ldy[i] * w * v[i]->Attr[0];
+                    dv[0] += ldx[i] * w * v[i]->Attr[1];
+                    dv[1] += ldy[i] * w * v[i]->Attr[1];
+                }
+                const float dudx = (du[0] - attr[0] * dq[0]) * invQ * texW;
+                const float dvdx = (dv[0] - attr[1] * dq[0]) * invQ * texH;
+                const float dudy = (du[1] - attr[0] * dq[1]) * invQ * texW;
+                const float dvdy = (dv[1] - attr[1] * dq[1]) * invQ * texH;
+                const float rho2 = std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+                const float lod = rho2 > 0.0f ? 0.5f * std::log2(rho2) : 0.0f;
+                texture->Sample(attr[0], attr[1], lod, texel);
+            }
+
+            if (surfaces != nullptr) {
+                const std::size_t p = row + x;
+                surfaces->PositionX[p] = attr[2];
+                surfaces->PositionY[p] = attr[3];
+                surfaces->PositionZ[p] = attr[4];
+                surfaces->NormalX[p] = normal[0];
+                surfaces->NormalY[p] = normal[1];
+                surfaces->NormalZ[p] = normal[2];
+                surfaces->AlbedoR[p] = texel[0];
+                surfaces->AlbedoG[p] = texel[1];
+                surfaces->AlbedoB[p] = texel[2];
+                surfaces->Mask[p] = 1;
+            }
+            if (!scene.Shade) {
+                continue;
+            }
+
+            float lit[3];
+            ShadeSpotLight(scene.Light, scene.Material, &attr[2], normal, scene.Eye, lit);
+            for (int c = 0; c < 3; ++c) {
+                const float value = std::min(1.0f, std::max(0.0f, lit[c])) * texel[c];
+                out[c] = ToByte(value);
+            }
+            out[3] = 255;
+        }
+    }
+}
+
+void SoftwareRasterizer::Render(const RasterScene& scene, int width, int height) {
+    this->Width = width;
+    this->Height = height;
+    this->TilesX = (width + TileSize - 1) / TileSize;
+    this->TilesY = (height + TileSize - 1) / TileSize;
+    this->Color.resize(static_cast<std::size_t>(width) * height * 4);
+    this->Depth.resize(static_cast<std::size_t>(width) * height);
+    if (scene.OutputUV) {
+        this->UV.resize(static_cast<std::size_t>(width) * height * 2);
+        this->Coverage.resize(static_cast<std::size_t>(width) * height);
+    }
+    if (scene.OutputGBuffer) {
+        this->Surfaces.Resize(width, height);
+    }
+
+    this->TransformVertices(scene);
+    this->SetupTriangles(scene);
+    this->BinTriangles();
+
+    const int tiles = this->TilesX * this->TilesY;
+    ThreadPool::Instance().ParallelFor(static_cast<std::size_t>(tiles), 1, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t tile = begin; tile < end; ++tile) {
+            this->RasterizeTile(scene, static_cast<int>(tile));
+        }
+    });
+}
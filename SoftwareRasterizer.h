@@ -0,0 +1,116 @@
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include "MeshBuffers.h"
+#include "SoftwareTexture.h"
+#include "SpotLightModel.h"
+
+#include <cstdint>
+#include <vector>
+
+// Матрицы хранятся по строкам, как в vtkMatrix4x4: p' = M * [x y z 1]^T.
+struct RasterScene {
+    MeshView Mesh;
+    float Model[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}; // UserTransform актора
+    float ViewProjection[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1}; // vtkCamera::GetCompositeProjectionTransformMatrix
+    float Eye[3] = {0.0f, 0.0f, 0.0f}; // позиция камеры в мировых координатах
+
+    const TextureMips* Texture = nullptr;
+    SpotLight Light;
+    SurfaceMaterial Material;
+    bool TwoSidedLighting = true;           // как vtkRenderer::TwoSidedLighting по умолчанию
+    float Background[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+
+    bool Shade = true;     // false — только проход видимости: цвет не пишется, глубина и UV пишутся
+    bool OutputUV = false; // сохранять перспективно-корректные (u, v) каждого видимого пикселя
+    bool OutputGBuffer = false; // сохранять G-буфер видимых пикселей для переосвещения (см. Relighter)
+
+    // ViewProjection * Model: из координат сетки сразу в пространство отсечения.
+    void GetModelViewProjection(float mvp[16]) const;
+};
+
+// G-буфер кадра: для каждого пикселя (строки снизу вверх) то, от чего зависит его цвет при другом освещении, —
+// мировая позиция, единичная нормаль, уже развернутая к наблюдателю, и отфильтрованный цвет текстуры.
+// Плоскости хранятся раздельно, чтобы переосвещение читало их векторами по 8 пикселей.
+struct GBuffer {
+    int Width = 0;
+    int Height = 0;
+    std::vector<float> PositionX, PositionY, PositionZ;
+    std::vector<float> NormalX, NormalY, NormalZ;
+    std::vector<float> AlbedoR, AlbedoG, AlbedoB;
+    std::vector<unsigned char> Mask; // 1 — пиксель покрыт сеткой
+
+    void Resize(int width, int height);
+};
+
+// Видна ли точка поверхности в кадре: x, y — экранные координаты в пикселях (y снизу вверх), z — оконная
+// глубина. Точка считается видимой, если в окрестности 3x3 ее пикселя есть поверхность не ближе нее:
+// точки на краю сетки попадают и в пиксели фона или соседнего участка той же поверхности.
+bool IsSurfacePointVisible(const std::vector<float>& depth, int width, int height, float x, float y, float z);
+
+// Программный растеризатор одной текстурированной освещенной сетки.
+//
+// Кадр строится в три этапа:
+//  1. преобразование вершин и подготовка треугольников (отсечение по ближней плоскости);
+//  2. раскладка треугольников по тайлам 32x32;
+//  3. параллельная обработка тайлов: сначала проход видимости (покрытие, глубина, барицентрические
+//     координаты — на AVX2 по 8 пикселей, если процессор это поддерживает), затем однократное
+//     затенение каждого видимого пикселя с перспективно-корректными UV и трилинейной выборкой текстуры.
+//     Те же UV могут сохраняться в карту соответствия пиксель -> текстура, а позиции, нормали и цвет
+//     текстуры — в G-буфер; затенение можно отключить, если нужны только они.
+//
+// Результат повторяет то, что рисует vtkOpenGLPolyDataMapper для этой сцены: строки снизу вверх,
+// глубина в оконных координатах [0, 1] (1 — фон), альфа 0 у фона и 255 у сетки.
+class SoftwareRasterizer {
+public:
+    void Render(const RasterScene& scene, int width, int height);
+
+    int GetWidth() const { return this->Width; }
+    int GetHeight() const { return this->Height; }
+    const std::vector<unsigned char>& GetColor() const { return this->Color; } // RGBA8
+    const std::vector<float>& GetDepth() const { return this->Depth; }
+    // При RasterScene::OutputUV: (u, v) по пикселям (строки снизу вверх) и маска покрытия 0/1.
+    const std::vector<float>& GetUV() const { return this->UV; }
+    const std::vector<unsigned char>& GetCoverage() const { return this->Coverage; }
+    // При RasterScene::OutputGBuffer: G-буфер кадра.
+    const GBuffer& GetGBuffer() const { return this->Surfaces; }
+
+    // Используется ли векторная (AVX2) версия прохода видимости.
+    static bool HasAVX2();
+
+    struct Vertex {
+        float X, Y, Z, InvW; // экранные координаты в пикселях (y вверх), оконная глубина, 1 / w
+        float Attr[8];       // u, v, мировая позиция, мировая нормаль
+    };
+    struct Triangle {
+        std::uint32_t V[3];
+        std::uint32_t Source;  // номер исходного треугольника сетки
+        std::int32_t MinX, MinY, MaxX, MaxY;
+        bool BackFacing;
+    };
+
+private:
+    void TransformVertices(const RasterScene& scene);
+    void SetupTriangles(const RasterScene& scene);
+    void BinTriangles();
+    void RasterizeTile(const RasterScene& scene, int tile);
+
+    int Width = 0;
+    int Height = 0;
+    int TilesX = 0;
+    int TilesY = 0;
+
+    std::vector<Vertex> Vertices;
+    std::vector<Triangle> Triangles;
+    std::vector<float> FaceNormals;          // 3 * TriangleCount; для сеток без нормалей
+    std::vector<std::uint32_t> TileOffsets;  // TilesX * TilesY + 1
+    std::vector<std::uint32_t> TileTriangles;
+
+    std::vector<unsigned char> Color;
+    std::vector<float> Depth;
+    std::vector<float> UV;
+    std::vector<unsigned char> Coverage;
+    GBuffer Surfaces;
+};
+
+#endif // SOFTWARE_RASTERIZER_H
@@ -0,0 +1,134 @@
+#include "SoftwareTexture.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    std::uint32_t PackRGBA(unsigned r, unsigned g, unsigned b, unsigned a) {
+        return r | (g << 8) | (b << 16) | (a << 24);
+    }
+
+    unsigned Channel(std::uint32_t texel, int channel) {
+        return (texel >> (8 * channel)) & 0xFFu;
+    }
+
+    // Номер текселя с повтором: -1 -> size - 1, size -> 0.
+    int Wrap(int i, int size) {
+        i %= size;
+        return i < 0 ? i + size : i;
+    }
+}
+
+void TextureMips::Build(const unsigned char* pixels, int width, int height, int components) {
+    this->Levels.clear();
+    if (pixels == nullptr || width <= 0 || height <= 0 || components < 1 || components > 4) {
+        return;
+    }
+
+    Level base;
+    base.Width = width;
+    base.Height = height;
+    base.Texels.resize(static_cast<std::size_t>(width) * height);
+    for (std::size_t i = 0; i < base.Texels.size(); ++i) {
+        const unsigned char* p = pixels + i * components;
+        switch (components) {
+            case 1:
+            case 2:
+                base.Texels[i] = PackRGBA(p[0], p[0], p[0], components == 2 ? p[1] : 255u);
+                break;
+            case 3:
+                base.Texels[i] = PackRGBA(p[0], p[1], p[2], 255u);
+                break;
+            default:
+                base.Texels[i] = PackRGBA(p[0], p[1], p[2], p[3]);
+                break;
+        }
+    }
+    this->Levels.push_back(std::move(base));
+
+    // Каждый следующий уровень — усреднение блоков 2x2 предыдущего (для нечетных размеров край повторяется).
+    while (this->Levels.back().Width > 1 || this->Levels.back().Height > 1) {
+        const Level& src = this->Levels.back();
+        Level dst;
+        dst.Width = std::max(1, src.Width / 2);
+        dst.Height = std::max(1, src.Height / 2);
+        dst.Texels.resize(static_cast<std::size_t>(dst.Width) * dst.Height);
+        for (int y = 0; y < dst.Height; ++y) {
+            const int y0 = std::min(2 * y, src.Height - 1);
+            const int y1 = std::min(2 * y + 1, src.Height - 1);
+            for (int x = 0; x < dst.Width; ++x) {
+                const int x0 = std::min(2 * x, src.Width - 1);
+                const int x1 = std::min(2 * x + 1, src.Width - 1);
+                const std::uint32_t t[4] = {
+                    src.Texels[static_cast<std::size_t>(y0) * src.Width + x0],
+                    src.Texels[static_cast<std::size_t>(y0) * src.Width + x1],
+                    src.Texels[static_cast<std::size_t>(y1) * src.Width + x0],
+                    src.Texels[static_cast<std::size_t>(y1) * src.Width + x1],
+                };
+                unsigned c[4];
+                for (int k = 0; k < 4; ++k) {
+                    c[k] = (Channel(t[0], k) + Channel(t[1], k) + Channel(t[2], k) + Channel(t[3], k) + 2) / 4;
+                }
+                dst.Texels[static_cast<std::size_t>(y) * dst.Width + x] = PackRGBA(c[0], c[1], c[2], c[3]);
+            }
+        }
+        this->Levels.push_back(std::move(dst));
+    }
+}
+
+std::size_t TextureMips::GetMemorySize() const {
+    std::size_t bytes = 0;
+    for (const Level& level : this->Levels) {
+        bytes += level.Texels.size() * sizeof(std::uint32_t);
+    }
+    return bytes;
+}
+
+void TextureMips::SampleLevel(int level, float u, float v, float rgb[3]) const {
+    const Level& l = this->Levels[static_cast<std::size_t>(level)];
+    // Центры текселей лежат в (i + 0.5) / size.
+    const float x = u * l.Width - 0.5f;
+    const float y = v * l.Height - 0.5f;
+    const float fx = std::floor(x);
+    const float fy = std::floor(y);
+    const float ax = x - fx;
+    const float ay = y - fy;
+    const int x0 = Wrap(static_cast<int>(fx), l.Width);
+    const int y0 = Wrap(static_cast<int>(fy), l.Height);
+    const int x1 = Wrap(x0 + 1, l.Width);
+    const int y1 = Wrap(y0 + 1, l.Height);
+
+    const std::uint32_t t00 = l.Texels[static_cast<std::size_t>(y0) * l.Width + x0];
+    const std::uint32_t t10 = l.Texels[static_cast<std::size_t>(y0) * l.Width + x1];
+    const std::uint32_t t01 = l.Texels[static_cast<std::size_t>(y1) * l.Width + x0];
+    const std::uint32_t t11 = l.Texels[static_cast<std::size_t>(y1) * l.Width + x1];
+    const float w00 = (1.0f - ax) * (1.0f - ay);
+    const float w10 = ax * (1.0f - ay);
+    const float w01 = (1.0f - ax) * ay;
+    const float w11 = ax * ay;
+    for (int k = 0; k < 3; ++k) {
+        rgb[k] = (w00 * Channel(t00, k) + w10 * Channel(t10, k) + w01 * Channel(t01, k) + w11 * Channel(t11, k)) *
+                 (1.0f / 255.0f);
+    }
+}
+
+void TextureMips::Sample(float u, float v, float lod, float rgb[3]) const {
+    const int last = static_cast<int>(this->Levels.size()) - 1;
+    if (!(lod > 0.0f)) { // также отсекает NaN
+        this->SampleLevel(0, u, v, rgb);
+        return;
+    }
+    if (lod >= static_cast<float>(last)) {
+        this->SampleLevel(last, u, v, rgb);
+        return;
+    }
+    const int level = static_cast<int>(lod);
+    const float t = lod - static_cast<float>(level);
+    float a[3];
+    float b[3];
+    this->SampleLevel(level, u, v, a);
+    this->SampleLevel(level + 1, u, v, b);
+    for (int k = 0; k < 3; ++k) {
+        rgb[k] = a[k] + (b[k] - a[k]) * t;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef SOFTWARE_TEXTURE_H
+#define SOFTWARE_TEXTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Текстура для программного растеризатора: пирамида mip-уровней в формате RGBA8.
+// Строки хранятся снизу вверх, как в vtkImageData, поэтому v = 0 соответствует первой строке,
+// а адресация (u, v) совпадает с тем, как OpenGL читает текстуру, загруженную vtkTexture.
+class TextureMips {
+public:
+    // pixels — width * height пикселей по components байт (1 — серый, 3 — RGB, 4 — RGBA).
+    void Build(const unsigned char* pixels, int width, int height, int components);
+
+    bool IsEmpty() const { return this->Levels.empty(); }
+    int GetWidth() const { return this->Levels.empty() ? 0 : this->Levels[0].Width; }
+    int GetHeight() const { return this->Levels.empty() ? 0 : this->Levels[0].Height; }
+    int GetLevelCount() const { return static_cast<int>(this->Levels.size()); }
+    std::size_t GetMemorySize() const;
+
+    // Трилинейная выборка: билинейная внутри двух соседних уровней и линейная между ними.
+    // lod = log2(число текселей нулевого уровня на пиксель экрана). Адресация повторяющаяся
+    // (GL_REPEAT), как у vtkTexture по умолчанию. Результат — RGB в диапазоне [0, 1].
+    void Sample(float u, float v, float lod, float rgb[3]) const;
+
+    // Билинейная выборка одного уровня.
+    void SampleLevel(int level, float u, float v, float rgb[3]) const;
+
+private:
+    struct Level {
+        int Width = 0;
+        int Height = 0;
+        std::vector<std::uint32_t> Texels; // RGBA8, младший байт — R
+    };
+    std::vector<Level> Levels;
+};
+
+#endif // SOFTWARE_TEXTURE_H
@@ -0,0 +1,75 @@
+#ifndef SPOT_LIGHT_MODEL_H
+#define SPOT_LIGHT_MODEL_H
+
+#include <cmath>
+
+// Позиционный прожектор в мировых координатах — те же параметры, что у vtkLight в main.cpp.
+struct SpotLight {
+    float Position[3] = {0.1f, -1.2f, 2.1f};
+    float Direction[3] = {0.0f, 0.0f, -1.0f}; // единичный вектор от источника к фокальной точке
+    float CosConeAngle = 0.866f;              // cos(ConeAngle); при ConeAngle > 90 конуса нет
+    bool HasCone = true;
+    float Exponent = 1.0f;                    // vtkLight::GetExponent
+    float Attenuation[3] = {1.0f, 0.0f, 0.0f}; // vtkLight::GetAttenuationValues
+    float Color[3] = {1.0f, 1.0f, 1.0f};      // DiffuseColor * Intensity
+};
+
+// Свойства поверхности — vtkProperty, уже умноженные на коэффициенты (Ambient * AmbientColor и т. д.).
+struct SurfaceMaterial {
+    float Ambient[3] = {0.0f, 0.0f, 0.0f};
+    float Diffuse[3] = {1.0f, 1.0f, 1.0f};
+    float Specular[3] = {0.0f, 0.0f, 0.0f};
+    float SpecularPower = 1.0f;
+};
+
+// Освещенность точки так же, как ее считает фрагментный шейдер vtkOpenGLPolyDataMapper
+// для позиционного света (LightComplexity 3):
+//   attenuation = 1 / (a0 + a1 d + a2 d^2) * pow(coneDot, exponent), 0 вне конуса;
+//   color = ambient + diffuse * max(0, attenuation * dot(n, -l)) + specular * ...
+// Результат не ограничен сверху — шейдер VTK обрезает его до [0, 1] перед умножением на текстуру.
+// point — точка поверхности, normal — единичная нормаль, уже развернутая к наблюдателю
+// (двустороннее освещение VTK), eye — позиция камеры.
+inline void ShadeSpotLight(const SpotLight& light, const SurfaceMaterial& material, const float point[3],
+                           const float normal[3], const float eye[3], float rgb[3]) {
+    float l[3] = {point[0] - light.Position[0], point[1] - light.Position[1], point[2] - light.Position[2]};
+    const float distance = std::sqrt(l[0] * l[0] + l[1] * l[1] + l[2] * l[2]);
+    const float invDistance = distance > 0.0f ? 1.0f / distance : 0.0f;
+    l[0] *= invDistance;
+    l[1] *= invDistance;
+    l[2] *= invDistance;
+
+    float attenuation =
+        1.0f / (light.Attenuation[0] + light.Attenuation[1] * distance + light.Attenuation[2] * distance * distance);
+    if (light.HasCone) {
+        const float coneDot = l[0] * light.Direction[0] + l[1] * light.Direction[1] + l[2] * light.Direction[2];
+        if (coneDot < light.CosConeAngle) {
+            attenuation = 0.0f;
+        } else if (light.Exponent != 1.0f) { // показатель 1 (по умолчанию) не требует pow
+            attenuation *= std::pow(coneDot, light.Exponent);
+        } else {
+            attenuation *= coneDot;
+        }
+    }
+
+    const float nDotL = -(normal[0] * l[0] + normal[1] * l[1] + normal[2] * l[2]);
+    const float df = std::fmax(0.0f, attenuation * nDotL);
+
+    float sf = 0.0f;
+    if (df > 0.0f && (material.Specular[0] > 0.0f || material.Specular[1] > 0.0f || material.Specular[2] > 0.0f)) {
+        // reflect(l, n) = l - 2 dot(n, l) n
+        const float r[3] = {l[0] + 2.0f * nDotL * normal[0], l[1] + 2.0f * nDotL * normal[1],
+                            l[2] + 2.0f * nDotL * normal[2]};
+        float v[3] = {eye[0] - point[0], eye[1] - point[1], eye[2] - point[2]};
+        const float vLength = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+        const float invV = vLength > 0.0f ? 1.0f / vLength : 0.0f;
+        const float rDotV = (r[0] * v[0] + r[1] * v[1] + r[2] * v[2]) * invV;
+        sf = attenuation * std::pow(std::fmax(0.0f, rDotV), material.SpecularPower);
+    }
+
+    for (int k = 0; k < 3; ++k) {
+        rgb[k] = material.Ambient[k] + material.Diffuse[k] * df * light.Color[k] +
+                 material.Specular[k] * sf * light.Color[k];
+    }
+}
+
+#endif // SPOT_LIGHT_MODEL_H
@@ -0,0 +1,406 @@
+#include "StageBenchmark.h"
+
+#include "ImageEncoder.h"
+#include "MeshConversion.h"
+#include "PageDeformer.h"
+#include "ParallelOBJReader.h"
+#include "ThreadPool.h"
+
+#include <vtkImageData.h>
+#include <vtkImageReader2.h>
+#include <vtkImageReader2Factory.h>
+#include <vtkNew.h>
+#include <vtkSmartPointer.h>
+#include <vtkXMLPolyDataWriter.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include <sys/stat.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double SecondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Замеры одной стадии на одном входе.
+    struct StageResult {
+        std::string Stage;
+        std::string Case;
+        double Work = 0.0;    // объем работы одного замера, в единицах Unit, умноженных на секунду
+        const char* Unit = "";
+        std::vector<double> Seconds;
+    };
+
+    struct StageSummary {
+        double Mean = 0.0; // все значения в миллисекундах
+        double Min = 0.0;
+        double P50 = 0.0;
+        double P90 = 0.0;
+        double P99 = 0.0;
+        double Max = 0.0;
+        double Throughput = 0.0; // Work за среднее время
+    };
+
+    // Процентиль по ближайшему рангу: всегда одно из измеренных значений.
+    double Percentile(const std::vector<double>& sorted, double fraction) {
+        const std::size_t rank = static_cast<std::size_t>(std::ceil(fraction * sorted.size()));
+        return sorted[std::max<std::size_t>(rank, 1) - 1];
+    }
+
+    StageSummary Summarize(const StageResult& result) {
+        std::vector<double> sorted = result.Seconds;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double seconds : sorted) {
+            sum += seconds;
+        }
+        StageSummary summary;
+        const double mean = sum / sorted.size();
+        summary.Mean = 1000.0 * mean;
+        summary.Min = 1000.0 * sorted.front();
+        summary.P50 = 1000.0 * Percentile(sorted, 0.50);
+        summary.P90 = 1000.0 * Percentile(sorted, 0.90);
+        summary.P99 = 1000.0 * Percentile(sorted, 0.99);
+        summary.Max = 1000.0 * sorted.back();
+        summary.Throughput = mean > 0.0 ? result.Work / mean : 0.0;
+        return summary;
+    }
+
+    // Вызывает body repeats раз и запоминает время каждого вызова. false — body не выполнилась.
+    template <typename Body>
+    bool Measure(StageResult& result, int repeats, Body body) {
+        for (int i = 0; i < repeats; ++i) {
+            const Clock::time_point start = Clock::now();
+            if (!body()) {
+                return false;
+            }
+            result.Seconds.push_back(SecondsSince(start));
+        }
+        return true;
+    }
+
+    std::string FormatCount(long count) {
+        char text[32];
+        if (count >= 1000000 && count % 1000000 == 0) {
+            std::snprintf(text, sizeof(text), "%ldM", count / 1000000);
+        } else if (count >= 1000 && count % 1000 == 0) {
+            std::snprintf(text, sizeof(text), "%ldk", count / 1000);
+        } else {
+            std::snprintf(text, sizeof(text), "%ld", count);
+        }
+        return text;
+    }
+
+    // Решетка страницы с пропорциями листа, близкая к triangles треугольникам.
+    void PageResolution(long triangles, int& columns, int& rows) {
+        const double cells = std::max(1.0, triangles / 2.0);
+        columns = std::max(1, static_cast<int>(std::lround(
+                                  std::sqrt(cells * PageDeformer::PageWidth / PageDeformer::PageHeight))));
+        rows = std::max(1, static_cast<int>(std::lround(cells / columns)));
+    }
+
+    double FileMegabytes(const std::string& path) {
+        struct stat info;
+        return ::stat(path.c_str(), &info) == 0 ? info.st_size / (1024.0 * 1024.0) : 0.0;
+    }
+
+    // Сетка страницы в OBJ с координатами, UV и нормалями — вход стадии obj_load.
+    bool WriteObj(const MeshBuffers& mesh, const std::string& path) {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (file == nullptr) {
+            return false;
+        }
+        for (std::size_t i = 0; i < mesh.GetPointCount(); ++i) {
+            std::fprintf(file, "v %.6g %.6g %.6g\n", mesh.X[i], mesh.Y[i], mesh.Z[i]);
+        }
+        for (std::size_t i = 0; i < mesh.U.size(); ++i) {
+            std::fprintf(file, "vt %.6g %.6g\n", mesh.U[i], mesh.V[i]);
+        }
+        for (std::size_t i = 0; i < mesh.NX.size(); ++i) {
+            std::fprintf(file, "vn %.6g %.6g %.6g\n", mesh.NX[i], mesh.NY[i], mesh.NZ[i]);
+        }
+        for (std::size_t i = 0; i + 2 < mesh.Indices.size(); i += 3) {
+            const unsigned a = mesh.Indices[i] + 1, b = mesh.Indices[i + 1] + 1, c = mesh.Indices[i + 2] + 1;
+            std::fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+        }
+        return std::fclose(file) == 0;
+    }
+
+    void PrintResults(std::ostream& out, const std::vector<StageResult>& results) {
+        out << std::left << std::setw(15) << "stage" << std::setw(18) << "case" << std::right << std::setw(8)
+            << "samples" << std::setw(11) << "mean, ms" << std::setw(11) << "p50, ms" << std::setw(11) << "p90, ms"
+            << std::setw(11) << "p99, ms" << std::setw(13) << "throughput" << "\n";
+        for (const StageResult& result : results) {
+            const StageSummary summary = Summarize(result);
+            out << std::left << std::setw(15) << result.Stage << std::setw(18) << result.Case << std::right
+                << std::fixed << std::setprecision(3) << std::setw(8) << result.Seconds.size() << std::setw(11)
+                << summary.Mean << std::setw(11) << summary.P50 << std::setw(11) << summary.P90 << std::setw(11)
+                << summary.P99 << std::setw(13) << std::setprecision(1) << summary.Throughput << " "
+                << result.Unit << "\n";
+        }
+        out.unsetf(std::ios::fixed);
+        out << std::setprecision(6);
+    }
+
+    // Одна стадия на строку, чтобы базу можно было читать построчно (см. ReadBaseline) и сравнивать diff.
+    bool WriteResults(const std::string& path, const StageBenchmarkOptions& options,
+                      const std::vector<StageResult>& results) {
+        std::ofstream out(path);
+        out << "{\"benchmark\":\"stages\",\"version\":1,\"backend\":\""
+            << (options.Backend == RenderBackend::Cpu ? "cpu" : "vtk") << "\",\"threads\":"
+            << ThreadPool::Instance().GetThreadCount() << ",\"repeats\":" << options.Repeats << ",\"results\":[\n";
+        char line[512];
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            const StageResult& result = results[i];
+            const StageSummary summary = Summarize(result);
+            std::snprintf(line, sizeof(line),
+                          "{\"stage\":\"%s\",\"case\":\"%s\",\"samples\":%zu,\"mean_ms\":%.4f,\"min_ms\":%.4f,"
+                          "\"p50_ms\":%.4f,\"p90_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f,\"throughput\":%.4f,"
+                          "\"unit\":\"%s\"}",
+                          result.Stage.c_str(), result.Case.c_str(), result.Seconds.size(), summary.Mean,
+                          summary.Min, summary.P50, summary.P90, summary.P99, summary.Max, summary.Throughput,
+                          result.Unit);
+            out << line << (i + 1 < results.size() ? ",\n" : "\n");
+        }
+        out << "]}\n";
+        return static_cast<bool>(out);
+    }
+
+    bool FindJsonString(const std::string& line, const std::string& key, std::string& value) {
+        const std::string pattern = "\"" + key + "\":\"";
+        const std::size_t begin = line.find(pattern);
+        if (begin == std::string::npos) {
+            return false;
+        }
+        const std::size_t end = line.find('"', begin + pattern.size());
+        if (end == std::string::npos) {
+            return false;
+        }
+        value = line.substr(begin + pattern.size(), end - begin - pattern.size());
+        return true;
+    }
+
+    bool FindJsonNumber(const std::string& line, const std::string& key, double& value) {
+        const std::string pattern = "\"" + key + "\":";
+        const std::size_t begin = line.find(pattern);
+        return begin != std::string::npos && std::sscanf(line.c_str() + begin + pattern.size(), "%lf", &value) == 1;
+    }
+
+    // Медианы базы по ключу "стадия случай". Читает только то, что пишет WriteResults.
+    bool ReadBaseline(const std::string& path, std::map<std::string, double>& medians) {
+        std::ifstream in(path);
+        if (!in) {
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            std::string stage, name;
+            double median = 0.0;
+            if (FindJsonString(line, "stage", stage) && FindJsonString(line, "case", name) &&
+                FindJsonNumber(line, "p50_ms", median)) {
+                medians[stage + " " + name] = median;
+            }
+        }
+        return true;
+    }
+
+    // Сравнивает медианы с базой. Возвращает false, если хоть одна выросла больше допуска; стадии
+    // короче NoiseFloor мс не считаются регрессией — там рост в разы бывает от одного прерывания.
+    bool CompareWithBaseline(std::ostream& out, const std::vector<StageResult>& results,
+                             const std::map<std::string, double>& baseline, double tolerance) {
+        const double NoiseFloor = 0.05;
+        bool ok = true;
+        out << std::left << std::setw(34) << "baseline comparison" << std::right << std::setw(11) << "base p50"
+            << std::setw(11) << "p50" << std::setw(9) << "change" << "\n";
+        for (const StageResult& result : results) {
+            const std::string key = result.Stage + " " + result.Case;
+            const auto found = baseline.find(key);
+            if (found == baseline.end() || found->second <= 0.0) {
+                out << std::left << std::setw(34) << key << std::right << std::setw(11) << "-" << "  new\n";
+                continue;
+            }
+            const double median = Summarize(result).P50;
+            const double change = median / found->second - 1.0;
+            const bool regressed = change > tolerance && median - found->second > NoiseFloor;
+            ok = ok && !regressed;
+            out << std::left << std::setw(34) << key << std::right << std::fixed << std::setprecision(3)
+                << std::setw(11) << found->second << std::setw(11) << median << std::setw(8)
+                << std::setprecision(1) << std::showpos << 100.0 * change << "%" << std::noshowpos
+                << (regressed ? "  REGRESSION" : "") << "\n";
+        }
+        out.unsetf(std::ios::fixed);
+        out << std::setprecision(6);
+        return ok;
+    }
+}
+
+int RunStageBenchmark(const StageBenchmarkOptions& options) {
+    // Без базы сравнение молча ничего бы не проверяло, поэтому ее отсутствие — ошибка, и до замеров.
+    std::map<std::string, double> baseline;
+    if (!options.BaselinePath.empty() && (!ReadBaseline(options.BaselinePath, baseline) || baseline.empty())) {
+        std::cerr << "no baseline at " << options.BaselinePath << "; record one on the reference machine with"
+                  << " --bench-out (or the bench-record target)" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const int heavyRepeats = std::max(3, options.Repeats / 4);
+    std::vector<StageResult> results;
+    bool ok = true;
+    const auto report = [&](StageResult& result, bool measured) {
+        if (measured) {
+            results.push_back(std::move(result));
+        } else {
+            std::cerr << result.Stage << " " << result.Case << ": failed" << std::endl;
+            ok = false;
+        }
+    };
+
+    // Две формы страницы по очереди: деформатор и маппер не могут пропустить работу из-за совпадения формы.
+    std::vector<PageWarp> shapes[2];
+    std::string error;
+    if (!ParsePageWarps("curl(0.15,0.2)+noise(0.005,0.1,7)", shapes[0], error) ||
+        !ParsePageWarps("fold(0.1,30,60,0.05)+wave(0.01,0.3,20,0)", shapes[1], error)) {
+        std::cerr << error << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    {
+        const std::size_t slash = options.Texture.find_last_of('/');
+        StageResult decode{"texture_decode", options.Texture.substr(slash == std::string::npos ? 0 : slash + 1),
+                           0.0, "Mpixel/s", {}};
+        const bool measured = Measure(decode, options.Repeats, [&] {
+            vtkNew<vtkImageReader2Factory> factory;
+            vtkSmartPointer<vtkImageReader2> reader;
+            reader.TakeReference(factory->CreateImageReader2(options.Texture.c_str()));
+            if (!reader) {
+                return false;
+            }
+            reader->SetFileName(options.Texture.c_str());
+            reader->Update();
+            decode.Work = reader->GetOutput()->GetNumberOfPoints() / 1e6;
+            return decode.Work > 0.0;
+        });
+        report(decode, measured);
+    }
+
+    for (long triangles : options.Triangles) {
+        int columns = 0;
+        int rows = 0;
+        PageResolution(triangles, columns, rows);
+        const std::string name = FormatCount(triangles);
+        PageDeformer deformer;
+        deformer.SetResolution(columns, rows);
+
+        int shape = 0;
+        StageResult deform{"deform", name, 2.0 * columns * rows / 1e6, "Mtri/s", {}};
+        report(deform, Measure(deform, options.Repeats, [&] {
+                   shape ^= 1;
+                   return deformer.Apply(shapes[shape]);
+               }));
+
+        const std::string objPath = options.WorkDirectory + "/bench-" + name + ".obj";
+        StageResult load{"obj_load", name, 0.0, "MB/s", {}};
+        bool measured = WriteObj(deformer.GetMesh(), objPath);
+        load.Work = FileMegabytes(objPath);
+        measured = measured && Measure(load, heavyRepeats, [&] {
+                       vtkNew<ParallelOBJReader> reader;
+                       reader->SetFileName(objPath.c_str());
+                       reader->Update();
+                       return reader->GetOutput()->GetNumberOfPoints() > 0;
+                   });
+        report(load, measured);
+        std::remove(objPath.c_str());
+
+        const std::string vtpPath = options.WorkDirectory + "/bench-" + name + ".vtp";
+        const vtkSmartPointer<vtkPolyData> polyData = PolyDataOverMesh(deformer.GetMesh());
+        StageResult write{"vtp_write", name, 0.0, "MB/s", {}};
+        measured = Measure(write, heavyRepeats, [&] {
+            vtkNew<vtkXMLPolyDataWriter> writer;
+            writer->SetFileName(vtpPath.c_str());
+            writer->SetInputData(polyData);
+            return writer->Write() != 0;
+        });
+        write.Work = FileMegabytes(vtpPath);
+        report(write, measured);
+        std::remove(vtpPath.c_str());
+
+        RenderJob job;
+        job.Texture = options.Texture;
+        job.Warps = shapes[0];
+        job.PageGrid[0] = columns;
+        job.PageGrid[1] = rows;
+        for (const std::pair<int, int>& size : options.Sizes) {
+            const int width = size.first;
+            const int height = size.second;
+            const std::string frameCase = name + "/" + std::to_string(width) + "x" + std::to_string(height);
+            std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * 3);
+
+            // Первый кадр нового контекста: окно и OpenGL-контекст, загрузка сетки и текстуры в GPU.
+            // Декодированная текстура к этому времени уже в кэше процесса (декодирование — texture_decode).
+            StageResult first{"first_render", frameCase, 1.0, "frames/s", {}};
+            report(first, Measure(first, heavyRepeats, [&] {
+                       RenderContext context(width, height, options.Backend);
+                       if (!context.Prepare(job, error)) {
+                           std::cerr << error << std::endl;
+                           return false;
+                       }
+                       context.DrawFrame();
+                       return context.ReadFrame(pixels.data(), 3);
+                   }));
+
+            RenderContext context(width, height, options.Backend);
+            if (!context.Prepare(job, error)) {
+                std::cerr << error << std::endl;
+                ok = false;
+                continue;
+            }
+            context.DrawFrame();
+            context.ReadFrame(pixels.data(), 3);
+
+            // Кадр считается готовым, только когда он прочитан: OpenGL рисует асинхронно, и без чтения
+            // замер показал бы лишь постановку команд в очередь.
+            StageResult steady{"steady_render", frameCase, 1.0, "frames/s", {}};
+            report(steady, Measure(steady, options.Repeats, [&] {
+                       context.DrawFrame();
+                       return context.ReadFrame(pixels.data(), 3);
+                   }));
+
+            // Повторное чтение уже готового кадра: только передача пикселей из GPU в память.
+            StageResult readback{"readback", frameCase, pixels.size() / (1024.0 * 1024.0), "MB/s", {}};
+            report(readback,
+                   Measure(readback, options.Repeats, [&] { return context.ReadFrame(pixels.data(), 3); }));
+
+            ImageEncoder encoder;
+            std::vector<unsigned char> bytes;
+            StageResult encode{"png_encode", frameCase, width * static_cast<double>(height) / 1e6, "Mpixel/s", {}};
+            report(encode, Measure(encode, options.Repeats, [&] {
+                       return encoder.Encode(pixels.data(), width, height, 3, ImageFormat::Png, bytes, error);
+                   }));
+        }
+    }
+
+    PrintResults(std::cout, results);
+    if (!options.OutputPath.empty()) {
+        if (WriteResults(options.OutputPath, options, results)) {
+            std::cout << "results written to " << options.OutputPath << std::endl;
+        } else {
+            std::cerr << "cannot write " << options.OutputPath << std::endl;
+            ok = false;
+        }
+    }
+    if (!options.BaselinePath.empty() && !CompareWithBaseline(std::cout, results, baseline, options.Tolerance)) {
+        std::cout << "p50 regressed by more than " << 100.0 * options.Tolerance << "% against the baseline"
+                  << std::endl;
+        ok = false;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
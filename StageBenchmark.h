@@ -0,0 +1,32 @@
+#ifndef STAGE_BENCHMARK_H
+#define STAGE_BENCHMARK_H
+
+#include "RenderContext.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Параметры замера стадий конвейера (--bench-stages).
+struct StageBenchmarkOptions {
+    // Размеры деформируемой страницы в треугольниках и разрешения кадра: каждая стадия рендеринга
+    // замеряется на всех сочетаниях.
+    std::vector<long> Triangles = {20000, 200000, 2000000};
+    std::vector<std::pair<int, int>> Sizes = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+    int Repeats = 20; // замеров дешевых стадий; загрузка, запись и первый кадр — вчетверо меньше, не меньше 3
+    RenderBackend Backend = RenderBackend::Vtk;
+    std::string Texture = "../chess.jpeg";
+    std::string WorkDirectory = "."; // сюда пишутся OBJ и VTP страниц
+    std::string OutputPath;          // JSON с результатами; пусто — не сохранять
+    std::string BaselinePath;        // JSON прошлого запуска для сравнения; пусто или нет файла — не сравнивать
+    double Tolerance = 0.15;         // допустимый рост медианы относительно базы
+};
+
+// Замеряет по отдельности стадии конвейера на синтетических страницах: чтение OBJ, декодирование
+// текстуры, деформацию сетки, первый и последующие кадры, чтение кадра, кодирование PNG и запись VTP.
+// Печатает таблицу, сохраняет JSON (одна стадия на строку: число замеров, среднее, минимум, p50, p90, p99,
+// максимум в мс и пропускная способность) и сравнивает медианы с базой.
+// Возвращает EXIT_FAILURE, если стадия не выполнилась или какая-то медиана выросла больше допуска.
+int RunStageBenchmark(const StageBenchmarkOptions& options);
+
+#endif // STAGE_BENCHMARK_H
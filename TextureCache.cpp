@@ -0,0 +1,224 @@
+#include "TextureCache.h"
+
+#include "Tracer.h"
+
+#include <vtkImageReader2.h>
+#include <vtkImageReader2Factory.h>
+#include <vtkNew.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <sys/stat.h>
+
+namespace {
+    const char MemoryPrefix[] = "memory:";
+
+    // Ключ: путь, время изменения (нс) и размер файла.
+    bool MakeKey(const std::string& path, std::string& key) {
+        struct stat info {};
+        if (stat(path.c_str(), &info) != 0) {
+            return false;
+        }
+        const long long mtime = static_cast<long long>(info.st_mtim.tv_sec) * 1000000000LL + info.st_mtim.tv_nsec;
+        key = path + '|' + std::to_string(mtime) + '|' + std::to_string(static_cast<long long>(info.st_size));
+        return true;
+    }
+}
+
+const TextureMips& CachedTexture::GetMips() const {
+    std::call_once(this->MipsOnce, [this] {
+        int dims[3];
+        this->Image->GetDimensions(dims);
+        if (this->Image->GetScalarType() == VTK_UNSIGNED_CHAR) {
+            this->Mips.Build(static_cast<const unsigned char*>(this->Image->GetScalarPointer()), dims[0], dims[1],
+                             this->Image->GetNumberOfScalarComponents());
+        }
+        if (this->Owner != nullptr) {
+            this->Owner->Charge(this, this->Mips.GetMemorySize());
+        }
+    });
+    return this->Mips;
+}
+
+std::ostream& operator<<(std::ostream& out, const TextureCacheStats& stats) {
+    return out << "texture cache: " << stats.Hits << " hits, " << stats.Misses << " misses, " << stats.Evictions
+               << " evictions, " << stats.Entries << " entries, " << stats.BytesResident / (1024 * 1024) << " of "
+               << stats.Capacity / (1024 * 1024) << " MB resident";
+}
+
+TextureCache& TextureCache::Instance() {
+    static TextureCache cache;
+    return cache;
+}
+
+void TextureCache::SetCapacity(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Capacity = bytes;
+    this->EvictLocked();
+}
+
+std::shared_ptr<const CachedTexture> TextureCache::Acquire(const std::string& path, std::string& error) {
+    const bool inMemory = path.compare(0, sizeof(MemoryPrefix) - 1, MemoryPrefix) == 0;
+    std::string key = path;
+    if (!inMemory && !MakeKey(path, key)) {
+        error = "cannot read texture " + path;
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        auto found = this->Slots.find(key);
+        if (found != this->Slots.end()) {
+            ++this->Stats.Hits;
+            this->Order.splice(this->Order.begin(), this->Order, found->second.Position);
+            return found->second.Texture;
+        }
+        ++this->Stats.Misses;
+        if (inMemory) {
+            // Изображение из памяти заново не прочитать: его можно найти, только пока запись кто-то держит.
+            auto stored = this->Stored.find(key);
+            std::shared_ptr<CachedTexture> texture = stored != this->Stored.end() ? stored->second.lock() : nullptr;
+            if (!texture) {
+                error = "texture " + path + " is no longer in memory";
+            }
+            return texture;
+        }
+    }
+
+    // Декодирование идет без блокировки, чтобы промахи разных потоков не ждали друг друга.
+    TRACE_SCOPE("texture.decode");
+    vtkNew<vtkImageReader2Factory> factory;
+    vtkSmartPointer<vtkImageReader2> reader;
+    reader.TakeReference(factory->CreateImageReader2(path.c_str()));
+    if (!reader) {
+        error = "cannot read texture " + path;
+        return nullptr;
+    }
+    reader->SetFileName(path.c_str());
+    reader->Update();
+    if (reader->GetOutput()->GetNumberOfPoints() == 0) {
+        error = "cannot decode texture " + path;
+        return nullptr;
+    }
+
+    auto texture = std::make_shared<CachedTexture>();
+    texture->Key = key;
+    texture->Path = path;
+    texture->Image = vtkSmartPointer<vtkImageData>::New();
+    texture->Image->ShallowCopy(reader->GetOutput());
+    texture->ImageBytes = static_cast<std::size_t>(texture->Image->GetActualMemorySize()) * 1024;
+    texture->Owner = this;
+
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    return this->InsertLocked(texture);
+}
+
+std::shared_ptr<const CachedTexture> TextureCache::Store(const std::string& name, const unsigned char* pixels,
+                                                         int width, int height, int channels) {
+    auto texture = std::make_shared<CachedTexture>();
+    texture->Image = vtkSmartPointer<vtkImageData>::New();
+    texture->Image->SetDimensions(width, height, 1);
+    texture->Image->AllocateScalars(VTK_UNSIGNED_CHAR, channels);
+    const std::size_t size = static_cast<std::size_t>(width) * height * channels;
+    std::memcpy(texture->Image->GetScalarPointer(), pixels, size);
+    texture->ImageBytes = size;
+    texture->Owner = this;
+
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->PruneStoredLocked();
+    texture->Key = MemoryPrefix + name + '#' + std::to_string(++this->StoredVersion);
+    texture->Path = texture->Key;
+    std::string& current = this->StoredNames[name];
+    if (!current.empty()) {
+        this->RemoveLocked(current);
+        this->Stored.erase(current);
+    }
+    current = texture->Key;
+    this->Stored[texture->Key] = texture;
+    return this->InsertLocked(texture);
+}
+
+std::shared_ptr<CachedTexture> TextureCache::InsertLocked(const std::shared_ptr<CachedTexture>& texture) {
+    auto found = this->Slots.find(texture->Key);
+    if (found != this->Slots.end()) {
+        // Другой поток успел декодировать тот же файл — используем его запись.
+        this->Order.splice(this->Order.begin(), this->Order, found->second.Position);
+        return found->second.Texture;
+    }
+    this->Order.push_front(texture->Key);
+    Slot& slot = this->Slots[texture->Key];
+    slot.Texture = texture;
+    slot.Position = this->Order.begin();
+    slot.Bytes = texture->ImageBytes;
+    this->Stats.BytesResident += slot.Bytes;
+    this->EvictLocked();
+    return texture;
+}
+
+void TextureCache::RemoveLocked(const std::string& key) {
+    auto found = this->Slots.find(key);
+    if (found == this->Slots.end()) {
+        return;
+    }
+    this->Stats.BytesResident -= found->second.Bytes;
+    this->Order.erase(found->second.Position);
+    this->Slots.erase(found);
+}
+
+void TextureCache::Charge(const CachedTexture* texture, std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    auto found = this->Slots.find(texture->Key);
+    if (found == this->Slots.end() || found->second.Texture.get() != texture) {
+        return; // запись уже вытеснена
+    }
+    found->second.Bytes += bytes;
+    this->Stats.BytesResident += bytes;
+    this->EvictLocked();
+}
+
+void TextureCache::EvictLocked() {
+    // Самую свежую запись не вытесняем, даже если она одна больше всей емкости.
+    while (this->Stats.BytesResident > this->Capacity && this->Order.size() > 1) {
+        const std::string key = this->Order.back();
+        this->Order.pop_back();
+        auto found = this->Slots.find(key);
+        this->Stats.BytesResident -= found->second.Bytes;
+        this->Slots.erase(found);
+        ++this->Stats.Evictions;
+        if (key.compare(0, sizeof(MemoryPrefix) - 1, MemoryPrefix) == 0) {
+            this->EvictedStored.push_back(key);
+        }
+    }
+    this->PruneStoredLocked();
+}
+
+void TextureCache::PruneStoredLocked() {
+    // Вытесненное изображение из памяти больше нигде не найти, как только его отпустил последний пользователь:
+    // тогда забываем и его ключ, и имя, если оно все еще указывает на эту запись.
+    std::vector<std::string>& evicted = this->EvictedStored;
+    auto expired = std::remove_if(evicted.begin(), evicted.end(), [this](const std::string& key) {
+        auto stored = this->Stored.find(key);
+        if (stored != this->Stored.end() && !stored->second.expired()) {
+            return false;
+        }
+        if (stored != this->Stored.end()) {
+            this->Stored.erase(stored);
+        }
+        const std::size_t prefix = sizeof(MemoryPrefix) - 1;
+        auto name = this->StoredNames.find(key.substr(prefix, key.rfind('#') - prefix));
+        if (name != this->StoredNames.end() && name->second == key) {
+            this->StoredNames.erase(name);
+        }
+        return true;
+    });
+    evicted.erase(expired, evicted.end());
+}
+
+TextureCacheStats TextureCache::GetStats() {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    TextureCacheStats stats = this->Stats;
+    stats.Entries = this->Slots.size();
+    stats.Capacity = this->Capacity;
+    return stats;
+}
@@ -0,0 +1,105 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include "SoftwareTexture.h"
+
+#include <vtkImageData.h>
+#include <vtkSmartPointer.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TextureCache;
+
+// Декодированная текстура. Только для чтения: одну запись одновременно используют несколько потоков.
+class CachedTexture {
+public:
+    const std::string& GetKey() const { return this->Key; }
+    const std::string& GetPath() const { return this->Path; }
+    vtkImageData* GetImage() const { return this->Image; }
+
+    // Mip-пирамида для программного растеризатора; строится при первом обращении.
+    const TextureMips& GetMips() const;
+
+private:
+    friend class TextureCache;
+
+    std::string Key;
+    std::string Path;
+    vtkSmartPointer<vtkImageData> Image;
+    std::size_t ImageBytes = 0;
+    TextureCache* Owner = nullptr;
+    mutable std::once_flag MipsOnce;
+    mutable TextureMips Mips;
+};
+
+struct TextureCacheStats {
+    std::uint64_t Hits = 0;
+    std::uint64_t Misses = 0;
+    std::uint64_t Evictions = 0;
+    std::size_t Entries = 0;
+    std::size_t BytesResident = 0;
+    std::size_t Capacity = 0;
+};
+
+std::ostream& operator<<(std::ostream& out, const TextureCacheStats& stats);
+
+// Общий для процесса LRU-кэш декодированных изображений, ограниченный по памяти.
+// Ключ — путь к файлу плюс время изменения и размер, поэтому перезаписанный файл читается заново.
+// Изображения из памяти (Store) получают пути вида "memory:имя#N" и дальше используются как файлы.
+// Вытесненная запись остается жить, пока ее держит хотя бы один пользователь (shared_ptr),
+// но в BytesResident уже не учитывается.
+class TextureCache {
+public:
+    static TextureCache& Instance();
+
+    void SetCapacity(std::size_t bytes);
+
+    // Возвращает декодированное изображение файла, при промахе читает его через vtkImageReader2Factory.
+    std::shared_ptr<const CachedTexture> Acquire(const std::string& path, std::string& error);
+
+    // Кладет в кэш копию изображения из памяти: width x height, channels от 1 до 4, строки снизу вверх.
+    // GetPath() записи — путь для Acquire. Запись с тем же name заменяет предыдущую, поэтому повторный Store
+    // под одним именем не копит изображения; пока запись кто-то держит, Acquire находит ее и после вытеснения.
+    std::shared_ptr<const CachedTexture> Store(const std::string& name, const unsigned char* pixels, int width,
+                                               int height, int channels);
+
+    TextureCacheStats GetStats();
+
+private:
+    friend class CachedTexture;
+
+    struct Slot {
+        std::shared_ptr<CachedTexture> Texture;
+        std::list<std::string>::iterator Position;
+        std::size_t Bytes = 0;
+    };
+
+    void Charge(const CachedTexture* texture, std::size_t bytes);
+    // Добавляет запись в начало LRU; если запись с тем же ключом уже есть, возвращает ее.
+    std::shared_ptr<CachedTexture> InsertLocked(const std::shared_ptr<CachedTexture>& texture);
+    void RemoveLocked(const std::string& key);
+    void EvictLocked();
+    void PruneStoredLocked();
+
+    std::mutex Mutex;
+    std::unordered_map<std::string, Slot> Slots;
+    std::list<std::string> Order; // от недавно использованных к давно не использованным
+    TextureCacheStats Stats;
+    std::size_t Capacity = std::size_t(1) << 30;
+    // Изображения из памяти: имя -> ключ текущей записи и ключ -> запись, пока ее кто-то держит.
+    std::unordered_map<std::string, std::string> StoredNames;
+    std::unordered_map<std::string, std::weak_ptr<CachedTexture>> Stored;
+    std::uint64_t StoredVersion = 0;
+    // Ключи вытесненных изображений из памяти: их записи в Stored и StoredNames удаляются, когда запись умрет.
+    std::vector<std::string> EvictedStored;
+};
+
+#endif // TEXTURE_CACHE_H
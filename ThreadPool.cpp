@@ -0,0 +1,99 @@
+#include "ThreadPool.h"
+
+namespace {
+    int DefaultThreadCount = 0;
+}
+
+ThreadPool::ThreadPool(int threads) {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    for (int i = 1; i < threads; ++i) {
+        this->Threads.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        this->Stopping = true;
+    }
+    this->WakeUp.notify_all();
+    for (std::thread& thread : this->Threads) {
+        thread.join();
+    }
+}
+
+ThreadPool& ThreadPool::Instance() {
+    static ThreadPool pool(DefaultThreadCount);
+    return pool;
+}
+
+void ThreadPool::SetDefaultThreadCount(int threads) {
+    DefaultThreadCount = threads;
+}
+
+void ThreadPool::RunChunks() {
+    for (;;) {
+        const std::size_t begin = this->NextChunk.fetch_add(this->Grain);
+        if (begin >= this->Count) {
+            return;
+        }
+        const std::size_t end = begin + this->Grain < this->Count ? begin + this->Grain : this->Count;
+        (*this->Body)(begin, end);
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    unsigned long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(this->Mutex);
+            this->WakeUp.wait(lock, [&] { return this->Stopping || this->Generation != seen; });
+            if (this->Stopping) {
+                return;
+            }
+            seen = this->Generation;
+            ++this->Busy;
+        }
+        this->RunChunks();
+        {
+            std::lock_guard<std::mutex> lock(this->Mutex);
+            --this->Busy;
+        }
+        this->Done.notify_all();
+    }
+}
+
+void ThreadPool::ParallelFor(std::size_t count, std::size_t grain,
+                             const std::function<void(std::size_t, std::size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+    // Мелкую работу дешевле сделать в текущем потоке, чем будить пул.
+    if (this->Threads.empty() || count <= grain) {
+        body(0, count);
+        return;
+    }
+
+    std::lock_guard<std::mutex> call(this->CallMutex);
+    {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        this->Body = &body;
+        this->Count = count;
+        this->Grain = grain;
+        this->NextChunk = 0;
+        ++this->Generation;
+    }
+    this->WakeUp.notify_all();
+
+    this->RunChunks();
+
+    // Ждем, пока все проснувшиеся потоки выйдут из RunChunks: после этого body можно уничтожать.
+    std::unique_lock<std::mutex> lock(this->Mutex);
+    this->Done.wait(lock, [&] { return this->Busy == 0; });
+    this->Body = nullptr;
+}
@@ -0,0 +1,54 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Постоянный пул потоков для параллельных циклов внутри одного кадра (растеризация по тайлам и т. п.).
+// Потоки создаются один раз и ждут работы, поэтому ParallelFor стоит микросекунды, а не создание потоков.
+//
+// Пул не переживает fork: рабочие процессы WorkerPool должны впервые обращаться к Instance()
+// уже после fork, тогда у каждого процесса будет свой пул.
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Общий пул процесса. Размер задается SetDefaultThreadCount до первого вызова (0 — по числу ядер).
+    static ThreadPool& Instance();
+    static void SetDefaultThreadCount(int threads);
+
+    int GetThreadCount() const { return static_cast<int>(this->Threads.size()) + 1; }
+
+    // Вызывает body(begin, end) для отрезков [0, count) длиной не более grain.
+    // Вызывающий поток тоже участвует в работе; возврат — после обработки всех отрезков.
+    void ParallelFor(std::size_t count, std::size_t grain, const std::function<void(std::size_t, std::size_t)>& body);
+
+private:
+    void WorkerLoop();
+    void RunChunks();
+
+    std::vector<std::thread> Threads;
+    std::mutex Mutex;
+    std::condition_variable WakeUp;
+    std::condition_variable Done;
+    std::mutex CallMutex; // ParallelFor из разных потоков выполняются по очереди
+
+    const std::function<void(std::size_t, std::size_t)>* Body = nullptr;
+    std::size_t Count = 0;
+    std::size_t Grain = 1;
+    std::atomic<std::size_t> NextChunk{0};
+    int Busy = 0;
+    unsigned long Generation = 0;
+    bool Stopping = false;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,206 @@
+#include "Tracer.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+#include <unistd.h>
+
+namespace {
+    volatile std::sig_atomic_t DumpRequested = 0;
+
+    void RequestDump(int) {
+        DumpRequested = 1;
+    }
+
+    // Одно событие на строку: Merge собирает события из файлов построчно.
+    void WriteEvent(std::FILE* file, bool& first, const char* line) {
+        std::fputs(first ? "\n" : ",\n", file);
+        std::fputs(line, file);
+        first = false;
+    }
+}
+
+thread_local Tracer::ThreadBuffer* Tracer::CurrentBuffer = nullptr;
+
+Tracer& Tracer::Instance() {
+    static Tracer tracer;
+    return tracer;
+}
+
+bool Tracer::IsCompiledIn() {
+#ifdef DOCRENDER_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+std::uint64_t Tracer::Now() {
+    // steady_clock — CLOCK_MONOTONIC, общий для всех процессов: трассировки рабочих совпадают по времени.
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+void Tracer::Enable(const std::string& path, std::size_t eventsPerThread) {
+    {
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        this->Path = path;
+        this->Capacity = eventsPerThread > 0 ? eventsPerThread : 1;
+    }
+    struct sigaction action = {};
+    action.sa_handler = RequestDump;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, nullptr);
+    this->Enabled.store(true, std::memory_order_relaxed);
+}
+
+void Tracer::AfterFork(const std::string& path) {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    this->Path = path;
+    std::unique_ptr<ThreadBuffer> current;
+    for (std::unique_ptr<ThreadBuffer>& buffer : this->Buffers) {
+        if (buffer.get() == Tracer::CurrentBuffer) {
+            current = std::move(buffer);
+        }
+    }
+    this->Buffers.clear();
+    if (current) {
+        current->Next = 0;
+        current->Count = 0;
+        this->Buffers.push_back(std::move(current));
+    }
+}
+
+Tracer::ThreadBuffer* Tracer::GetThreadBuffer() {
+    if (Tracer::CurrentBuffer == nullptr) {
+        std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+        std::lock_guard<std::mutex> lock(this->Mutex);
+        buffer->Events.resize(this->Capacity);
+        buffer->Id = this->NextId++;
+        Tracer::CurrentBuffer = buffer.get();
+        this->Buffers.push_back(std::move(buffer));
+    }
+    return Tracer::CurrentBuffer;
+}
+
+void Tracer::Record(const char* name, std::uint64_t start, std::uint64_t end) {
+    ThreadBuffer* buffer = this->GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffer->Mutex);
+    Event& event = buffer->Events[buffer->Next];
+    event.Name = name;
+    event.Start = start;
+    event.End = end;
+    buffer->Next = buffer->Next + 1 == buffer->Events.size() ? 0 : buffer->Next + 1;
+    if (buffer->Count < buffer->Events.size()) {
+        ++buffer->Count;
+    }
+}
+
+void Tracer::RecordDuration(const char* name, double seconds) {
+    if (!this->IsEnabled()) {
+        return;
+    }
+    const std::uint64_t end = Tracer::Now();
+    const std::uint64_t duration = static_cast<std::uint64_t>(seconds > 0.0 ? seconds * 1e9 : 0.0);
+    this->Record(name, end > duration ? end - duration : 0, end);
+}
+
+void Tracer::SetThreadName(const std::string& name) {
+    if (!this->IsEnabled()) {
+        return;
+    }
+    ThreadBuffer* buffer = this->GetThreadBuffer();
+    std::lock_guard<std::mutex> lock(buffer->Mutex);
+    buffer->Name = name;
+}
+
+bool Tracer::Dump(std::string& error) {
+    std::lock_guard<std::mutex> lock(this->Mutex);
+    std::FILE* file = std::fopen(this->Path.c_str(), "w");
+    if (file == nullptr) {
+        error = "cannot write " + this->Path;
+        return false;
+    }
+    const long pid = static_cast<long>(::getpid());
+    std::fputs("{\"traceEvents\":[", file);
+    bool first = true;
+    char line[256];
+    std::vector<Event> events;
+    std::string name;
+    for (const std::unique_ptr<ThreadBuffer>& buffer : this->Buffers) {
+        {
+            // Копия под блокировкой буфера: поток продолжает писать, пока события форматируются.
+            std::lock_guard<std::mutex> bufferLock(buffer->Mutex);
+            const std::size_t capacity = buffer->Events.size();
+            const std::size_t oldest = (buffer->Next + capacity - buffer->Count) % capacity;
+            events.clear();
+            for (std::size_t i = 0; i < buffer->Count; ++i) {
+                events.push_back(buffer->Events[(oldest + i) % capacity]);
+            }
+            name = buffer->Name.empty() ? "thread " + std::to_string(buffer->Id) : buffer->Name;
+        }
+        std::snprintf(line, sizeof(line),
+                      "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%ld,\"tid\":%d,\"args\":{\"name\":\"%s\"}}", pid,
+                      buffer->Id, name.c_str());
+        WriteEvent(file, first, line);
+        for (const Event& event : events) {
+            std::snprintf(line, sizeof(line),
+                          "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%ld,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}", event.Name,
+                          pid, buffer->Id, event.Start / 1000.0, (event.End - event.Start) / 1000.0);
+            WriteEvent(file, first, line);
+        }
+    }
+    std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+    if (std::fclose(file) != 0) {
+        error = "cannot write " + this->Path;
+        return false;
+    }
+    return true;
+}
+
+void Tracer::DumpIfRequested() {
+    if (DumpRequested == 0 || !this->IsEnabled()) {
+        return;
+    }
+    DumpRequested = 0;
+    std::string error;
+    if (this->Dump(error)) {
+        std::cerr << "trace written to " << this->Path << std::endl;
+    } else {
+        std::cerr << error << std::endl;
+    }
+}
+
+bool Tracer::Merge(const std::vector<std::string>& parts, const std::string& path, std::string& error) {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        error = "cannot write " + path;
+        return false;
+    }
+    std::fputs("{\"traceEvents\":[", file);
+    bool first = true;
+    for (const std::string& part : parts) {
+        std::ifstream in(part);
+        std::string line;
+        while (std::getline(in, line)) {
+            if (line.compare(0, 8, "{\"name\":") != 0) {
+                continue;
+            }
+            if (!line.empty() && line.back() == ',') {
+                line.pop_back();
+            }
+            WriteEvent(file, first, line.c_str());
+        }
+    }
+    std::fputs("\n],\"displayTimeUnit\":\"ms\"}\n", file);
+    if (std::fclose(file) != 0) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,111 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Трассировка стадий: TRACE_SCOPE("encode") замеряет область видимости и кладет событие в кольцевой буфер
+// своего потока; Dump пишет буферы всех потоков в формате Chrome trace-event (chrome://tracing, Perfetto).
+//
+// Без DOCRENDER_TRACE макросы пусты и в код не попадает ничего. Со сборочным флагом, но без Enable,
+// событие стоит одну проверку флага; с Enable — два чтения часов и запись в буфер под блокировкой,
+// которую кроме своего потока берет только Dump, то есть десятки наносекунд на стадию.
+#ifdef DOCRENDER_TRACE
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#define TRACE_DURATION(name, seconds) Tracer::Instance().RecordDuration(name, seconds)
+#define TRACE_THREAD_NAME(name) Tracer::Instance().SetThreadName(name)
+#else
+#define TRACE_SCOPE(name) static_cast<void>(0)
+#define TRACE_DURATION(name, seconds) static_cast<void>(0)
+#define TRACE_THREAD_NAME(name) static_cast<void>(0)
+#endif
+
+class Tracer {
+public:
+    static Tracer& Instance();
+
+    // Собрана ли программа с DOCRENDER_TRACE: иначе Enable ничего не даст.
+    static bool IsCompiledIn();
+
+    // Включает запись: у каждого потока свой буфер на eventsPerThread последних событий. Dump пишет в path;
+    // по сигналу SIGUSR1 запись делается между заданиями (см. DumpIfRequested).
+    void Enable(const std::string& path, std::size_t eventsPerThread = 1 << 16);
+    bool IsEnabled() const { return this->Enabled.load(std::memory_order_relaxed); }
+
+    // Вызывается в дочернем процессе после fork: буферы потоков родителя, которых здесь нет, отбрасываются,
+    // буфер текущего потока очищается, и дальше события пишутся в path.
+    void AfterFork(const std::string& path);
+
+    // name должен жить все время работы программы (строковый литерал).
+    void Record(const char* name, std::uint64_t start, std::uint64_t end);
+    // Событие, которое закончилось сейчас и длилось seconds (время, измеренное не нами, например VTK).
+    void RecordDuration(const char* name, double seconds);
+    void SetThreadName(const std::string& name);
+
+    bool Dump(std::string& error);
+    // Пишет трассировку, если с прошлого раза пришел SIGUSR1. Вызывается из потока рендеринга между заданиями.
+    void DumpIfRequested();
+    const std::string& GetPath() const { return this->Path; }
+
+    // Объединяет файлы Dump нескольких процессов в один.
+    static bool Merge(const std::vector<std::string>& parts, const std::string& path, std::string& error);
+
+    // Монотонное время в наносекундах.
+    static std::uint64_t Now();
+
+private:
+    struct Event {
+        const char* Name = nullptr;
+        std::uint64_t Start = 0;
+        std::uint64_t End = 0;
+    };
+
+    struct ThreadBuffer {
+        std::mutex Mutex;
+        std::vector<Event> Events; // кольцо: Next — место следующего события
+        std::size_t Next = 0;
+        std::size_t Count = 0;
+        int Id = 0;
+        std::string Name;
+    };
+
+    Tracer() = default;
+    ThreadBuffer* GetThreadBuffer();
+
+    static thread_local ThreadBuffer* CurrentBuffer; // буфер потока, владеет им Buffers
+
+    std::atomic<bool> Enabled{false};
+    std::string Path;
+    std::size_t Capacity = 1 << 16;
+    std::mutex Mutex; // защищает Buffers и NextId
+    std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+    int NextId = 1;
+};
+
+// Область видимости, время которой попадает в трассировку. Пользуйтесь через TRACE_SCOPE.
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : Name(Tracer::Instance().IsEnabled() ? name : nullptr), Start(this->Name != nullptr ? Tracer::Now() : 0) {}
+    ~TraceScope() {
+        if (this->Name != nullptr) {
+            Tracer::Instance().Record(this->Name, this->Start, Tracer::Now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* Name;
+    std::uint64_t Start;
+};
+
+#endif // TRACER_H
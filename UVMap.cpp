@@ -0,0 +1,87 @@
+#include "UVMap.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    const char UVMapMagic[8] = {'D', 'O', 'C', 'U', 'V', 'M', 'A', 'P'};
+    const std::uint32_t UVMapVersion = 1;
+    const std::size_t SectionAlignment = 64;
+
+    std::uint64_t AlignUp(std::uint64_t value) {
+        return (value + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+    }
+
+    std::uint16_t ToFixed16(float value) {
+        const float clamped = std::min(1.0f, std::max(0.0f, value));
+        return static_cast<std::uint16_t>(std::lround(clamped * 65535.0f));
+    }
+}
+
+bool ParseUVMapEncoding(const std::string& name, UVMapEncoding& encoding) {
+    if (name == "f32") {
+        encoding = UVMapEncoding::Float32;
+    } else if (name == "u16") {
+        encoding = UVMapEncoding::Fixed16;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void EncodeUVMap(const float* uv, const unsigned char* mask, int width, int height, UVMapEncoding encoding,
+                 std::vector<unsigned char>& bytes) {
+    const std::size_t pixels = static_cast<std::size_t>(width) * height;
+    const std::size_t valueSize = encoding == UVMapEncoding::Float32 ? sizeof(float) : sizeof(std::uint16_t);
+
+    UVMapHeader header {};
+    std::memcpy(header.Magic, UVMapMagic, sizeof(UVMapMagic));
+    header.Version = UVMapVersion;
+    header.Encoding = static_cast<std::uint32_t>(encoding);
+    header.Width = static_cast<std::uint32_t>(width);
+    header.Height = static_cast<std::uint32_t>(height);
+    header.UOffset = AlignUp(sizeof(UVMapHeader));
+    header.VOffset = AlignUp(header.UOffset + pixels * valueSize);
+    header.MaskOffset = AlignUp(header.VOffset + pixels * valueSize);
+    header.FileSize = header.MaskOffset + pixels;
+
+    bytes.assign(static_cast<std::size_t>(header.FileSize), 0);
+    std::memcpy(bytes.data(), &header, sizeof(header));
+    unsigned char* u = bytes.data() + header.UOffset;
+    unsigned char* v = bytes.data() + header.VOffset;
+    unsigned char* m = bytes.data() + header.MaskOffset;
+
+    for (int y = 0; y < height; ++y) {
+        // Растеризатор хранит строки снизу вверх, файл — сверху вниз.
+        const std::size_t source = static_cast<std::size_t>(height - 1 - y) * width;
+        const std::size_t target = static_cast<std::size_t>(y) * width;
+        std::memcpy(m + target, mask + source, static_cast<std::size_t>(width));
+        if (encoding == UVMapEncoding::Float32) {
+            float* uRow = reinterpret_cast<float*>(u) + target;
+            float* vRow = reinterpret_cast<float*>(v) + target;
+            for (int x = 0; x < width; ++x) {
+                uRow[x] = uv[(source + x) * 2];
+                vRow[x] = uv[(source + x) * 2 + 1];
+            }
+        } else {
+            std::uint16_t* uRow = reinterpret_cast<std::uint16_t*>(u) + target;
+            std::uint16_t* vRow = reinterpret_cast<std::uint16_t*>(v) + target;
+            for (int x = 0; x < width; ++x) {
+                uRow[x] = ToFixed16(uv[(source + x) * 2]);
+                vRow[x] = ToFixed16(uv[(source + x) * 2 + 1]);
+            }
+        }
+    }
+}
+
+bool WriteBinaryFile(const std::string& path, const std::vector<unsigned char>& bytes, std::string& error) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!out) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
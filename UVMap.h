@@ -0,0 +1,43 @@
+#ifndef UV_MAP_H
+#define UV_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Как хранятся координаты в карте соответствия.
+enum class UVMapEncoding : std::uint32_t {
+    Float32 = 0, // float32 как есть
+    Fixed16 = 1, // uint16, round(clamp(u, 0, 1) * 65535)
+};
+
+bool ParseUVMapEncoding(const std::string& name, UVMapEncoding& encoding);
+
+// Двоичная карта пиксель -> текстура (.uvmap), рассчитанная на отображение в память (np.memmap и т. п.):
+//
+//   UVMapHeader
+//   U    — Width * Height значений в кодировке Encoding
+//   V    — то же
+//   Mask — Width * Height байт: 1 — в пикселе видна сетка, 0 — фон (U и V там равны 0)
+//
+// Строки идут сверху вниз, как в PNG того же кадра; разделы выровнены по 64 байтам.
+struct UVMapHeader {
+    char Magic[8];          // "DOCUVMAP"
+    std::uint32_t Version;  // 1
+    std::uint32_t Encoding; // UVMapEncoding
+    std::uint32_t Width;
+    std::uint32_t Height;
+    std::uint64_t UOffset;
+    std::uint64_t VOffset;
+    std::uint64_t MaskOffset;
+    std::uint64_t FileSize;
+};
+
+// Собирает файл карты из пиксельных (u, v) и маски растеризатора (строки снизу вверх).
+void EncodeUVMap(const float* uv, const unsigned char* mask, int width, int height, UVMapEncoding encoding,
+                 std::vector<unsigned char>& bytes);
+
+bool WriteBinaryFile(const std::string& path, const std::vector<unsigned char>& bytes, std::string& error);
+
+#endif // UV_MAP_H
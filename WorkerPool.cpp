@@ -0,0 +1,146 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <new>
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Заголовок области разделяемой памяти: общий счетчик очереди.
+    // Сразу за ним лежат слоты отчетов, по одному на рабочего.
+    struct alignas(alignof(WorkerReport)) SharedState {
+        std::atomic<std::size_t> Next{0};
+
+        WorkerReport* Reports() { return reinterpret_cast<WorkerReport*>(this + 1); }
+    };
+
+    std::size_t SharedStateSize(int workers) {
+        return sizeof(SharedState) + sizeof(WorkerReport) * static_cast<std::size_t>(workers);
+    }
+
+    void RunWorker(int worker, std::size_t jobCount, std::size_t grain, const WorkerBatch& runBatch,
+                   SharedState* shared) {
+        WorkerReport& report = shared->Reports()[worker];
+        report.Worker = worker;
+        report.Pid = static_cast<long>(getpid());
+
+        const auto start = Clock::now();
+        for (;;) {
+            const std::size_t begin = shared->Next.fetch_add(grain, std::memory_order_relaxed);
+            if (begin >= jobCount) {
+                break;
+            }
+            const std::size_t end = std::min(begin + grain, jobCount);
+            const auto batchStart = Clock::now();
+            report.Failed += runBatch(worker, begin, end);
+            report.BusySeconds += std::chrono::duration<double>(Clock::now() - batchStart).count();
+            report.Jobs += static_cast<long>(end - begin);
+        }
+        report.WallSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+}
+
+std::vector<WorkerReport> RunWorkerPool(int workers, std::size_t jobCount, const WorkerJob& runJob,
+                                        const std::function<long(int worker)>& finish) {
+    const auto runBatch = [&runJob](int worker, std::size_t begin, std::size_t end) {
+        long failed = 0;
+        for (std::size_t index = begin; index < end; ++index) {
+            if (!runJob(worker, index)) {
+                ++failed;
+            }
+        }
+        return failed;
+    };
+    return RunWorkerPool(workers, jobCount, 1, runBatch, finish);
+}
+
+std::vector<WorkerReport> RunWorkerPool(int workers, std::size_t jobCount, std::size_t grain,
+                                        const WorkerBatch& runBatch, const std::function<long(int worker)>& finish) {
+    if (workers < 1) {
+        workers = 1;
+    }
+    grain = std::max<std::size_t>(1, grain);
+    const std::size_t size = SharedStateSize(workers);
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return {};
+    }
+    auto* shared = new (memory) SharedState;
+    for (int i = 0; i < workers; ++i) {
+        new (&shared->Reports()[i]) WorkerReport;
+        shared->Reports()[i].Worker = i;
+    }
+
+    // Несброшенный буфер вывода иначе напечатался бы каждым дочерним процессом.
+    std::fflush(nullptr);
+    std::vector<pid_t> children(static_cast<std::size_t>(workers), -1);
+    for (int i = 0; i < workers; ++i) {
+        const pid_t pid = fork();
+        if (pid == 0) {
+            RunWorker(i, jobCount, grain, runBatch, shared);
+            if (finish) {
+                shared->Reports()[i].Failed += finish(i);
+            }
+            // _exit, а не exit: дочерний процесс не должен выполнять деструкторы и atexit родителя.
+            _exit(shared->Reports()[i].Failed == 0 ? 0 : 1);
+        }
+        children[static_cast<std::size_t>(i)] = pid;
+        if (pid < 0) {
+            shared->Reports()[i].Crashed = true;
+        }
+    }
+
+    for (int i = 0; i < workers; ++i) {
+        const pid_t pid = children[static_cast<std::size_t>(i)];
+        if (pid <= 0) {
+            continue;
+        }
+        int status = 0;
+        if (waitpid(pid, &status, 0) != pid) {
+            shared->Reports()[i].Crashed = true;
+            continue;
+        }
+        // Дошедший до конца рабочий завершается кодом 1, только если у него были неудачные задания;
+        // любой другой код (например, exit внутри VTK) или сигнал — падение.
+        const int expected = shared->Reports()[i].Failed == 0 ? 0 : 1;
+        if (WIFSIGNALED(status) || (WIFEXITED(status) && WEXITSTATUS(status) != expected)) {
+            shared->Reports()[i].Crashed = true;
+        }
+    }
+
+    std::vector<WorkerReport> reports(shared->Reports(), shared->Reports() + workers);
+    munmap(memory, size);
+    return reports;
+}
+
+void PrintWorkerReport(std::ostream& out, const std::vector<WorkerReport>& reports, double wallSeconds) {
+    long jobs = 0;
+    long failed = 0;
+    const std::ios::fmtflags flags = out.flags();
+    const std::streamsize precision = out.precision();
+    out << "worker      pid   jobs  failed   busy, s   wall, s   util\n";
+    for (const WorkerReport& report : reports) {
+        const double utilisation = wallSeconds > 0.0 ? 100.0 * report.BusySeconds / wallSeconds : 0.0;
+        out << std::setw(6) << report.Worker << std::setw(9) << report.Pid << std::setw(7) << report.Jobs
+            << std::setw(8) << report.Failed << std::fixed << std::setprecision(2) << std::setw(10)
+            << report.BusySeconds << std::setw(10) << report.WallSeconds << std::setw(6) << std::setprecision(1)
+            << utilisation << "%" << (report.Crashed ? "  crashed" : "") << "\n";
+        jobs += report.Jobs;
+        failed += report.Failed;
+    }
+    out.flags(flags);
+    out.precision(precision);
+    out << "total: " << jobs - failed << " of " << jobs << " images in " << wallSeconds << " s";
+    if (wallSeconds > 0.0) {
+        out << " (" << (jobs - failed) / wallSeconds << " images/s)";
+    }
+    out << std::endl;
+}
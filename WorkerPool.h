@@ -0,0 +1,53 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+// Статистика одного рабочего процесса за весь прогон.
+struct WorkerReport {
+    int Worker = 0;
+    long Pid = 0;
+    long Jobs = 0;
+    long Failed = 0;
+    double BusySeconds = 0.0; // суммарное время внутри runJob
+    double WallSeconds = 0.0; // от старта рабочего до опустошения очереди
+    bool Crashed = false;     // процесс завершился сигналом или кодом, не совпадающим с Failed
+};
+
+// Функция, выполняемая в рабочем процессе для задания с номером index.
+// Возвращает false, если задание не удалось.
+using WorkerJob = std::function<bool(int worker, std::size_t index)>;
+
+// Функция, выполняемая в рабочем процессе для заданий begin..end-1 одним вызовом.
+// Возвращает число неудавшихся заданий.
+using WorkerBatch = std::function<long(int worker, std::size_t begin, std::size_t end)>;
+
+// Выполняет задания 0..jobCount-1 в workers дочерних процессах.
+//
+// OpenGL-контекст VTK нельзя безопасно делить между потоками, поэтому каждый рабочий —
+// отдельный процесс со своим окном, маппером, актором и рендерером. Очередь общая:
+// атомарный счетчик в разделяемой памяти, из которого освободившийся рабочий забирает
+// следующий номер, так что быстрые рабочие автоматически разбирают работу медленных.
+//
+// finish, если задан, вызывается в каждом рабочем процессе после опустошения очереди
+// (например, чтобы дождаться отложенной записи результатов и напечатать статистику кэшей).
+// Он возвращает число заданий, которые runJob завершил успешно, но которые не удались позже
+// (например, при асинхронной записи); они добавляются к Failed рабочего.
+//
+// Важно: до вызова в родительском процессе не должно быть созданного OpenGL-контекста.
+std::vector<WorkerReport> RunWorkerPool(int workers, std::size_t jobCount, const WorkerJob& runJob,
+                                        const std::function<long(int worker)>& finish = nullptr);
+
+// То же, но рабочий забирает из очереди сразу grain номеров подряд (последний отрезок может быть короче)
+// и выполняет их одним вызовом runBatch — например, чтобы переставить задания отрезка (см. RunBatch).
+std::vector<WorkerReport> RunWorkerPool(int workers, std::size_t jobCount, std::size_t grain,
+                                        const WorkerBatch& runBatch,
+                                        const std::function<long(int worker)>& finish = nullptr);
+
+// Печатает таблицу загрузки рабочих и общую пропускную способность.
+void PrintWorkerReport(std::ostream& out, const std::vector<WorkerReport>& reports, double wallSeconds);
+
+#endif // WORKER_POOL_H
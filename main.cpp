@@ -1,219 +1,352 @@
-#include <vtkActor.h>
-#include <vtkBoxWidget.h>
-#include <vtkCamera.h>
-#include <vtkCommand.h>
-#include <vtkFeatureEdges.h>
-#include <vtkInteractorStyleTrackballCamera.h>
-#include <vtkJPEGReader.h>
-#include <vtkLight.h>
-#include <vtkNamedColors.h>
 #include <vtkNew.h>
 #include <vtkOBJReader.h>
-#include <vtkPNGWriter.h>
-#include <vtkPolyDataMapper.h>
-#include <vtkProperty.h>
-#include <vtkRenderWindow.h>
-#include <vtkRenderWindowInteractor.h>
-#include <vtkRenderer.h>
-#include <vtkTexture.h>
-#include <vtkTransform.h>
-#include <vtkWindowToImageFilter.h>
-#include <vtkXMLPolyDataWriter.h>
-#include <vtkCylinderSource.h>
-#include <vtkPlaneSource.h>
+
+#include "BatchRenderer.h"
+#include "MeshConversion.h"
+#include "ParallelOBJReader.h"
+#include "ParameterSweep.h"
+#include "RenderDaemon.h"
+#include "RenderJob.h"
+#include "StageBenchmark.h"
+#include "ThreadPool.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
 
 namespace {
-    class vtkMyCallback : public vtkCommand { // vtkCommand — это базовый класс для всех callback'ов в VTK,
-        // который предоставляет интерфейс для выполнения действий в ответ на определенные события.
-    public:
-        static vtkMyCallback* New() { //  VTK использует свою систему управления памятью и часто требует определения
-            // такого метода для правильного создания объектов.
-            return new vtkMyCallback;
+    void PrintUsage(const char* program) {
+        std::cerr << "usage: " << program << " --batch jobs.txt [options]  offscreen batch rendering\n"
+                  << "       " << program << " --sweep sweep.txt N [options]  N jobs generated from a sweep template\n"
+                  << "       " << program << " --daemon [--socket P] [options]  serve jobs sent one per line\n"
+                  << "       " << program << " --bench-obj mesh.obj [N]    compare OBJ readers, best of N runs\n"
+                  << "       " << program << " --bench-stages [options]    time every pipeline stage separately\n"
+                  << "the interactive viewer is the separate program Tutorial_Step6_Viewer\n"
+                  << "options:\n"
+                  << "  --size WxH     output image size (default 1920x1080)\n"
+                  << "  --socket P     --daemon listens on Unix socket P instead of stdin, in --workers processes\n"
+                  << "  --warmup F     jobs rendered before --daemon accepts requests, nothing is written\n"
+                  << "  --workers N    render in N worker processes, 0 = one per core (default 1)\n"
+                  << "  --group-scenes N    group runs of N jobs by mesh and texture (default 64, 0 = list order)\n"
+                  << "  --backend B    vtk (OpenGL) or cpu (built-in rasterizer), default vtk\n"
+                  << "  --threads N    threads of the cpu backend per worker, 0 = one per core (default 0)\n"
+                  << "  --verify       render every job with both backends and check the difference\n"
+                  << "  --texture-cache MB  decoded texture cache size per worker (default 1024)\n"
+                  << "  --mesh-cache DIR    convert OBJ meshes once to memory-mapped .dmesh files in DIR\n"
+                  << "  --uvmap-format F    f32 or u16 storage of uvmap= outputs (default f32)\n"
+                  << "  --forward-map-size WxH  size of forwardmap= outputs (default: texture size)\n"
+                  << "  --supersample N     render N times larger per axis and downsample (default 1)\n"
+                  << "  --downsample F lanczos or box filter of --supersample (default lanczos)\n"
+                  << "  --tile WxH     largest render window; bigger frames are rendered in tiles (default 2048x2048)\n"
+                  << "  --encoders N   image encoding threads per worker, 0 = encode on the render thread (default 2)\n"
+                  << "  --encode-queue N    frames waiting for encoders per worker (default 4)\n"
+                  << "  --png-level N  zlib level of PNG outputs, 0-9 (default 5)\n"
+                  << "  --png-filter F none, sub, up, average, paeth or adaptive PNG row filter (default adaptive)\n"
+                  << "  --jpeg-quality Q  quality of .jpg outputs, 0-100 (default 95)\n"
+                  << "  --alpha        keep the alpha channel in PNG, QOI and raw outputs (default RGB)\n"
+                  << "  --dataset DIR  write each job's outputs and parameters as one record of .rec shards in DIR\n"
+                  << "  --shard-size MB   size of dataset shards (default 1024)\n"
+                  << "  --trace FILE   record per-stage timings as a Chrome trace (chrome://tracing, Perfetto)\n"
+                  << "  --seed S       seed of the sweep's random streams (default 0)\n"
+                  << "  --shard I/N    render only the I-th of N equal contiguous parts of the jobs (I from 0)\n"
+                  << "  --job K        render only job K and print its parameters\n"
+                  << "stage benchmark options (with --backend, --threads):\n"
+                  << "  --bench-triangles N,N...  page mesh sizes (default 20000,200000,2000000)\n"
+                  << "  --bench-sizes WxH,WxH...  frame sizes (default 1280x720,1920x1080,3840x2160)\n"
+                  << "  --bench-repeats N   samples of fast stages, a quarter for loads and first frames (default 20)\n"
+                  << "  --bench-texture F   texture to decode and render (default ../chess.jpeg)\n"
+                  << "  --bench-out F       save the results as JSON\n"
+                  << "  --bench-baseline F  compare the medians with an earlier --bench-out\n"
+                  << "  --bench-tolerance X allowed median growth over the baseline (default 0.15)\n";
+    }
+
+    // Лучшее из repeats время чтения файла свежим читателем (старый читатель не перечитал бы тот же файл).
+    template <typename Reader>
+    double TimeObjReader(const char* path, int repeats, MeshBuffers& mesh) {
+        double best = 0.0;
+        for (int i = 0; i < repeats; ++i) {
+            vtkNew<Reader> reader;
+            reader->SetFileName(path);
+            const auto start = std::chrono::steady_clock::now();
+            reader->Update();
+            const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            best = i == 0 ? seconds : std::min(best, seconds);
+            if (i + 1 == repeats) {
+                MeshFromPolyData(reader->GetOutput(), mesh);
+            }
+        }
+        return best;
+    }
+
+    // Число треугольников, углы которых различаются координатами, UV или нормалями. Точки у читателей разные
+    // (ParallelOBJReader не дублирует их по углам, см. ParseObjFile), поэтому сравниваются не массивы точек,
+    // а треугольники в порядке файла: оба разбивают грани веером одинаково.
+    std::size_t CountDifferentTriangles(const MeshBuffers& a, const MeshBuffers& b) {
+        const std::size_t triangles = std::max(a.GetTriangleCount(), b.GetTriangleCount());
+        if (a.GetTriangleCount() != b.GetTriangleCount() || a.U.empty() != b.U.empty() ||
+            a.NX.empty() != b.NX.empty()) {
+            return triangles;
+        }
+        // Числа разбирают разные парсеры, поэтому допускается расхождение в последних битах.
+        const auto same = [](const std::vector<float>& x, std::size_t i, const std::vector<float>& y, std::size_t j) {
+            return std::fabs(x[i] - y[j]) <= 1e-5f * std::max(1.0f, std::fabs(x[i]));
+        };
+        std::size_t different = 0;
+        for (std::size_t t = 0; t < triangles; ++t) {
+            bool equal = true;
+            for (std::size_t k = 3 * t; equal && k < 3 * t + 3; ++k) {
+                const std::size_t i = a.Indices[k];
+                const std::size_t j = b.Indices[k];
+                equal = same(a.X, i, b.X, j) && same(a.Y, i, b.Y, j) && same(a.Z, i, b.Z, j) &&
+                        (a.U.empty() || (same(a.U, i, b.U, j) && same(a.V, i, b.V, j))) &&
+                        (a.NX.empty() || (same(a.NX, i, b.NX, j) && same(a.NY, i, b.NY, j) && same(a.NZ, i, b.NZ, j)));
+            }
+            different += equal ? 0 : 1;
+        }
+        return different;
+    }
+
+    // Сравнивает vtkOBJReader и ParallelOBJReader на одном файле: время и получившуюся сетку.
+    int RunObjBenchmark(const char* path, int repeats) {
+        MeshBuffers stock, parallel;
+        const double stockSeconds = TimeObjReader<vtkOBJReader>(path, repeats, stock);
+        const double parallelSeconds = TimeObjReader<ParallelOBJReader>(path, repeats, parallel);
+
+        std::cout << "vtkOBJReader:      " << stockSeconds << " s, " << stock.GetPointCount() << " points, "
+                  << stock.GetTriangleCount() << " triangles\n"
+                  << "ParallelOBJReader: " << parallelSeconds << " s, " << parallel.GetPointCount() << " points, "
+                  << parallel.GetTriangleCount() << " triangles, " << ThreadPool::Instance().GetThreadCount()
+                  << " threads\n";
+        if (parallelSeconds > 0.0) {
+            std::cout << "speedup: " << stockSeconds / parallelSeconds << "x" << std::endl;
+        }
+        const std::size_t different = CountDifferentTriangles(stock, parallel);
+        if (different == 0) {
+            std::cout << "geometry: all triangles match (positions, UVs and normals)" << std::endl;
+        } else {
+            std::cout << "geometry: " << different << " of " << stock.GetTriangleCount()
+                      << " triangles differ" << std::endl;
+        }
+        return different == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Замер стадий конвейера: размеры сеток и кадров перечисляются через запятую.
+    int RunStageBenchmarkCommand(int argc, char* argv[]) {
+        StageBenchmarkOptions options;
+        for (int i = 2; i < argc; ++i) {
+            const bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--bench-triangles") == 0 && hasValue) {
+                options.Triangles.clear();
+                for (const char* item = argv[++i]; *item != '\0';) {
+                    char* end = nullptr;
+                    const long triangles = std::strtol(item, &end, 10);
+                    if (triangles <= 0) {
+                        PrintUsage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    options.Triangles.push_back(triangles);
+                    item = *end == ',' ? end + 1 : end + std::strlen(end);
+                }
+            } else if (std::strcmp(argv[i], "--bench-sizes") == 0 && hasValue) {
+                options.Sizes.clear();
+                for (const char* item = argv[++i]; item != nullptr;) {
+                    int width = 0;
+                    int height = 0;
+                    if (std::sscanf(item, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                        PrintUsage(argv[0]);
+                        return EXIT_FAILURE;
+                    }
+                    options.Sizes.emplace_back(width, height);
+                    item = std::strchr(item, ',');
+                    item = item != nullptr ? item + 1 : nullptr;
+                }
+            } else if (std::strcmp(argv[i], "--bench-repeats") == 0 && hasValue) {
+                options.Repeats = std::max(1, std::atoi(argv[++i]));
+            } else if (std::strcmp(argv[i], "--bench-texture") == 0 && hasValue) {
+                options.Texture = argv[++i];
+            } else if (std::strcmp(argv[i], "--bench-out") == 0 && hasValue) {
+                options.OutputPath = argv[++i];
+            } else if (std::strcmp(argv[i], "--bench-baseline") == 0 && hasValue) {
+                options.BaselinePath = argv[++i];
+            } else if (std::strcmp(argv[i], "--bench-tolerance") == 0 && hasValue) {
+                options.Tolerance = std::atof(argv[++i]);
+            } else if (std::strcmp(argv[i], "--backend") == 0 && hasValue &&
+                       ParseRenderBackend(argv[++i], options.Backend)) {
+                continue;
+            } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+                ThreadPool::SetDefaultThreadCount(std::atoi(argv[++i]));
+            } else {
+                PrintUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        return RunStageBenchmark(options);
+    }
+
+    // Пакетный режим: читает список заданий или шаблон перебора и рендерит их без окна и интерактора.
+    int RunBatchCommand(int argc, char* argv[]) {
+        std::string jobsPath;
+        std::string sweepPath;
+        unsigned long long sweepCount = 0;
+        unsigned long long seed = 0;
+        unsigned long long shard[2] = {0, 1};
+        long long singleJob = -1;
+        bool daemonMode = false;
+        DaemonOptions daemon;
+        BatchOptions options;
+        for (int i = 1; i < argc; ++i) {
+            const bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--batch") == 0 && hasValue) {
+                jobsPath = argv[++i];
+            } else if (std::strcmp(argv[i], "--sweep") == 0 && i + 2 < argc) {
+                sweepPath = argv[++i];
+                sweepCount = std::strtoull(argv[++i], nullptr, 10);
+            } else if (std::strcmp(argv[i], "--daemon") == 0) {
+                daemonMode = true;
+            } else if (std::strcmp(argv[i], "--socket") == 0 && hasValue) {
+                daemon.SocketPath = argv[++i];
+            } else if (std::strcmp(argv[i], "--warmup") == 0 && hasValue) {
+                daemon.WarmupPath = argv[++i];
+            } else if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+                seed = std::strtoull(argv[++i], nullptr, 10);
+            } else if (std::strcmp(argv[i], "--shard") == 0 && hasValue &&
+                       std::sscanf(argv[++i], "%llu/%llu", &shard[0], &shard[1]) == 2 && shard[0] < shard[1]) {
+                continue;
+            } else if (std::strcmp(argv[i], "--job") == 0 && hasValue) {
+                singleJob = std::atoll(argv[++i]);
+            } else if (std::strcmp(argv[i], "--size") == 0 && hasValue &&
+                       std::sscanf(argv[++i], "%dx%d", &options.Width, &options.Height) == 2) {
+                continue;
+            } else if (std::strcmp(argv[i], "--workers") == 0 && hasValue) {
+                options.Workers = std::atoi(argv[++i]);
+                if (options.Workers <= 0) {
+                    options.Workers = static_cast<int>(std::thread::hardware_concurrency());
+                }
+            } else if (std::strcmp(argv[i], "--group-scenes") == 0 && hasValue) {
+                options.GroupWindow = static_cast<std::size_t>(std::max(0, std::atoi(argv[++i])));
+            } else if (std::strcmp(argv[i], "--backend") == 0 && hasValue &&
+                       ParseRenderBackend(argv[++i], options.Backend)) {
+                continue;
+            } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+                ThreadPool::SetDefaultThreadCount(std::atoi(argv[++i]));
+            } else if (std::strcmp(argv[i], "--texture-cache") == 0 && hasValue) {
+                options.TextureCacheBytes = static_cast<std::size_t>(std::atol(argv[++i])) * 1024 * 1024;
+            } else if (std::strcmp(argv[i], "--mesh-cache") == 0 && hasValue) {
+                options.MeshCacheDirectory = argv[++i];
+            } else if (std::strcmp(argv[i], "--uvmap-format") == 0 && hasValue &&
+                       ParseUVMapEncoding(argv[++i], options.UVEncoding)) {
+                continue;
+            } else if (std::strcmp(argv[i], "--forward-map-size") == 0 && hasValue &&
+                       std::sscanf(argv[++i], "%dx%d", &options.ForwardMapWidth, &options.ForwardMapHeight) == 2) {
+                continue;
+            } else if (std::strcmp(argv[i], "--supersample") == 0 && hasValue) {
+                options.Capture.Supersample = std::atoi(argv[++i]);
+            } else if (std::strcmp(argv[i], "--downsample") == 0 && hasValue &&
+                       ParseDownsampleFilter(argv[++i], options.Capture.Filter)) {
+                continue;
+            } else if (std::strcmp(argv[i], "--tile") == 0 && hasValue &&
+                       std::sscanf(argv[++i], "%dx%d", &options.Capture.TileWidth, &options.Capture.TileHeight) == 2) {
+                continue;
+            } else if (std::strcmp(argv[i], "--encoders") == 0 && hasValue) {
+                options.Encoders = std::atoi(argv[++i]);
+            } else if (std::strcmp(argv[i], "--encode-queue") == 0 && hasValue) {
+                options.EncodeQueue = static_cast<std::size_t>(std::max(1, std::atoi(argv[++i])));
+            } else if (std::strcmp(argv[i], "--png-level") == 0 && hasValue) {
+                options.Encoding.PngLevel = std::atoi(argv[++i]);
+            } else if (std::strcmp(argv[i], "--png-filter") == 0 && hasValue &&
+                       ParsePngFilter(argv[++i], options.Encoding.Filter)) {
+                continue;
+            } else if (std::strcmp(argv[i], "--jpeg-quality") == 0 && hasValue) {
+                options.Encoding.JpegQuality = std::atoi(argv[++i]);
+            } else if (std::strcmp(argv[i], "--alpha") == 0) {
+                options.Encoding.Alpha = true;
+            } else if (std::strcmp(argv[i], "--dataset") == 0 && hasValue) {
+                options.DatasetDirectory = argv[++i];
+            } else if (std::strcmp(argv[i], "--shard-size") == 0 && hasValue) {
+                options.DatasetShardBytes = static_cast<std::uint64_t>(std::max(1, std::atoi(argv[++i]))) << 20;
+            } else if (std::strcmp(argv[i], "--trace") == 0 && hasValue) {
+                options.TracePath = argv[++i];
+            } else if (std::strcmp(argv[i], "--verify") == 0) {
+                options.Verify = true;
+            } else {
+                PrintUsage(argv[0]);
+                return EXIT_FAILURE;
+            }
+        }
+        if (static_cast<int>(!jobsPath.empty()) + static_cast<int>(!sweepPath.empty()) + static_cast<int>(daemonMode) !=
+            1) {
+            PrintUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+        if (!options.TracePath.empty() && !Tracer::IsCompiledIn()) {
+            std::cerr << "--trace needs a build with DOCRENDER_TRACE (cmake -DDOCRENDER_TRACE=ON)" << std::endl;
+            return EXIT_FAILURE;
+        }
+        if (daemonMode) {
+            // Служба отвечает, когда вывод задания уже на диске, поэтому пишет его сама, без конвейера.
+            if (!options.DatasetDirectory.empty() || options.Verify) {
+                std::cerr << "--dataset and --verify are batch-only options" << std::endl;
+                return EXIT_FAILURE;
+            }
+            return RunDaemon(options, daemon);
         }
-        void Execute(vtkObject* caller, unsigned long, void*) override { // Перегруженный метод Execute, который будет
-            // вызван, когда срабатывает событие, к которому vtkMyCallback подписан
-
-            vtkNew<vtkTransform> t; // используется для хранения информации о трансформации (позиции, повороте, масштабе)
-
-            auto widget = reinterpret_cast<vtkBoxWidget*>(caller); // vtkBoxWidget позволяет
-            // интерактивно манипулировать объектом (перемещать, вращать, масштабировать) в 3D пространстве.
-
-            widget->GetTransform(t); // извлекается текущая трансформация - процесс изменения позиции, ориентации или размера объекта
 
-            widget->GetProp3D()->SetUserTransform(t); // трансформация применяется к связанному с ним 3D объекту,
-            // то есть изменения, заданные в vtkTransform фактически применяются к объекту, изменяя его положение, ориентацию или размер в сцене.
+        // Перебор не хранит заданий: каждое строится по номеру, в том числе в рабочих процессах.
+        std::vector<RenderJob> list;
+        ParameterSweep sweep;
+        JobSource jobs;
+        std::string error;
+        if (!sweepPath.empty()) {
+            sweep.SetSeed(seed);
+            if (!sweep.Load(sweepPath, error)) {
+                std::cerr << error << std::endl;
+                return EXIT_FAILURE;
+            }
+            jobs.Count = static_cast<std::size_t>(sweepCount);
+            jobs.Get = [&sweep](std::size_t index, RenderJob& job, std::string& jobError) {
+                return sweep.GetJob(index, job, jobError);
+            };
+            jobs.Meshes = sweep.GetMeshes();
+        } else {
+            if (!ReadRenderJobs(jobsPath, list, error)) {
+                std::cerr << error << std::endl;
+                return EXIT_FAILURE;
+            }
+            jobs = JobsFromList(list);
+        }
 
+        if (singleJob >= 0) {
+            if (static_cast<unsigned long long>(singleJob) >= jobs.Count) {
+                std::cerr << "job " << singleJob << " is out of range, there are " << jobs.Count << std::endl;
+                return EXIT_FAILURE;
+            }
+            if (!sweepPath.empty()) {
+                std::cout << sweep.GetJobLine(static_cast<std::uint64_t>(singleJob)) << std::endl;
+            }
+            jobs = SliceJobs(jobs, static_cast<std::size_t>(singleJob), 1);
+        } else if (shard[1] > 1) {
+            const std::size_t first = static_cast<std::size_t>(jobs.Count * shard[0] / shard[1]);
+            const std::size_t last = static_cast<std::size_t>(jobs.Count * (shard[0] + 1) / shard[1]);
+            jobs = SliceJobs(jobs, first, last - first);
+            // Части пакета могут писать набор данных в один каталог, не пересекаясь по именам шардов.
+            options.DatasetPrefix = "part" + std::to_string(shard[0]);
         }
-    };
+        return RunBatch(jobs, options);
+    }
 }
 
-int main(int, char*[]) {
-    vtkNew<vtkNamedColors> colors; // Создается объект для управления цветами, который предоставляет доступ к предопределенным цветам.
-
-    vtkNew<vtkOBJReader> objReader; // Создается объект для чтения 3D-модели из файла
-    objReader->SetFileName("/home/aleksandr/CLionProjects/individual/mesh.obj");
-
-    // Создание источника плоскости
-    vtkNew<vtkPlaneSource> planeSource;
-    planeSource->SetOrigin(0.0, 0.0, 0.0);
-    planeSource->SetPoint1(0.913, 0.0, 0.0);
-    planeSource->SetPoint2(0.0, 1.291, 0.0);
-    planeSource->SetCenter(0.0, 0.0, 0.0);
-    planeSource->Update();
-
-    // Создание трансформации для изгиба плоскости
-    vtkNew<vtkTransform> transform;
-    transform->PostMultiply(); // Для применения масштабирования после остальных трансформаций
-    transform->RotateX(45); // Поворот плоскости, чтобы создать эффект изгиба
-
-    // Создается маппер (mapper), который преобразует полигональные данные, полученные от objReader,
-    // в графические примитивы, которые можно отрисовать на экране.
-    vtkNew<vtkPolyDataMapper> mapper;
-    mapper->SetInputConnection(objReader->GetOutputPort());
-    mapper->SetInputConnection(planeSource->GetOutputPort());
-
-    // Создается объект для чтения изображения в формате JPEG, которое будет использоваться как текстура.
-    vtkNew<vtkJPEGReader> jpegReader;
-    jpegReader->SetFileName("../chess.jpeg");
-
-    // Создается текстура и ей устанавливается источник данных - выходной поток jpegReader.
-    vtkNew<vtkTexture> texture;
-    texture->SetInputConnection(jpegReader->GetOutputPort());
-
-    // Создается актор (actor), который представляет собой элемент визуализации в сцене.
-    // Актору назначается маппер для геометрии и текстура для внешнего вида.
-    vtkNew<vtkActor> actor;
-    actor->SetMapper(mapper);
-    actor->SetTexture(texture);
-    actor->SetUserTransform(transform);
-
-    // Создается рендерер (renderer), который управляет тем, как сцена отображается.
-    // В рендерер добавляется актор, и устанавливается цвет фона сцены.
-    vtkNew<vtkRenderer> ren1;
-    ren1->AddActor(actor);
-    ren1->SetBackground(colors->GetColor3d("MidnightBlue").GetData());
-
-    // Создается новый объект камеры, который определяет точку зрения, с которой будет производиться рендеринг сцены.
-    vtkNew<vtkCamera> camera;
-    camera->SetPosition(0, -1.5, 2);
-    camera->SetFocalPoint(actor->GetPosition()); // камера направлена на положение актора в сцене, то есть то место, где расположен объект.
-    camera->SetViewUp(0, 1, 0);
-    ren1->SetActiveCamera(camera); // созданная камера назначается активной для рендерера ren1,
-    // который затем будет использовать ее для определения, как должна выглядеть сцена.
-
-    vtkNew<vtkLight> light; // Создается новый объект света, который будет освещать сцену.
-
-    light->SetLightTypeToSceneLight(); // Устанавливается тип света как "сценический свет", что означает,
-    // что свет будет рассматриваться как часть сцены и будет влиять на объекты внутри нее.
-
-    light->SetPosition(0.1, -1.2, 2.1); // Задается положение источника света в пространстве сцены.
-
-    light->SetPositional(true); // Указывает, что свет является позиционным (в отличие от направленного),
-    // что означает, что он будет иметь определенное положение и характеристики, такие как затухание и конус света.
-
-    light->SetConeAngle(30); // Устанавливается угол конуса для позиционного света, что влияет на распространение света от источника.
-
-    light->SetFocalPoint(actor->GetPosition()); // Задается точка, на которую направлен свет.
-    // Она совпадает с положением актора, так что свет будет направлен на объект.
-
-    light->SetDiffuseColor(colors->GetColor3d("White").GetData()); // Определяется основной цвет света, который будет влиять на объекты в сцене.
-    light->SetAmbientColor(colors->GetColor3d("Gray").GetData()); // Устанавливается цвет окружающего света, который определяет интенсивность света, рассеянного во всех направлениях.
-    light->SetSpecularColor(colors->GetColor3d("White").GetData()); // Устанавливается цвет бликов света, которые появляются на более глянцевых поверхностях.
-
-    light->SetAmbientColor(1.0, 1.0, 1.0); // теперь сцена равномерно освещается белым, но этого не видно(
-
-    ren1->AddLight(light); // Добавляется источник света к рендереру, что позволяет ему влиять на внешний вид сцены.
-
-    vtkNew<vtkRenderWindow> renWin; // окно для рендеринга 3D сцены.
-    renWin->AddRenderer(ren1); // К окну рендеринга добавляется рендерер ren1. Рендерер управляет тем, как сцена отображается в окне.
-    renWin->SetSize(1920, 1080); // размер окна рендеринга
-    renWin->SetWindowName("Tutorial_Step6"); // название окна
-
-    // Интерактор обрабатывает ввод пользователя (например, движения мыши, клики, нажатия клавиш) и переводит его в действия в окне рендеринга.
-    vtkNew<vtkRenderWindowInteractor> iren;
-    iren->SetRenderWindow(renWin); // Интерактору назначается окно рендеринга, с которым он будет взаимодействовать.
-
-    // Создается объект style класса vtkInteractorStyleTrackballCamera, который определяет стиль взаимодействия
-    // пользователя с камерой. В данном случае это "trackball" стиль, который позволяет камере вращаться вокруг объекта,
-    // как если бы объект находился внутри виртуального шара (trackball), и пользователь мог вращать этот шар мышью.
-    vtkNew<vtkInteractorStyleTrackballCamera> style;
-    iren->SetInteractorStyle(style);
-
-    // Создается новый объект featureEdges, который будет использоваться для выделения границ на полигональной модели
-    vtkNew<vtkFeatureEdges> featureEdges;
-
-    // featureEdges настраивается на прием данных с выходного порта objReader, который читает 3D модель из файла.
-    featureEdges->SetInputConnection(objReader->GetOutputPort());
-
-    // Включает выделение граничных ребер модели. Это ребра, которые присутствуют только на одной грани полигональной сетки.
-    featureEdges->BoundaryEdgesOn();
-
-    // Отключает выделение особых ребер (feature edges), которые обычно отличаются по углу между смежными гранями.
-    featureEdges->FeatureEdgesOff();
-
-    // Отключает выделение ребер, которые не являются многообразными (non-manifold edges), то есть ребер, имеющих более двух смежных граней.
-    featureEdges->NonManifoldEdgesOff();
-
-    // Отключает выделение многообразных ребер (manifold edges), которые обычно имеют ровно две смежные грани.
-    featureEdges->ManifoldEdgesOff();
-
-    // Создается новый маппер edgeMapper, который будет использоваться для отображения данных о выделенных границах.
-    vtkNew<vtkPolyDataMapper> edgeMapper;
-
-    // edgeMapper настраивается на прием данных с выходного порта featureEdges, который содержит информацию о выделенных ребрах модели.
-    edgeMapper->SetInputConnection(featureEdges->GetOutputPort());
-
-    // Создается новый актер edgeActor, который будет использоваться для отображения выделенных ребер в сцене.
-    vtkNew<vtkActor> edgeActor;
-    edgeActor->SetMapper(edgeMapper);
-    edgeActor->GetProperty()->SetColor(colors->GetColor3d("Red").GetData());
-    ren1->AddActor(edgeActor);
-
-    // Создается новый экземпляр vtkBoxWidget. Этот виджет представляет собой манипулятор в виде трехмерного
-    // прямоугольного ящика, который может быть использован для вращения, перемещения и масштабирования объекта.
-    vtkNew<vtkBoxWidget> boxWidget;
-    boxWidget->SetInteractor(iren);
-    boxWidget->SetPlaceFactor(1.25); // виджет будет на 25% больше, чем ограничивающий прямоугольник объекта.
-    boxWidget->GetOutlineProperty()->SetColor(colors->GetColor3d("Gold").GetData());
-
-    // Виджет связывается с actor, что позволяет ему контролировать положение и ориентацию объекта.
-    boxWidget->SetProp3D(actor);
-    // Размещает виджет в сцене в соответствии с текущими размерами и позицией связанного объекта.
-    boxWidget->PlaceWidget();
-
-    // Виджет подписывается на события интеракции с помощью созданного callback.
-    // Это значит, что каждый раз при взаимодействии с виджетом будет вызываться метод Execute класса vtkMyCallback.
-    vtkNew<vtkMyCallback> callback;
-    boxWidget->AddObserver(vtkCommand::InteractionEvent, callback);
-
-    // Включает виджет, делая его активным и видимым в сцене для взаимодействия с пользователем
-    boxWidget->On();
-
-    // Инициализация интерактора и начало цикла рендеринга
-    iren->Initialize();
-
-    // делает скриншот
-    vtkNew<vtkWindowToImageFilter> windowToImageFilter;
-    windowToImageFilter->SetInput(renWin);
-    windowToImageFilter->SetScale(1); // устанавливает масштаб
-    windowToImageFilter->SetInputBufferTypeToRGBA(); // захват альфа-канала (прозрачность)
-    windowToImageFilter->ReadFrontBufferOff(); // Чтение из заднего буфера, так как окно не отображается
-    windowToImageFilter->Update();
-
-    vtkNew<vtkPNGWriter> pngWriter;
-    pngWriter->SetFileName("../screenshot.png");
-    pngWriter->SetInputConnection(windowToImageFilter->GetOutputPort());
-    pngWriter->Write();
-
-    // Экспорт данных геометрии
-    vtkNew<vtkXMLPolyDataWriter> polyDataWriter;
-    polyDataWriter->SetFileName("../mesh.vtp");
-    polyDataWriter->SetInputConnection(objReader->GetOutputPort());
-    polyDataWriter->Write();
-
-    // Начать взаимодействие
-    iren->Start();
-
-
-    return EXIT_SUCCESS;
-}
\ No newline at end of file
+int main(int argc, char* argv[]) {
+    if (argc > 2 && std::strcmp(argv[1], "--bench-obj") == 0) {
+        return RunObjBenchmark(argv[2], argc > 3 ? std::max(1, std::atoi(argv[3])) : 3);
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--bench-stages") == 0) {
+        return RunStageBenchmarkCommand(argc, argv);
+    }
+    return RunBatchCommand(argc, argv);
+}
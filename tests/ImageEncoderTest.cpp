@@ -0,0 +1,257 @@
+#include "ImageEncoder.h"
+#include "TestSupport.h"
+
+#include <vtk_zlib.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    std::uint32_t GetBigEndian(const unsigned char* in) {
+        return static_cast<std::uint32_t>(in[0]) << 24 | static_cast<std::uint32_t>(in[1]) << 16 |
+               static_cast<std::uint32_t>(in[2]) << 8 | in[3];
+    }
+
+    // Кадр, на котором встречаются все приемы кодировщиков: пологий и крутой градиенты (малые и средние разности
+    // QOI, фильтры PNG), шум (полные цвета), одноцветные полосы (серии), повторы цветов (индекс QOI)
+    // и переменная альфа.
+    std::vector<unsigned char> MakeFrame(int width, int height, int channels) {
+        std::vector<unsigned char> pixels(static_cast<std::size_t>(width) * height * channels);
+        unsigned state = 12345;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                unsigned char* p = pixels.data() + (static_cast<std::size_t>(y) * width + x) * channels;
+                state = state * 1103515245u + 12345u;
+                if (y % 7 == 3) {
+                    p[0] = p[1] = p[2] = 200;
+                } else if (x < width / 4) {
+                    p[0] = static_cast<unsigned char>(x + y);
+                    p[1] = static_cast<unsigned char>(x - y);
+                    p[2] = static_cast<unsigned char>(x % 3 == 0 ? x : x - 2);
+                } else if (x < width / 2) {
+                    p[0] = static_cast<unsigned char>(x * 3);
+                    p[1] = static_cast<unsigned char>(y * 2 + x);
+                    p[2] = static_cast<unsigned char>(x + y);
+                } else if (x % 5 == 0) {
+                    p[0] = 10;
+                    p[1] = 20;
+                    p[2] = 30;
+                } else {
+                    p[0] = static_cast<unsigned char>(state >> 24);
+                    p[1] = static_cast<unsigned char>(state >> 16);
+                    p[2] = static_cast<unsigned char>(state >> 8);
+                }
+                if (channels == 4) {
+                    p[3] = static_cast<unsigned char>(x % 9 == 0 ? 255 - y : 255);
+                }
+            }
+        }
+        return pixels;
+    }
+
+    // Ожидаемое содержимое файла: строки сверху вниз и outputChannels каналов.
+    std::vector<unsigned char> Expected(const std::vector<unsigned char>& pixels, int width, int height, int channels,
+                                        int outputChannels) {
+        std::vector<unsigned char> expected(static_cast<std::size_t>(width) * height * outputChannels);
+        for (int y = 0; y < height; ++y) {
+            CopyChannels(pixels.data() + static_cast<std::size_t>(height - 1 - y) * width * channels, channels,
+                         static_cast<std::size_t>(width),
+                         expected.data() + static_cast<std::size_t>(y) * width * outputChannels, outputChannels);
+        }
+        return expected;
+    }
+
+    int Paeth(int a, int b, int c) {
+        const int p = a + b - c;
+        const int pa = std::abs(p - a);
+        const int pb = std::abs(p - b);
+        const int pc = std::abs(p - c);
+        return pa <= pb && pa <= pc ? a : (pb <= pc ? b : c);
+    }
+
+    // Минимальный декодер PNG: 8 бит на канал, RGB или RGBA, без чередования; проверяет CRC чанков.
+    bool DecodePng(const std::vector<unsigned char>& bytes, int& width, int& height, int& channels,
+                   std::vector<unsigned char>& pixels) {
+        const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        if (bytes.size() < 8 || std::memcmp(bytes.data(), signature, 8) != 0) {
+            return false;
+        }
+        std::vector<unsigned char> compressed;
+        bool ended = false;
+        for (std::size_t position = 8; position + 12 <= bytes.size() && !ended;) {
+            const std::uint32_t size = GetBigEndian(bytes.data() + position);
+            const unsigned char* type = bytes.data() + position + 4;
+            if (position + 12 + size > bytes.size() ||
+                crc32(0L, type, size + 4) != GetBigEndian(bytes.data() + position + 8 + size)) {
+                return false;
+            }
+            const unsigned char* data = type + 4;
+            if (std::memcmp(type, "IHDR", 4) == 0) {
+                width = static_cast<int>(GetBigEndian(data));
+                height = static_cast<int>(GetBigEndian(data + 4));
+                if (data[8] != 8 || (data[9] != 2 && data[9] != 6) || data[10] != 0 || data[11] != 0 || data[12] != 0) {
+                    return false;
+                }
+                channels = data[9] == 6 ? 4 : 3;
+            } else if (std::memcmp(type, "IDAT", 4) == 0) {
+                compressed.insert(compressed.end(), data, data + size);
+            } else if (std::memcmp(type, "IEND", 4) == 0) {
+                ended = true;
+            }
+            position += 12 + size;
+        }
+        const std::size_t stride = static_cast<std::size_t>(width) * channels;
+        std::vector<unsigned char> filtered((stride + 1) * height);
+        uLongf length = static_cast<uLongf>(filtered.size());
+        const uLong compressedSize = static_cast<uLong>(compressed.size());
+        if (!ended || uncompress(filtered.data(), &length, compressed.data(), compressedSize) != Z_OK ||
+            length != filtered.size()) {
+            return false;
+        }
+        pixels.assign(stride * height, 0);
+        for (int y = 0; y < height; ++y) {
+            const unsigned char* in = filtered.data() + (stride + 1) * y;
+            unsigned char* row = pixels.data() + stride * y;
+            const unsigned char* above = y > 0 ? row - stride : nullptr;
+            for (std::size_t i = 0; i < stride; ++i) {
+                const int a = i >= static_cast<std::size_t>(channels) ? row[i - channels] : 0;
+                const int b = above != nullptr ? above[i] : 0;
+                const int c = above != nullptr && i >= static_cast<std::size_t>(channels) ? above[i - channels] : 0;
+                int predicted = 0;
+                switch (in[0]) {
+                case 0: predicted = 0; break;
+                case 1: predicted = a; break;
+                case 2: predicted = b; break;
+                case 3: predicted = (a + b) >> 1; break;
+                case 4: predicted = Paeth(a, b, c); break;
+                default: return false;
+                }
+                row[i] = static_cast<unsigned char>(in[1 + i] + predicted);
+            }
+        }
+        return true;
+    }
+
+    // Декодер QOI 1.0 по спецификации qoiformat.org.
+    bool DecodeQoi(const std::vector<unsigned char>& bytes, int& width, int& height, int& channels,
+                   std::vector<unsigned char>& pixels) {
+        const unsigned char end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+        if (bytes.size() < 22 || std::memcmp(bytes.data(), "qoif", 4) != 0 ||
+            std::memcmp(bytes.data() + bytes.size() - 8, end, 8) != 0) {
+            return false;
+        }
+        width = static_cast<int>(GetBigEndian(bytes.data() + 4));
+        height = static_cast<int>(GetBigEndian(bytes.data() + 8));
+        channels = bytes[12];
+        const std::size_t count = static_cast<std::size_t>(width) * height;
+        pixels.assign(count * channels, 0);
+        unsigned char index[64][4] = {};
+        unsigned char pixel[4] = {0, 0, 0, 255};
+        const unsigned char* in = bytes.data() + 14;
+        const unsigned char* const last = bytes.data() + bytes.size() - 8;
+        int run = 0;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (run > 0) {
+                --run;
+            } else {
+                if (in >= last) {
+                    return false;
+                }
+                const unsigned char tag = *in++;
+                if (tag == 0xFE) {
+                    std::memcpy(pixel, in, 3);
+                    in += 3;
+                } else if (tag == 0xFF) {
+                    std::memcpy(pixel, in, 4);
+                    in += 4;
+                } else if ((tag & 0xC0) == 0x00) {
+                    std::memcpy(pixel, index[tag], 4);
+                } else if ((tag & 0xC0) == 0x40) {
+                    pixel[0] = static_cast<unsigned char>(pixel[0] + ((tag >> 4) & 3) - 2);
+                    pixel[1] = static_cast<unsigned char>(pixel[1] + ((tag >> 2) & 3) - 2);
+                    pixel[2] = static_cast<unsigned char>(pixel[2] + (tag & 3) - 2);
+                } else if ((tag & 0xC0) == 0x80) {
+                    const int dg = (tag & 0x3F) - 32;
+                    const unsigned char next = *in++;
+                    pixel[0] = static_cast<unsigned char>(pixel[0] + dg - 8 + (next >> 4));
+                    pixel[1] = static_cast<unsigned char>(pixel[1] + dg);
+                    pixel[2] = static_cast<unsigned char>(pixel[2] + dg - 8 + (next & 0x0F));
+                } else {
+                    run = tag & 0x3F;
+                }
+                std::memcpy(index[(pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64], pixel, 4);
+            }
+            std::memcpy(pixels.data() + i * channels, pixel, static_cast<std::size_t>(channels));
+        }
+        return in == last;
+    }
+
+    bool DecodeRaw(const std::vector<unsigned char>& bytes, int& width, int& height, int& channels,
+                   std::vector<unsigned char>& pixels) {
+        RawImageHeader header;
+        if (bytes.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, bytes.data(), sizeof(header));
+        width = static_cast<int>(header.Width);
+        height = static_cast<int>(header.Height);
+        channels = static_cast<int>(header.Channels);
+        const std::size_t size = static_cast<std::size_t>(width) * height * channels;
+        if (std::memcmp(header.Magic, "DOCIMAGE", 8) != 0 || header.Version != 1 ||
+            header.PixelOffset + size != bytes.size()) {
+            return false;
+        }
+        pixels.assign(bytes.begin() + static_cast<std::ptrdiff_t>(header.PixelOffset), bytes.end());
+        return true;
+    }
+
+    using Decoder = bool (*)(const std::vector<unsigned char>&, int&, int&, int&, std::vector<unsigned char>&);
+
+    void CheckRoundTrip(const ImageEncoding& encoding, ImageFormat format, Decoder decode, int channels) {
+        const int width = 67;
+        const int height = 45;
+        const std::vector<unsigned char> pixels = MakeFrame(width, height, channels);
+        ImageEncoder encoder;
+        encoder.SetEncoding(encoding);
+        std::vector<unsigned char> bytes;
+        std::string error;
+        CHECK(encoder.Encode(pixels.data(), width, height, channels, format, bytes, error));
+
+        int decodedWidth = 0, decodedHeight = 0, decodedChannels = 0;
+        std::vector<unsigned char> decoded;
+        CHECK(decode(bytes, decodedWidth, decodedHeight, decodedChannels, decoded));
+        const int outputChannels = GetOutputChannels(encoding, format, channels);
+        CHECK(decodedWidth == width && decodedHeight == height && decodedChannels == outputChannels);
+        CHECK(decoded == Expected(pixels, width, height, channels, outputChannels));
+    }
+}
+
+int main() {
+    const PngFilter filters[] = {PngFilter::None, PngFilter::Sub, PngFilter::Up, PngFilter::Average,
+                                 PngFilter::Paeth, PngFilter::Adaptive};
+    for (int channels = 3; channels <= 4; ++channels) {
+        for (bool alpha : {false, true}) {
+            ImageEncoding encoding;
+            encoding.Alpha = alpha;
+            for (PngFilter filter : filters) {
+                for (int level : {0, 5, 9}) {
+                    encoding.Filter = filter;
+                    encoding.PngLevel = level;
+                    CheckRoundTrip(encoding, ImageFormat::Png, DecodePng, channels);
+                }
+            }
+            CheckRoundTrip(encoding, ImageFormat::Qoi, DecodeQoi, channels);
+            CheckRoundTrip(encoding, ImageFormat::Raw, DecodeRaw, channels);
+        }
+    }
+
+    // Формат выбирается по расширению.
+    CHECK(ImageFormatFromPath("out/frame.qoi") == ImageFormat::Qoi);
+    CHECK(ImageFormatFromPath("frame.RAW") == ImageFormat::Raw);
+    CHECK(ImageFormatFromPath("frame.jpeg") == ImageFormat::Jpeg);
+    CHECK(ImageFormatFromPath("frame.png") == ImageFormat::Png);
+    CHECK(ImageFormatFromPath("dir.qoi/frame") == ImageFormat::Png);
+    return TEST_RESULT();
+}
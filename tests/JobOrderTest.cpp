@@ -0,0 +1,112 @@
+#include "RenderJob.h"
+#include "TestSupport.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+    // Сцены идут в порядке первого появления, задания внутри сцены — в исходном порядке.
+    void TestOrderByScene() {
+        const char* meshes[] = {"a.obj", "b.obj", "a.obj", "c.obj", "b.obj", "a.obj", "a.obj"};
+        std::vector<RenderJob> jobs(7);
+        std::vector<const RenderJob*> pointers;
+        for (std::size_t i = 0; i < jobs.size(); ++i) {
+            jobs[i].Mesh = meshes[i];
+            jobs[i].Texture = "page.png";
+            pointers.push_back(&jobs[i]);
+        }
+        // Та же сетка с другой текстурой — другая сцена.
+        jobs[6].Texture = "other.png";
+        // Непостроенное задание — своя сцена.
+        pointers[3] = nullptr;
+
+        std::vector<std::size_t> order;
+        OrderJobsByScene(pointers, order);
+        CHECK((order == std::vector<std::size_t>{0, 2, 5, 1, 4, 3, 6}));
+    }
+
+    void TestOrderKeepsSingleScene() {
+        std::vector<RenderJob> jobs(5);
+        std::vector<const RenderJob*> pointers;
+        for (RenderJob& job : jobs) {
+            pointers.push_back(&job);
+        }
+        std::vector<std::size_t> order;
+        OrderJobsByScene(pointers, order);
+        CHECK((order == std::vector<std::size_t>{0, 1, 2, 3, 4}));
+
+        OrderJobsByScene({}, order);
+        CHECK(order.empty());
+    }
+
+    // Каждый номер выполняется ровно один раз, отрезки не длиннее grain, неудачи суммируются по рабочим.
+    void TestWorkerPoolBatches() {
+        const std::size_t count = 23;
+        const std::size_t grain = 5;
+        void* shared = mmap(nullptr, sizeof(std::atomic<int>) * (count + 1), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        CHECK(shared != MAP_FAILED);
+        if (shared == MAP_FAILED) {
+            return;
+        }
+        auto* runs = new (shared) std::atomic<int>[count + 1]();
+        std::atomic<int>& longBatches = runs[count];
+
+        const std::vector<WorkerReport> reports =
+            RunWorkerPool(3, count, grain, [&](int, std::size_t begin, std::size_t end) {
+                if (end - begin > grain || begin % grain != 0) {
+                    ++longBatches;
+                }
+                for (std::size_t i = begin; i < end; ++i) {
+                    ++runs[i];
+                }
+                return begin == 0 ? 1L : 0L;
+            });
+
+        long done = 0, failed = 0;
+        for (const WorkerReport& report : reports) {
+            CHECK(!report.Crashed);
+            done += report.Jobs;
+            failed += report.Failed;
+        }
+        CHECK(done == static_cast<long>(count));
+        CHECK(failed == 1);
+        CHECK(longBatches.load() == 0);
+        for (std::size_t i = 0; i < count; ++i) {
+            CHECK(runs[i].load() == 1);
+        }
+        munmap(shared, sizeof(std::atomic<int>) * (count + 1));
+    }
+
+    // Рабочий, вышедший посреди работы (как при exit внутри VTK), считается упавшим, даже с кодом 1.
+    void TestWorkerPoolCrash() {
+        for (int code : {1, 7}) {
+            const std::vector<WorkerReport> reports =
+                RunWorkerPool(2, 8, 1, [code](int, std::size_t begin, std::size_t) {
+                    if (begin == 0) {
+                        _exit(code);
+                    }
+                    return 0L;
+                });
+            int crashed = 0;
+            for (const WorkerReport& report : reports) {
+                crashed += report.Crashed ? 1 : 0;
+            }
+            CHECK(crashed == 1);
+        }
+    }
+}
+
+int main() {
+    TestOrderByScene();
+    TestOrderKeepsSingleScene();
+    TestWorkerPoolBatches();
+    TestWorkerPoolCrash();
+    return TEST_RESULT();
+}
@@ -0,0 +1,152 @@
+#include "MeshFile.h"
+#include "TestSupport.h"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+    // Квадрат из двух треугольников с текстурными координатами и нормалями.
+    MeshBuffers MakeSquare() {
+        MeshBuffers mesh;
+        mesh.Resize(4, true, true);
+        const float x[] = {0.0f, 1.0f, 1.0f, 0.0f};
+        const float y[] = {0.0f, 0.0f, 2.0f, 2.0f};
+        for (std::size_t i = 0; i < 4; ++i) {
+            mesh.X[i] = x[i];
+            mesh.Y[i] = y[i];
+            mesh.Z[i] = 0.5f;
+            mesh.U[i] = x[i];
+            mesh.V[i] = y[i] / 2.0f;
+            mesh.NZ[i] = 1.0f;
+        }
+        mesh.Indices = {0, 1, 2, 0, 2, 3};
+        return mesh;
+    }
+
+    bool SameArray(const float* a, const std::vector<float>& b) {
+        return a != nullptr && std::memcmp(a, b.data(), b.size() * sizeof(float)) == 0;
+    }
+
+    // Перезаписывает байты файла на месте, как это сделал бы сбой диска.
+    void Patch(const std::string& path, std::uint64_t offset, const void* data, std::size_t size) {
+        std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    }
+
+    void TestRoundTrip() {
+        test::TemporaryDirectory directory;
+        const std::string path = directory.GetPath() + "/square.dmesh";
+        const MeshBuffers source = MakeSquare();
+        std::string error;
+        CHECK(WriteMeshFile(path, source.GetView(), error));
+
+        std::shared_ptr<MappedMesh> mesh = MappedMesh::Open(path, error);
+        CHECK(mesh != nullptr);
+        if (!mesh) {
+            return;
+        }
+        CHECK(mesh->Verify());
+        const MeshFileHeader& header = mesh->GetHeader();
+        CHECK(header.PointCount == 4);
+        CHECK(header.TriangleCount == 2);
+        CHECK(header.Bounds[0] == 0.0f && header.Bounds[1] == 1.0f);
+        CHECK(header.Bounds[2] == 0.0f && header.Bounds[3] == 2.0f);
+        CHECK(header.Bounds[4] == 0.5f && header.Bounds[5] == 0.5f);
+        for (int s = 0; s < MeshFileHeader::SectionCount; ++s) {
+            CHECK(header.Offsets[s] % 64 == 0);
+        }
+
+        const MeshView view = mesh->GetView();
+        CHECK(view.PointCount == 4);
+        CHECK(view.TriangleCount == 2);
+        CHECK(view.HasTCoords() && view.HasNormals());
+        CHECK(SameArray(view.X, source.X) && SameArray(view.Y, source.Y) && SameArray(view.Z, source.Z));
+        CHECK(SameArray(view.U, source.U) && SameArray(view.V, source.V));
+        CHECK(SameArray(view.NX, source.NX) && SameArray(view.NY, source.NY) && SameArray(view.NZ, source.NZ));
+        CHECK(view.Indices != nullptr &&
+              std::memcmp(view.Indices, source.Indices.data(), 6 * sizeof(std::uint32_t)) == 0);
+        const auto* cells = static_cast<const std::int32_t*>(mesh->GetSection(MeshFileHeader::SectionCellOffsets));
+        CHECK(cells != nullptr && cells[0] == 0 && cells[1] == 3 && cells[2] == 6);
+    }
+
+    void TestWithoutAttributes() {
+        test::TemporaryDirectory directory;
+        const std::string path = directory.GetPath() + "/plain.dmesh";
+        MeshBuffers source = MakeSquare();
+        source.Resize(4, false, false);
+        std::string error;
+        CHECK(WriteMeshFile(path, source.GetView(), error));
+        std::shared_ptr<MappedMesh> mesh = MappedMesh::Open(path, error);
+        CHECK(mesh != nullptr);
+        if (mesh) {
+            CHECK(!mesh->GetView().HasTCoords() && !mesh->GetView().HasNormals());
+            CHECK(mesh->GetSection(MeshFileHeader::SectionU) == nullptr);
+        }
+    }
+
+    // Индекс за пределами точек и испорченные координаты отвергаются при открытии с проверкой;
+    // обычное открытие содержимого не читает и видит только заголовок и границы разделов.
+    void TestCorruption() {
+        test::TemporaryDirectory directory;
+        const std::string path = directory.GetPath() + "/square.dmesh";
+        std::string error;
+        CHECK(WriteMeshFile(path, MakeSquare().GetView(), error));
+        std::shared_ptr<MappedMesh> mesh = MappedMesh::Open(path, error);
+        CHECK(mesh != nullptr);
+        if (!mesh) {
+            return;
+        }
+        const MeshFileHeader header = mesh->GetHeader();
+        mesh.reset();
+        const std::vector<unsigned char> original = test::ReadFile(path);
+
+        const std::uint32_t outOfRange = 4;
+        Patch(path, header.Offsets[MeshFileHeader::SectionIndices] + sizeof(std::uint32_t), &outOfRange,
+              sizeof(outOfRange));
+        CHECK(MappedMesh::Open(path, error) != nullptr);
+        error.clear();
+        CHECK(MappedMesh::Open(path, error, true) == nullptr);
+        CHECK(!error.empty());
+
+        Patch(path, 0, original.data(), original.size());
+        const float moved = 3.0f;
+        Patch(path, header.Offsets[MeshFileHeader::SectionY], &moved, sizeof(moved));
+        error.clear();
+        CHECK(MappedMesh::Open(path, error, true) == nullptr);
+        CHECK(!error.empty());
+
+        Patch(path, 0, original.data(), original.size());
+        CHECK(MappedMesh::Open(path, error, true) != nullptr);
+
+        // Обрезанный файл: раздел выходит за конец.
+        std::ofstream(path, std::ios::binary | std::ios::trunc)
+            .write(reinterpret_cast<const char*>(original.data()), static_cast<std::streamsize>(original.size() / 2));
+        error.clear();
+        CHECK(MappedMesh::Open(path, error) == nullptr);
+        CHECK(!error.empty());
+
+        CHECK(MappedMesh::Open(directory.GetPath() + "/missing.dmesh", error) == nullptr);
+    }
+
+    void TestWriteRejectsBadIndex() {
+        test::TemporaryDirectory directory;
+        const std::string path = directory.GetPath() + "/bad.dmesh";
+        MeshBuffers source = MakeSquare();
+        source.Indices[4] = 4;
+        std::string error;
+        CHECK(!WriteMeshFile(path, source.GetView(), error));
+        CHECK(!error.empty());
+        CHECK(test::ReadFile(path).empty());
+    }
+}
+
+int main() {
+    TestRoundTrip();
+    TestWithoutAttributes();
+    TestCorruption();
+    TestWriteRejectsBadIndex();
+    return TEST_RESULT();
+}
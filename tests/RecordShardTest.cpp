@@ -0,0 +1,148 @@
+#include "RecordShard.h"
+#include "TestSupport.h"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+
+namespace {
+    std::string ShardPath(const std::string& directory, int shard) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/part-%05d.rec", shard);
+        return directory + name;
+    }
+
+    std::vector<RecordField> MakeFields(std::uint64_t key, std::size_t size) {
+        RecordField field;
+        field.Name = "data";
+        field.Bytes.resize(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            field.Bytes[i] = static_cast<unsigned char>(key * 31 + i);
+        }
+        return {field};
+    }
+
+    // Читает шард так же, как читатель набора: заголовок, индекс и поле "data" каждой записи.
+    bool ReadShard(const std::string& path, std::size_t fieldSize, std::vector<std::uint64_t>& keys) {
+        const std::vector<unsigned char> file = test::ReadFile(path);
+        if (file.size() < sizeof(RecordShardHeader)) {
+            return false;
+        }
+        RecordShardHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        if (std::memcmp(header.Magic, "DOCSHARD", 8) != 0 || header.Version != 1 || header.FileSize != file.size() ||
+            header.IndexOffset + header.RecordCount * sizeof(RecordIndexEntry) != file.size()) {
+            return false;
+        }
+        for (std::uint64_t k = 0; k < header.RecordCount; ++k) {
+            RecordIndexEntry entry;
+            std::memcpy(&entry, file.data() + header.IndexOffset + k * sizeof(entry), sizeof(entry));
+            RecordHeader record;
+            std::memcpy(&record, file.data() + entry.Offset, sizeof(record));
+            RecordFieldEntry field;
+            std::memcpy(&field, file.data() + entry.Offset + sizeof(record), sizeof(field));
+            if (entry.Offset % 64 != 0 || std::memcmp(record.Magic, "DREC", 4) != 0 || record.Key != entry.Key ||
+                record.FieldCount != 1 || std::strcmp(field.Name, "data") != 0 || field.Size != fieldSize) {
+                return false;
+            }
+            const std::vector<unsigned char> expected = MakeFields(entry.Key, fieldSize)[0].Bytes;
+            if (std::memcmp(file.data() + entry.Offset + field.Offset, expected.data(), fieldSize) != 0) {
+                return false;
+            }
+            keys.push_back(entry.Key);
+        }
+        return true;
+    }
+
+    bool Exists(const std::string& path) {
+        struct stat info {};
+        return stat(path.c_str(), &info) == 0;
+    }
+
+    // Запись занимает 64 байта заголовка и 256 байт поля, поэтому в шард на 1024 байта (с заголовком шарда)
+    // помещаются три записи, и 10 записей ложатся в шарды по 3, 3, 3 и 1.
+    void TestRollover() {
+        test::TemporaryDirectory directory;
+        {
+            RecordShardWriter writer(directory.GetPath(), "part", 1024);
+            std::string error;
+            for (std::uint64_t key = 0; key < 10; ++key) {
+                CHECK(writer.Append(key, MakeFields(key, 200), error));
+            }
+            CHECK(writer.Close(error));
+            CHECK(writer.GetShardCount() == 4);
+            CHECK(writer.GetRecordCount() == 10);
+            CHECK(writer.TakeLostKeys().empty());
+        }
+        const std::size_t expected[] = {3, 3, 3, 1};
+        std::vector<std::uint64_t> keys;
+        for (int shard = 0; shard < 4; ++shard) {
+            const std::size_t before = keys.size();
+            CHECK(ReadShard(ShardPath(directory.GetPath(), shard), 200, keys));
+            CHECK(keys.size() - before == expected[shard]);
+            CHECK(!Exists(ShardPath(directory.GetPath(), shard) + ".tmp"));
+        }
+        CHECK((keys == std::vector<std::uint64_t>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}));
+        CHECK(!Exists(ShardPath(directory.GetPath(), 4)));
+    }
+
+    void TestRejectedRecord() {
+        test::TemporaryDirectory directory;
+        RecordShardWriter writer(directory.GetPath(), "part", 1024);
+        std::string error;
+        std::vector<RecordField> fields = MakeFields(7, 10);
+        fields[0].Name = "a-field-name-longer-than-23";
+        CHECK(!writer.Append(7, fields, error));
+        CHECK(!error.empty());
+        CHECK((writer.TakeLostKeys() == std::vector<std::uint64_t>{7}));
+        CHECK(writer.TakeLostKeys().empty());
+    }
+
+    void TestUnwritableDirectory() {
+        test::TemporaryDirectory directory;
+        // Каталог набора не создать: на его месте обычный файл.
+        const std::string blocked = directory.GetPath() + "/file";
+        std::fclose(std::fopen(blocked.c_str(), "w"));
+        RecordShardWriter writer(blocked + "/dataset", "part", 1024);
+        std::string error;
+        CHECK(!writer.Append(3, MakeFields(3, 10), error));
+        CHECK((writer.TakeLostKeys() == std::vector<std::uint64_t>{3}));
+        CHECK(writer.GetRecordCount() == 0);
+    }
+
+    // Заполненный шард не закрывается (его имя занято каталогом): его записи потеряны,
+    // а запись, из-за которой шард закрывался, уходит в следующий.
+    void TestRolloverCloseFailure() {
+        test::TemporaryDirectory directory;
+        std::vector<std::uint64_t> keys;
+        {
+            RecordShardWriter writer(directory.GetPath(), "part", 1024);
+            std::string error;
+            for (std::uint64_t key = 0; key < 3; ++key) {
+                CHECK(writer.Append(key, MakeFields(key, 200), error));
+            }
+            CHECK(mkdir(ShardPath(directory.GetPath(), 0).c_str(), 0755) == 0);
+            CHECK(writer.Append(3, MakeFields(3, 200), error));
+            CHECK(!error.empty());
+            CHECK((writer.TakeLostKeys() == std::vector<std::uint64_t>{0, 1, 2}));
+            CHECK(writer.GetRecordCount() == 1);
+            error.clear();
+            CHECK(writer.Close(error));
+            CHECK(writer.TakeLostKeys().empty());
+        }
+        CHECK(!Exists(ShardPath(directory.GetPath(), 0) + ".tmp"));
+        CHECK(ReadShard(ShardPath(directory.GetPath(), 1), 200, keys));
+        CHECK((keys == std::vector<std::uint64_t>{3}));
+    }
+}
+
+int main() {
+    TestRollover();
+    TestRejectedRecord();
+    TestUnwritableDirectory();
+    TestRolloverCloseFailure();
+    return TEST_RESULT();
+}
@@ -0,0 +1,66 @@
+#ifndef TEST_SUPPORT_H
+#define TEST_SUPPORT_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <ftw.h>
+
+// Проверки тестов: невыполненное условие печатается с местом и засчитывается как ошибка,
+// а TEST_RESULT в конце main превращает их число в код возврата для ctest.
+namespace test {
+    inline int& Failures() {
+        static int failures = 0;
+        return failures;
+    }
+
+    // Временный каталог, удаляемый вместе с содержимым.
+    class TemporaryDirectory {
+    public:
+        TemporaryDirectory() {
+            const char* base = std::getenv("TMPDIR");
+            std::string pattern = std::string(base != nullptr ? base : "/tmp") + "/docrender-test-XXXXXX";
+            if (mkdtemp(&pattern[0]) != nullptr) {
+                this->Path = pattern;
+            }
+        }
+
+        ~TemporaryDirectory() {
+            if (!this->Path.empty()) {
+                nftw(this->Path.c_str(), [](const char* path, const struct stat*, int, struct FTW*) {
+                    return std::remove(path);
+                }, 16, FTW_DEPTH | FTW_PHYS);
+            }
+        }
+
+        TemporaryDirectory(const TemporaryDirectory&) = delete;
+        TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+        const std::string& GetPath() const { return this->Path; }
+
+    private:
+        std::string Path;
+    };
+
+    inline std::vector<unsigned char> ReadFile(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<unsigned char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+}
+
+#define CHECK(condition)                                                                                   \
+    do {                                                                                                   \
+        if (!(condition)) {                                                                                \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl;       \
+            ++test::Failures();                                                                            \
+        }                                                                                                  \
+    } while (false)
+
+#define TEST_RESULT() (test::Failures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+#endif // TEST_SUPPORT_H